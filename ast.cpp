@@ -11,13 +11,186 @@ Date 26/01/2025
 #define AST_CPP
 
 #include "ast.hpp"
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// Symbol table
+static std::unordered_map<std::string, int> symbolIds;
+static std::vector<std::string> symbolNames;
+
+// Where each name falls in name order, so O-2 compares two numbers rather than two strings. The ranks are spaced out and a new name
+// takes one between its neighbours; a name past the last (or before the first) takes one a fixed step on, so names that turn up
+// already sorted, x1, x2, ..., don't halve the room each time. If two neighbours have nothing left between them all of them are
+// spread out evenly again
+static std::map<std::string, int> symbolsByName;
+static std::vector<u64> symbolRanks;
+static const u64 RANK_STEP = u64(1) << 32;
+
+static void spreadRanks() {
+    u64 step = UINT64_MAX / (symbolsByName.size() + 1);
+    u64 rank = 0;
+    for (const auto& entry : symbolsByName) symbolRanks[entry.second] = rank += step;
+}
+
+int internSymbol(const std::string& name) {
+    auto it = symbolIds.find(name);
+    if (it != symbolIds.end()) return it->second;
+
+    int id = static_cast<int>(symbolNames.size());
+    symbolIds.emplace(name, id);
+    symbolNames.push_back(name);
+    symbolRanks.push_back(0);
+
+    auto at = symbolsByName.emplace(name, id).first;
+    auto next = std::next(at);
+    bool first = at == symbolsByName.begin(), last = next == symbolsByName.end();
+    u64 lo = first ? 0 : symbolRanks[std::prev(at)->second];
+    u64 hi = last ? UINT64_MAX : symbolRanks[next->second];
+    if (hi - lo < 2) {
+        spreadRanks();
+        return id;
+    }
+    u64 half = (hi - lo) / 2;
+    if (last && !first) symbolRanks[id] = lo + std::min(half, RANK_STEP);
+    else if (first && !last) symbolRanks[id] = hi - std::min(half, RANK_STEP);
+    else symbolRanks[id] = lo + half;
+    return id;
+}
+
+const std::string& symbolName(int id) { return symbolNames[id]; }
+u64 symbolRank(int id) { return symbolRanks[id]; }
+size_t symbolCount() { return symbolNames.size(); }
+
+// The variable bitset is exact while there are at most 64 symbols, after that a set bit only means "maybe" and we walk to make sure
+bool freeOf(const ExpressionNode* node, int symbol) {
+    const Synopsis& syn = node->getSynopsis();
+    if ((syn.Vars & symbolBit(symbol)) == 0) return true;
+    if (symbolCount() <= 64) return false;
+
+    switch (node->Key.Rank) {
+        case OrderRank::CONSTANT:
+        case OrderRank::REAL: return true;
+        case OrderRank::SYMBOL: return node->Key.Symbol != symbol;
+        case OrderRank::PRODUCT:
+        case OrderRank::SUM: {
+            for (const auto& op : static_cast<const NaryExpressionNode*>(node)->Operands) {
+                if (!freeOf(op.get(), symbol)) return false;
+            }
+            return true;
+        }
+        default: break;
+    }
 
+    if (node->Key.Kind == InfixKind::PRE_MINUS) {
+        return freeOf(static_cast<const PrefixExpressionNode*>(node)->Right.get(), symbol);
+    }
+    const auto* infix = static_cast<const InfixExpressionNode*>(node);
+    return freeOf(infix->Left.get(), symbol) && freeOf(infix->Right.get(), symbol);
+}
 
+bool sameTree(const ExpressionNode* a, const ExpressionNode* b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    if (a->getSynopsis().Hash != b->getSynopsis().Hash || a->getKind() != b->getKind()) return false;
+
+    switch (a->getKind()) {
+        case InfixKind::NUM:
+            return static_cast<const NumberExpressionNode*>(a)->Value == static_cast<const NumberExpressionNode*>(b)->Value;
+
+        case InfixKind::REAL:
+            return a->Key.Real == b->Key.Real;
+
+        case InfixKind::VAR:
+            return a->Key.Symbol == b->Key.Symbol;
+
+        case InfixKind::PRE_MINUS: {
+            auto* pa = static_cast<const PrefixExpressionNode*>(a);
+            auto* pb = static_cast<const PrefixExpressionNode*>(b);
+            return pa->Operator == pb->Operator && sameTree(pa->Right.get(), pb->Right.get());
+        }
+
+        case InfixKind::PLUS:
+        case InfixKind::MULTIPLY: {
+            // the parser builds these as infix nodes before they're flattened
+            auto* na = dynamic_cast<const NaryExpressionNode*>(a);
+            auto* nb = dynamic_cast<const NaryExpressionNode*>(b);
+            if (na && nb) {
+                if (na->Operands.size() != nb->Operands.size()) return false;
+                for (size_t i = 0; i < na->Operands.size(); i++) {
+                    if (na->coeff(i) != nb->coeff(i) || !sameTree(na->Operands[i].get(), nb->Operands[i].get())) return false;
+                }
+                return true;
+            }
+            if (na || nb) return false;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    auto* ia = static_cast<const InfixExpressionNode*>(a);
+    auto* ib = static_cast<const InfixExpressionNode*>(b);
+    return ia->Operator == ib->Operator && sameTree(ia->Left.get(), ib->Left.get()) && sameTree(ia->Right.get(), ib->Right.get());
+}
+
+// mixes v into a running structural hash (the splitmix64 finaliser)
+static u64 mixHash(u64 h, u64 v) {
+    h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// combine a child's synopsis into its parent's
+static void addChildSynopsis(Synopsis& parent, const Synopsis& child) {
+    parent.Hash = mixHash(parent.Hash, child.Hash);
+    parent.Vars |= child.Vars;
+    parent.Size += child.Size;
+    parent.Depth = std::max(parent.Depth, child.Depth + 1);
+    parent.Expandable = parent.Expandable || child.Expandable;
+}
+
+// degrees only ever grow, so one too big to count is left at INT64_MAX, still more than any packed exponent can hold
+static i64 saturatedDegree(i128 degree) { return degree > INT64_MAX ? INT64_MAX : static_cast<i64>(degree); }
 
 
 
 // Number Node
-NumberExpressionNode::NumberExpressionNode(Token tok, int Val, InfixKind Kind) : Tok(tok), Value(Val), Kind(Kind) {}
+NumberExpressionNode::NumberExpressionNode(Token tok, i64 Val, InfixKind Kind) : Tok(tok), Value(Val), Kind(Kind) {
+    Key.Rank = OrderRank::CONSTANT;
+    Key.Kind = Kind;
+    Key.Value = Rational(Val);
+}
+
+NumberExpressionNode::NumberExpressionNode(Token tok, double Val) : Tok(tok), Value(0), Kind(InfixKind::REAL), Real(Val) {
+    Key.Rank = OrderRank::REAL;
+    Key.Kind = Kind;
+    Key.Real = Val;
+}
+
+Synopsis NumberExpressionNode::computeSynopsis() const {
+    Synopsis syn;
+    u64 bits = static_cast<u64>(Value);
+    if (Kind == InfixKind::REAL) std::memcpy(&bits, &Real, sizeof(bits));
+    syn.Hash = mixHash(static_cast<u64>(Kind), bits);
+    return syn;
+}
+
+// 15 digits is enough for most, the rest need all 17
+std::string realLiteral(double x) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", x);
+    if (std::strtod(buffer, nullptr) != x) std::snprintf(buffer, sizeof(buffer), "%.17g", x);
+    return buffer;
+}
 
 std::string NumberExpressionNode::TokenLiteral() const { return Tok.Literal; }
 std::string NumberExpressionNode::String() const { return Tok.Literal; }
@@ -30,7 +203,19 @@ void NumberExpressionNode::accept(ExprMutableVisitor& visitor) {visitor.visit(*t
 
 
 // Variable Node
-VariableExpressionNode::VariableExpressionNode(const std::string &Name, Token &tok, InfixKind Kind) : Value(Name), Tok(tok), Kind(Kind)  {}
+VariableExpressionNode::VariableExpressionNode(const std::string &Name, Token &tok, InfixKind Kind) : Value(Name), Tok(tok), Kind(Kind)  {
+    Key.Rank = OrderRank::SYMBOL;
+    Key.Kind = Kind;
+    Key.Symbol = internSymbol(Name);
+}
+
+Synopsis VariableExpressionNode::computeSynopsis() const {
+    Synopsis syn;
+    syn.Vars = symbolBit(Key.Symbol);
+    syn.Degree = 1;
+    syn.Hash = mixHash(static_cast<u64>(Kind), static_cast<u64>(Key.Symbol));
+    return syn;
+}
 
 std::string VariableExpressionNode::TokenLiteral() const { return Tok.Literal; };
 std::string VariableExpressionNode::String() const { return Value; };
@@ -44,7 +229,20 @@ void VariableExpressionNode::accept(ExprMutableVisitor& visitor) {visitor.visit(
 
 // UNARY/PREFIX Node
 PrefixExpressionNode:: PrefixExpressionNode(char Op, Token &tok, InfixKind Kind, std::unique_ptr<ExpressionNode> Right) 
-        : Operator(Op), Tok(tok), Kind(Kind), Right(std::move(Right)) {}
+        : Operator(Op), Tok(tok), Kind(Kind), Right(std::move(Right)) {
+    Key.Kind = Kind;
+}
+
+Synopsis PrefixExpressionNode :: computeSynopsis() const {
+    Synopsis syn;
+    syn.Hash = mixHash(static_cast<u64>(Kind), static_cast<u64>(Operator));
+    if (!Right) return syn;
+
+    const Synopsis& right = Right->getSynopsis();
+    addChildSynopsis(syn, right);
+    syn.Degree = right.Degree;
+    return syn;
+}
 
 std::string PrefixExpressionNode :: TokenLiteral() const { return Tok.Literal; };
 InfixKind PrefixExpressionNode :: getKind() const  { return Kind; };
@@ -69,6 +267,33 @@ void PrefixExpressionNode :: accept(ExprMutableVisitor& visitor) {visitor.visit(
 
 // INFIX NODE
 
+Synopsis InfixExpressionNode :: computeSynopsis() const {
+    Synopsis syn;
+    syn.Hash = mixHash(static_cast<u64>(Kind), static_cast<u64>(Operator));
+    if (!Left || !Right) return syn;
+
+    const Synopsis& left = Left->getSynopsis();
+    const Synopsis& right = Right->getSynopsis();
+    addChildSynopsis(syn, left);
+    addChildSynopsis(syn, right);
+
+    if (Kind == InfixKind::DIVIDE || Kind == InfixKind::FRACTION) {
+        // only a polynomial if the denominator is constant
+        syn.Degree = (right.Vars == 0 && left.Degree >= 0) ? left.Degree : -1;
+    } else if (Kind == InfixKind::POWER) {
+        // x^n is a polynomial for a whole non negative n, anything else in the exponent isn't
+        const Rational& n = Right->Key.Value;
+        bool whole = Right->Key.Kind == InfixKind::NUM && n.num >= 0;
+        syn.Degree = (whole && left.Degree >= 0) ? saturatedDegree(static_cast<i128>(left.Degree) * n.num) : -1;
+        if (whole && n.num > 1 && Left->Key.Kind == InfixKind::PLUS) syn.Expandable = true;
+    } else if (left.Degree < 0 || right.Degree < 0) {
+        syn.Degree = -1;
+    } else {
+        syn.Degree = std::max(left.Degree, right.Degree);
+    }
+    return syn;
+}
+
 std::string InfixExpressionNode :: TokenLiteral() const { return Tok.Literal; };
 InfixKind  InfixExpressionNode :: getKind() const { return Kind; };
 std::string InfixExpressionNode :: String() const { 
@@ -87,7 +312,16 @@ std::string InfixExpressionNode :: String() const {
 
 
 InfixExpressionNode :: InfixExpressionNode(Token &tok, char Op, InfixKind Kind, std::unique_ptr<ExpressionNode> Left, std::unique_ptr<ExpressionNode> Right) 
-        : Tok(tok), Operator(Op), Kind(Kind), Left(std::move(Left)), Right(std::move(Right)) {}
+        : Tok(tok), Operator(Op), Kind(Kind), Left(std::move(Left)), Right(std::move(Right)) {
+    Key.Kind = Kind;
+
+    // fractions are constants, cache their value so ordering doesn't have to dig through the children
+    if (Kind == InfixKind::FRACTION && this->Left && this->Right && 
+        this->Left->Key.Kind == InfixKind::NUM && this->Right->Key.Kind == InfixKind::NUM && !this->Right->Key.Value.isZero()) {
+        Key.Rank = OrderRank::CONSTANT;
+        Key.Value = this->Left->Key.Value / this->Right->Key.Value;
+    }
+}
 
 void InfixExpressionNode :: accept(ExprVisitor& visitor) const  {visitor.visit(*this);}
 void InfixExpressionNode :: accept(ExprMutableVisitor& visitor)  {visitor.visit(*this);}
@@ -96,18 +330,86 @@ void InfixExpressionNode :: accept(ExprMutableVisitor& visitor)  {visitor.visit(
 
 
 // Nary expression node
-NaryExpressionNode :: NaryExpressionNode(Token &tok, char Op, InfixKind Kind, std::vector<std::unique_ptr<ExpressionNode>> ops)
-: Tok(tok), Operator(Op), Kind(Kind), Operands(std::move(ops)) {}
+NaryExpressionNode :: NaryExpressionNode(Token &tok, char Op, InfixKind Kind, std::vector<std::unique_ptr<ExpressionNode>> ops, std::vector<Rational> coeffs)
+: Tok(tok), Operator(Op), Kind(Kind), Operands(std::move(ops)), Coeffs(std::move(coeffs)) {
+    Key.Kind = Kind;
+    if (Kind == InfixKind::MULTIPLY) Key.Rank = OrderRank::PRODUCT;
+    else if (Kind == InfixKind::PLUS) Key.Rank = OrderRank::SUM;
+}
+
+Synopsis NaryExpressionNode :: computeSynopsis() const {
+    Synopsis syn;
+    syn.Hash = mixHash(static_cast<u64>(Kind), KIND_COUNT);    // not an operator character, so it can't match the infix form
+
+    for (const auto& op : Operands) {
+        if (!op) continue;
+        const Synopsis& child = op->getSynopsis();
+        addChildSynopsis(syn, child);
+
+        // annotations of 1 left out, the same as no annotations at all
+        Rational c = coeff(&op - Operands.data());
+        if (!c.isOne()) syn.Hash = mixHash(mixHash(syn.Hash, static_cast<u64>(c.num)), static_cast<u64>(c.den));
+
+        if (syn.Degree < 0 || child.Degree < 0) {
+            syn.Degree = -1;
+        } else if (Kind == InfixKind::MULTIPLY) {
+            // x^e only stays a polynomial for whole non negative exponents
+            Rational e = coeff(&op - Operands.data());
+            if (child.Vars == 0) {
+                // constant base, degree doesn't change
+            } else if (e.isInteger() && e.num >= 0) {
+                syn.Degree = saturatedDegree(syn.Degree + static_cast<i128>(child.Degree) * e.num);
+            } else {
+                syn.Degree = -1;
+            }
+        } else {
+            syn.Degree = std::max(syn.Degree, child.Degree);
+        }
+
+        // a sum times something, or a sum raised to a whole power
+        if (Kind == InfixKind::MULTIPLY && op->Key.Kind == InfixKind::PLUS) {
+            Rational e = coeff(&op - Operands.data());
+            if (e.isInteger() && e.num > 0) syn.Expandable = true;
+        }
+    }
+    return syn;
+}
 
 std::string NaryExpressionNode :: TokenLiteral() const { return Tok.Literal; }
 InfixKind NaryExpressionNode :: getKind() const { return Kind; }
 
 
+// Print an operand with its annotation, so a sum term 3·x comes out as (3 * x) and a product factor x² as (x ^ 2), the same as the unannotated tree would
+static void writeAnnotatedOperand(std::ostringstream& oss, InfixKind kind, const ExpressionNode* op, const Rational& c) {
+    if (c.isOne()) {
+        oss << op->String();
+    } else if (kind == InfixKind::PLUS) {
+        oss << "(" << c.String() << " * ";
+        if (op->Key.Kind == InfixKind::MULTIPLY && static_cast<const NaryExpressionNode*>(op)->Operands.size() > 1) {
+            // splice the factors in, (3 * x * y) rather than (3 * (x * y))
+            std::string inner = op->String();
+            oss << inner.substr(1, inner.size() - 2);
+        } else {
+            oss << op->String();
+        }
+        oss << ")";
+    } else {
+        oss << "(" << op->String() << " ^ " << c.String() << ")";
+    }
+}
+
 std::string NaryExpressionNode :: String() const {
     std::ostringstream oss;
+
+    // a single annotated operand is just a scaled term or a power
+    if (Operands.size() == 1 && !coeff(0).isOne()) {
+        writeAnnotatedOperand(oss, Kind, Operands[0].get(), coeff(0));
+        return oss.str();
+    }
+
     oss << "(";
     for (size_t i = 0; i < Operands.size(); i++) {
-        oss << Operands[i]->String();
+        writeAnnotatedOperand(oss, Kind, Operands[i].get(), coeff(i));
         if (i != Operands.size() - 1) oss << " " << Operator << " ";
     }
     oss << ")";
@@ -26,18 +26,51 @@ enum class InfixKind;
 #include <sstream>
 #include "token.hpp"
 #include "visitors.hpp"
+#include "rational.hpp"
 
 
 
 
 using u64 = uint64_t;
 
-enum class InfixKind {PLUS, MULTIPLY, POWER, DIFFERENCE, DIVIDE, FRACTION, NUM, VAR, PRE_MINUS};
+enum class InfixKind {PLUS, MULTIPLY, POWER, DIFFERENCE, DIVIDE, FRACTION, NUM, VAR, REAL, PRE_MINUS};
+constexpr size_t KIND_COUNT = static_cast<size_t>(InfixKind::PRE_MINUS) + 1;   // keep PRE_MINUS last, tables are sized off it
+
+// Symbol table, every variable name gets a small integer id the first time it's seen so nodes can be compared without strings
+int internSymbol(const std::string& name);
+const std::string& symbolName(int id);
+u64 symbolRank(int id);            // a before b in name order exactly when symbolRank(a) < symbolRank(b)
+size_t symbolCount();
+
+// Which group of the order relation a node falls in (p.g.84), constants first. REAL is a double, a constant too but without an
+// exact Value, so it's kept apart from the integers and fractions everything else folds exactly
+enum class OrderRank {CONSTANT, REAL, SYMBOL, PRODUCT, SUM, OTHER};
+
+// Ordering key, filled in by the constructors so operandCompare only reads plain fields instead of calling String() or getKind()
+struct OrderKey {
+    OrderRank Rank {OrderRank::OTHER};
+    InfixKind Kind {InfixKind::NUM};
+    int Symbol {-1};        // interned id, symbols only
+    Rational Value;         // integers and fractions only
+    double Real {0.0};      // reals only
+};
+
 
+// Summary of a subtree so questions like "is this constant" or "does this contain x" don't need a walk.
+// Computed bottom up the first time it's asked for and then cached, so a node shouldn't be mutated after that (the simplifier builds new nodes anyway)
+struct Synopsis {
+    u64 Vars {0};           // bit (id % 64) set for every interned symbol in the subtree
+    i64 Degree {0};         // total polynomial degree, -1 if it isn't a polynomial (e.g. variable in a denominator)
+    int Size {1};           // node count
+    int Depth {1};
+    bool Expandable {false};    // a product somewhere below has a sum operand, i.e. expand_tree has something to do
+    u64 Hash {0};               // structural, trees that are the same (see sameTree) hash the same
+};
 
 // Base class for all expressions
 class ExpressionNode {
     public: 
+        OrderKey Key;
     
         virtual ~ExpressionNode() = default;
         
@@ -45,18 +78,48 @@ class ExpressionNode {
         virtual std::string String() const = 0;
         virtual InfixKind getKind() const = 0;
 
+        const Synopsis& getSynopsis() const {
+            if (!synopsisValid) {
+                synopsis = computeSynopsis();
+                synopsisValid = true;
+            }
+            return synopsis;
+        }
+
         virtual void accept(ExprVisitor& visitor) const  = 0;
         virtual void accept(ExprMutableVisitor& visitor) = 0;
+
+    protected:
+        virtual Synopsis computeSynopsis() const = 0;
+
+    private:
+        mutable Synopsis synopsis;
+        mutable bool synopsisValid {false};
 };
 
+// O(1) checks off the synopsis
+inline u64 symbolBit(int id) { return u64(1) << (id & 63); }
+inline bool isConstantExpr(const ExpressionNode* node) { return node->getSynopsis().Vars == 0; }
+bool freeOf(const ExpressionNode* node, int symbol);
+
+// same shape, operators, numbers, symbols and annotations all the way down. Different hashes turn most pairs down straight away
+bool sameTree(const ExpressionNode* a, const ExpressionNode* b);
+
+// the shortest text that reads back as x, for REAL nodes the simplifier makes
+std::string realLiteral(double x);
 
+
+// An integer (NUM) or a double (REAL). Decimals in the input come in as REAL, the simplifier makes them exact unless it's working
+// in doubles (see NumericDomain in simplifier.hpp)
 class NumberExpressionNode : public ExpressionNode {
     public:
         Token Tok;   
-        int Value;  //TODO:change this to a double when rewriting
+        i64 Value;  // NUM only, doubles are REAL
         InfixKind Kind;
+        double Real {0.0};  // REAL only
 
-        NumberExpressionNode(Token tok, int Val, InfixKind Kind);
+        NumberExpressionNode(Token tok, i64 Val, InfixKind Kind);
+        NumberExpressionNode(Token tok, double Val);
         
         std::string TokenLiteral() const override;
         std::string String() const override;
@@ -66,6 +129,9 @@ class NumberExpressionNode : public ExpressionNode {
         void accept(ExprMutableVisitor& visitor) override;
 
 
+
+    protected:
+        Synopsis computeSynopsis() const override;
 };
 
 class VariableExpressionNode : public ExpressionNode {
@@ -82,6 +148,9 @@ class VariableExpressionNode : public ExpressionNode {
 
         void accept(ExprVisitor& visitor) const override;
         void accept(ExprMutableVisitor& visitor) override;
+
+    protected:
+        Synopsis computeSynopsis() const override;
 };
 
 
@@ -102,6 +171,9 @@ class PrefixExpressionNode : public ExpressionNode {    //* RENAME TO UNARY
 
         void accept(ExprVisitor& visitor) const override;
         void accept(ExprMutableVisitor& visitor) override;
+
+    protected:
+        Synopsis computeSynopsis() const override;
 };
 
 class InfixExpressionNode : public ExpressionNode { //* RENAME TO BINARY WHEN YOU REDO EVERYTHING FOR DISSERATTION
@@ -120,6 +192,9 @@ class InfixExpressionNode : public ExpressionNode { //* RENAME TO BINARY WHEN YO
         
         void accept(ExprVisitor& visitor) const override;
         void accept(ExprMutableVisitor& visitor) override;
+
+    protected:
+        Synopsis computeSynopsis() const override;
 };
 
 
@@ -129,8 +204,14 @@ class NaryExpressionNode : public ExpressionNode {
         char Operator;
         InfixKind Kind;
         std::vector<std::unique_ptr<ExpressionNode>> Operands;  //TODO: a vector of unique pointers is not very good, all those pointers are allocated in random areas in memory, better to use an area allocator. Use areas when re writing everything for report
+        
+        // Annotation per operand. For a sum it's the coefficient of the term (3x + y is stored as [x, y] with [3, 1]),
+        // for a product it's the exponent of the base (x*x*y is [x, y] with [2, 1]). Empty means they're all 1, which is what the parser builds
+        std::vector<Rational> Coeffs;
 
-        NaryExpressionNode(Token &tok, char Op, InfixKind Kind, std::vector<std::unique_ptr<ExpressionNode>> ops);
+        NaryExpressionNode(Token &tok, char Op, InfixKind Kind, std::vector<std::unique_ptr<ExpressionNode>> ops, std::vector<Rational> coeffs = {});
+
+        Rational coeff(size_t i) const { return Coeffs.empty() ? Rational(1) : Coeffs[i]; }
 
         std::string TokenLiteral() const override;
         InfixKind getKind() const override;
@@ -138,6 +219,9 @@ class NaryExpressionNode : public ExpressionNode {
 
         void accept(ExprVisitor& visitor) const override;
         void accept(ExprMutableVisitor& visitor) override;
+
+    protected:
+        Synopsis computeSynopsis() const override;
 };
 
 
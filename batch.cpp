@@ -0,0 +1,190 @@
+/*
+batch.cpp
+*/
+
+#include "batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86 1
+#endif
+
+static const size_t BLOCK = 256;                        // rows at a time, a multiple of every vector width
+static const size_t MIN_ROWS_PER_THREAD = 1 << 16;      // less than this and starting a thread costs more than it saves
+
+// 4 and 8 doubles. Arithmetic on these is plain +, -, *, / and GCC turns it into whatever the function it ends up in is built for,
+// so the one runBlock below becomes AVX2 or AVX-512 code depending on which wrapper it's inlined into. Only 8 byte aligned since the
+// columns are the caller's, and never passed to or returned from a function, which would tie them to one ABI. They're handed to
+// runBlock inside a struct because attributes on a template argument itself are dropped
+typedef double Vec4Aligned __attribute__((vector_size(32)));
+typedef double Vec8Aligned __attribute__((vector_size(64)));
+
+struct ScalarLanes { typedef double V; };
+struct Avx2Lanes { typedef Vec4Aligned V __attribute__((aligned(8), may_alias)); };
+struct Avx512Lanes { typedef Vec8Aligned V __attribute__((aligned(8), may_alias)); };
+
+// every instruction over len rows (a multiple of the width) before the next. reg[r] is where register r's rows are for this block
+template<typename Lanes>
+static inline __attribute__((always_inline)) void runBlock(const Instruction* code, size_t count, double* const* reg, size_t len) {
+    typedef typename Lanes::V V;
+    const size_t lanes = len / (sizeof(V) / sizeof(double));
+
+    for (const Instruction* in = code; in != code + count; in++) {
+        V* d = reinterpret_cast<V*>(reg[in->Dst]);
+        const V* a = reinterpret_cast<const V*>(reg[in->A]);
+        const V* b = reinterpret_cast<const V*>(reg[in->B]);
+
+        switch (in->Code) {
+            case OpCode::ADD: for (size_t i = 0; i < lanes; i++) d[i] = a[i] + b[i]; break;
+            case OpCode::SUB: for (size_t i = 0; i < lanes; i++) d[i] = a[i] - b[i]; break;
+            case OpCode::MUL: for (size_t i = 0; i < lanes; i++) d[i] = a[i] * b[i]; break;
+            case OpCode::DIV: for (size_t i = 0; i < lanes; i++) d[i] = a[i] / b[i]; break;
+            case OpCode::NEG: for (size_t i = 0; i < lanes; i++) d[i] = -a[i]; break;
+
+            case OpCode::POWI: {
+                // by squaring in every lane at once, the exponent is the same for all of them
+                int32_t n = in->Power;
+                u64 magnitude = n < 0 ? -static_cast<i64>(n) : n;
+                for (size_t i = 0; i < lanes; i++) {
+                    V base = a[i];
+                    V result = V{} + 1.0;
+                    for (u64 m = magnitude; m > 0; m >>= 1) {
+                        if (m & 1) result *= base;
+                        base *= base;
+                    }
+                    d[i] = n < 0 ? 1.0 / result : result;
+                }
+                break;
+            }
+
+            case OpCode::POW: {
+                // no vector pow, it's rare enough (fractional exponents) to go a row at a time
+                double* dd = reg[in->Dst];
+                const double* aa = reg[in->A];
+                const double* bb = reg[in->B];
+                for (size_t i = 0; i < len; i++) dd[i] = std::pow(aa[i], bb[i]);
+                break;
+            }
+        }
+    }
+}
+
+static void blockScalar(const Instruction* code, size_t count, double* const* reg, size_t len) {
+    runBlock<ScalarLanes>(code, count, reg, len);
+}
+
+#ifdef BATCH_X86
+__attribute__((target("avx2")))
+static void blockAvx2(const Instruction* code, size_t count, double* const* reg, size_t len) {
+    runBlock<Avx2Lanes>(code, count, reg, len);
+}
+
+__attribute__((target("avx512f")))
+static void blockAvx512(const Instruction* code, size_t count, double* const* reg, size_t len) {
+    runBlock<Avx512Lanes>(code, count, reg, len);
+}
+#endif
+
+using BlockFn = void (*)(const Instruction*, size_t, double* const*, size_t);
+
+static BlockFn blockFunction(BatchKernel kernel) {
+#ifdef BATCH_X86
+    if (kernel == BatchKernel::AVX512) return blockAvx512;
+    if (kernel == BatchKernel::AVX2) return blockAvx2;
+#endif
+    return blockScalar;
+}
+
+BatchKernel batchKernel() {
+#ifdef BATCH_X86
+    static const BatchKernel best = __builtin_cpu_supports("avx512f") ? BatchKernel::AVX512
+                                  : __builtin_cpu_supports("avx2")    ? BatchKernel::AVX2
+                                  : BatchKernel::SCALAR;
+    return best;
+#else
+    return BatchKernel::SCALAR;
+#endif
+}
+
+const char* batchKernelName(BatchKernel kernel) {
+    switch (kernel) {
+        case BatchKernel::AVX512: return "avx512";
+        case BatchKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// rows [begin, end) on this thread. Variable registers point straight into the columns, constants and temporaries get a block's
+// worth of rows each. The last block, if it's short, has its values copied into padding so the kernel can still run whole vectors
+static void evaluateRows(const Bytecode& code, const double* const* columns, size_t begin, size_t end, double* out, BlockFn block) {
+    size_t vars = code.symbols().size();
+    size_t consts = code.constants().size();
+    size_t regs = code.registers();
+    const std::vector<Instruction>& program = code.instructions();
+    size_t result = code.result();
+
+    // constants and temporaries, then the padded copies of the variables for the short block
+    std::vector<double> storage(regs * BLOCK, 0.0);
+    std::vector<double*> reg(regs);
+    for (size_t r = vars; r < regs; r++) reg[r] = storage.data() + (r - vars) * BLOCK;
+    for (size_t k = 0; k < consts; k++) std::fill(reg[vars + k], reg[vars + k] + BLOCK, code.constants()[k]);
+    double* padding = storage.data() + (regs - vars) * BLOCK;
+    double* temp_result = result >= vars + consts ? reg[result] : nullptr;
+
+    for (size_t row = begin; row < end; row += BLOCK) {
+        size_t rows = std::min(BLOCK, end - row);
+
+        if (rows == BLOCK) {
+            // only ever read, the const goes because reg has the temporaries in it too
+            for (size_t v = 0; v < vars; v++) reg[v] = const_cast<double*>(columns[v] + row);
+
+            // a temporary result is written straight into out
+            if (temp_result) {
+                reg[result] = out + row;
+                block(program.data(), program.size(), reg.data(), BLOCK);
+                reg[result] = temp_result;
+            } else {
+                block(program.data(), program.size(), reg.data(), BLOCK);
+                std::copy(reg[result], reg[result] + BLOCK, out + row);
+            }
+            continue;
+        }
+
+        for (size_t v = 0; v < vars; v++) {
+            reg[v] = padding + v * BLOCK;
+            std::copy(columns[v] + row, columns[v] + row + rows, reg[v]);
+        }
+        size_t len = (rows + 7) & ~size_t(7);
+        block(program.data(), program.size(), reg.data(), len);
+        std::copy(reg[result], reg[result] + rows, out + row);
+    }
+}
+
+void evaluateBatch(const Bytecode& code, const double* const* columns, size_t n, double* out, unsigned threads) {
+    evaluateBatch(code, columns, n, out, threads, batchKernel());
+}
+
+void evaluateBatch(const Bytecode& code, const double* const* columns, size_t n, double* out, unsigned threads, BatchKernel kernel) {
+    if (static_cast<int>(kernel) > static_cast<int>(batchKernel())) kernel = batchKernel();
+    BlockFn block = blockFunction(kernel);
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t parts = std::min<size_t>(threads, n / MIN_ROWS_PER_THREAD);
+    if (parts <= 1) {
+        evaluateRows(code, columns, 0, n, out, block);
+        return;
+    }
+
+    // whole blocks per thread, the calling thread takes the first share
+    size_t share = ((n + parts - 1) / parts + BLOCK - 1) / BLOCK * BLOCK;
+    std::vector<std::thread> workers;
+    for (size_t begin = share; begin < n; begin += share) {
+        workers.emplace_back(evaluateRows, std::cref(code), columns, begin, std::min(n, begin + share), out, block);
+    }
+    evaluateRows(code, columns, 0, std::min(n, share), out, block);
+    for (auto& worker : workers) worker.join();
+}
@@ -0,0 +1,32 @@
+/*
+batch.hpp
+
+Evaluating one compiled expression (see bytecode.hpp) over many sets of variable values at once, for parameter sweeps. The values
+come as columns, one contiguous array per variable in the Bytecode's symbols() order, and the results go in one more.
+
+Rather than running the whole program once per row, the rows are taken in blocks and each instruction is run across the whole
+block before moving on to the next, so the switch is paid once per block and the inner loop is straight arithmetic on contiguous
+doubles. That loop is written once on GCC vector types and built three times, plain, AVX2 and AVX-512, with the widest one the
+machine has picked when the program starts. Big batches are split across threads, each with its own registers.
+*/
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <cstddef>
+#include "bytecode.hpp"
+
+enum class BatchKernel {SCALAR, AVX2, AVX512};
+
+// the widest kernel this machine can run
+BatchKernel batchKernel();
+const char* batchKernelName(BatchKernel kernel);
+
+// columns[i] has n values for code.symbols()[i], out gets n results. threads 0 means one per core, batches too small to be
+// worth splitting run on the calling thread either way
+void evaluateBatch(const Bytecode& code, const double* const* columns, size_t n, double* out, unsigned threads = 0);
+
+// the same with the kernel chosen, one the machine can't run falls back to the widest it can
+void evaluateBatch(const Bytecode& code, const double* const* columns, size_t n, double* out, unsigned threads, BatchKernel kernel);
+
+#endif
@@ -0,0 +1,611 @@
+/*
+bytecode.cpp
+*/
+
+#include "bytecode.hpp"
+#include "visitors.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+// While compiling, a register is a kind and an index in that kind, since how many variables and constants there are (and so where
+// the temporaries start) isn't known until the whole tree has been seen. They're turned into real register numbers at the end
+static const int VAR_REG = 0;
+static const int CONST_REG = 1 << 20;
+static const int TEMP_REG = 2 << 20;
+static const int REG_INDEX = (1 << 20) - 1;
+static const int MAX_REGISTERS = UINT16_MAX;
+
+
+// Optimising (Bytecode::compile's optimize) changes how a tree becomes instructions, not the tree:
+//  - a subtree that turns up more than once (by sameTree) is computed the first time and its register kept for the rest
+//  - a sum is treated as a polynomial in whatever its terms are built from (the atoms, x, y, (x + 1)^(1/2), ...) and evaluated in
+//    nested Horner form, pulling the atom that's in the most terms out of those terms, c0 + x(c1 + x(c2 + ...)), and again inside
+//  - each power of an atom is computed once, by squaring, and reused
+// The canonical form the simplifier leaves is sorted and expanded for comparing, which is about the most expensive way to evaluate
+// it, 3x^3 + 2x^2 + x + 5 is 10 operations as written and 6 in Horner form.
+
+// a term of a sum as c * atom1^e1 * atom2^e2 ..., the powers sorted by atom
+struct Monomial {
+    Rational Coeff {1};
+    std::vector<std::pair<int, int32_t>> Powers;
+
+    int32_t exponentOf(int atom) const {
+        for (const auto& [a, e] : Powers) {
+            if (a == atom) return e;
+        }
+        return 0;
+    }
+};
+
+// something a sum's terms are built from, node^Exp. Exp is 1 unless the node came with an exponent that isn't a positive whole
+// number, like y in x/y (y, -1), which then can't be factored out
+struct Atom {
+    const ExpressionNode* Node;
+    Rational Exp;
+    int Register {-1};
+};
+
+// One walk over the tree emitting instructions, each visit leaves the register its node ends up in in Out
+class BytecodeCompiler : public ExprVisitor {
+    public:
+        BytecodeCompiler(Bytecode& code, bool optimize) : Code(code), Optimize(optimize) {}
+
+        bool compile(const ExpressionNode* expr) {
+            if (Optimize) countSubtrees(expr);
+            int result = compileNode(expr);
+            if (Failed) return false;
+
+            int vars = static_cast<int>(Code.Symbols.size());
+            int consts = static_cast<int>(Code.ExactConstants.size());
+            if (vars + consts + Temps > MAX_REGISTERS) return false;
+
+            auto place = [&](int reg) {
+                int index = reg & REG_INDEX;
+                if (reg >= TEMP_REG) return static_cast<uint16_t>(vars + consts + index);
+                if (reg >= CONST_REG) return static_cast<uint16_t>(vars + index);
+                return static_cast<uint16_t>(index);
+            };
+
+            for (const Pending& p : Program) {
+                Code.Code.push_back(Instruction{p.Code, place(p.Dst), place(p.A), place(p.B), p.Power});
+            }
+            Code.Result = place(result);
+
+            Code.Registers.assign(vars + consts + Temps, 0.0);
+            Code.ExactRegisters.assign(vars + consts + Temps, Rational(0));
+            Code.IntervalRegisters.assign(vars + consts + Temps, Interval());
+            for (int i = 0; i < consts; i++) {
+                Code.Registers[vars + i] = Code.Constants[i];
+                Code.ExactRegisters[vars + i] = Code.ExactConstants[i];
+                Code.IntervalRegisters[vars + i] = Code.ExactConstants[i].den == 0 ? Interval(Code.Constants[i]) : exactInterval(Code.ExactConstants[i]);
+            }
+            return true;
+        }
+
+        void visit(const NumberExpressionNode& node) override {
+            if (node.Kind == InfixKind::REAL) {
+                Out = realConstant(node.Real);
+                return;
+            }
+            Out = constant(Rational(node.Value));
+        }
+
+        void visit(const VariableExpressionNode& node) override {
+            if (node.Value == "Undefined") {
+                Failed = true;
+                Out = constant(Rational(0));
+                return;
+            }
+            auto [it, added] = Slots.try_emplace(node.Key.Symbol, static_cast<int>(Code.Symbols.size()));
+            if (added) Code.Symbols.push_back(node.Key.Symbol);
+            Out = VAR_REG + it->second;
+        }
+
+        void visit(const PrefixExpressionNode& node) override {
+            int right = compileNode(node.Right.get());
+            Out = emit(OpCode::NEG, right, right);
+        }
+
+        void visit(const InfixExpressionNode& node) override {
+            // fractions have their value cached already
+            if (node.Key.Rank == OrderRank::CONSTANT) {
+                Out = constant(node.Key.Value);
+                return;
+            }
+
+            int32_t n;
+            if (node.Operator == '^' && wholeExponent(node.Right.get(), n)) {
+                int base = compileNode(node.Left.get());
+                Out = powerOf(base, n);
+                return;
+            }
+
+            int left = compileNode(node.Left.get());
+            int right = compileNode(node.Right.get());
+            switch (node.Operator) {
+                case '+': Out = emit(OpCode::ADD, left, right); break;
+                case '-': Out = emit(OpCode::SUB, left, right); break;
+                case '*': Out = emit(OpCode::MUL, left, right); break;
+                case '/': Out = emit(OpCode::DIV, left, right); break;
+                default:  Out = emit(OpCode::POW, left, right); break;
+            }
+        }
+
+        // sum: c1 u1 + c2 u2 + ..., with a multiply only where the coefficient isn't 1 or -1.
+        // product: u1^e1 * u2^e2 * ..., a negative whole exponent divides instead (x/y^2 rather than x * y^-2)
+        void visit(const NaryExpressionNode& node) override {
+            bool sum = node.Kind == InfixKind::PLUS;
+            if (sum && Optimize) {
+                Out = hornerSum(node);
+                return;
+            }
+
+            int acc = -1;
+            for (size_t i = 0; i < node.Operands.size(); i++) {
+                Rational c = node.coeff(i);
+                int term = compileNode(node.Operands[i].get());
+
+                if (sum) {
+                    acc = addTerm(acc, term, c);
+                    continue;
+                }
+
+                if (!c.isInteger() || c.num > INT32_MAX || c.num < -INT32_MAX) {
+                    term = emit(OpCode::POW, term, constant(c));
+                    acc = acc < 0 ? term : emit(OpCode::MUL, acc, term);
+                    continue;
+                }
+
+                int32_t e = static_cast<int32_t>(c.num);
+                if (acc < 0) {
+                    acc = powerOf(term, e);
+                } else {
+                    term = powerOf(term, e < 0 ? -e : e);
+                    acc = emit(e < 0 ? OpCode::DIV : OpCode::MUL, acc, term);
+                }
+            }
+
+            Out = acc >= 0 ? acc : constant(Rational(sum ? 0 : 1));
+        }
+
+    private:
+        struct Pending {
+            OpCode Code;
+            int Dst, A, B;
+            int32_t Power;
+        };
+
+        int compileNode(const ExpressionNode* u) {
+            if (!Optimize || u->getSynopsis().Size == 1 || Seen[u->getSynopsis().Hash] < 2) {
+                u->accept(*this);
+                return Out;
+            }
+
+            // a repeated subtree, the first copy is compiled and kept
+            auto& computed = Computed[u->getSynopsis().Hash];
+            for (const auto& [node, reg] : computed) {
+                if (sameTree(node, u)) return reg;
+            }
+            u->accept(*this);
+            int reg = Out;
+            pin(reg);
+            computed.push_back({u, reg});
+            return reg;
+        }
+
+        // how many times each subtree turns up, by hash. The inside of a repeat isn't counted again since it's only compiled once
+        void countSubtrees(const ExpressionNode* u) {
+            if (Seen[u->getSynopsis().Hash]++ > 0) return;
+
+            switch (u->getKind()) {
+                case InfixKind::NUM:
+                case InfixKind::REAL:
+                case InfixKind::VAR:
+                    return;
+                case InfixKind::PRE_MINUS:
+                    countSubtrees(static_cast<const PrefixExpressionNode*>(u)->Right.get());
+                    return;
+                default:
+                    break;
+            }
+            if (auto* nary = dynamic_cast<const NaryExpressionNode*>(u)) {
+                for (const auto& op : nary->Operands) countSubtrees(op.get());
+                return;
+            }
+            auto* infix = static_cast<const InfixExpressionNode*>(u);
+            countSubtrees(infix->Left.get());
+            countSubtrees(infix->Right.get());
+        }
+
+        // acc + c * term, acc < 0 for the first one
+        int addTerm(int acc, int term, const Rational& c) {
+            bool negative = c == Rational(-1);
+            if (!c.isOne() && !negative) term = emit(OpCode::MUL, constant(c), term);
+            if (acc < 0) return negative ? emit(OpCode::NEG, term, term) : term;
+            return emit(negative ? OpCode::SUB : OpCode::ADD, acc, term);
+        }
+
+        int hornerSum(const NaryExpressionNode& node) {
+            std::vector<Atom> atoms;
+            std::unordered_map<u64, std::vector<int>> atom_of;
+            std::vector<Monomial> terms;
+
+            for (size_t i = 0; i < node.Operands.size(); i++) {
+                Monomial term;
+                term.Coeff = node.coeff(i);
+                const ExpressionNode* u = node.Operands[i].get();
+                while (u->getKind() == InfixKind::PRE_MINUS) {
+                    term.Coeff = -term.Coeff;
+                    u = static_cast<const PrefixExpressionNode*>(u)->Right.get();
+                }
+                addFactor(u, Rational(1), term, atoms, atom_of);
+                std::sort(term.Powers.begin(), term.Powers.end());
+                terms.push_back(term);
+            }
+
+            // the atoms and their powers are let go once the sum is done, and their powers forgotten since the registers get reused
+            std::vector<int> pins;
+            int result = horner(terms, atoms, pins);
+            for (int reg : pins) {
+                if (!unpin(reg)) continue;
+                if (reg != result) Free.push_back(reg);
+                for (auto it = Powers.begin(); it != Powers.end();) {
+                    if (it->second == reg || it->first.first == reg) it = Powers.erase(it);
+                    else ++it;
+                }
+            }
+            return result;
+        }
+
+        // u^e into the term, a constant goes into the coefficient and a product is taken apart
+        void addFactor(const ExpressionNode* u, const Rational& e, Monomial& term, std::vector<Atom>& atoms,
+                       std::unordered_map<u64, std::vector<int>>& atom_of) {
+            bool whole = e.isInteger() && e.num > 0 && e.num <= INT32_MAX;
+
+            Rational scaled;
+            if (whole && u->Key.Rank == OrderRank::CONSTANT && powRational(u->Key.Value, e.num, scaled) &&
+                checkedMultiply(term.Coeff, scaled, term.Coeff)) {
+                return;
+            }
+
+            int32_t n;
+            if (whole && u->getKind() == InfixKind::POWER && wholeExponent(static_cast<const InfixExpressionNode*>(u)->Right.get(), n) &&
+                n > 0 && static_cast<i64>(n) * e.num <= INT32_MAX) {
+                addFactor(static_cast<const InfixExpressionNode*>(u)->Left.get(), Rational(n * e.num), term, atoms, atom_of);
+                return;
+            }
+
+            // a product is taken apart, unless it's a repeated subtree which is better computed once and shared
+            auto* nary = u->getKind() == InfixKind::MULTIPLY ? dynamic_cast<const NaryExpressionNode*>(u) : nullptr;
+            if (nary && e.isOne() && Seen[u->getSynopsis().Hash] < 2) {
+                for (size_t i = 0; i < nary->Operands.size(); i++) {
+                    addFactor(nary->Operands[i].get(), nary->coeff(i), term, atoms, atom_of);
+                }
+                return;
+            }
+
+            Rational base_exp = whole ? Rational(1) : e;
+            int32_t power_of = whole ? static_cast<int32_t>(e.num) : 1;
+            int atom = -1;
+            for (int candidate : atom_of[u->getSynopsis().Hash]) {
+                if (atoms[candidate].Exp == base_exp && sameTree(atoms[candidate].Node, u)) atom = candidate;
+            }
+            if (atom < 0) {
+                atom = static_cast<int>(atoms.size());
+                atoms.push_back(Atom{u, base_exp});
+                atom_of[u->getSynopsis().Hash].push_back(atom);
+            }
+
+            for (auto& [a, exp] : term.Powers) {
+                if (a == atom) {
+                    exp += power_of;
+                    return;
+                }
+            }
+            term.Powers.push_back({atom, power_of});
+        }
+
+        // The atom in the most terms is pulled out of them, P = rest + atom^m * inner with m the lowest power it has among them,
+        // then rest and inner go the same way. Once no atom is in two terms there's nothing to share and the terms are summed
+        int horner(const std::vector<Monomial>& terms, std::vector<Atom>& atoms, std::vector<int>& pins) {
+            std::vector<int> count(atoms.size(), 0);
+            for (const Monomial& term : terms) {
+                for (const auto& [a, e] : term.Powers) count[a]++;
+            }
+            int best = -1;
+            for (size_t a = 0; a < atoms.size(); a++) {
+                if (count[a] >= 2 && (best < 0 || count[a] > count[best])) best = static_cast<int>(a);
+            }
+
+            if (best < 0) {
+                int acc = -1;
+                for (const Monomial& term : terms) {
+                    if (term.Powers.empty()) {
+                        acc = addTerm(acc, constant(term.Coeff), Rational(1));
+                        continue;
+                    }
+                    int product = -1;
+                    for (const auto& [a, e] : term.Powers) {
+                        int factor = atomPower(atoms[a], e, pins);
+                        product = product < 0 ? factor : emit(OpCode::MUL, product, factor);
+                    }
+                    acc = addTerm(acc, product, term.Coeff);
+                }
+                return acc >= 0 ? acc : constant(Rational(0));
+            }
+
+            std::vector<Monomial> rest, inner;
+            int32_t lowest = INT32_MAX;
+            for (const Monomial& term : terms) {
+                int32_t e = term.exponentOf(best);
+                if (e == 0) rest.push_back(term);
+                else lowest = std::min(lowest, e);
+            }
+            for (const Monomial& term : terms) {
+                if (term.exponentOf(best) == 0) continue;
+                Monomial reduced = term;
+                for (auto& [a, e] : reduced.Powers) {
+                    if (a == best) e -= lowest;
+                }
+                reduced.Powers.erase(std::remove_if(reduced.Powers.begin(), reduced.Powers.end(),
+                                                    [](const std::pair<int, int32_t>& p) { return p.second == 0; }),
+                                     reduced.Powers.end());
+                inner.push_back(reduced);
+            }
+
+            int acc = rest.empty() ? -1 : horner(rest, atoms, pins);
+            int factor = atomPower(atoms[best], lowest, pins);
+            int product = emit(OpCode::MUL, factor, horner(inner, atoms, pins));
+            return acc < 0 ? product : emit(OpCode::ADD, acc, product);
+        }
+
+        // atom^e, the atom compiled once and each of its powers once, all kept until the sum is done
+        int atomPower(Atom& atom, int32_t e, std::vector<int>& pins) {
+            if (atom.Register < 0) {
+                int reg = compileNode(atom.Node);
+                if (!atom.Exp.isOne()) {
+                    if (atom.Exp.isInteger() && atom.Exp.num >= -INT32_MAX && atom.Exp.num <= INT32_MAX) {
+                        reg = powerOf(reg, static_cast<int32_t>(atom.Exp.num));
+                    } else {
+                        reg = emit(OpCode::POW, reg, constant(atom.Exp));
+                    }
+                }
+                atom.Register = reg;
+                pin(reg);
+                pins.push_back(reg);
+            }
+            if (e == 1) return atom.Register;
+
+            auto [it, added] = Powers.try_emplace({atom.Register, e}, -1);
+            if (added) {
+                it->second = powerOf(atom.Register, e);
+                pin(it->second);
+                pins.push_back(it->second);
+            }
+            return it->second;
+        }
+
+        // the same value gets the one register
+        int constant(const Rational& c) {
+            auto [it, added] = ConstantOf.try_emplace({c.num, c.den}, static_cast<int>(Code.ExactConstants.size()));
+            if (added) {
+                Code.ExactConstants.push_back(c);
+                Code.Constants.push_back(static_cast<double>(c.num) / static_cast<double>(c.den));
+            }
+            return CONST_REG + it->second;
+        }
+
+        // a double from the simplifier's double domain. It has no exact value, which is kept as a 0 denominator, and exact
+        // evaluation of the whole expression is turned down. Keyed by its bits with a 0 denominator so it can't meet a Rational
+        int realConstant(double x) {
+            i64 bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            auto [it, added] = ConstantOf.try_emplace({bits, 0}, static_cast<int>(Code.ExactConstants.size()));
+            if (added) {
+                Rational none;
+                none.den = 0;
+                Code.ExactConstants.push_back(none);
+                Code.Constants.push_back(x);
+                Code.Inexact = true;
+            }
+            return CONST_REG + it->second;
+        }
+
+        int powerOf(int base, int32_t n) {
+            if (n == 1) return base;
+            return emit(OpCode::POWI, base, base, n);
+        }
+
+        // the operands are given back before the result is taken, so r1 = r1 + r2 reuses r1. That's safe since every instruction
+        // reads both its operands before it writes
+        int emit(OpCode code, int a, int b, int32_t power = 0) {
+            release(a);
+            if (b != a) release(b);
+            int dst = temp();
+            Program.push_back(Pending{code, dst, a, b, power});
+            return dst;
+        }
+
+        int temp() {
+            if (!Free.empty()) {
+                int reg = Free.back();
+                Free.pop_back();
+                return reg;
+            }
+            return TEMP_REG + Temps++;
+        }
+
+        void release(int reg) {
+            if (reg >= TEMP_REG && !Pinned.count(reg)) Free.push_back(reg);
+        }
+
+        // kept from being given back while it may still be read. Shared subtrees stay pinned to the end, a sum's atoms and powers
+        // only until the sum is done
+        void pin(int reg) {
+            if (reg >= TEMP_REG) Pinned[reg]++;
+        }
+
+        // true if that was the last pin
+        bool unpin(int reg) {
+            auto it = Pinned.find(reg);
+            if (it == Pinned.end() || --it->second > 0) return false;
+            Pinned.erase(it);
+            return true;
+        }
+
+        Bytecode& Code;
+        bool Optimize;
+        std::vector<Pending> Program;
+        std::unordered_map<int, int> Slots;                 // symbol id -> variable register
+        std::map<std::pair<i64, i64>, int> ConstantOf;
+        std::vector<int> Free;
+        int Temps {0};
+        int Out {0};
+        bool Failed {false};
+
+        std::unordered_map<u64, int> Seen;                  // subtree hash -> how many times it's in the tree
+        std::unordered_map<u64, std::vector<std::pair<const ExpressionNode*, int>>> Computed;
+        std::map<std::pair<int, int32_t>, int> Powers;      // (register, n) -> register ^ n
+        std::unordered_map<int, int> Pinned;
+};
+
+
+bool Bytecode::compile(const ExpressionNode* expr, bool optimize) {
+    Code.clear();
+    Symbols.clear();
+    Constants.clear();
+    ExactConstants.clear();
+    Registers.clear();
+    ExactRegisters.clear();
+    IntervalRegisters.clear();
+    Inexact = false;
+    Result = 0;
+
+    BytecodeCompiler compiler(*this, optimize);
+    return compiler.compile(expr);
+}
+
+int Bytecode::slot(int symbol) const {
+    auto it = std::find(Symbols.begin(), Symbols.end(), symbol);
+    return it == Symbols.end() ? -1 : static_cast<int>(it - Symbols.begin());
+}
+
+size_t Bytecode::operations() const {
+    size_t count = 0;
+    for (const Instruction& in : Code) {
+        if (in.Code != OpCode::POWI) {
+            count++;
+            continue;
+        }
+        // the squarings and the multiplies into the result, the first of which is only a copy, and 1 / x^n for a negative n
+        u64 m = in.Power < 0 ? -static_cast<i64>(in.Power) : in.Power;
+        if (m == 0) continue;
+        count += (in.Power < 0);
+        for (bool first = true; m > 0; m >>= 1) {
+            if (m & 1) {
+                count += !first;
+                first = false;
+            }
+            count += (m > 1);
+        }
+    }
+    return count;
+}
+
+double Bytecode::evaluate(const double* values) {
+    double* r = Registers.data();
+    std::copy(values, values + Symbols.size(), r);
+
+    for (const Instruction& in : Code) {
+        switch (in.Code) {
+            case OpCode::ADD:  r[in.Dst] = r[in.A] + r[in.B]; break;
+            case OpCode::SUB:  r[in.Dst] = r[in.A] - r[in.B]; break;
+            case OpCode::MUL:  r[in.Dst] = r[in.A] * r[in.B]; break;
+            case OpCode::DIV:  r[in.Dst] = r[in.A] / r[in.B]; break;
+            case OpCode::NEG:  r[in.Dst] = -r[in.A]; break;
+            case OpCode::POWI: r[in.Dst] = power(r[in.A], in.Power); break;
+            case OpCode::POW:  r[in.Dst] = std::pow(r[in.A], r[in.B]); break;
+        }
+    }
+    return r[Result];
+}
+
+bool Bytecode::evaluate(const Rational* values, Rational& result) {
+    if (Inexact) return false;
+
+    Rational* r = ExactRegisters.data();
+    for (size_t i = 0; i < Symbols.size(); i++) {
+        // normalised and away from INT64_MIN, like everything narrowRational hands back
+        if (!narrowRational(values[i].num, values[i].den, r[i])) return false;
+    }
+
+    for (const Instruction& in : Code) {
+        bool ok = true;
+        switch (in.Code) {
+            case OpCode::ADD:  ok = checkedAdd(r[in.A], r[in.B], r[in.Dst]); break;
+            case OpCode::SUB:  ok = checkedSubtract(r[in.A], r[in.B], r[in.Dst]); break;
+            case OpCode::MUL:  ok = checkedMultiply(r[in.A], r[in.B], r[in.Dst]); break;
+            case OpCode::DIV:  ok = checkedDivide(r[in.A], r[in.B], r[in.Dst]); break;
+            case OpCode::NEG:  r[in.Dst] = Rational(-r[in.A].num, r[in.A].den); break;
+            case OpCode::POWI: ok = powRational(r[in.A], in.Power, r[in.Dst]); break;
+            case OpCode::POW: {
+                // only whole exponents have an exact answer in general
+                const Rational& e = r[in.B];
+                ok = e.isInteger() && powRational(r[in.A], e.num, r[in.Dst]);
+                break;
+            }
+        }
+        if (!ok) return false;
+    }
+    result = r[Result];
+    return true;
+}
+
+Interval Bytecode::bounds(const Interval* values) {
+    Interval* r = IntervalRegisters.data();
+    std::copy(values, values + Symbols.size(), r);
+
+    for (const Instruction& in : Code) {
+        switch (in.Code) {
+            case OpCode::ADD:  r[in.Dst] = r[in.A] + r[in.B]; break;
+            case OpCode::SUB:  r[in.Dst] = r[in.A] - r[in.B]; break;
+            case OpCode::MUL:  r[in.Dst] = r[in.A] * r[in.B]; break;
+            case OpCode::DIV:  r[in.Dst] = r[in.A] / r[in.B]; break;
+            case OpCode::NEG:  r[in.Dst] = -r[in.A]; break;
+            case OpCode::POWI: r[in.Dst] = power(r[in.A], in.Power); break;
+            case OpCode::POW:  r[in.Dst] = power(r[in.A], r[in.B]); break;
+        }
+    }
+    return r[Result];
+}
+
+std::string Bytecode::String() const {
+    std::string out;
+    size_t vars = Symbols.size();
+    auto reg = [](int r) { return "r" + std::to_string(r); };
+
+    for (size_t i = 0; i < vars; i++) out += reg(i) + " = " + symbolName(Symbols[i]) + "\n";
+    for (size_t i = 0; i < ExactConstants.size(); i++) {
+        out += reg(vars + i) + " = " + (ExactConstants[i].den == 0 ? realLiteral(Constants[i]) : ExactConstants[i].String()) + "\n";
+    }
+
+    for (const Instruction& in : Code) {
+        out += reg(in.Dst) + " = ";
+        switch (in.Code) {
+            case OpCode::ADD:  out += reg(in.A) + " + " + reg(in.B); break;
+            case OpCode::SUB:  out += reg(in.A) + " - " + reg(in.B); break;
+            case OpCode::MUL:  out += reg(in.A) + " * " + reg(in.B); break;
+            case OpCode::DIV:  out += reg(in.A) + " / " + reg(in.B); break;
+            case OpCode::NEG:  out += "-" + reg(in.A); break;
+            case OpCode::POWI: out += reg(in.A) + " ^ " + std::to_string(in.Power); break;
+            case OpCode::POW:  out += reg(in.A) + " ^ " + reg(in.B); break;
+        }
+        out += "\n";
+    }
+    out += "return " + reg(Result) + "\n";
+    return out;
+}
@@ -0,0 +1,105 @@
+/*
+bytecode.hpp
+
+Numeric evaluation of a (simplified) expression. The tree is walked once by compile, which turns it into a flat list of register
+instructions, r3 = r0 * r2 and so on. Evaluating is then one loop over that list with a switch per instruction, no nodes, no
+virtual calls and no allocation, so the same expression can be evaluated millions of times for different values of its variables.
+
+Registers are laid out as the variables first (in symbols() order), then the constants, then temporaries. The constants are put in
+their registers by compile, so an evaluation only copies the variables in. Temporaries are given back as soon as the instruction
+using them is emitted, so the register count follows the depth of the tree rather than its size.
+
+An annotated sum or product (Cohen's coefficients and exponents, see NaryExpressionNode) doesn't get rebuilt as nodes, 3x is a
+multiply by the constant 3 and x^-2 a divide by x^2. Whole powers are done by squaring. Compiling optimised (the default) also
+rearranges for fewer operations: Horner form for sums, and repeated subtrees and powers computed once.
+
+Values are either doubles, exact Rationals or Intervals. Exact evaluation is checked, it returns false on dividing by zero, a power that isn't
+whole, or numbers too big for 64 bits, where the Rational operators would quietly wrap. It's also false for anything simplified in
+doubles (NumericDomain::DOUBLE) that kept a double constant, since that has no exact value to start from.
+*/
+
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "interval.hpp"
+
+enum class OpCode : uint8_t {ADD, SUB, MUL, DIV, NEG, POWI, POW};
+
+struct Instruction {
+    OpCode Code;
+    uint16_t Dst, A, B;     // registers, B unused by NEG and POWI
+    int32_t Power {0};      // the exponent for POWI
+};
+
+// b^n by squaring, what POWI does. Anything else evaluating a compiled expression (GradientTape) calls this so its values match
+inline double power(double b, int32_t n) {
+    uint64_t m = n < 0 ? -static_cast<int64_t>(n) : n;
+    double result = 1.0;
+    while (m > 0) {
+        if (m & 1) result *= b;
+        m >>= 1;
+        b *= b;
+    }
+    return n < 0 ? 1.0 / result : result;
+}
+
+// the whole number u is, false if it isn't a (possibly negated) whole number that fits an instruction
+inline bool wholeExponent(const ExpressionNode* u, int32_t& n) {
+    if (u->getKind() == InfixKind::PRE_MINUS) {
+        if (!wholeExponent(static_cast<const PrefixExpressionNode*>(u)->Right.get(), n)) return false;
+        n = -n;
+        return true;
+    }
+    if (u->Key.Rank != OrderRank::CONSTANT || !u->Key.Value.isInteger()) return false;
+    if (u->Key.Value.num > INT32_MAX || u->Key.Value.num < -INT32_MAX) return false;
+    n = static_cast<int32_t>(u->Key.Value.num);
+    return true;
+}
+
+class Bytecode {
+    public:
+        // false if the expression has Undefined in it or needs more registers than fit in an instruction. optimize evaluates sums
+        // in Horner form and computes repeated subtrees and powers once (see bytecode.cpp), for fewer operations in a different order
+        bool compile(const ExpressionNode* expr, bool optimize = true);
+
+        // interned ids of the variables, values are passed in this order
+        const std::vector<int>& symbols() const { return Symbols; }
+        int slot(int symbol) const;             // index into symbols(), -1 if the expression doesn't have it
+
+        size_t size() const { return Code.size(); }
+        size_t operations() const;              // arithmetic operations per evaluation, a whole power counted as its multiplications
+        size_t registers() const { return Registers.size(); }
+
+        // values holds symbols().size() numbers
+        double evaluate(const double* values);
+        bool evaluate(const Rational* values, Rational& result);
+
+        // bounds over a box, values[i] the range of symbols()[i] (see interval.hpp)
+        Interval bounds(const Interval* values);
+
+        // one instruction per line, for reading and for tests
+        std::string String() const;
+
+        const std::vector<Instruction>& instructions() const { return Code; }
+        const std::vector<double>& constants() const { return Constants; }
+        int result() const { return Result; }
+
+    private:
+        friend class BytecodeCompiler;
+
+        std::vector<Instruction> Code;
+        std::vector<int> Symbols;
+        std::vector<double> Constants;          // the constants as doubles, register Symbols.size() + i
+        std::vector<Rational> ExactConstants;
+        std::vector<double> Registers;          // scratch, the constants already in place
+        std::vector<Rational> ExactRegisters;
+        std::vector<Interval> IntervalRegisters;
+        bool Inexact {false};                   // a double constant in it, so no exact value
+        int Result {0};
+};
+
+#endif
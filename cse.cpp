@@ -0,0 +1,127 @@
+/*
+cse.cpp
+*/
+
+#include "cse.hpp"
+
+SharedForm::SharedForm(const ExpressionNode* expr, int minSize) : MinSize(minSize) {
+    count(expr);
+    Result = text(expr);
+}
+
+// Counts every subtree by walking the tree once. A copy of something already seen isn't walked into, so what's inside a repeated
+// subtree is only counted the once, and a part of it that's used nowhere else stays at 1 and doesn't get a name of its own
+void SharedForm::count(const ExpressionNode* u) {
+    if (Occurrence* seen = find(u)) {
+        seen->Count++;
+        return;
+    }
+    Seen[u->getSynopsis().Hash].push_back(Occurrence{u, 1, -1});
+
+    switch (u->getKind()) {
+        case InfixKind::NUM:
+        case InfixKind::REAL:
+        case InfixKind::VAR:
+            return;
+
+        case InfixKind::PRE_MINUS:
+            count(static_cast<const PrefixExpressionNode*>(u)->Right.get());
+            return;
+
+        default:
+            break;
+    }
+
+    if (auto nary = dynamic_cast<const NaryExpressionNode*>(u)) {
+        for (const auto& op : nary->Operands) count(op.get());
+        return;
+    }
+    auto infix = static_cast<const InfixExpressionNode*>(u);
+    count(infix->Left.get());
+    count(infix->Right.get());
+}
+
+// the entry for u's subtree, nullptr if it hasn't been seen (only happens under a copy that was skipped by count)
+SharedForm::Occurrence* SharedForm::find(const ExpressionNode* u) {
+    auto it = Seen.find(u->getSynopsis().Hash);
+    if (it == Seen.end()) return nullptr;
+    for (Occurrence& o : it->second) {
+        if (sameTree(o.Node, u)) return &o;
+    }
+    return nullptr;
+}
+
+// u as a part of something bigger: its name if it's repeated, written out otherwise. The binding is made the first time it's
+// needed, after any it uses, so the lines come out in an order that can be read top to bottom. Identifiers are letters only, so a
+// name can't clash with a variable
+std::string SharedForm::operand(const ExpressionNode* u) {
+    Occurrence* o = u->getSynopsis().Size >= MinSize ? find(u) : nullptr;
+    if (!o || o->Count < 2) return text(u);
+
+    if (o->Binding < 0) {
+        const ExpressionNode* node = o->Node;
+        int uses = o->Count;
+        std::string body = text(node);        // may add bindings, Seen itself doesn't change so o stays put
+        o->Binding = static_cast<int>(Bindings.size());
+        Bindings.push_back(Binding{"t" + std::to_string(Bindings.size() + 1), node, std::move(body), uses});
+    }
+    return Bindings[o->Binding].Name;
+}
+
+// the same as u->String(), with operand() for the children
+std::string SharedForm::text(const ExpressionNode* u) {
+    switch (u->getKind()) {
+        case InfixKind::NUM:
+        case InfixKind::REAL:
+        case InfixKind::VAR:
+            return u->String();
+
+        case InfixKind::PRE_MINUS: {
+            auto prefix = static_cast<const PrefixExpressionNode*>(u);
+            return std::string("(") + prefix->Operator + operand(prefix->Right.get()) + ")";
+        }
+
+        default:
+            break;
+    }
+
+    auto nary = dynamic_cast<const NaryExpressionNode*>(u);
+    if (!nary) {
+        auto infix = static_cast<const InfixExpressionNode*>(u);
+        return "(" + operand(infix->Left.get()) + " " + infix->Operator + " " + operand(infix->Right.get()) + ")";
+    }
+
+    // the annotations as NaryExpressionNode::String writes them, 3·x as (3 * x) and x² as (x ^ 2)
+    auto annotated = [&](size_t i) {
+        const ExpressionNode* op = nary->Operands[i].get();
+        Rational c = nary->coeff(i);
+        if (c.isOne()) return operand(op);
+        if (nary->Kind != InfixKind::PLUS) return "(" + operand(op) + " ^ " + c.String() + ")";
+
+        std::string inner = operand(op);
+        auto product = dynamic_cast<const NaryExpressionNode*>(op);
+        if (product && product->Kind == InfixKind::MULTIPLY && product->Operands.size() > 1 && inner.front() == '(') {
+            inner = inner.substr(1, inner.size() - 2);      // (3 * x * y), unless the product has a name
+        }
+        return "(" + c.String() + " * " + inner + ")";
+    };
+
+    if (nary->Operands.size() == 1 && !nary->coeff(0).isOne()) return annotated(0);
+
+    std::string s = "(";
+    for (size_t i = 0; i < nary->Operands.size(); i++) {
+        s += annotated(i);
+        if (i != nary->Operands.size() - 1) s += std::string(" ") + nary->Operator + " ";
+    }
+    return s + ")";
+}
+
+std::string SharedForm::String() const {
+    std::string s;
+    for (const Binding& b : Bindings) s += "let " + b.Name + " = " + b.Text + "\n";
+    return s + Result;
+}
+
+std::string sharedString(const ExpressionNode* expr) {
+    return SharedForm(expr).String();
+}
@@ -0,0 +1,65 @@
+/*
+cse.hpp
+
+Printing an expression with its repeated parts written once. Expanding and solving tend to leave the same big subterm in a result
+many times over, and String() prints every copy. SharedForm finds the subtrees that occur more than once (by the structural hash in
+the Synopsis, checked with sameTree) and gives each one a name, so the result reads as a list of bindings that use each other:
+
+    let t1 = (x + y)
+    let t2 = ((t1 ^ 2) * z)
+    (t2 + (3 * t2) + t1)
+
+Each binding only uses the ones above it, and the last line is the expression itself. A subtree inside a repeated one is only named
+if it's also repeated somewhere outside it, the rest stay written out inline.
+
+The tree isn't changed, names stand for nodes of it (the first copy met, walking left to right).
+*/
+
+#ifndef CSE_HPP
+#define CSE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+
+struct Binding {
+    std::string Name;               // t1, t2, ...
+    const ExpressionNode* Node;     // the first copy in the tree
+    std::string Text;               // its String(), with the bindings before it standing in for their subtrees
+    int Uses;                       // how many times it appears, counting copies inside other bindings once
+};
+
+class SharedForm {
+    public:
+        // minSize is the smallest subtree (in nodes, see Synopsis) worth naming, the default leaves out single numbers and variables
+        explicit SharedForm(const ExpressionNode* expr, int minSize = 2);
+
+        const std::vector<Binding>& bindings() const { return Bindings; }
+        const std::string& result() const { return Result; }    // the last line
+
+        // the let lines then the result, one per line. Just result() when nothing repeats
+        std::string String() const;
+
+    private:
+        struct Occurrence {
+            const ExpressionNode* Node;     // first copy
+            int Count;
+            int Binding;                    // index into Bindings, -1 until it's written
+        };
+
+        void count(const ExpressionNode* u);
+        Occurrence* find(const ExpressionNode* u);
+        std::string text(const ExpressionNode* u);
+        std::string operand(const ExpressionNode* u);
+
+        int MinSize;
+        std::unordered_map<u64, std::vector<Occurrence>> Seen;    // hash -> the different subtrees with it, almost always one
+        std::vector<Binding> Bindings;
+        std::string Result;
+};
+
+// SharedForm(expr).String()
+std::string sharedString(const ExpressionNode* expr);
+
+#endif
@@ -0,0 +1,226 @@
+/*
+dense.cpp
+*/
+
+#include "dense.hpp"
+#include <algorithm>
+
+using u64 = uint64_t;
+using u128 = unsigned __int128;
+
+// bits needed for the largest absolute value
+static int maxBits(const std::vector<i64>& a) {
+    u64 m = 0;
+    for (i64 c : a) {
+        u64 v = (c < 0) ? static_cast<u64>(-(c + 1)) + 1 : static_cast<u64>(c);
+        m = std::max(m, v);
+    }
+    int bits = 0;
+    while (m > 0) {
+        bits++;
+        m >>= 1;
+    }
+    return bits;
+}
+
+static int ceilLog2(size_t n) {
+    int bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    return bits;
+}
+
+// ---------------- schoolbook and Karatsuba ----------------
+
+static void schoolbook(const i128* a, size_t n, const i128* b, size_t m, i128* out) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] == 0) continue;
+        for (size_t j = 0; j < m; j++) out[i + j] += a[i] * b[j];
+    }
+}
+
+// a and b both have n coefficients, adds the 2n - 1 coefficients of a*b into out
+static void karatsuba(const i128* a, const i128* b, size_t n, i128* out) {
+    if (n <= KARATSUBA_THRESHOLD) {
+        schoolbook(a, n, b, n, out);
+        return;
+    }
+
+    // a = a0 + a1 x^m, b = b0 + b1 x^m, with a1 and b1 the longer halves
+    size_t m = n / 2;
+    size_t h = n - m;
+
+    std::vector<i128> sa(h), sb(h);
+    for (size_t i = 0; i < h; i++) {
+        sa[i] = a[m + i] + (i < m ? a[i] : 0);
+        sb[i] = b[m + i] + (i < m ? b[i] : 0);
+    }
+
+    std::vector<i128> z0(2 * m - 1, 0), z1(2 * h - 1, 0), z2(2 * h - 1, 0);
+    karatsuba(a, b, m, z0.data());
+    karatsuba(a + m, b + m, h, z2.data());
+    karatsuba(sa.data(), sb.data(), h, z1.data());
+
+    // (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 is the middle
+    for (size_t i = 0; i < z0.size(); i++) z1[i] -= z0[i];
+    for (size_t i = 0; i < z2.size(); i++) z1[i] -= z2[i];
+
+    for (size_t i = 0; i < z0.size(); i++) out[i] += z0[i];
+    for (size_t i = 0; i < z1.size(); i++) out[m + i] += z1[i];
+    for (size_t i = 0; i < z2.size(); i++) out[2 * m + i] += z2[i];
+}
+
+// ---------------- number theoretic transform ----------------
+// three primes of the form k 2^n + 1, all with 3 as a primitive root, product just over 2^86
+
+struct NttPrime {
+    u64 P;
+    u64 Root;
+    int MaxLog;     // largest power of two length the prime supports
+};
+
+static const NttPrime NTT_PRIMES[3] = {
+    {998244353, 3, 23},     // 119 * 2^23 + 1
+    {167772161, 3, 25},     // 5 * 2^25 + 1
+    {469762049, 3, 26},     // 7 * 2^26 + 1
+};
+
+static u64 powMod(u64 b, u64 e, u64 p) {
+    u64 r = 1;
+    b %= p;
+    while (e > 0) {
+        if (e & 1) r = r * b % p;
+        b = b * b % p;
+        e >>= 1;
+    }
+    return r;
+}
+
+// in place iterative transform, the length is a power of two
+static void ntt(std::vector<u64>& a, const NttPrime& prime, bool inverse) {
+    size_t n = a.size();
+    u64 p = prime.P;
+
+    // bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        u64 w = powMod(prime.Root, (p - 1) / len, p);
+        if (inverse) w = powMod(w, p - 2, p);
+
+        for (size_t i = 0; i < n; i += len) {
+            u64 wn = 1;
+            for (size_t j = 0; j < len / 2; j++) {
+                u64 u = a[i + j];
+                u64 v = a[i + j + len / 2] * wn % p;
+                a[i + j] = (u + v) % p;
+                a[i + j + len / 2] = (u + p - v) % p;
+                wn = wn * w % p;
+            }
+        }
+    }
+
+    if (inverse) {
+        u64 n_inv = powMod(n, p - 2, p);
+        for (auto& x : a) x = x * n_inv % p;
+    }
+}
+
+// a*b mod prime, coefficients already reduced
+static std::vector<u64> multiplyMod(const std::vector<i64>& a, const std::vector<i64>& b, size_t size, const NttPrime& prime) {
+    u64 p = prime.P;
+    std::vector<u64> fa(size, 0), fb(size, 0);
+    for (size_t i = 0; i < a.size(); i++) fa[i] = static_cast<u64>((a[i] % static_cast<i64>(p) + static_cast<i64>(p)) % static_cast<i64>(p));
+    for (size_t i = 0; i < b.size(); i++) fb[i] = static_cast<u64>((b[i] % static_cast<i64>(p) + static_cast<i64>(p)) % static_cast<i64>(p));
+
+    ntt(fa, prime, false);
+    ntt(fb, prime, false);
+    for (size_t i = 0; i < size; i++) fa[i] = fa[i] * fb[i] % p;
+    ntt(fa, prime, true);
+    return fa;
+}
+
+// Garner's algorithm, the residues mod the three primes back to the signed integer in (-M/2, M/2]
+static i128 crt(u64 r1, u64 r2, u64 r3) {
+    const u64 p1 = NTT_PRIMES[0].P;
+    const u64 p2 = NTT_PRIMES[1].P;
+    const u64 p3 = NTT_PRIMES[2].P;
+
+    static const u64 p1_inv_p2 = powMod(p1, p2 - 2, p2);
+    static const u64 p1_inv_p3 = powMod(p1, p3 - 2, p3);
+    static const u64 p2_inv_p3 = powMod(p2, p3 - 2, p3);
+
+    u64 x2 = (r2 + p2 - r1 % p2) % p2 * p1_inv_p2 % p2;
+    u64 t = (r3 + p3 - r1 % p3) % p3 * p1_inv_p3 % p3;
+    u64 x3 = (t + p3 - x2 % p3) % p3 * p2_inv_p3 % p3;
+
+    u128 m = static_cast<u128>(p1) * p2 * p3;
+    u128 x = r1 + static_cast<u128>(x2) * p1 + static_cast<u128>(x3) * p1 * p2;
+    return (x > m / 2) ? static_cast<i128>(x) - static_cast<i128>(m) : static_cast<i128>(x);
+}
+
+bool multiplyDense(const std::vector<i64>& a, const std::vector<i64>& b, std::vector<i128>& out) {
+    if (a.empty() || b.empty()) {
+        out.clear();
+        return true;
+    }
+
+    size_t n = a.size();
+    size_t m = b.size();
+    size_t shorter = std::min(n, m);
+
+    // |c_k| <= shorter * max|a| * max|b|
+    int bound = maxBits(a) + maxBits(b) + ceilLog2(shorter);
+
+    if (shorter >= NTT_THRESHOLD) {
+        size_t size = 1;
+        while (size < n + m - 1) size <<= 1;
+
+        // the coefficient has to be recoverable from its residues, signed so one bit less than the product of the primes, and
+        // the length supported by every prime
+        if (bound <= 85 && ceilLog2(size) <= NTT_PRIMES[0].MaxLog) {
+            std::vector<u64> r1 = multiplyMod(a, b, size, NTT_PRIMES[0]);
+            std::vector<u64> r2 = multiplyMod(a, b, size, NTT_PRIMES[1]);
+            std::vector<u64> r3 = multiplyMod(a, b, size, NTT_PRIMES[2]);
+
+            out.assign(n + m - 1, 0);
+            for (size_t k = 0; k < out.size(); k++) out[k] = crt(r1[k], r2[k], r3[k]);
+            return true;
+        }
+    }
+
+    // every level of Karatsuba can double both halves before multiplying
+    int levels = (shorter > KARATSUBA_THRESHOLD) ? ceilLog2(shorter / KARATSUBA_THRESHOLD) + 1 : 0;
+    if (bound + 2 * levels > 125) return false;
+
+    out.assign(n + m - 1, 0);
+
+    const std::vector<i64>& s = (n <= m) ? a : b;
+    const std::vector<i64>& l = (n <= m) ? b : a;
+    std::vector<i128> ws(s.begin(), s.end());
+
+    if (shorter <= KARATSUBA_THRESHOLD) {
+        std::vector<i128> wl(l.begin(), l.end());
+        schoolbook(ws.data(), ws.size(), wl.data(), wl.size(), out.data());
+        return true;
+    }
+
+    // Karatsuba wants equal lengths, so the longer one is cut into blocks the length of the shorter one (the last block padded with zeros)
+    std::vector<i128> block(shorter), product(2 * shorter - 1);
+    for (size_t start = 0; start < l.size(); start += shorter) {
+        size_t count = std::min(shorter, l.size() - start);
+        std::fill(block.begin(), block.end(), 0);
+        std::copy(l.begin() + start, l.begin() + start + count, block.begin());
+        std::fill(product.begin(), product.end(), 0);
+
+        karatsuba(ws.data(), block.data(), shorter, product.data());
+
+        size_t used = std::min(product.size(), out.size() - start);
+        for (size_t k = 0; k < used; k++) out[start + k] += product[k];
+    }
+    return true;
+}
@@ -0,0 +1,22 @@
+/*
+dense.hpp
+
+Multiplication of dense univariate polynomials with integer coefficients, lowest degree first.
+Schoolbook for short inputs, Karatsuba for mid sizes and number theoretic transforms over three word sized primes (joined back up
+with the chinese remainder theorem) for long ones. Used by Polynomial when both sides of a product are dense in one variable.
+*/
+
+#ifndef DENSE_HPP
+#define DENSE_HPP
+
+#include <vector>
+#include "rational.hpp"
+
+// sizes where each method takes over, by the length of the shorter input
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t NTT_THRESHOLD = 256;
+
+// false if the result coefficients could overflow what the chosen method can hold, out is left alone and the caller multiplies another way
+bool multiplyDense(const std::vector<i64>& a, const std::vector<i64>& b, std::vector<i128>& out);
+
+#endif
@@ -0,0 +1,182 @@
+/*
+derivative.cpp
+*/
+
+#include "derivative.hpp"
+
+static bool isUndefinedNode(const ExpressionNode* u) {
+    return u->getKind() == InfixKind::VAR && static_cast<const VariableExpressionNode*>(u)->Value == "Undefined";
+}
+
+Differentiator::Differentiator(int symbol, NumericDomain domain) : Symbol(symbol), Simplifier(domain) {
+    Zero = Simplifier.createNumber(0);
+    One = Simplifier.createNumber(1);
+    Token undefinedTok{token::VAR, "Undefined"};
+    Undefined = std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
+}
+
+std::unique_ptr<ExpressionNode> Differentiator::derivative(const ExpressionNode* expr) {
+    // Undefined swallows everything it's in, so it can only turn up as the whole expression
+    if (isUndefinedNode(expr)) return copy(Undefined.get());
+    return copy(derive(expr));
+}
+
+// u's derivative, owned by the memo (or one of the constants). The synopsis answers "is the variable in here" without going in
+const ExpressionNode* Differentiator::derive(const ExpressionNode* u) {
+    if (!hasSymbol(u)) return Zero.get();
+    if (u->getKind() == InfixKind::VAR) return One.get();
+
+    u64 hash = u->getSynopsis().Hash;
+    for (const auto& [node, d] : Memo[hash]) {
+        if (sameTree(node, u)) return d.get();
+    }
+
+    // rule() fills in the memo for the subtrees below, which can move the bucket, so it's looked up again afterwards
+    auto d = rule(u);
+    Computed++;
+    auto& bucket = Memo[hash];
+    bucket.emplace_back(u, std::move(d));
+    return bucket.back().second.get();
+}
+
+std::unique_ptr<ExpressionNode> Differentiator::rule(const ExpressionNode* u) {
+    switch (u->getKind()) {
+        case InfixKind::PLUS:
+            return sumRule(static_cast<const NaryExpressionNode*>(u));
+
+        case InfixKind::MULTIPLY:
+            return productRule(static_cast<const NaryExpressionNode*>(u));
+
+        case InfixKind::POWER: {
+            auto* power = static_cast<const InfixExpressionNode*>(u);
+            return powerRule(power->Left.get(), power->Right.get());
+        }
+
+        case InfixKind::DIVIDE: {
+            auto* quotient = static_cast<const InfixExpressionNode*>(u);
+            return quotientRule(quotient->Left.get(), quotient->Right.get());
+        }
+
+        // these two aren't in simplified trees but cost nothing to cover
+        case InfixKind::DIFFERENCE: {
+            auto* difference = static_cast<const InfixExpressionNode*>(u);
+            std::vector<std::unique_ptr<ExpressionNode>> terms;
+            terms.push_back(copy(derive(difference->Left.get())));
+            terms.push_back(copy(derive(difference->Right.get())));
+            return sum(std::move(terms), {Rational(1), Rational(-1)});
+        }
+
+        case InfixKind::PRE_MINUS: {
+            std::vector<std::unique_ptr<ExpressionNode>> terms;
+            terms.push_back(copy(derive(static_cast<const PrefixExpressionNode*>(u)->Right.get())));
+            return sum(std::move(terms), {Rational(-1)});
+        }
+
+        // numbers and variables never get here, derive answers them
+        default:
+            return copy(Zero.get());
+    }
+}
+
+// (c1 u1 + c2 u2 + ...)' = c1 u1' + c2 u2' + ..., terms without the variable dropped
+std::unique_ptr<ExpressionNode> Differentiator::sumRule(const NaryExpressionNode* u) {
+    std::vector<std::unique_ptr<ExpressionNode>> terms;
+    std::vector<Rational> coeffs;
+    for (size_t i = 0; i < u->Operands.size(); i++) {
+        if (!hasSymbol(u->Operands[i].get())) continue;
+        terms.push_back(copy(derive(u->Operands[i].get())));
+        coeffs.push_back(u->coeff(i));
+    }
+    return sum(std::move(terms), std::move(coeffs));
+}
+
+// (u1^e1 u2^e2 ...)' = sum over the factors with the variable of e_i u_i^(e_i - 1) u_i' times the other factors as they are.
+// k such factors out of n is k terms of n + 1 factors each, the other factors copied rather than differentiated
+std::unique_ptr<ExpressionNode> Differentiator::productRule(const NaryExpressionNode* u) {
+    std::vector<std::unique_ptr<ExpressionNode>> terms;
+    std::vector<Rational> coeffs;
+    size_t n = u->Operands.size();
+
+    for (size_t i = 0; i < n; i++) {
+        const ExpressionNode* factor = u->Operands[i].get();
+        if (!hasSymbol(factor)) continue;
+
+        std::vector<std::unique_ptr<ExpressionNode>> factors;
+        std::vector<Rational> exponents;
+        for (size_t j = 0; j < n; j++) {
+            Rational e = u->coeff(j);
+            if (j == i) e = e - Rational(1);
+            if (e.isZero()) continue;
+            factors.push_back(copy(u->Operands[j].get()));
+            exponents.push_back(e);
+        }
+        factors.push_back(copy(derive(factor)));
+        exponents.push_back(Rational(1));
+
+        terms.push_back(product(std::move(factors), std::move(exponents)));
+        coeffs.push_back(u->coeff(i));
+    }
+    return sum(std::move(terms), std::move(coeffs));
+}
+
+// (u^w)' = w u^(w - 1) u' for w without the variable. With the variable in w it'd need ln u, which there's no node for
+std::unique_ptr<ExpressionNode> Differentiator::powerRule(const ExpressionNode* base, const ExpressionNode* exponent) {
+    if (hasSymbol(exponent)) return copy(Undefined.get());
+
+    std::unique_ptr<ExpressionNode> lowered;
+    if (exponent->Key.Rank == OrderRank::CONSTANT) {
+        lowered = Simplifier.createRational(exponent->Key.Value - Rational(1));
+    } else {
+        std::vector<std::unique_ptr<ExpressionNode>> terms;
+        terms.push_back(copy(exponent));
+        terms.push_back(copy(One.get()));
+        lowered = sum(std::move(terms), {Rational(1), Rational(-1)});
+    }
+
+    std::vector<std::unique_ptr<ExpressionNode>> factors;
+    factors.push_back(copy(exponent));
+    factors.push_back(Simplifier.simplify_power(copy(base), std::move(lowered)));
+    factors.push_back(copy(derive(base)));
+    return product(std::move(factors), {});
+}
+
+// (u / v)' = u' v^-1 - u v' v^-2
+std::unique_ptr<ExpressionNode> Differentiator::quotientRule(const ExpressionNode* u, const ExpressionNode* v) {
+    std::vector<std::unique_ptr<ExpressionNode>> terms;
+    std::vector<Rational> coeffs;
+
+    if (hasSymbol(u)) {
+        std::vector<std::unique_ptr<ExpressionNode>> factors;
+        factors.push_back(copy(derive(u)));
+        factors.push_back(copy(v));
+        terms.push_back(product(std::move(factors), {Rational(1), Rational(-1)}));
+        coeffs.push_back(Rational(1));
+    }
+    if (hasSymbol(v)) {
+        std::vector<std::unique_ptr<ExpressionNode>> factors;
+        factors.push_back(copy(u));
+        factors.push_back(copy(derive(v)));
+        factors.push_back(copy(v));
+        terms.push_back(product(std::move(factors), {Rational(1), Rational(1), Rational(-2)}));
+        coeffs.push_back(Rational(-1));
+    }
+    return sum(std::move(terms), std::move(coeffs));
+}
+
+// the simplifier's SSUM and SPRD on operands that are simplified already, nothing is walked again
+std::unique_ptr<ExpressionNode> Differentiator::sum(std::vector<std::unique_ptr<ExpressionNode>> terms, std::vector<Rational> coeffs) {
+    if (terms.empty()) return copy(Zero.get());
+    return Simplifier.simplify_sum(Simplifier.createSum(std::move(terms), std::move(coeffs)));
+}
+
+std::unique_ptr<ExpressionNode> Differentiator::product(std::vector<std::unique_ptr<ExpressionNode>> factors, std::vector<Rational> exponents) {
+    return Simplifier.simplify_product(Simplifier.createProduct(std::move(factors), std::move(exponents)));
+}
+
+std::unique_ptr<ExpressionNode> differentiate(const ExpressionNode* expr, int symbol, NumericDomain domain) {
+    return Differentiator(symbol, domain).derivative(expr);
+}
+
+std::unique_ptr<ExpressionNode> differentiate(const ExpressionNode* expr, const std::string& var, NumericDomain domain) {
+    return differentiate(expr, internSymbol(var), domain);
+}
@@ -0,0 +1,71 @@
+/*
+derivative.hpp
+
+Symbolic derivatives: d/dx of a simplified expression, as another simplified expression. The rules are the usual sum, product,
+quotient and power rules, with the chain rule through powers, n u^(n-1) u'. As in Cohen's Derivative, each derivative is put
+together from pieces that are already simplified, using the simplifier's own simplify_sum, simplify_product and simplify_power. So
+nothing gets simplified twice.
+
+Differentiating a tree naively blows up on nested products: every level copies the level below and differentiates it again. Three
+things keep that from happening here:
+ - A subtree without the variable in it has derivative 0. The Synopsis answers that in O(1), so those subtrees are never entered.
+ - Each distinct subtree is differentiated only once. A repeated subtree (same hash, checked with sameTree, as the bytecode does)
+   looks up the first copy's derivative. In (f + x)(f - y) the derivative of f is worked out once, and when f is built the same
+   way the saving compounds.
+ - The input is only read. A piece of it the derivative needs, such as u in n u^(n-1) u', is copied once for each place it goes.
+
+Every node has one owner, so the result can't point into the input or into itself. A part of the result that repeats is written
+out each time. sharedString (see cse.hpp) prints such a result with the repeats named, and Bytecode computes them once.
+
+A power with the variable in its exponent would need a logarithm, and there's no node for one. Its derivative is Undefined.
+*/
+
+#ifndef DERIVATIVE_HPP
+#define DERIVATIVE_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+#include "simplifier.hpp"
+
+// Derivatives with respect to one variable. Remembers what it has worked out, so the expressions given to it have to outlive it.
+// Use one per variable when differentiating several expressions that share parts
+class Differentiator {
+    public:
+        explicit Differentiator(int symbol, NumericDomain domain = NumericDomain::EXACT);
+
+        // expr should be simplified (as automatic_simplify leaves it), and so is what comes back
+        std::unique_ptr<ExpressionNode> derivative(const ExpressionNode* expr);
+
+        int symbol() const { return Symbol; }
+
+        // how many distinct subtrees have been differentiated so far, not counting ones without the variable
+        size_t computed() const { return Computed; }
+
+    private:
+        const ExpressionNode* derive(const ExpressionNode* u);
+        std::unique_ptr<ExpressionNode> rule(const ExpressionNode* u);
+        std::unique_ptr<ExpressionNode> sumRule(const NaryExpressionNode* u);
+        std::unique_ptr<ExpressionNode> productRule(const NaryExpressionNode* u);
+        std::unique_ptr<ExpressionNode> powerRule(const ExpressionNode* base, const ExpressionNode* exponent);
+        std::unique_ptr<ExpressionNode> quotientRule(const ExpressionNode* u, const ExpressionNode* v);
+
+        std::unique_ptr<ExpressionNode> copy(const ExpressionNode* u) { return Simplifier.clone_expr(u); }
+        std::unique_ptr<ExpressionNode> sum(std::vector<std::unique_ptr<ExpressionNode>> terms, std::vector<Rational> coeffs);
+        std::unique_ptr<ExpressionNode> product(std::vector<std::unique_ptr<ExpressionNode>> factors, std::vector<Rational> exponents);
+        bool hasSymbol(const ExpressionNode* u) const { return !freeOf(u, Symbol); }
+
+        int Symbol;
+        SimplifyVisitor Simplifier;
+        std::unique_ptr<ExpressionNode> Zero, One, Undefined;
+        std::unordered_map<u64, std::vector<std::pair<const ExpressionNode*, std::unique_ptr<ExpressionNode>>>> Memo;   // hash -> (subtree, derivative)
+        size_t Computed {0};
+};
+
+// Differentiator(symbol, domain).derivative(expr), for a single derivative
+std::unique_ptr<ExpressionNode> differentiate(const ExpressionNode* expr, int symbol, NumericDomain domain = NumericDomain::EXACT);
+std::unique_ptr<ExpressionNode> differentiate(const ExpressionNode* expr, const std::string& var, NumericDomain domain = NumericDomain::EXACT);
+
+#endif
@@ -0,0 +1,314 @@
+/*
+fastlinear.cpp
+*/
+
+#include "fastlinear.hpp"
+#include "ast.hpp"
+#include <algorithm>
+#include <numeric>
+
+// Binding powers from parser.hpp
+static const int ADDITIVE_BP = 10;
+static const int MULTIPLICATIVE_BP = 20;
+static const int IMPLICIT_BP = 21;
+static const int UNARY_BP = 30;
+static const int EXPONENT_BP = 40;
+
+// Everything here is checked (see checkedAdd and the rest in rational.hpp), so a number that doesn't fit stops the fast path and
+// the full one decides what to do with it
+static Rational negated(const Rational& a) { return Rational(-a.num, a.den); }
+
+// left = left op right, false if the result isn't linear or doesn't fit. Numbers on both sides skip the x part altogether
+static bool combineValues(LinearTok op, LinearValue& left, const LinearValue& right) {
+    bool numbers = left.X.isZero() && right.X.isZero();
+    switch (op) {
+        case LinearTok::PLUS:
+            return (numbers || checkedAdd(left.X, right.X, left.X)) && checkedAdd(left.K, right.K, left.K);
+        case LinearTok::MINUS:
+            return (numbers || checkedSubtract(left.X, right.X, left.X)) && checkedSubtract(left.K, right.K, left.K);
+        case LinearTok::MULT: {
+            if (numbers) return checkedMultiply(left.K, right.K, left.K);
+
+            // x * x isn't linear
+            if (!left.X.isZero() && !right.X.isZero()) return false;
+            Rational a;
+            Rational b;
+            if (!checkedMultiply(left.X, right.K, a) || !checkedMultiply(right.X, left.K, b)) return false;
+            return checkedAdd(a, b, left.X) && checkedMultiply(left.K, right.K, left.K);
+        }
+        case LinearTok::DIV:
+            if (!right.X.isZero()) return false;
+            return (numbers || checkedDivide(left.X, right.K, left.X)) && checkedDivide(left.K, right.K, left.K);
+        case LinearTok::POW: {
+            // numbers only, to a whole power
+            if (!numbers || !right.K.isInteger()) return false;
+            // 0^0 is left to the full path
+            if (left.K.isZero() && right.K.isZero()) return false;
+            return powRational(left.K, right.K.num, left.K);
+        }
+        default:
+            return false;
+    }
+}
+
+// ---------------- reading ----------------
+
+// Tokens straight off the characters. Peek is the next token not yet used, Implicit stands for the IMPLICIT_MULT token Parser would
+// have put in front of it
+class LinearLexer {
+    public:
+        explicit LinearLexer(std::string_view input) : Input(input) { advance(); }
+        void advance();
+
+        LinearTok Peek {LinearTok::END};
+        std::string_view Text;      // the name of a VAR
+        i64 Number {0};             // the value of a NUM
+        bool Implicit {false};
+
+    private:
+        std::string_view Input;
+        size_t Pos {0};
+};
+
+void LinearLexer::advance() {
+    while (Pos < Input.size() && (Input[Pos] == ' ' || Input[Pos] == '\t' || Input[Pos] == '\n' || Input[Pos] == '\r')) Pos++;
+    if (Pos >= Input.size() || Input[Pos] == '$') {
+        Peek = LinearTok::END;
+        return;
+    }
+
+    char ch = Input[Pos];
+    if (('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z')) {
+        size_t start = Pos;
+        while (Pos < Input.size() && (('a' <= Input[Pos] && Input[Pos] <= 'z') || ('A' <= Input[Pos] && Input[Pos] <= 'Z'))) Pos++;
+        Text = Input.substr(start, Pos - start);
+        Peek = LinearTok::VAR;
+        return;
+    }
+    if ('0' <= ch && ch <= '9') {
+        // 18 digits always fits, anything longer goes the long way
+        size_t start = Pos;
+        Number = 0;
+        while (Pos < Input.size() && '0' <= Input[Pos] && Input[Pos] <= '9') Number = 10 * Number + (Input[Pos++] - '0');
+        Peek = Pos - start > 18 ? LinearTok::BAD : LinearTok::NUM;
+        return;
+    }
+
+    Pos++;
+    switch (ch) {
+        case '+': Peek = LinearTok::PLUS; break;
+        case '-': Peek = LinearTok::MINUS; break;
+        case '*': Peek = LinearTok::MULT; break;
+        case '/': Peek = LinearTok::DIV; break;
+        case '^': Peek = LinearTok::POW; break;
+        case '(': Peek = LinearTok::LPAREN; break;
+        case ')': Peek = LinearTok::RPAREN; break;
+        default: Peek = LinearTok::BAD;
+    }
+}
+
+static int bindingPower(LinearTok t) {
+    switch (t) {
+        case LinearTok::PLUS:
+        case LinearTok::MINUS: return ADDITIVE_BP;
+        case LinearTok::MULT:
+        case LinearTok::DIV: return MULTIPLICATIVE_BP;
+        case LinearTok::POW: return EXPONENT_BP;
+        default: return 0;
+    }
+}
+
+// Parser::parseExpression over the lexer. What a number, the variable, a unary minus and an operator turn into is up to Actions, which
+// works out values for the fast path and writes a program for a prepared equation. Any of them can say no
+template <class Actions>
+static bool parseLinear(LinearLexer& lex, Actions& actions, int bp, typename Actions::Value& out) {
+    // NUD
+    switch (lex.Peek) {
+        case LinearTok::NUM:
+            if (!actions.number(lex.Number, out)) return false;
+            lex.advance();
+            if (lex.Peek == LinearTok::VAR || lex.Peek == LinearTok::LPAREN) lex.Implicit = true;     // 2x, 2(...)
+            break;
+        case LinearTok::VAR:
+            if (!actions.variable(lex.Text, out)) return false;
+            lex.advance();
+            if (lex.Peek == LinearTok::LPAREN) lex.Implicit = true;                                   // x(...)
+            break;
+        case LinearTok::MINUS:
+            lex.advance();
+            if (!parseLinear(lex, actions, UNARY_BP, out) || !actions.negate(out)) return false;
+            break;
+        case LinearTok::LPAREN:
+            lex.advance();
+            if (!parseLinear(lex, actions, 0, out) || lex.Peek != LinearTok::RPAREN) return false;
+            lex.advance();
+            break;
+        default:
+            return false;
+    }
+
+    // LEDs while they bind tighter
+    while (true) {
+        LinearTok op = lex.Implicit ? LinearTok::MULT : lex.Peek;
+        int op_bp = lex.Implicit ? IMPLICIT_BP : bindingPower(lex.Peek);
+        if ((!lex.Implicit && lex.Peek == LinearTok::END) || bp >= op_bp) break;
+
+        if (lex.Implicit) lex.Implicit = false;
+        else lex.advance();
+
+        // ^ is right associative
+        typename Actions::Value right;
+        if (!parseLinear(lex, actions, op == LinearTok::POW ? op_bp - 1 : op_bp, right)) return false;
+        if (!actions.combine(op, out, right)) return false;
+    }
+    return true;
+}
+
+// a whole side, the parser has to have read all of it
+template <class Actions>
+static bool parseSide(std::string_view input, Actions& actions, typename Actions::Value& out) {
+    LinearLexer lex(input);
+    return parseLinear(lex, actions, 0, out) && lex.Peek == LinearTok::END && !lex.Implicit;
+}
+
+// one variable, the first one seen
+static bool sameVariable(std::string& variable, std::string_view name) {
+    if (variable.empty()) variable = name;
+    return variable == name;
+}
+
+// ---------------- fast path ----------------
+
+struct Evaluate {
+    using Value = LinearValue;
+    std::string Variable;
+
+    bool number(i64 n, Value& out) {
+        out = Value{Rational(0), Rational(n)};
+        return true;
+    }
+    bool variable(std::string_view name, Value& out) {
+        out = Value{Rational(1), Rational(0)};
+        return sameVariable(Variable, name);
+    }
+    bool negate(Value& out) {
+        out.X.num = -out.X.num;
+        out.K.num = -out.K.num;
+        return true;
+    }
+    bool combine(LinearTok op, Value& left, const Value& right) { return combineValues(op, left, right); }
+};
+
+bool fastLinearEquation(std::string_view left, std::string_view right, LinearForm& form) {
+    Evaluate evaluate;
+    LinearValue l;
+    LinearValue r;
+    if (!parseSide(left, evaluate, l) || !parseSide(right, evaluate, r)) return false;
+    if (evaluate.Variable.empty() || !combineValues(LinearTok::MINUS, l, r)) return false;
+
+    form = LinearForm();
+    form.Constant = l.K;
+    form.addTerm(internSymbol(evaluate.Variable), l.X);
+    return true;
+}
+
+bool fastLinearSolve(const LinearForm& form, Rational& value) {
+    // c x + k = 0  ->  x = -k / c
+    if (form.Coeffs.size() != 1) return false;
+    return checkedDivide(negated(form.Constant), form.Coeffs[0].second, value);
+}
+
+// ---------------- prepared ----------------
+
+// Writes the program instead of working anything out. The checks that don't depend on the numbers happen here, once: which side of
+// a * or / can have x in it, and x under ^
+struct Compile {
+    struct Value {
+        bool HasX {false};
+    };
+    std::string Variable;
+    std::vector<PreparedLinear::Op>& Program;
+    std::vector<i64>& Literals;
+    size_t Depth {0};
+    size_t MaxDepth {0};
+
+    void push(PreparedLinear::Op op) {
+        Program.push_back(op);
+        MaxDepth = std::max(MaxDepth, ++Depth);
+    }
+
+    bool number(i64 n, Value& out) {
+        push(PreparedLinear::Op{LinearTok::NUM, static_cast<int>(Literals.size())});
+        Literals.push_back(n);
+        out.HasX = false;
+        return true;
+    }
+    bool variable(std::string_view name, Value& out) {
+        push(PreparedLinear::Op{LinearTok::VAR, 0});
+        out.HasX = true;
+        return sameVariable(Variable, name);
+    }
+    bool negate(Value&) {
+        Program.push_back(PreparedLinear::Op{LinearTok::MINUS, 0});
+        return true;
+    }
+    bool combine(LinearTok op, Value& left, const Value& right) {
+        if (op == LinearTok::MULT && left.HasX && right.HasX) return false;
+        if ((op == LinearTok::DIV || op == LinearTok::POW) && right.HasX) return false;
+        if (op == LinearTok::POW && left.HasX) return false;
+
+        Program.push_back(PreparedLinear::Op{op, 1});
+        Depth--;
+        left.HasX = left.HasX || right.HasX;
+        return true;
+    }
+};
+
+bool PreparedLinear::prepare(std::string_view left, std::string_view right) {
+    Program.clear();
+    Literals.clear();
+
+    Compile compile {"", Program, Literals};
+    Compile::Value l;
+    Compile::Value r;
+    if (!parseSide(left, compile, l) || !parseSide(right, compile, r) || (!l.HasX && !r.HasX)) {
+        Program.clear();
+        Literals.clear();
+        return false;
+    }
+    compile.combine(LinearTok::MINUS, l, r);
+
+    Symbol = internSymbol(compile.Variable);
+    Stack.resize(compile.MaxDepth);
+    return true;
+}
+
+// A unary minus is MINUS with Arg 0, a binary operator has Arg 1
+bool PreparedLinear::solve(const i64* params, Rational& value) {
+    size_t top = 0;
+    for (const Op& op : Program) {
+        switch (op.Code) {
+            case LinearTok::NUM:
+                // INT64_MIN can't be negated, nothing written down gets near it anyway
+                if (params[op.Arg] == INT64_MIN) return false;
+                Stack[top++] = LinearValue{Rational(0), Rational(params[op.Arg])};
+                break;
+            case LinearTok::VAR:
+                Stack[top++] = LinearValue{Rational(1), Rational(0)};
+                break;
+            default:
+                if (op.Code == LinearTok::MINUS && op.Arg == 0) {
+                    Stack[top - 1].X.num = -Stack[top - 1].X.num;
+                    Stack[top - 1].K.num = -Stack[top - 1].K.num;
+                    break;
+                }
+                top--;
+                if (!combineValues(op.Code, Stack[top - 1], Stack[top])) return false;
+        }
+    }
+
+    // left - right = c x + k
+    const LinearValue& form = Stack[0];
+    if (form.X.isZero()) return false;
+    return checkedDivide(negated(form.K), form.X, value);
+}
@@ -0,0 +1,68 @@
+/*
+fastlinear.hpp
+
+Fast path for the common case, an equation that is linear in a single variable like 3(x + 2) - 4 = 2x/5. Each side is read straight
+from the text into c * x + k while it's being parsed, with no tokens vector and no nodes, so none of simplify, expand and rearrange
+happen at all.
+
+The reading follows Parser's rules exactly (binding powers, implicit multiplication after a number or before a bracket, ^ to the
+right, unary minus binding tighter than * but looser than ^), so whatever it accepts comes out the same as the full path. Anything
+else, x * x, dividing by x, a second variable, text the parser would stop early on, numbers too big for 64 bits, is turned down and
+the caller goes the usual way.
+
+There are no intermediate forms to show either, so the REPL prints only the answer for an equation this takes, the same line the full
+path would end on (fastlinear_test checks the two agree).
+*/
+
+#ifndef FASTLINEAR_HPP
+#define FASTLINEAR_HPP
+
+#include <string_view>
+#include <vector>
+#include "linear.hpp"
+
+enum class LinearTok {NUM, VAR, PLUS, MINUS, MULT, DIV, POW, LPAREN, RPAREN, END, BAD};
+
+// c * x + k
+struct LinearValue {
+    Rational X {0};
+    Rational K {0};
+};
+
+// left = right as the form left - right, false if either side isn't linear in the one variable (or there's no variable at all).
+// A trailing $ ends the text the same as the end of the string
+bool fastLinearEquation(std::string_view left, std::string_view right, LinearForm& form);
+
+// the value of the only symbol in form = 0, false if its coefficient is zero or the numbers don't fit
+bool fastLinearSolve(const LinearForm& form, Rational& value);
+
+// An equation with each of its numbers turned into a parameter, in the order they're written, so 3(x + 2) - 4 = 2x/5 has five. It's
+// parsed once into a short stack program (a parameter, x, or an operator on the top two), and solving for a set of numbers runs the
+// program and one division, with no text or nodes involved. Like a prepared statement, only the numbers change between runs.
+// Whether the equation is linear at all is settled by prepare. What depends on the numbers, a zero coefficient, dividing by zero, a
+// power that isn't whole or numbers too big, makes solve return false, and that one set has to go the full way
+class PreparedLinear {
+    public:
+        // false if the equation isn't linear in a single variable whatever the numbers are
+        bool prepare(std::string_view left, std::string_view right);
+
+        size_t parameters() const { return Literals.size(); }
+        const std::vector<i64>& literals() const { return Literals; }   // the numbers as they were written
+        int symbol() const { return Symbol; }
+
+        // params holds parameters() numbers
+        bool solve(const i64* params, Rational& value);
+
+        struct Op {
+            LinearTok Code;
+            int Arg;            // the parameter for NUM, for MINUS 0 if it's the unary one
+        };
+
+    private:
+        std::vector<Op> Program;
+        std::vector<i64> Literals;
+        std::vector<LinearValue> Stack;     // as deep as the program gets, reused between solves
+        int Symbol {-1};
+};
+
+#endif
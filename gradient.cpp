@@ -0,0 +1,107 @@
+/*
+gradient.cpp
+*/
+
+#include "gradient.hpp"
+#include <algorithm>
+#include <cmath>
+
+bool GradientTape::compile(const ExpressionNode* expr, bool optimize) {
+    Bytecode code;
+    if (!code.compile(expr, optimize)) return false;
+    record(code);
+    return true;
+}
+
+void GradientTape::record(const Bytecode& code) {
+    Symbols = code.symbols();
+    uint32_t vars = static_cast<uint32_t>(Symbols.size());
+    uint32_t consts = static_cast<uint32_t>(code.constants().size());
+    Inputs = vars + consts;
+
+    // which slot each register's value is in right now. Variables and constants are never written so they keep their own
+    std::vector<uint32_t> slot_of(code.registers());
+    for (uint32_t r = 0; r < Inputs; r++) slot_of[r] = r;
+
+    Steps.clear();
+    for (const Instruction& in : code.instructions()) {
+        Steps.push_back(Step{in.Code, slot_of[in.A], slot_of[in.B], in.Power});
+        slot_of[in.Dst] = Inputs + static_cast<uint32_t>(Steps.size() - 1);
+    }
+    Result = slot_of[code.result()];
+
+    Values.assign(Inputs + Steps.size(), 0.0);
+    Adjoints.assign(Inputs + Steps.size(), 0.0);
+    std::copy(code.constants().begin(), code.constants().end(), Values.begin() + vars);
+}
+
+int GradientTape::slot(int symbol) const {
+    auto it = std::find(Symbols.begin(), Symbols.end(), symbol);
+    return it == Symbols.end() ? -1 : static_cast<int>(it - Symbols.begin());
+}
+
+double GradientTape::gradient(const double* values, double* gradient) {
+    double* v = Values.data();
+    double* adj = Adjoints.data();
+    size_t vars = Symbols.size();
+    std::copy(values, values + vars, v);
+
+    double* out = v + Inputs;
+    for (const Step& s : Steps) {
+        switch (s.Code) {
+            case OpCode::ADD:  *out = v[s.A] + v[s.B]; break;
+            case OpCode::SUB:  *out = v[s.A] - v[s.B]; break;
+            case OpCode::MUL:  *out = v[s.A] * v[s.B]; break;
+            case OpCode::DIV:  *out = v[s.A] / v[s.B]; break;
+            case OpCode::NEG:  *out = -v[s.A]; break;
+            case OpCode::POWI: *out = power(v[s.A], s.Power); break;
+            case OpCode::POW:  *out = std::pow(v[s.A], v[s.B]); break;
+        }
+        out++;
+    }
+
+    // Backwards, d(result)/d(slot) collected in adj. A step's operands come before it on the tape, so by the time a step is reached
+    // everything that reads its slot has been through and its adjoint is complete
+    std::fill(Adjoints.begin(), Adjoints.end(), 0.0);
+    adj[Result] = 1.0;
+    for (size_t i = Steps.size(); i-- > 0;) {
+        const Step& s = Steps[i];
+        double a = adj[Inputs + i];
+        if (a == 0.0) continue;
+
+        switch (s.Code) {
+            case OpCode::ADD:
+                adj[s.A] += a;
+                adj[s.B] += a;
+                break;
+            case OpCode::SUB:
+                adj[s.A] += a;
+                adj[s.B] -= a;
+                break;
+            case OpCode::MUL:
+                adj[s.A] += a * v[s.B];
+                adj[s.B] += a * v[s.A];
+                break;
+            case OpCode::DIV:
+                // (u/w)' = u'/w - (u/w) w'/w
+                adj[s.A] += a / v[s.B];
+                adj[s.B] -= a * v[Inputs + i] / v[s.B];
+                break;
+            case OpCode::NEG:
+                adj[s.A] -= a;
+                break;
+            case OpCode::POWI:
+                if (s.Power != 0) adj[s.A] += a * s.Power * power(v[s.A], s.Power - 1);
+                break;
+            case OpCode::POW:
+                // u^w = e^(w ln u). The exponent is nearly always a constant, whose log term is skipped since nobody wants it and
+                // the log of a negative base would only put a nan there
+                adj[s.A] += a * v[s.B] * std::pow(v[s.A], v[s.B] - 1.0);
+                if (s.B < vars || s.B >= Inputs) adj[s.B] += a * v[Inputs + i] * std::log(v[s.A]);
+                break;
+        }
+    }
+
+    std::copy(adj, adj + vars, gradient);
+    return v[Result];
+}
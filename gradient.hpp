@@ -0,0 +1,57 @@
+/*
+gradient.hpp
+
+Every partial derivative of a compiled expression (see bytecode.hpp) at once, by reverse mode automatic differentiation. Numbers,
+not a derivative expression: the gradient at the point given, to within the rounding of the evaluation itself.
+
+The Bytecode reuses its temporaries, so by the end of an evaluation most of the in between values are gone, and going backwards
+needs all of them. Recording turns the instructions into a tape where every instruction writes a slot of its own (variables, then
+constants, then one slot per instruction), so nothing is overwritten. gradient then runs the tape forwards for the values and once
+backwards, each instruction handing the derivative of the result with respect to it (its adjoint) on to its operands by the chain
+rule, x * y passes adjoint * y to x and adjoint * x to y and so on. Where a value is used more than once the adjoints add up.
+
+That's two passes over the instructions however many variables there are, where differencing or forward mode would be one
+evaluation per variable. A whole power costs a second power going backwards and a general one a pow and a log, so the backward pass
+is a bit dearer than the forward one, a few evaluations' worth altogether.
+*/
+
+#ifndef GRADIENT_HPP
+#define GRADIENT_HPP
+
+#include <cstdint>
+#include <vector>
+#include "bytecode.hpp"
+
+class GradientTape {
+    public:
+        // false if the expression can't be compiled (see Bytecode::compile), optimize is passed on to it
+        bool compile(const ExpressionNode* expr, bool optimize = true);
+
+        // the tape for an already compiled expression, which isn't needed afterwards
+        void record(const Bytecode& code);
+
+        // the same order as the Bytecode's, gradient's values and derivatives both go in this order
+        const std::vector<int>& symbols() const { return Symbols; }
+        int slot(int symbol) const;
+
+        size_t size() const { return Steps.size(); }
+
+        // values holds symbols().size() numbers, gradient gets the derivative with respect to each. Returns the value
+        double gradient(const double* values, double* gradient);
+
+    private:
+        struct Step {
+            OpCode Code;
+            uint32_t A, B;          // slots read, B unused by NEG and POWI
+            int32_t Power;
+        };
+
+        std::vector<Step> Steps;            // step i writes slot Inputs + i
+        std::vector<int> Symbols;
+        std::vector<double> Values;         // every slot's value, the constants already in place
+        std::vector<double> Adjoints;
+        uint32_t Inputs {0};                // variables and constants
+        uint32_t Result {0};
+};
+
+#endif
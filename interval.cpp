@@ -0,0 +1,88 @@
+/*
+interval.cpp
+*/
+
+#include "interval.hpp"
+#include "ast.hpp"
+#include "bytecode.hpp"
+
+// One walk, each visit leaves its node's bounds in Out
+class IntervalEvaluator : public ExprVisitor {
+    public:
+        explicit IntervalEvaluator(const std::vector<Interval>& box) : Box(box) {}
+
+        Interval evaluate(const ExpressionNode* u) {
+            u->accept(*this);
+            return Out;
+        }
+
+        // a double (see NumericDomain) is taken as the number it is
+        void visit(const NumberExpressionNode& node) override {
+            Out = node.Kind == InfixKind::REAL ? Interval(node.Real) : exactInterval(Rational(node.Value));
+        }
+
+        void visit(const VariableExpressionNode& node) override {
+            int id = node.Key.Symbol;
+            Out = node.Value != "Undefined" && id >= 0 && static_cast<size_t>(id) < Box.size() ? Box[id] : Interval::entire();
+        }
+
+        void visit(const PrefixExpressionNode& node) override {
+            Out = -evaluate(node.Right.get());
+        }
+
+        void visit(const InfixExpressionNode& node) override {
+            if (node.Key.Rank == OrderRank::CONSTANT) {
+                Out = exactInterval(node.Key.Value);
+                return;
+            }
+
+            int32_t n;
+            if (node.Operator == '^' && wholeExponent(node.Right.get(), n)) {
+                Out = power(evaluate(node.Left.get()), n);
+                return;
+            }
+
+            Interval left = evaluate(node.Left.get());
+            Interval right = evaluate(node.Right.get());
+            switch (node.Operator) {
+                case '+': Out = left + right; break;
+                case '-': Out = left - right; break;
+                case '*': Out = left * right; break;
+                case '/': Out = left / right; break;
+                default:  Out = power(left, right); break;
+            }
+        }
+
+        // the annotations are used as they are, a coefficient is one multiply by an exact number and an exponent one power
+        void visit(const NaryExpressionNode& node) override {
+            bool sum = node.Kind == InfixKind::PLUS;
+            Interval acc(sum ? 0.0 : 1.0);
+
+            for (size_t i = 0; i < node.Operands.size(); i++) {
+                Rational c = node.coeff(i);
+                Interval term = evaluate(node.Operands[i].get());
+
+                if (sum) {
+                    if (c == Rational(-1)) term = -term;
+                    else if (!c.isOne()) term = exactInterval(c) * term;
+                } else if (c.isInteger() && c.num <= INT32_MAX && c.num >= -INT32_MAX) {
+                    term = power(term, static_cast<int32_t>(c.num));
+                } else {
+                    term = power(term, exactInterval(c));
+                }
+
+                // the first term as it is, adding it to 0 would only widen it
+                if (i == 0) acc = term;
+                else acc = sum ? acc + term : acc * term;
+            }
+            Out = acc;
+        }
+
+    private:
+        const std::vector<Interval>& Box;
+        Interval Out;
+};
+
+Interval evaluateInterval(const ExpressionNode* expr, const std::vector<Interval>& box) {
+    return IntervalEvaluator(box).evaluate(expr);
+}
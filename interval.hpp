@@ -0,0 +1,161 @@
+/*
+interval.hpp
+
+Interval arithmetic for bounding an expression over a box, each variable somewhere in [Lo, Hi]. Every operation gives an interval
+that's sure to hold the real answer for any values in its operands, so if the result doesn't contain 0 the expression can't be 0
+anywhere in the box and a candidate there can be thrown out without looking any closer.
+
+Doubles round to nearest, so each bound that came out of an operation is moved one double outwards (by its bits, no switching the
+rounding mode, which is slow and which the optimiser doesn't know about). That's enough since a correctly rounded operation is never
+more than half a step off.
+
+Powers use the structure rather than repeated multiplying, x^2 over [-1, 2] is [0, 4] where x*x would be [-2, 4]. Dividing by an
+interval with 0 strictly inside it, or a fractional power of something that might be negative, gives the whole line, which is still
+a right answer, just one that rules nothing out. The same goes for Undefined.
+
+Two ways in: evaluateInterval walks the tree, with the box given by symbol id, and Bytecode::bounds runs the
+compiled form (see bytecode.hpp), which is the quick one when the same expression is bounded over many boxes.
+*/
+
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "rational.hpp"
+
+class ExpressionNode;
+
+struct Interval {
+    double Lo {0.0};
+    double Hi {0.0};
+
+    Interval() = default;
+    Interval(double x) : Lo(x), Hi(x) {}
+    Interval(double lo, double hi) : Lo(lo), Hi(hi) {}
+
+    static Interval entire() { return Interval(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()); }
+
+    bool contains(double x) const { return Lo <= x && x <= Hi; }
+    bool isEntire() const { return Lo == -std::numeric_limits<double>::infinity() && Hi == std::numeric_limits<double>::infinity(); }
+    double width() const { return Hi - Lo; }
+};
+
+// the next double up and down. Infinities stay where they are (down(inf) is the biggest double, still below), nan stays nan.
+// Positive numbers go up by one in their bits and negative ones down, worked out from the sign bit rather than branched on since
+// a sum's sign is anyone's guess. Adding 0 turns -0 into +0 first, which then goes up to the smallest double like +0 should
+inline double roundUp(double x) {
+    x += 0.0;
+    if (!(x < std::numeric_limits<double>::infinity())) return x;
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(x));
+    bits += 1 - 2 * (bits >> 63);
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+inline double roundDown(double x) {
+    return -roundUp(-x);
+}
+
+// an exact number, widened a little when the double isn't
+inline Interval exactInterval(const Rational& r) {
+    const i64 EXACT = i64(1) << 53;
+    double q = static_cast<double>(r.num) / static_cast<double>(r.den);
+    bool small = r.num < EXACT && r.num > -EXACT && r.den < EXACT;
+    if (small && std::fma(q, static_cast<double>(r.den), -static_cast<double>(r.num)) == 0.0) return Interval(q);
+
+    // two conversions and a division, none more than half a step off
+    return Interval(roundDown(roundDown(q)), roundUp(roundUp(q)));
+}
+
+inline Interval operator+(const Interval& a, const Interval& b) {
+    return Interval(roundDown(a.Lo + b.Lo), roundUp(a.Hi + b.Hi));
+}
+
+inline Interval operator-(const Interval& a, const Interval& b) {
+    return Interval(roundDown(a.Lo - b.Hi), roundUp(a.Hi - b.Lo));
+}
+
+inline Interval operator-(const Interval& a) {
+    return Interval(-a.Hi, -a.Lo);
+}
+
+// 0 * inf is taken as 0, the infinite end stands for numbers that are big but not infinite
+inline double boundProduct(double a, double b) {
+    return (a == 0.0 || b == 0.0) ? 0.0 : a * b;
+}
+
+inline Interval operator*(const Interval& a, const Interval& b) {
+    double p1 = a.Lo * b.Lo, p2 = a.Lo * b.Hi, p3 = a.Hi * b.Lo, p4 = a.Hi * b.Hi;
+
+    // a nan means there was an infinite end (or one already came in), only then are the products checked one by one
+    if (std::isnan(p1 + p2 + p3 + p4)) {
+        p1 = boundProduct(a.Lo, b.Lo), p2 = boundProduct(a.Lo, b.Hi);
+        p3 = boundProduct(a.Hi, b.Lo), p4 = boundProduct(a.Hi, b.Hi);
+    }
+    return Interval(roundDown(std::min(std::min(p1, p2), std::min(p3, p4))), roundUp(std::max(std::max(p1, p2), std::max(p3, p4))));
+}
+
+inline Interval operator/(const Interval& a, const Interval& b) {
+    const double INF = std::numeric_limits<double>::infinity();
+    if (b.Lo > 0.0 || b.Hi < 0.0) {
+        double q1 = a.Lo / b.Lo, q2 = a.Lo / b.Hi, q3 = a.Hi / b.Lo, q4 = a.Hi / b.Hi;
+        if (std::isnan(q1) || std::isnan(q2) || std::isnan(q3) || std::isnan(q4)) return Interval::entire();    // inf / inf
+        return Interval(roundDown(std::min(std::min(q1, q2), std::min(q3, q4))), roundUp(std::max(std::max(q1, q2), std::max(q3, q4))));
+    }
+
+    // 0 at one end only, the reciprocal goes off to infinity on one side
+    if (b.Lo == 0.0 && b.Hi > 0.0) return a * Interval(roundDown(1.0 / b.Hi), INF);
+    if (b.Hi == 0.0 && b.Lo < 0.0) return a * Interval(-INF, roundUp(1.0 / b.Lo));
+    return Interval::entire();
+}
+
+// x^n for x >= 0 by squaring, every multiplication rounded the same way so the whole thing is
+inline double boundPower(double x, uint64_t n, bool up) {
+    double result = 1.0;
+    for (; n > 0; n >>= 1) {
+        if (n & 1) result = up ? roundUp(result * x) : roundDown(result * x);
+        if (n > 1) x = up ? roundUp(x * x) : roundDown(x * x);
+    }
+    return std::max(result, 0.0);
+}
+
+inline Interval power(const Interval& a, int32_t n) {
+    if (n == 0) return Interval(1.0);
+    if (n < 0) return Interval(1.0) / power(a, -n);
+
+    uint64_t m = static_cast<uint64_t>(n);
+    if (n % 2 == 0) {
+        // even, the smallest magnitude gives the bottom
+        if (a.Lo >= 0.0) return Interval(boundPower(a.Lo, m, false), boundPower(a.Hi, m, true));
+        if (a.Hi <= 0.0) return Interval(boundPower(-a.Hi, m, false), boundPower(-a.Lo, m, true));
+        return Interval(0.0, boundPower(std::max(-a.Lo, a.Hi), m, true));
+    }
+
+    // odd, increasing all the way along
+    double lo = a.Lo >= 0.0 ? boundPower(a.Lo, m, false) : -boundPower(-a.Lo, m, true);
+    double hi = a.Hi >= 0.0 ? boundPower(a.Hi, m, true) : -boundPower(-a.Hi, m, false);
+    return Interval(lo, hi);
+}
+
+// a^b for b that isn't whole, only bounded when a can't be negative. b ln a is bilinear in ln a and b, so the corners of the box
+// give the smallest and largest. pow isn't correctly rounded, so its answers are widened two steps rather than one
+inline Interval power(const Interval& a, const Interval& b) {
+    if (!(a.Lo >= 0.0) || (a.Lo == 0.0 && !(b.Lo > 0.0))) return Interval::entire();
+
+    double p1 = std::pow(a.Lo, b.Lo), p2 = std::pow(a.Lo, b.Hi), p3 = std::pow(a.Hi, b.Lo), p4 = std::pow(a.Hi, b.Hi);
+    if (std::isnan(p1) || std::isnan(p2) || std::isnan(p3) || std::isnan(p4)) return Interval::entire();
+    double lo = std::min(std::min(p1, p2), std::min(p3, p4));
+    double hi = std::max(std::max(p1, p2), std::max(p3, p4));
+    return Interval(std::max(roundDown(roundDown(lo)), 0.0), roundUp(roundUp(hi)));
+}
+
+// Bounds expr over the box, box[id] is the range of the variable with interned id id. A variable that's not in box gets the whole line
+Interval evaluateInterval(const ExpressionNode* expr, const std::vector<Interval>& box);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+jacobian.cpp
+*/
+
+#include "jacobian.hpp"
+#include "derivative.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+// every symbol in u, repeats and all. Constant subtrees are passed over on their synopsis without being entered
+static void collectSymbols(const ExpressionNode* u, std::vector<int>& out) {
+    if (isConstantExpr(u)) return;
+
+    switch (u->getKind()) {
+        case InfixKind::VAR:
+            if (static_cast<const VariableExpressionNode*>(u)->Value != "Undefined") out.push_back(u->Key.Symbol);
+            return;
+
+        case InfixKind::PRE_MINUS:
+            collectSymbols(static_cast<const PrefixExpressionNode*>(u)->Right.get(), out);
+            return;
+
+        case InfixKind::PLUS:
+        case InfixKind::MULTIPLY:
+            for (const auto& op : static_cast<const NaryExpressionNode*>(u)->Operands) collectSymbols(op.get(), out);
+            return;
+
+        default: {
+            auto* infix = static_cast<const InfixExpressionNode*>(u);
+            collectSymbols(infix->Left.get(), out);
+            collectSymbols(infix->Right.get(), out);
+            return;
+        }
+    }
+}
+
+int SparseJacobian::column(int symbol) const {
+    auto it = std::find(Symbols.begin(), Symbols.end(), symbol);
+    return it == Symbols.end() ? -1 : static_cast<int>(it - Symbols.begin());
+}
+
+const ExpressionNode* SparseJacobian::entry(size_t row, int column) const {
+    auto first = Columns.begin() + RowStart[row];
+    auto last = Columns.begin() + RowStart[row + 1];
+    auto it = std::lower_bound(first, last, column);
+    return it != last && *it == column ? Entries[it - Columns.begin()].get() : nullptr;
+}
+
+SparseJacobian jacobian(const std::vector<const ExpressionNode*>& equations, const std::vector<int>& unknowns, NumericDomain domain) {
+    SparseJacobian J;
+    std::unordered_map<int, int> column_of;
+    bool every_symbol = unknowns.empty();
+    for (int symbol : unknowns) {
+        if (column_of.try_emplace(symbol, static_cast<int>(J.Symbols.size())).second) J.Symbols.push_back(symbol);
+    }
+
+    // the pattern, each row's columns sorted
+    size_t n = equations.size();
+    std::vector<std::vector<int>> pattern(n);
+    std::vector<int> symbols;
+    for (size_t i = 0; i < n; i++) {
+        symbols.clear();
+        collectSymbols(equations[i], symbols);
+        for (int symbol : symbols) {
+            auto it = column_of.find(symbol);
+            if (it == column_of.end()) {
+                if (!every_symbol) continue;
+                it = column_of.emplace(symbol, static_cast<int>(J.Symbols.size())).first;
+                J.Symbols.push_back(symbol);
+            }
+            pattern[i].push_back(it->second);
+        }
+        std::sort(pattern[i].begin(), pattern[i].end());
+        pattern[i].erase(std::unique(pattern[i].begin(), pattern[i].end()), pattern[i].end());
+    }
+
+    // the rows of each column, the pattern turned on its side
+    std::vector<std::vector<size_t>> column_rows(J.Symbols.size());
+    size_t entries = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (int c : pattern[i]) column_rows[c].push_back(i);
+        entries += pattern[i].size();
+    }
+
+    std::vector<size_t> row_start(n + 1, 0);
+    for (size_t i = 0; i < n; i++) row_start[i + 1] = row_start[i] + pattern[i].size();
+
+    // A column at a time, rows in order. Columns go up, so within each row the entries are filled left to right and the next one
+    // is always at that row's cursor
+    std::vector<std::unique_ptr<ExpressionNode>> derivatives(entries);
+    std::vector<size_t> cursor(row_start.begin(), row_start.end() - 1);
+    for (size_t c = 0; c < J.Symbols.size(); c++) {
+        Differentiator d(J.Symbols[c], domain);
+        for (size_t i : column_rows[c]) derivatives[cursor[i]++] = d.derivative(equations[i]);
+    }
+
+    // dropping the ones that came out 0
+    J.RowStart.push_back(0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t k = row_start[i]; k < row_start[i + 1]; k++) {
+            const ExpressionNode* u = derivatives[k].get();
+            if (u->Key.Rank == OrderRank::CONSTANT && u->Key.Value.isZero()) continue;
+            J.Columns.push_back(pattern[i][k - row_start[i]]);
+            J.Entries.push_back(std::move(derivatives[k]));
+        }
+        J.RowStart.push_back(J.Entries.size());
+    }
+    return J;
+}
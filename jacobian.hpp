@@ -0,0 +1,47 @@
+/*
+jacobian.hpp
+
+The Jacobian of a system of equations as symbols, each equation an expression read as f = 0 and entry (i, j) the derivative of
+f_i by the j-th unknown. Big systems usually have only a few unknowns in each equation, so the matrix is kept sparse in compressed
+rows (CSR): each row lists only the columns of the unknowns its equation actually has in it.
+
+Building it:
+ - Each equation is walked once for the symbols in it, skipping constant subtrees by their Synopsis. That fixes the pattern before
+   anything is differentiated, so only the entries that can be nonzero are ever looked at.
+ - The entries are then done a column at a time, with one Differentiator (see derivative.hpp) per column. A subexpression that
+   turns up in several equations has its derivative worked out once for the whole column, and only one column's memo is alive at
+   a time.
+ - An entry whose derivative cancels to 0 is dropped, so every entry stored is a real nonzero.
+
+The work goes with the number of nonzeros and the size of the equations, not rows times columns, so a system with thousands of
+equations and unknowns but a handful of unknowns per equation is cheap.
+*/
+
+#ifndef JACOBIAN_HPP
+#define JACOBIAN_HPP
+
+#include <memory>
+#include <vector>
+#include "ast.hpp"
+#include "simplifier.hpp"
+
+struct SparseJacobian {
+    std::vector<int> Symbols;                           // the unknown of each column
+    std::vector<size_t> RowStart;                       // row i is entries [RowStart[i], RowStart[i + 1])
+    std::vector<int> Columns;                           // column of each entry, increasing along a row
+    std::vector<std::unique_ptr<ExpressionNode>> Entries;   // simplified derivatives, never 0
+
+    size_t rows() const { return RowStart.empty() ? 0 : RowStart.size() - 1; }
+    size_t columns() const { return Symbols.size(); }
+    size_t nonzeros() const { return Entries.size(); }
+
+    int column(int symbol) const;                                       // -1 if it isn't an unknown
+    const ExpressionNode* entry(size_t row, int column) const;          // nullptr where it's 0
+};
+
+// equations are simplified, each read as equation = 0, and have to stay alive while this runs. unknowns are the symbols to
+// differentiate by, in column order; everything else is a parameter. Empty means every symbol, in the order they first appear
+SparseJacobian jacobian(const std::vector<const ExpressionNode*>& equations, const std::vector<int>& unknowns = {},
+                        NumericDomain domain = NumericDomain::EXACT);
+
+#endif
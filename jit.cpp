@@ -0,0 +1,304 @@
+/*
+jit.cpp
+*/
+
+#include "jit.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X64 1
+#endif
+
+#ifdef JIT_X64
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+#ifdef JIT_X64
+
+// xmm0 - xmm3 hold temporaries, xmm4 and xmm5 are scratch. Those six are the ones neither calling convention asks to be kept, so the
+// code needs no prologue at all
+static const int TEMP_XMM = 4;
+static const int WORK = 4;
+static const int SCRATCH = 5;
+
+// the two arguments, values and spill
+#ifdef _WIN32
+static const int VALUES_BASE = 1;   // rcx
+static const int SPILL_BASE = 2;    // rdx
+#else
+static const int VALUES_BASE = 7;   // rdi
+static const int SPILL_BASE = 6;    // rsi
+#endif
+
+// The table after the code, in 8 byte slots: the sign mask for negating (16 byte aligned for xorpd, with a zero after it), 1.0,
+// then the bytecode's constants
+static const int SIGN_SLOT = 0;
+static const int ONE_SLOT = 2;
+static const int CONSTANT_SLOT = 3;
+
+// SSE2 opcodes, after the F2 (scalar double) or 66 (packed double) prefix and 0F
+static const uint8_t MOVSD_LOAD = 0x10;
+static const uint8_t MOVSD_STORE = 0x11;
+static const uint8_t ADDSD = 0x58;
+static const uint8_t MULSD = 0x59;
+static const uint8_t SUBSD = 0x5C;
+static const uint8_t DIVSD = 0x5E;
+static const uint8_t XORPD = 0x57;
+
+// Where a bytecode register lives: an xmm register, [base + disp] or a slot in the table after the code
+struct Location {
+    enum {XMM, MEMORY, TABLE} Kind;
+    int Reg;            // xmm number, or the base register
+    int32_t Disp;       // bytes for MEMORY, the slot for TABLE
+};
+
+static Location xmm(int reg) { return Location{Location::XMM, reg, 0}; }
+
+class Emitter {
+    public:
+        std::vector<uint8_t> Bytes;
+
+        // table slots referenced rip relative, patched once the table's position is known
+        struct Fixup {
+            size_t At;      // the disp32, the next instruction starts right after it
+            int Slot;
+        };
+        std::vector<Fixup> Fixups;
+
+        // prefix 0F op with reg in the modrm reg field and rm as the operand
+        void sse(uint8_t prefix, uint8_t op, int reg, const Location& rm) {
+            Bytes.push_back(prefix);
+            Bytes.push_back(0x0F);
+            Bytes.push_back(op);
+
+            switch (rm.Kind) {
+                case Location::XMM:
+                    Bytes.push_back(static_cast<uint8_t>(0xC0 | (reg << 3) | rm.Reg));
+                    break;
+
+                case Location::MEMORY:
+                    if (rm.Disp >= -128 && rm.Disp <= 127) {
+                        Bytes.push_back(static_cast<uint8_t>(0x40 | (reg << 3) | rm.Reg));
+                        Bytes.push_back(static_cast<uint8_t>(rm.Disp));
+                    } else {
+                        Bytes.push_back(static_cast<uint8_t>(0x80 | (reg << 3) | rm.Reg));
+                        int32(rm.Disp);
+                    }
+                    break;
+
+                case Location::TABLE:
+                    Bytes.push_back(static_cast<uint8_t>(0x05 | (reg << 3)));
+                    Fixups.push_back(Fixup{Bytes.size(), rm.Disp});
+                    int32(0);
+                    break;
+            }
+        }
+
+        void int32(int32_t v) {
+            for (int i = 0; i < 4; i++) Bytes.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+
+        void load(int reg, const Location& from) {
+            if (from.Kind == Location::XMM && from.Reg == reg) return;
+            sse(0xF2, MOVSD_LOAD, reg, from);
+        }
+
+        void store(const Location& to, int reg) {
+            if (to.Kind == Location::XMM) load(to.Reg, xmm(reg));
+            else sse(0xF2, MOVSD_STORE, reg, to);
+        }
+
+        void arith(uint8_t op, int reg, const Location& operand) { sse(0xF2, op, reg, operand); }
+
+        void negate(int reg) { sse(0x66, XORPD, reg, Location{Location::TABLE, 0, SIGN_SLOT}); }
+
+        void ret() { Bytes.push_back(0xC3); }
+};
+
+static bool sameXmm(const Location& a, const Location& b) {
+    return a.Kind == Location::XMM && b.Kind == Location::XMM && a.Reg == b.Reg;
+}
+
+// d = a op b, straight into d when it's an xmm register that doesn't hold b, otherwise through the scratch register
+static void binary(Emitter& e, uint8_t op, const Location& d, const Location& a, const Location& b) {
+    bool commutes = op == ADDSD || op == MULSD;
+
+    if (d.Kind == Location::XMM && sameXmm(d, a)) {
+        e.arith(op, d.Reg, b);
+    } else if (d.Kind == Location::XMM && !sameXmm(d, b)) {
+        e.load(d.Reg, a);
+        e.arith(op, d.Reg, b);
+    } else if (commutes && sameXmm(d, b)) {
+        e.arith(op, d.Reg, a);
+    } else {
+        e.load(SCRATCH, a);
+        e.arith(op, SCRATCH, b);
+        e.store(d, SCRATCH);
+    }
+}
+
+// d = a^n by squaring, unrolled since n is known. Same order of multiplications as the bytecode so the answers agree to the bit.
+// The base is squared in the scratch register (a might be d)
+static void powerOf(Emitter& e, const Location& d, const Location& a, int32_t n) {
+    int w = d.Kind == Location::XMM ? d.Reg : WORK;
+    u64 m = n < 0 ? -static_cast<i64>(n) : n;
+
+    if (m == 0) {
+        e.load(w, Location{Location::TABLE, 0, ONE_SLOT});
+    } else {
+        e.load(SCRATCH, a);
+        bool first = true;
+        for (; m > 0; m >>= 1) {
+            if (m & 1) {
+                if (first) e.load(w, xmm(SCRATCH));
+                else e.arith(MULSD, w, xmm(SCRATCH));
+                first = false;
+            }
+            if (m > 1) e.arith(MULSD, SCRATCH, xmm(SCRATCH));
+        }
+        if (n < 0) {
+            e.load(SCRATCH, Location{Location::TABLE, 0, ONE_SLOT});
+            e.arith(DIVSD, SCRATCH, xmm(w));
+            e.load(w, xmm(SCRATCH));
+        }
+    }
+    if (d.Kind != Location::XMM) e.store(d, w);
+}
+
+// the machine code and the table, false if there's a general power in it
+static bool emitProgram(const Bytecode& code, Emitter& e, std::vector<double>& table, size_t& spills) {
+    size_t vars = code.symbols().size();
+    size_t consts = code.constants().size();
+    spills = 0;
+
+    auto place = [&](size_t reg) {
+        if (reg < vars) return Location{Location::MEMORY, VALUES_BASE, static_cast<int32_t>(reg * 8)};
+        if (reg < vars + consts) return Location{Location::TABLE, 0, static_cast<int32_t>(CONSTANT_SLOT + reg - vars)};
+        size_t temp = reg - vars - consts;
+        if (temp < TEMP_XMM) return xmm(static_cast<int>(temp));
+        spills = std::max(spills, temp - TEMP_XMM + 1);
+        return Location{Location::MEMORY, SPILL_BASE, static_cast<int32_t>((temp - TEMP_XMM) * 8)};
+    };
+
+    for (const Instruction& in : code.instructions()) {
+        Location d = place(in.Dst), a = place(in.A), b = place(in.B);
+        switch (in.Code) {
+            case OpCode::ADD: binary(e, ADDSD, d, a, b); break;
+            case OpCode::SUB: binary(e, SUBSD, d, a, b); break;
+            case OpCode::MUL: binary(e, MULSD, d, a, b); break;
+            case OpCode::DIV: binary(e, DIVSD, d, a, b); break;
+            case OpCode::POWI: powerOf(e, d, a, in.Power); break;
+
+            case OpCode::NEG:
+                if (d.Kind == Location::XMM) {
+                    e.load(d.Reg, a);
+                    e.negate(d.Reg);
+                } else {
+                    e.load(SCRATCH, a);
+                    e.negate(SCRATCH);
+                    e.store(d, SCRATCH);
+                }
+                break;
+
+            case OpCode::POW:
+                return false;
+        }
+    }
+
+    // the result goes back in xmm0
+    e.load(0, place(code.result()));
+    e.ret();
+
+    u64 sign = u64(1) << 63;
+    double negative_zero;
+    std::memcpy(&negative_zero, &sign, sizeof(double));
+    table = {negative_zero, 0.0, 1.0};
+    table.insert(table.end(), code.constants().begin(), code.constants().end());
+    return true;
+}
+
+#endif
+
+
+JitExpression::~JitExpression() {
+    release();
+}
+
+void JitExpression::release() {
+#ifdef JIT_X64
+    if (Page) {
+#ifdef _WIN32
+        VirtualFree(Page, 0, MEM_RELEASE);
+#else
+        munmap(Page, PageSize);
+#endif
+    }
+#endif
+    Page = nullptr;
+    PageSize = 0;
+    CodeSize = 0;
+    Native = nullptr;
+}
+
+bool JitExpression::compile(const ExpressionNode* expr, bool native, bool optimize) {
+    release();
+    if (!Code.compile(expr, optimize)) return false;
+    if (!native) return true;
+
+#ifdef JIT_X64
+    Emitter e;
+    std::vector<double> table;
+    size_t spills;
+    if (!emitProgram(Code, e, table, spills)) return true;
+    Spill.assign(spills, 0.0);
+
+    // code, then the table 16 byte aligned
+    size_t table_at = (e.Bytes.size() + 15) & ~size_t(15);
+    for (const Emitter::Fixup& f : e.Fixups) {
+        int32_t rel = static_cast<int32_t>(table_at + f.Slot * 8 - (f.At + 4));
+        std::memcpy(&e.Bytes[f.At], &rel, sizeof(rel));
+    }
+    size_t total = table_at + table.size() * sizeof(double);
+
+    // written while it's only writable, then switched to only executable
+#ifdef _WIN32
+    void* page = VirtualAlloc(nullptr, total, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!page) return true;
+#else
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    total = (total + page_size - 1) / page_size * page_size;
+    void* page = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) return true;
+#endif
+    Page = page;
+    PageSize = total;
+
+    uint8_t* bytes = static_cast<uint8_t*>(page);
+    std::memcpy(bytes, e.Bytes.data(), e.Bytes.size());
+    std::memcpy(bytes + table_at, table.data(), table.size() * sizeof(double));
+
+#ifdef _WIN32
+    DWORD old;
+    if (!VirtualProtect(page, total, PAGE_EXECUTE_READ, &old)) {
+        release();
+        return true;
+    }
+    FlushInstructionCache(GetCurrentProcess(), page, total);
+#else
+    if (mprotect(page, total, PROT_READ | PROT_EXEC) != 0) {
+        release();
+        return true;
+    }
+#endif
+
+    CodeSize = e.Bytes.size();
+    Native = reinterpret_cast<NativeFn>(page);
+#endif
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+jit.hpp
+
+For an expression evaluated so many times that even the bytecode loop's switch shows up: the Bytecode (see bytecode.hpp) is turned
+into x86-64 machine code, one or two SSE2 instructions per bytecode instruction, written into a page of its own that's then made
+executable. No compiler or library is involved, the few instruction encodings needed are written out by hand in jit.cpp.
+
+Variables are read straight from the values array, constants from a table placed just after the code, and the first few temporaries
+live in xmm registers (the rest in a spill array). Whole powers are unrolled into their multiplications since the exponent is known
+when compiling. A general power, x^(1/2), would need a call out to pow, so those expressions stay on the bytecode, and so does
+everything on a machine that isn't x86-64 or where an executable page can't be had. evaluate works the same either way.
+*/
+
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bytecode.hpp"
+
+class JitExpression {
+    public:
+        JitExpression() = default;
+        ~JitExpression();
+        JitExpression(const JitExpression&) = delete;
+        JitExpression& operator=(const JitExpression&) = delete;
+
+        // false if the expression can't be compiled at all (see Bytecode::compile). native false keeps it on the bytecode, optimize
+        // is passed on to Bytecode::compile
+        bool compile(const ExpressionNode* expr, bool native = true, bool optimize = true);
+
+        // whether evaluate runs machine code
+        bool isNative() const { return Native != nullptr; }
+        size_t codeSize() const { return CodeSize; }
+
+        const std::vector<int>& symbols() const { return Code.symbols(); }
+        int slot(int symbol) const { return Code.slot(symbol); }
+
+        // values holds symbols().size() numbers
+        double evaluate(const double* values) { return Native ? Native(values, Spill.data()) : Code.evaluate(values); }
+
+    private:
+        using NativeFn = double (*)(const double* values, double* spill);
+
+        void release();
+
+        Bytecode Code;
+        NativeFn Native {nullptr};
+        void* Page {nullptr};
+        size_t PageSize {0};
+        size_t CodeSize {0};
+        std::vector<double> Spill;
+};
+
+#endif
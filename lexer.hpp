@@ -108,6 +108,9 @@ const Token Lexer::tokenise(size_t tok_index) {
         case '/':
             tok = newToken(token::DIV, ch, tok_index);
             break;
+        case '^':
+            tok = newToken(token::POW, ch, tok_index);
+            break;
         case '(':
             tok = newToken(token::LPAREN, ch, tok_index);
             break;
@@ -174,18 +177,26 @@ char Lexer::peekChar() const {
 }
 
 std::string Lexer::readVariable() {
-    int16_t startPos = position;
+    size_t startPos = position;
     while (isLetter(ch)) {
         readChar();
     }
     return input.substr(startPos, position-startPos);
 }
 
+// digits, and a decimal point with more digits after it if there is one. Still an INT token, so 0.25x is implicit
+// multiplication the same as 2x, the parser tells them apart by the '.'
 std::string Lexer::readNumber() {
-    int startPos = position;
+    size_t startPos = position;
     while (isNumber(ch)) {
         readChar();
     }
+    if (ch == '.' && isNumber(peekChar())) {
+        readChar();
+        while (isNumber(ch)) {
+            readChar();
+        }
+    }
     return input.substr(startPos, position-startPos);
 }
 
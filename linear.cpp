@@ -0,0 +1,71 @@
+/*
+linear.cpp
+*/
+
+#include "linear.hpp"
+#include <algorithm>
+
+Rational LinearForm::coefficient(int symbol) const {
+    auto it = std::lower_bound(Coeffs.begin(), Coeffs.end(), symbol, [](const auto& term, int s) { return term.first < s; });
+    return (it != Coeffs.end() && it->first == symbol) ? it->second : Rational(0);
+}
+
+LinearForm& LinearForm::scale(const Rational& c) {
+    if (c.isZero()) {
+        Coeffs.clear();
+        Constant = Rational(0);
+        return *this;
+    }
+    for (auto& term : Coeffs) term.second *= c;
+    Constant *= c;
+    return *this;
+}
+
+LinearForm& LinearForm::addTerm(int symbol, const Rational& c) {
+    auto it = std::lower_bound(Coeffs.begin(), Coeffs.end(), symbol, [](const auto& term, int s) { return term.first < s; });
+    if (it != Coeffs.end() && it->first == symbol) {
+        it->second += c;
+        if (it->second.isZero()) Coeffs.erase(it);
+    } else if (!c.isZero()) {
+        Coeffs.insert(it, {symbol, c});
+    }
+    return *this;
+}
+
+LinearForm LinearForm::solveFor(int symbol) const {
+    // c x + rest = 0  ->  x = -rest / c
+    Rational c = coefficient(symbol);
+    LinearForm rest;
+    rest.Constant = Constant;
+    for (const auto& term : Coeffs) {
+        if (term.first != symbol) rest.Coeffs.push_back(term);
+    }
+    return rest.scale(Rational(-1) / c);
+}
+
+// merge of the two sorted coefficient lists, sign is +1 or -1 on b
+static LinearForm combine(const LinearForm& a, const LinearForm& b, const Rational& sign) {
+    LinearForm result;
+    result.Constant = a.Constant + sign * b.Constant;
+    result.Coeffs.reserve(a.Coeffs.size() + b.Coeffs.size());
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.Coeffs.size() || j < b.Coeffs.size()) {
+        if (j == b.Coeffs.size() || (i < a.Coeffs.size() && a.Coeffs[i].first < b.Coeffs[j].first)) {
+            result.Coeffs.push_back(a.Coeffs[i++]);
+        } else if (i == a.Coeffs.size() || b.Coeffs[j].first < a.Coeffs[i].first) {
+            result.Coeffs.emplace_back(b.Coeffs[j].first, sign * b.Coeffs[j].second);
+            j++;
+        } else {
+            Rational c = a.Coeffs[i].second + sign * b.Coeffs[j].second;
+            if (!c.isZero()) result.Coeffs.emplace_back(a.Coeffs[i].first, c);
+            i++;
+            j++;
+        }
+    }
+    return result;
+}
+
+LinearForm operator+(const LinearForm& a, const LinearForm& b) { return combine(a, b, Rational(1)); }
+LinearForm operator-(const LinearForm& a, const LinearForm& b) { return combine(a, b, Rational(-1)); }
@@ -0,0 +1,32 @@
+/*
+linear.hpp
+
+Linear forms c_1 x_1 + ... + c_n x_n + k over interned symbol ids, used by the equation solver. An equation left = right becomes the
+single form left - right = 0, after which moving a term across the = is subtraction and solving for a symbol is one division.
+*/
+
+#ifndef LINEAR_HPP
+#define LINEAR_HPP
+
+#include <vector>
+#include <utility>
+#include "rational.hpp"
+
+struct LinearForm {
+    std::vector<std::pair<int, Rational>> Coeffs;     // (symbol id, coefficient) sorted by id, no zero coefficients
+    Rational Constant;
+
+    bool isConstant() const { return Coeffs.empty(); }
+    Rational coefficient(int symbol) const;
+
+    LinearForm& scale(const Rational& c);
+    LinearForm& addTerm(int symbol, const Rational& c);
+
+    // the form = 0 solved for symbol, i.e. symbol = the returned form. The coefficient of symbol can't be zero
+    LinearForm solveFor(int symbol) const;
+
+    friend LinearForm operator+(const LinearForm& a, const LinearForm& b);
+    friend LinearForm operator-(const LinearForm& a, const LinearForm& b);
+};
+
+#endif
@@ -3,10 +3,14 @@
 #include "ast.hpp"
 #include "visitors.hpp"
 #include "simplifier.hpp"
+#include "system.hpp"
+#include "fastlinear.hpp"
+#include "cse.hpp"
 // #include "token.hpp"
 #include <fstream>
+#include <optional>
 
-// g++ -Wall -std=c++20 -g -O0 -mconsole -o BIN/main  Mathly/main.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp
+// g++ -Wall -std=c++20 -g -O0 -mconsole -o BIN/main  Mathly/main.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp Mathly/system.cpp Mathly/fastlinear.cpp Mathly/cse.cpp
 
 int checkParserErrors(const Parser& p) {
     std::vector<std::string> errors = p.errors;
@@ -25,12 +29,51 @@ int checkParserErrors(const Parser& p) {
 
 }
 
+// what the linear equations entered since "system" pin down, once there's more than one unknown
+void printSystem(const IncrementalSystem& system, SolveStatus status) {
+    if (status == SolveStatus::INCONSISTENT) {
+        std::cout << "system: contradicts the earlier equations, left out" << "\n";
+        return;
+    }
+    if (status == SolveStatus::OVERFLOW) {
+        std::cout << "system: numbers too big, left out" << "\n";
+        return;
+    }
+
+    std::vector<std::pair<int, Rational>> values;
+    if (!system.values(values)) {
+        std::cout << "system: values too big to show" << "\n";
+        return;
+    }
+
+    std::string line;
+    for (const auto& [symbol, value] : values) {
+        line += (line.empty() ? "" : ", ") + symbolName(symbol) + " = " + value.String();
+    }
+    std::string free;
+    for (int symbol : system.freeSymbols()) free += (free.empty() ? "" : ", ") + symbolName(symbol);
+    if (!free.empty()) line += (line.empty() ? "free " : "; free ") + free;
+    std::cout << "system: " << line << "\n";
+}
+
+// a result with the same parts in it over and over is shown again with those named once (see cse.hpp), when that's at most half
+// the length
+void printShared(const ExpressionNode* expr) {
+    SharedForm form(expr);
+    if (form.bindings().empty()) return;
+    std::string shared = form.String();
+    if (shared.size() * 2 > expr->String().size()) return;
+    std::cout << shared << "\n";
+}
+
 int main() {
     
     
     const std::string PROMPT = ">> ";
 
     bool running = true;
+    std::optional<IncrementalSystem> system;       // only while "system" is on, otherwise each equation is on its own
+    NumericDomain domain = NumericDomain::EXACT;
     std::string expr1;
     std::string expr2;
 
@@ -54,6 +97,22 @@ int main() {
             running = false;
             break;
         }   
+
+        // "double" or "exact" for Expr 1 picks how numbers are folded from then on (see NumericDomain)
+        if (expr1 == "double$" || expr1 == "exact$") {
+            domain = expr1 == "double$" ? NumericDomain::DOUBLE : NumericDomain::EXACT;
+            std::cout << "numbers are " << (domain == NumericDomain::DOUBLE ? "doubles" : "exact") << "\n";
+            continue;
+        }
+
+        // "system" for Expr 1 starts collecting the linear equations that follow into one system, solved again after each, and
+        // "reset" stops and forgets them
+        if (expr1 == "system$" || expr1 == "reset$") {
+            if (expr1 == "system$") system.emplace();
+            else system.reset();
+            std::cout << (system ? "collecting equations into a new system" : "equations are on their own") << "\n";
+            continue;
+        }
     
         // if (expr1.back() != '$') {
         //     std::cerr << "End in '$'" << std::endl;
@@ -66,6 +125,19 @@ int main() {
         //     break;
         // }
 
+        // most equations are linear in one variable, those are solved straight from the text without building any nodes. Only the
+        // answer is printed then, the same line the full path below ends on, as there's no parsed, simplified or expanded form to show
+        LinearForm quick;
+        Rational value;
+        if (domain == NumericDomain::EXACT && fastLinearEquation(expr1, expr2, quick) && fastLinearSolve(quick, value)) {
+            std::cout << symbolName(quick.Coeffs[0].first) << " = " << value.String() << "\n";
+            if (system) {
+                SolveStatus status = system->addEquation(quick);
+                if (system->unknowns() > 1) printSystem(*system, status);
+            }
+            continue;
+        }
+
         Lexer lexer = Lexer(expr1);
         Parser parser = Parser(lexer);
         auto parsedExpr = parser.parseLoop();
@@ -86,11 +158,11 @@ int main() {
             break;
         }
 
-        SimplifyVisitor visitor;
+        SimplifyVisitor visitor(domain);
         parsedExpr->accept(visitor);
         auto simplified = visitor.getResult();
 
-        SimplifyVisitor visitor2;
+        SimplifyVisitor visitor2(domain);
         parsedExpr2->accept(visitor2);
         auto simplified2 = visitor2.getResult();
 
@@ -105,6 +177,8 @@ int main() {
         //===============================================
         
         std::cout << simplified->String()  << " = "<< simplified2->String() << "\n";
+        printShared(simplified.get());
+        printShared(simplified2.get());
         
 
         
@@ -125,6 +199,23 @@ int main() {
 
 
 
+        // linear equations are converted once and solved with a single division
+        LinearForm equation;
+        if (visitor.linear_equation(simplified, simplified2, equation)) {
+            if (visitor.solve_linear(equation, simplified, simplified2)) {
+                std::cout << simplified->String()  << " = "<< simplified2->String() << "\n";
+            } else {
+                std::cout << (equation.Constant.isZero() ? "true for every value" : "no solution") << "\n";
+            }
+
+            // and folded in with the ones before it when there's a system going
+            if (system && !equation.isConstant()) {
+                SolveStatus status = system->addEquation(equation);
+                if (system->unknowns() > 1) printSystem(*system, status);
+            }
+            continue;
+        }
+
         visitor.rearrange_left(simplified, simplified2);
         std::cout << simplified->String()  << " = "<< simplified2->String() << "\n";
 
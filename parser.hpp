@@ -14,6 +14,8 @@ Data: 25/01/2025
 #include <unordered_map>
 #include <vector>
 #include <cstdint>
+#include <charconv>
+#include <system_error>
 #include "ast.hpp"
 #include "lexer.hpp"
 #include "token.hpp"
@@ -23,6 +25,7 @@ const int ADDITIVE = 10;
 const int MULTIPLICATIVE = 20;
 const int UNARY = 30;
 const int IMPLICIT_MULT = 21;
+const int EXPONENT = 40;
 
 // left binding power
 static std::map<TokenType, int> precedenceList = {
@@ -30,7 +33,8 @@ static std::map<TokenType, int> precedenceList = {
     {token::MINUS, ADDITIVE},
     {token::DIV, MULTIPLICATIVE},
     {token::MULT, MULTIPLICATIVE},
-    {token::IMPLICIT_MULT, IMPLICIT_MULT}
+    {token::IMPLICIT_MULT, IMPLICIT_MULT},
+    {token::POW, EXPONENT}
 };
 
 
@@ -74,6 +78,7 @@ class Parser {
             registerInfix(token::IMPLICIT_MULT, parseNaryExpression);
             registerInfix(token::MINUS, parseInfixExpression);
             registerInfix(token::DIV, parseInfixExpression);
+            registerInfix(token::POW, parseInfixExpression);
 
 
             nextToken();
@@ -239,10 +244,19 @@ class Parser {
         //     expr = PrefixExpressionNode();
         // }
 
+        // a literal too big for an i64 (or a double) is Undefined, the same as a number that overflows later on
         std::unique_ptr<ExpressionNode> parseNumber() {
-
-            //TODO: perhaps some error handling for conversion
-            return std::make_unique<NumberExpressionNode>(curToken, std::stoi(curToken.Literal), InfixKind::NUM);
+            const std::string& text = curToken.Literal;
+            const char* last = text.data() + text.size();
+            if (text.find('.') != std::string::npos) {
+                double d = 0.0;
+                if (std::from_chars(text.data(), last, d).ec == std::errc()) return std::make_unique<NumberExpressionNode>(curToken, d);
+            } else {
+                i64 v = 0;
+                if (std::from_chars(text.data(), last, v).ec == std::errc()) return std::make_unique<NumberExpressionNode>(curToken, v, InfixKind::NUM);
+            }
+            Token undefinedTok{token::VAR, "Undefined"};
+            return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
         }
 
         std::unique_ptr<ExpressionNode> parsePrefixExpression() { 
@@ -262,12 +276,16 @@ class Parser {
             InfixKind kind;
             if (curToken.Type == token::MINUS) { kind = InfixKind::DIFFERENCE; }
             else if (curToken.Type == token::DIV) { kind = InfixKind::DIVIDE; }
+            else if (curToken.Type == token::POW) { kind = InfixKind::POWER; }
                 
 
             std::unique_ptr<InfixExpressionNode> expr = std::make_unique<InfixExpressionNode>(curToken, *(curToken.Literal.c_str()), kind, std::move(left), nullptr);
 
             int precedence = currentPrecedence(); // get lbp
             nextToken();
+
+            // ^ is right associative, a^b^c = a^(b^c), so the right hand side is allowed to take another ^
+            if (kind == InfixKind::POWER) precedence -= 1;
             expr->Right = parseExpression(precedence);
 
             return expr;
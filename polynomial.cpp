@@ -0,0 +1,326 @@
+/*
+polynomial.cpp
+*/
+
+#include "polynomial.hpp"
+#include "dense.hpp"
+#include <algorithm>
+#include <queue>
+
+Polynomial::Polynomial(int nvars) : NumVars(nvars), Bits(nvars > 0 ? 64 / nvars : 64) {}
+
+Polynomial Polynomial::constant(int nvars, const Rational& c) {
+    Polynomial p(nvars);
+    if (!c.isZero()) p.Terms.push_back(PolyTerm{c, 0});
+    return p;
+}
+
+Polynomial Polynomial::variable(int nvars, int var) {
+    Polynomial p(nvars);
+    p.Terms.push_back(PolyTerm{Rational(1), u64(1) << p.shift(var)});
+    return p;
+}
+
+int Polynomial::exponent(u64 exps, int var) const {
+    if (Bits >= 64) return static_cast<int>(exps);
+    return static_cast<int>((exps >> shift(var)) & ((u64(1) << Bits) - 1));
+}
+
+u64 Polynomial::pack(const std::vector<int>& exps) const {
+    u64 packed = 0;
+    for (int var = 0; var < NumVars; var++) {
+        packed |= static_cast<u64>(exps[var]) << shift(var);
+    }
+    return packed;
+}
+
+Polynomial& Polynomial::scale(const Rational& c) {
+    if (c.isZero()) {
+        Terms.clear();
+        return *this;
+    }
+    for (auto& term : Terms) term.Coeff *= c;
+    return *this;
+}
+
+bool Polynomial::overflowed() const {
+    return std::any_of(Terms.begin(), Terms.end(), [](const PolyTerm& term) { return term.Coeff.isOverflow(); });
+}
+
+// repeated squaring, log n multiplications. Stops at the first overflow, which the result then has in it
+Polynomial Polynomial::pow(i64 n) const {
+    Polynomial result = constant(NumVars, Rational(1));
+    Polynomial base = *this;
+
+    while (n > 0) {
+        if (n & 1) result = result * base;
+        n >>= 1;
+        if (n > 0) base = base * base;
+        if (result.overflowed()) return result;
+        if (base.overflowed()) return base;
+    }
+    return result;
+}
+
+// merge of the two sorted term lists
+Polynomial operator+(const Polynomial& a, const Polynomial& b) {
+    Polynomial result(a.NumVars);
+    result.Terms.reserve(a.Terms.size() + b.Terms.size());
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.Terms.size() && j < b.Terms.size()) {
+        if (a.Terms[i].Exps > b.Terms[j].Exps) {
+            result.Terms.push_back(a.Terms[i++]);
+        } else if (b.Terms[j].Exps > a.Terms[i].Exps) {
+            result.Terms.push_back(b.Terms[j++]);
+        } else {
+            Rational c = a.Terms[i].Coeff + b.Terms[j].Coeff;
+            if (!c.isZero()) result.Terms.push_back(PolyTerm{c, a.Terms[i].Exps});
+            i++;
+            j++;
+        }
+    }
+    for (; i < a.Terms.size(); i++) result.Terms.push_back(a.Terms[i]);
+    for (; j < b.Terms.size(); j++) result.Terms.push_back(b.Terms[j]);
+    return result;
+}
+
+// One variable with most of the coefficients up to the degree present, clear denominators and hand the coefficient arrays to
+// multiplyDense. False when it doesn't apply or the numbers get too big, then the heap does it.
+static bool multiplyUnivariateDense(const Polynomial& a, const Polynomial& b, Polynomial& result) {
+    if (a.NumVars != 1 || a.Terms.empty() || b.Terms.empty()) return false;
+    if (std::min(a.size(), b.size()) < KARATSUBA_THRESHOLD) return false;
+
+    // Terms are in decreasing order so the first one has the degree
+    auto dense = [](const Polynomial& p) { return 2 * p.size() >= p.Terms[0].Exps + 1; };
+    if (!dense(a) || !dense(b)) return false;
+
+    // integer coefficients times the lcm of the denominators, lowest degree first
+    auto integerCoeffs = [](const Polynomial& p, std::vector<i64>& coeffs, i64& lcm) {
+        i128 l = 1;
+        for (const auto& term : p.Terms) {
+            l = l / gcd_i64(static_cast<i64>(l % term.Coeff.den), term.Coeff.den) * term.Coeff.den;
+            if (l > INT64_MAX) return false;
+        }
+        lcm = static_cast<i64>(l);
+
+        coeffs.assign(p.Terms[0].Exps + 1, 0);
+        for (const auto& term : p.Terms) {
+            i128 c = static_cast<i128>(term.Coeff.num) * (lcm / term.Coeff.den);
+            if (c > INT64_MAX || c < -INT64_MAX) return false;
+            coeffs[term.Exps] = static_cast<i64>(c);
+        }
+        return true;
+    };
+
+    std::vector<i64> ca, cb;
+    i64 la, lb;
+    if (!integerCoeffs(a, ca, la) || !integerCoeffs(b, cb, lb)) return false;
+
+    std::vector<i128> product;
+    if (!multiplyDense(ca, cb, product)) return false;
+
+    i128 den = static_cast<i128>(la) * lb;
+    result.Terms.clear();
+    for (size_t k = product.size(); k-- > 0;) {
+        if (product[k] == 0) continue;
+        result.Terms.push_back(PolyTerm{makeRational(product[k], den), static_cast<u64>(k)});
+    }
+    return true;
+}
+
+// Monagan & Pearce heap multiplication. The products f_i * g_j come out of a max heap in decreasing monomial order, so the result
+// is produced already sorted and like terms are next to each other. f_(i+1) * g_0 only goes into the heap once f_i * g_0 has come out,
+// which keeps the heap about as small as the shorter polynomial instead of holding every pair.
+Polynomial operator*(const Polynomial& a, const Polynomial& b) {
+    // the heap is over the shorter one
+    const Polynomial& f = (a.Terms.size() <= b.Terms.size()) ? a : b;
+    const Polynomial& g = (a.Terms.size() <= b.Terms.size()) ? b : a;
+
+    Polynomial result(a.NumVars);
+    if (f.Terms.empty()) return result;
+    if (multiplyUnivariateDense(a, b, result)) return result;
+
+    struct HeapEntry {
+        u64 Exps;
+        uint32_t i;
+        uint32_t j;
+        bool operator<(const HeapEntry& other) const { return Exps < other.Exps; }
+    };
+
+    std::vector<HeapEntry> storage;
+    storage.reserve(f.Terms.size());
+    std::priority_queue<HeapEntry> heap(std::less<HeapEntry>(), std::move(storage));
+    heap.push(HeapEntry{f.Terms[0].Exps + g.Terms[0].Exps, 0, 0});
+
+    while (!heap.empty()) {
+        u64 exps = heap.top().Exps;
+        Rational c(0);
+
+        // every product with this monomial
+        while (!heap.empty() && heap.top().Exps == exps) {
+            HeapEntry e = heap.top();
+            heap.pop();
+
+            c += f.Terms[e.i].Coeff * g.Terms[e.j].Coeff;
+
+            if (e.j == 0 && e.i + 1 < f.Terms.size()) {
+                heap.push(HeapEntry{f.Terms[e.i + 1].Exps + g.Terms[0].Exps, e.i + 1, 0});
+            }
+            if (e.j + 1 < g.Terms.size()) {
+                heap.push(HeapEntry{f.Terms[e.i].Exps + g.Terms[e.j + 1].Exps, e.i, e.j + 1});
+            }
+        }
+
+        if (!c.isZero()) result.Terms.push_back(PolyTerm{c, exps});
+    }
+
+    return result;
+}
+
+// ---------------- division and gcd ----------------
+
+bool Polynomial::monomialDivides(u64 b, u64 a) const {
+    for (int var = 0; var < NumVars; var++) {
+        if (exponent(b, var) > exponent(a, var)) return false;
+    }
+    return true;
+}
+
+// p * c x^exps
+static Polynomial multiplyTerm(const Polynomial& p, const PolyTerm& term) {
+    Polynomial result(p.NumVars);
+    result.Terms.reserve(p.size());
+    for (const auto& t : p.Terms) result.Terms.push_back(PolyTerm{t.Coeff * term.Coeff, t.Exps + term.Exps});
+    return result;
+}
+
+// If b divides a then every remainder on the way is (what's left of the quotient) * b, so its leading monomial has to be divisible
+// by b's. The first time it isn't there's no point going on
+bool divide(const Polynomial& a, const Polynomial& b, Polynomial& quotient) {
+    quotient = Polynomial(a.NumVars);
+    if (b.isZero() || a.overflowed() || b.overflowed()) return false;
+
+    const PolyTerm& lead = b.Terms[0];
+    Polynomial remainder = a;
+    while (!remainder.isZero()) {
+        const PolyTerm& t = remainder.Terms[0];
+        if (!a.monomialDivides(lead.Exps, t.Exps)) return false;
+
+        // leading terms get smaller every step, so the quotient comes out in order
+        PolyTerm q{t.Coeff / lead.Coeff, t.Exps - lead.Exps};
+        if (q.Coeff.isOverflow()) return false;        // it would never cancel t
+        quotient.Terms.push_back(q);
+        remainder = remainder + multiplyTerm(b, PolyTerm{-q.Coeff, q.Exps});
+    }
+    return true;
+}
+
+// The gcd works recursively: p as a polynomial in its first variable v with coefficients in the later ones. Every variable before v
+// has to be absent from everything involved, which holds because we always take the first one either side still has
+
+// the first variable in p, -1 for a constant. In lex order the leading term has it if any term does
+static int mainVariable(const Polynomial& p) {
+    if (p.isConstant()) return -1;
+    for (int var = 0; var < p.NumVars; var++) {
+        if (p.exponent(p.Terms[0].Exps, var) > 0) return var;
+    }
+    return -1;
+}
+
+static int degreeIn(const Polynomial& p, int v) {
+    return p.isZero() ? -1 : p.exponent(p.Terms[0].Exps, v);
+}
+
+// coefficients[e] is the coefficient of v^e
+static std::vector<Polynomial> coefficientsIn(const Polynomial& p, int v) {
+    std::vector<Polynomial> coeffs(degreeIn(p, v) + 1, Polynomial(p.NumVars));
+    for (const auto& term : p.Terms) {
+        int e = p.exponent(term.Exps, v);
+        coeffs[e].Terms.push_back(PolyTerm{term.Coeff, term.Exps - p.varPower(v, e)});
+    }
+    return coeffs;
+}
+
+static Polynomial gcdRec(const Polynomial& a, const Polynomial& b);
+
+// gcd of the coefficients, a polynomial in the variables after v
+static Polynomial contentIn(const Polynomial& p, int v) {
+    Polynomial content(p.NumVars);
+    for (const auto& c : coefficientsIn(p, v)) {
+        if (c.isZero()) continue;
+        content = gcdRec(content, c);
+        if (content.isConstant()) break;
+    }
+    return content;
+}
+
+static Polynomial primitivePartIn(const Polynomial& p, int v) {
+    Polynomial content = contentIn(p, v);
+    Polynomial q;
+    if (!divide(p, content, q)) return p;
+    return q.makeMonic();
+}
+
+// pseudo remainder of a by b in v, lc(b)^k a = q b + r with deg r < deg b, done without leaving polynomial coefficients
+static Polynomial pseudoRemainder(const Polynomial& a, const Polynomial& b, int v) {
+    int db = degreeIn(b, v);
+    Polynomial lead_b = coefficientsIn(b, v)[db];
+
+    Polynomial r = a;
+    while (!r.isZero() && degreeIn(r, v) >= db) {
+        int dr = degreeIn(r, v);
+        Polynomial lead_r = coefficientsIn(r, v)[dr];
+
+        // lc(b) r - lc(r) v^(dr - db) b kills the v^dr term
+        Polynomial shifted = multiplyTerm(lead_r, PolyTerm{Rational(-1), r.varPower(v, dr - db)});
+        r = lead_b * r + shifted * b;
+        if (r.overflowed()) break;      // the v^dr term didn't go, gcdRec gives up on it
+    }
+    return r;
+}
+
+// gcd = gcd of contents * primitive Euclid on the primitive parts, e.g. Geddes, Czapor & Labahn ch. 7
+static Polynomial gcdRec(const Polynomial& a, const Polynomial& b) {
+    if (a.isZero()) return Polynomial(b).makeMonic();
+    if (b.isZero()) return Polynomial(a).makeMonic();
+
+    int va = mainVariable(a);
+    int vb = mainVariable(b);
+    if (va < 0 || vb < 0) return Polynomial::constant(a.NumVars, Rational(1));
+
+    int v = std::min(va, vb);
+    Polynomial content_a = contentIn(a, v);
+    Polynomial content_b = contentIn(b, v);
+    Polynomial content = gcdRec(content_a, content_b);
+
+    // one of them doesn't have v at all, so it's its own content
+    if (degreeIn(a, v) == 0 || degreeIn(b, v) == 0) return content;
+
+    Polynomial f = primitivePartIn(a, v);
+    Polynomial g = primitivePartIn(b, v);
+    if (degreeIn(f, v) < degreeIn(g, v)) std::swap(f, g);
+
+    while (!g.isZero()) {
+        Polynomial r = pseudoRemainder(f, g, v);
+        if (r.overflowed()) return Polynomial::constant(a.NumVars, Rational(1));
+        f = std::move(g);
+        g = r.isZero() ? std::move(r) : primitivePartIn(r, v);
+
+        // a remainder free of v means the primitive parts have nothing in common
+        if (!g.isZero() && degreeIn(g, v) == 0) return content;
+    }
+
+    return (content * f).makeMonic();
+}
+
+Polynomial gcd(const Polynomial& a, const Polynomial& b) {
+    if (a.overflowed() || b.overflowed()) return Polynomial::constant(a.NumVars, Rational(1));
+    Polynomial g = gcdRec(a, b);
+
+    // the coefficients are only 64 bits, so check the answer really divides both rather than trust it
+    Polynomial q;
+    if (g.isConstant() || !divide(a, g, q) || !divide(b, g, q)) return Polynomial::constant(a.NumVars, Rational(1));
+    return g;
+}
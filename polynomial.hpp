@@ -0,0 +1,66 @@
+/*
+polynomial.hpp
+
+Sparse multivariate polynomials with rational coefficients, used by the simplifier when an expression is a polynomial in its symbols.
+Each term is a coefficient and the exponent vector packed into one machine word, Bits bits per variable, variable 0 in the highest bits.
+Comparing the packed words as integers is then lex order, and multiplying two monomials is adding the words.
+*/
+
+#ifndef POLYNOMIAL_HPP
+#define POLYNOMIAL_HPP
+
+#include <vector>
+#include <cstdint>
+#include "rational.hpp"
+
+using u64 = uint64_t;
+
+struct PolyTerm {
+    Rational Coeff;
+    u64 Exps {0};
+};
+
+class Polynomial {
+    public:
+        int NumVars {0};
+        int Bits {64};
+        std::vector<PolyTerm> Terms;     // strictly decreasing Exps, no zero coefficients
+
+        Polynomial() = default;
+        explicit Polynomial(int nvars);
+
+        static Polynomial constant(int nvars, const Rational& c);
+        static Polynomial variable(int nvars, int var);
+
+        // largest exponent a single variable can hold, the caller makes sure no product goes over it
+        int maxExponent() const { return Bits >= 31 ? INT32_MAX : static_cast<int>((u64(1) << Bits) - 1); }
+        int exponent(u64 exps, int var) const;
+        u64 pack(const std::vector<int>& exps) const;
+        u64 varPower(int var, u64 e) const { return e << shift(var); }      // packed var^e
+
+        bool monomialDivides(u64 b, u64 a) const;      // every exponent of b <= the one in a
+        bool isZero() const { return Terms.empty(); }
+        bool isConstant() const { return Terms.empty() || (Terms.size() == 1 && Terms[0].Exps == 0); }
+        size_t size() const { return Terms.size(); }
+        bool overflowed() const;        // a coefficient didn't fit in 64 bits (see Rational::overflow), nothing built from it is right
+
+        Polynomial& scale(const Rational& c);
+        Polynomial& makeMonic() { return isZero() ? *this : scale(Rational(1) / Terms[0].Coeff); }
+        Polynomial pow(i64 n) const;
+
+        friend Polynomial operator+(const Polynomial& a, const Polynomial& b);
+        friend Polynomial operator*(const Polynomial& a, const Polynomial& b);
+
+        // exact division, false if b doesn't divide a
+        friend bool divide(const Polynomial& a, const Polynomial& b, Polynomial& quotient);
+        // monic greatest common divisor, 1 if the coefficients got too big to trust the answer
+        friend Polynomial gcd(const Polynomial& a, const Polynomial& b);
+
+    private:
+        int shift(int var) const { return (NumVars - 1 - var) * Bits; }
+};
+
+bool divide(const Polynomial& a, const Polynomial& b, Polynomial& quotient);
+Polynomial gcd(const Polynomial& a, const Polynomial& b);
+
+#endif
@@ -0,0 +1,225 @@
+/*
+rational.hpp
+
+Exact rational numbers used by the simplifier for coefficients, constant values and ordering keys.
+Always kept in lowest terms with a positive denominator, so two equal values have equal fields.
+
+Results are worked out in 128 bits and checked on the way back down. One that doesn't fit in 64 is the overflow value (denominator
+0), which sticks through any further arithmetic the way a NaN does, so a long chain only needs checking at the end. The simplifier
+turns it into Undefined rather than print a number that wrapped.
+*/
+
+#ifndef RATIONAL_HPP
+#define RATIONAL_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+
+using i64 = int64_t;
+using u64 = uint64_t;
+using i128 = __int128;
+
+inline i64 gcd_i64(i64 a, i64 b) {
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+    while (b != 0) {
+        i64 temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+
+inline i128 gcd_i128(i128 a, i128 b) {
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+    while (b != 0) {
+        i128 temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+
+inline bool fitsI64(i128 v) { return v >= INT64_MIN && v <= INT64_MAX; }
+
+struct Rational {
+    i64 num {0};
+    i64 den {1};
+
+    Rational() = default;
+    Rational(i64 n) : num(n), den(1) {}
+    Rational(i64 n, i64 d) : num(n), den(d) { normalise(); }
+
+    // reduce to lowest terms, sign lives on the numerator
+    void normalise() {
+        if (den < 0) { num = -num; den = -den; }
+        i64 g = gcd_i64(num, den);
+        if (g > 1) { num /= g; den /= g; }
+    }
+
+    bool isInteger() const { return den == 1; }
+    bool isZero() const { return num == 0; }
+    bool isOne() const { return num == 1 && den == 1; }
+    bool isOverflow() const { return den == 0; }
+
+    // what a result that doesn't fit in 64 bits comes out as. Not zero, not one and not an integer, so nothing mistakes it for a value
+    static Rational overflow() {
+        Rational r;
+        r.num = 1;
+        r.den = 0;
+        return r;
+    }
+
+    std::string String() const {
+        if (den == 0) return "Undefined";
+        if (den == 1) return std::to_string(num);
+        return "(" + std::to_string(num) + " / " + std::to_string(den) + ")";
+    }
+};
+
+// n / d in lowest terms, false if it doesn't fit a Rational (or d is 0). out is only written when it fits
+inline bool narrowRational(i128 n, i128 d, Rational& out) {
+    if (d == 0) return false;
+    if (d < 0) {
+        n = -n;
+        d = -d;
+    }
+    i128 a = n < 0 ? -n : n;
+    i128 b = d;
+    if (a <= INT64_MAX && b <= INT64_MAX) {
+        // the usual case, the gcd in 64 bits since 128 bit division is a lot slower
+        u64 g = std::gcd(static_cast<u64>(a), static_cast<u64>(b));
+        if (g > 1) {
+            n /= static_cast<i64>(g);
+            d /= static_cast<i64>(g);
+        }
+    } else {
+        i128 g = gcd_i128(a, b);
+        if (g > 1) {
+            n /= g;
+            d /= g;
+        }
+    }
+    // INT64_MIN is left out too so negating never overflows
+    if (n <= INT64_MIN || n > INT64_MAX || d > INT64_MAX) return false;
+    out.num = static_cast<i64>(n);
+    out.den = static_cast<i64>(d);
+    return true;
+}
+
+// Narrow a 128 bit fraction back down, the overflow value if it doesn't fit. An overflow going in has a 0 denominator, so it comes
+// straight back out of every operator below
+inline Rational makeRational(i128 n, i128 d) {
+    Rational r;
+    if (!narrowRational(n, d, r)) return Rational::overflow();
+    return r;
+}
+
+inline Rational operator+(const Rational& a, const Rational& b) {
+    if (a.den == 1 && b.den == 1) return makeRational(static_cast<i128>(a.num) + b.num, 1);
+    return makeRational(static_cast<i128>(a.num) * b.den + static_cast<i128>(b.num) * a.den, static_cast<i128>(a.den) * b.den);
+}
+
+inline Rational operator-(const Rational& a) {
+    Rational r = a;
+    r.num = -r.num;
+    return r;
+}
+
+inline Rational operator-(const Rational& a, const Rational& b) { return a + (-b); }
+
+inline Rational operator*(const Rational& a, const Rational& b) {
+    if (a.den == 1 && b.den == 1) return makeRational(static_cast<i128>(a.num) * b.num, 1);
+    return makeRational(static_cast<i128>(a.num) * b.num, static_cast<i128>(a.den) * b.den);
+}
+
+// caller checks for division by zero (the simplifier turns it into Undefined), it comes out as the overflow value here
+inline Rational operator/(const Rational& a, const Rational& b) {
+    if (b.isOverflow()) return b;
+    return makeRational(static_cast<i128>(a.num) * b.den, static_cast<i128>(a.den) * b.num);
+}
+
+inline Rational& operator+=(Rational& a, const Rational& b) { a = a + b; return a; }
+inline Rational& operator-=(Rational& a, const Rational& b) { a = a - b; return a; }
+inline Rational& operator*=(Rational& a, const Rational& b) { a = a * b; return a; }
+
+// b^n by repeated squaring, log n multiplications, each one checked. False for 0^n with negative n and for a power that doesn't
+// fit in 64 bits, out is left alone then, so the caller can keep the power as it was
+inline bool powRational(Rational b, i64 n, Rational& out) {
+    if (b.isOverflow() || (b.isZero() && n < 0) || n == INT64_MIN) return false;
+    if (n < 0) {
+        b = Rational(1) / b;
+        n = -n;
+    }
+
+    Rational result(1);
+    while (n > 0) {
+        if (n & 1) result *= b;
+        n >>= 1;
+        if (n > 0) b *= b;
+        if (result.isOverflow() || b.isOverflow()) return false;
+    }
+    out = result;
+    return true;
+}
+
+// the same for arithmetic that carries on regardless, a power that can't be done is the overflow value like the operators give
+inline Rational powRational(const Rational& b, i64 n) {
+    Rational result;
+    return powRational(b, n, result) ? result : Rational::overflow();
+}
+
+// The same arithmetic for code that stops at the first result that doesn't fit instead of carrying the overflow value along.
+// out is only written when the result fits, and dividing by 0 is false too
+inline bool fitted(const Rational& r, Rational& out) {
+    if (r.isOverflow()) return false;
+    out = r;
+    return true;
+}
+
+inline bool checkedAdd(const Rational& a, const Rational& b, Rational& out) { return fitted(a + b, out); }
+inline bool checkedSubtract(const Rational& a, const Rational& b, Rational& out) { return fitted(a - b, out); }
+inline bool checkedMultiply(const Rational& a, const Rational& b, Rational& out) { return fitted(a * b, out); }
+inline bool checkedDivide(const Rational& a, const Rational& b, Rational& out) { return fitted(a / b, out); }
+
+// three way comparison, -1, 0, 1. Cross multiplying in 128 bits so it's exact
+inline int compareRational(const Rational& a, const Rational& b) {
+    if (a.den == b.den) return (a.num < b.num) ? -1 : (a.num > b.num);
+    i128 l = static_cast<i128>(a.num) * b.den;
+    i128 r = static_cast<i128>(b.num) * a.den;
+    return (l < r) ? -1 : (l > r);
+}
+
+// a decimal like 12.375 as the fraction its digits spell, 12375/1000 = 99/8. False if it isn't one or the digits don't fit in 64 bits
+// (zeros on the end of the fraction don't count)
+inline bool parseDecimal(const std::string& text, Rational& out) {
+    size_t end = text.size();
+    if (text.find('.') != std::string::npos) {
+        while (end > 0 && text[end - 1] == '0') end--;
+    }
+
+    i64 num = 0;
+    i64 den = 1;
+    bool point = false;
+    for (size_t i = 0; i < end; i++) {
+        if (text[i] == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (text[i] < '0' || text[i] > '9') return false;
+        if (num > (INT64_MAX - 9) / 10 || (point && den > INT64_MAX / 10)) return false;
+        num = 10 * num + (text[i] - '0');
+        if (point) den *= 10;
+    }
+    out = Rational(num, den);
+    return true;
+}
+
+inline bool operator==(const Rational& a, const Rational& b) { return a.num == b.num && a.den == b.den; }
+inline bool operator!=(const Rational& a, const Rational& b) { return !(a == b); }
+inline bool operator<(const Rational& a, const Rational& b) { return compareRational(a, b) < 0; }
+
+#endif
@@ -2,17 +2,39 @@
 #define SIMPLIFIER_CPP
 
 #include "simplifier.hpp"
+#include <cmath>
 
 
 // Main automatic simplify function
-std::unique_ptr<ExpressionNode> automatic_simplify(std::unique_ptr<ExpressionNode> expr) {
-    SimplifyVisitor visitor;
+std::unique_ptr<ExpressionNode> automatic_simplify(std::unique_ptr<ExpressionNode> expr, NumericDomain domain) {
+    SimplifyVisitor visitor(domain);
     expr->accept(visitor);
     return visitor.getResult();
 }
 
+// integers, fractions and doubles
+static bool isNumeric(const ExpressionNode* u) {
+    return u->Key.Rank == OrderRank::CONSTANT || u->Key.Rank == OrderRank::REAL;
+}
+
+static double toDouble(const Rational& r) {
+    return static_cast<double>(r.num) / static_cast<double>(r.den);
+}
+
+static double numericValue(const ExpressionNode* u) {
+    return u->Key.Rank == OrderRank::REAL ? u->Key.Real : toDouble(u->Key.Value);
+}
+
 // Visitor implementations
 void SimplifyVisitor::visit(NumberExpressionNode& node) {
+    // a decimal is the fraction its digits spell, unless we're in doubles or there are too many digits for 64 bits
+    if (node.Kind == InfixKind::REAL) {
+        Rational exact;
+        if (Domain == NumericDomain::EXACT && parseDecimal(node.Tok.Literal, exact)) result = createRational(exact);
+        else result = createReal(node.Real);
+        return;
+    }
+
     // CASE 1-2: Integer/constant nodes are already simplified
     result = std::make_unique<NumberExpressionNode>(node.Tok, node.Value, node.Kind);
 }
@@ -26,49 +48,8 @@ void SimplifyVisitor::visit(PrefixExpressionNode& node) {
     // Simplify the operand
     auto simplified_right = automatic_simplify(std::move(node.Right));
 
-    // u - v --> u + (-1) . v
-    // this way we can utilise our sum and product simplification functions, and the associative properties of these two operators
-    std::vector<std::unique_ptr<ExpressionNode>> sum_operands;
-
-    // std::vector<std::unique_ptr<ExpressionNode>> prod_operands;
-    // prod_operands.push_back(createNumber(-1));
-    // prod_operands.push_back(std::move(simplified_right));
-    // auto prod = createProduct(std::move(prod_operands));    // (-1) . v 
-
-    if (simplified_right->getKind() == InfixKind::NUM) {
-        auto right_cast = dynamic_cast<NumberExpressionNode*>(simplified_right.get());
-        auto num = createNumber(-1 * right_cast->Value);
-        sum_operands.push_back(std::move(num));
-    } else {
-        std::vector<std::unique_ptr<ExpressionNode>> prod_operands;
-        prod_operands.push_back(createNumber(-1));
-        prod_operands.push_back(std::move(simplified_right));
-        auto prod = createProduct(std::move(prod_operands));    // (-1) . v
-        auto simplified_prod = simplify_product(std::move(prod));
-        
-        sum_operands.push_back(std::move(simplified_prod));                // u + (-1) . v
-    } 
-
-
-    
-
-    Token sumToken{token::PLUS, "+"};
-
-    auto sum = std::make_unique<NaryExpressionNode>(
-        sumToken,
-        '+', 
-        InfixKind::PLUS, 
-        std::move(sum_operands)
-    );
-
-    result = simplify_sum(std::move(sum));
-    
-    // result = std::make_unique<PrefixExpressionNode>(
-    //     node.Operator, 
-    //     node.Tok, 
-    //     node.Kind, 
-    //     std::move(simplified_right)
-    // );
+    // -v is (-1) . v, but with annotated sums and products that's just flipping the sign of a coefficient, no product node to build and simplify
+    result = negate(std::move(simplified_right));
 }
 
 void SimplifyVisitor::visit(InfixExpressionNode& node) {
@@ -91,17 +72,27 @@ void SimplifyVisitor::visit(InfixExpressionNode& node) {
             return;
         }
 
-        if (left_is_integer && right_is_integer) {
-            // Fraction c/d, where c and d are integers
-            int numerator = getintValue(simplified_left.get());
-            int denominator = getintValue(simplified_right.get());
+        // a double over a number is divided there and then, anything else over one is multiplied by its reciprocal
+        bool reals = simplified_left->Key.Rank == OrderRank::REAL || simplified_right->Key.Rank == OrderRank::REAL;
+        if (reals && isNumeric(simplified_right.get())) {
+            double d = numericValue(simplified_right.get());
+            if (isNumeric(simplified_left.get())) result = createReal(numericValue(simplified_left.get()) / d);
+            else result = scaleReal(std::move(simplified_left), 1.0 / d);
+            return;
+        }
 
-            // Create a simplified fraction
-            result = simplify_rational_number(createFraction(numerator, denominator));
+        if (left_is_integer && right_is_integer) {
+            // Fraction c/d, where c and d are integers, already in lowest terms as a Rational
+            result = createRational(simplified_left->Key.Value / simplified_right->Key.Value);
         } else if ((simplified_left->getKind() == InfixKind::FRACTION) && (simplified_right->getKind() == InfixKind::FRACTION)) {
             // Quotient (a/b) / (c/d)
             result = simplify_rne(createQuotient(std::move(simplified_left), std::move(simplified_right)));
         } else {
+            // common polynomial factors top and bottom cancel now, before the quotient goes anywhere else
+            if (auto cancelled = cancel_quotient(simplified_left, simplified_right)) {
+                result = std::move(cancelled);
+                return;
+            }
 
             if (simplified_left->getKind() == InfixKind::VAR && simplified_right->getKind() == InfixKind::NUM) {
                 // x/1 -> x
@@ -125,63 +116,17 @@ void SimplifyVisitor::visit(InfixExpressionNode& node) {
             );
         }
 
+    } else if (node.Kind == InfixKind::POWER) {
+        result = simplify_power(std::move(simplified_left), std::move(simplified_right));
     } else if (node.Kind == InfixKind::DIFFERENCE) {
-        // if ((simplified_left->getKind() == InfixKind::FRACTION) && (simplified_right->getKind() == InfixKind::FRACTION)) {
-
-        //     result = simplify_rne(createDifference(std::move(simplified_left), std::move(simplified_right)));
-
-            
-
-        // } else {
-
-        //     result = std::make_unique<InfixExpressionNode>(
-        //         node.Tok,
-        //         node.Operator,
-        //         node.Kind,
-        //         std::move(simplified_left),
-        //         std::move(simplified_right)
-        //     );
-        // }
-
         // u - v --> u + (-1) . v
-        // this way we can utilise our sum and product simplification functions, and the associative properties of these two operators
+        // this way we can utilise our sum and product simplification functions, and the associative properties of these two operators.
+        // The (-1) goes straight onto v's coefficient
         std::vector<std::unique_ptr<ExpressionNode>> sum_operands;
-    
-        // std::vector<std::unique_ptr<ExpressionNode>> prod_operands;
-        // prod_operands.push_back(createNumber(-1));
-        // prod_operands.push_back(std::move(simplified_right));
-        // auto prod = createProduct(std::move(prod_operands));    // (-1) . v 
-
-        if (simplified_right->getKind() == InfixKind::NUM) {
-            auto right_cast = dynamic_cast<NumberExpressionNode*>(simplified_right.get());
-            auto num = createNumber(-1 * right_cast->Value);
-            sum_operands.push_back(std::move(simplified_left));
-            sum_operands.push_back(std::move(num));
-        } else {
-            std::vector<std::unique_ptr<ExpressionNode>> prod_operands;
-            prod_operands.push_back(createNumber(-1));
-            prod_operands.push_back(std::move(simplified_right));
-            auto prod = createProduct(std::move(prod_operands));    // (-1) . v
-            auto simplified_prod = simplify_product(std::move(prod));
-            
-
-            sum_operands.push_back(std::move(simplified_left));
-            sum_operands.push_back(std::move(simplified_prod));                // u + (-1) . v
-        } 
-
-
-        
+        sum_operands.push_back(std::move(simplified_left));
+        sum_operands.push_back(negate(std::move(simplified_right)));
 
-        Token sumToken{token::PLUS, "+"};
-
-        auto sum = std::make_unique<NaryExpressionNode>(
-            sumToken,
-            '+', 
-            InfixKind::PLUS, 
-            std::move(sum_operands)
-        );
-
-        result = simplify_sum(std::move(sum));
+        result = simplify_sum(createSum(std::move(sum_operands)));
     }
 
 }
@@ -197,38 +142,24 @@ std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_rational_number(std::u
         const InfixExpressionNode* frac = dynamic_cast<InfixExpressionNode*>(expr.get());
         if(!frac || !frac->Left || !frac->Right) return expr;
 
-        int numerator = getintValue(frac->Left.get());
-        int denominator = getintValue(frac->Right.get());
-
         // Check for division by zero
-        if (denominator == 0) {
+        if (isZero(frac->Right.get())) {
             Token undefinedTok{token::VAR, "Undefined"};
             return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
         }
 
-        // If numerator is exactly divisible by denominator, return integer quotient of numerator and denomiator
-        if (static_cast<int>(numerator) % static_cast<int>(denominator) == 0) {
-            return createNumber(numerator / denominator);
-        }
-
-        // Calculate GCD to simplify the fraction
-        int g = gcd(static_cast<int>(numerator), static_cast<int>(denominator));
-
-        // If positive
-        if (denominator > 0) {
-            return createFraction(numerator / g, denominator / g);
-        } else {    // if negative, (already check for denominator == 0 above)
-            return createFraction(-numerator / g, -denominator / g);
-        }
-
+        // Rational divides out the gcd and puts the sign on top, and createRational gives an integer when it comes out whole
+        // (a double in that domain)
+        return createRational(frac->Left->Key.Value / frac->Right->Key.Value);
     }
 
+    return expr;
 }
 
 // Helper Functions for RNE Simplification
 
 // Create a fraction node
-std::unique_ptr<InfixExpressionNode> SimplifyVisitor::createFraction(int numerator, int denominator) {
+std::unique_ptr<InfixExpressionNode> SimplifyVisitor::createFraction(i64 numerator, i64 denominator) {
     Token fracTok{token::DIV, "/"};
     auto num_node = createNumber(numerator);
     auto denom_node = createNumber(denominator);
@@ -252,152 +183,32 @@ bool SimplifyVisitor::isInteger(const ExpressionNode* node) {
 
 }
 
-// Get integer value from a node
-int SimplifyVisitor::getintValue(const ExpressionNode* node) const {
-    if (!node || node->getKind() != InfixKind::NUM) {
-        return 0; // Default, should handle errors better in real code
-    }   
-    
-    const NumberExpressionNode* num_node = dynamic_cast<const NumberExpressionNode*>(node);
-    if (num_node) {
-        return num_node->Value;
-    }
-    return 0;
-}
-
-bool SimplifyVisitor::isPlusNodeChild(const std::vector<std::unique_ptr<ExpressionNode>>&  operands) {
-    for (const auto& op : operands) {
-        if (op->getKind() == InfixKind::PLUS) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-
-// Get numerator of a fraction or integer
-int SimplifyVisitor::getNumerator(const ExpressionNode* node) const {
-    if (!node) return 0;
-    
-    if (node->getKind() == InfixKind::NUM) {
-        return getintValue(node);
-    }
-    else if (node->getKind() == InfixKind::FRACTION) {
-        const InfixExpressionNode* frac_node = dynamic_cast<const InfixExpressionNode*>(node);
-        if (frac_node && frac_node->Left) {
-            return getintValue(frac_node->Left.get());
-        }
-    }
-    return 0;
-}
-
-// Get denominator of a fraction or integer
-int SimplifyVisitor::getDenominator(const ExpressionNode* node) const {
-    if (!node) return 1;
-    
-    if (node->getKind() == InfixKind::NUM) {
-        return 1; // Denominator of an integer is 1
-    }
-    else if (node->getKind() == InfixKind::FRACTION) {
-        const InfixExpressionNode* frac_node = dynamic_cast<const InfixExpressionNode*>(node);
-        if (frac_node && frac_node->Right) {
-            return getintValue(frac_node->Right.get());
-        }
-    }
-    return 1;
-}
-
-// Calculate GCD
-int SimplifyVisitor::gcd(int a, int b) {
-    a = std::abs(a);
-    b = std::abs(b);
-    while (b != 0) {
-        int temp = b;
-        b = a % b;
-        a = temp;
-    }
-    return a;
-}
-
+// The four below work on the values the NUM and FRACTION nodes already carry in Key.Value, so the numbers are 64 bit and an
+// overflow comes out Undefined (see createRational)
 std::unique_ptr<ExpressionNode> SimplifyVisitor::evaluate_product(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right) {
-    int num_left = getNumerator(left.get());
-    int denom_left = getDenominator(left.get());
-
-    int num_right = getNumerator(right.get());
-    int denom_right = getDenominator(right.get());
-
-    // Division by zero, denom is 0
-    if (denom_left == 0 || denom_right == 0) {
-        Token undefinedTok{token::VAR, "Undefined"};
-        return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
-    }
-
     // (a/b) * (c/d) = (a*c)/(b*d)
-    int new_num = num_left * num_right;
-    int new_denom = denom_left * denom_right;
-
-    return createFraction(new_num, new_denom);
+    return createRational(left->Key.Value * right->Key.Value);
 }
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::evaluate_quotient(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right) {
-    int num_left = getNumerator(left.get());
-    int denom_left = getDenominator(left.get());
-
-    int num_right = getNumerator(right.get());
-    int denom_right = getDenominator(right.get());
-
-    // Division by zero, denom is 0
-    if (num_right == 0) {
+    // Division by zero, numerator of the right is 0
+    if (right->Key.Value.isZero()) {
         Token undefinedTok{token::VAR, "Undefined"};
         return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
     }
 
     // (a/b) / (c/d) = (a*d)/(b*c)
-    int new_num = num_left * denom_right;
-    int new_denom = denom_left * num_right;
-
-    return createFraction(new_num, new_denom);
+    return createRational(left->Key.Value / right->Key.Value);
 }
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::evaluate_sum(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right) {
-    int num_left = getNumerator(left.get());
-    int denom_left = getDenominator(left.get());
-
-    int num_right = getNumerator(right.get());
-    int denom_right = getDenominator(right.get());
-
-    // Division by zero, denom is 0
-    if (denom_left == 0 || denom_right == 0) {
-        Token undefinedTok{token::VAR, "Undefined"};
-        return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
-    }
-
     // (a/b) + (c/d) = (a*d + b*c)/(b*d) (cross multiplication)
-    int new_num = (num_left * denom_right) + (denom_left * num_right);
-    int new_denom = denom_left * denom_right;
-
-    return createFraction(new_num, new_denom);
+    return createRational(left->Key.Value + right->Key.Value);
 }
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::evaluate_difference(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right) {
-    int num_left = getNumerator(left.get());
-    int denom_left = getDenominator(left.get());
-
-    int num_right = getNumerator(right.get());
-    int denom_right = getDenominator(right.get());
-
-    // Division by zero, denom is 0
-    if (denom_left == 0 || denom_right == 0) {
-        Token undefinedTok{token::VAR, "Undefined"};
-        return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
-    }
-
     // (a/b) - (c/d) = (a*d - b*c)/(b*d) (cross multiplication)
-    int new_num = (num_left * denom_right) - (denom_left * num_right);
-    int new_denom = denom_left * denom_right;
-
-    return createFraction(new_num, new_denom);
+    return createRational(left->Key.Value - right->Key.Value);
 }
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_rne(std::unique_ptr<ExpressionNode> expr) {
@@ -497,7 +308,8 @@ void SimplifyVisitor::visit(NaryExpressionNode& node) {
             node.Tok, 
             node.Operator, 
             node.Kind, 
-            std::move(simplified_operands)
+            std::move(simplified_operands),
+            std::move(node.Coeffs)
         );
         
         result = simplify_product(std::move(product));
@@ -506,7 +318,8 @@ void SimplifyVisitor::visit(NaryExpressionNode& node) {
             node.Tok,
             node.Operator, 
             node.Kind, 
-            std::move(simplified_operands)
+            std::move(simplified_operands),
+            std::move(node.Coeffs)
         );
 
         result = simplify_sum(std::move(sum));
@@ -516,17 +329,13 @@ void SimplifyVisitor::visit(NaryExpressionNode& node) {
 // Helper method implementations
 std::unique_ptr<ExpressionNode> SimplifyVisitor::automatic_simplify(std::unique_ptr<ExpressionNode> expr) {
     // Apply the visitor to the expression
-    SimplifyVisitor visitor;
+    SimplifyVisitor visitor(Domain);
     expr->accept(visitor);
     return visitor.getResult();
 }
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_sum(std::unique_ptr<NaryExpressionNode> sum) {
-    // Get the operands
-    std::vector<std::unique_ptr<ExpressionNode>> operands;
-    for (auto& op : sum->Operands) {
-        operands.push_back(std::move(op));
-    }
+    auto& operands = sum->Operands;
 
     // SSUM-1: If any operand is Undefined, return Undefined
     for (const auto& op : operands) {
@@ -538,325 +347,271 @@ std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_sum(std::unique_ptr<Na
 
     // SSUM-2 : Unary sum simplifies to its operand.    sum = [u1] -> u1, +u -> u
     if (operands.size() == 1) {
-        return std::move(operands[0]);
+        return scale(std::move(operands[0]), sum->coeff(0));
     }
 
     //SSUM-3 : If first two rules do not apply
-    auto simplified_operands = simplify_sum_rec(operands);
-
-    // Handle the three cases from SSUM-4
-    if (simplified_operands.empty()) {
-        // SSUM-4-3: If empty, return 0
-        return createNumber(0);
-    } else if (simplified_operands.size() == 1) {
-        // SSUM-4-1: If one operand, return it
-        return std::move(simplified_operands[0]);
-    } else {
-        // SSUM-4-2: If multiple operands, construct sum
-        return std::make_unique<NaryExpressionNode>(
-            sum->Tok, 
-            sum->Operator, 
-            sum->Kind, 
-            std::move(simplified_operands)
-        );
-    }
+    auto simplified_terms = simplify_sum_rec(operands, sum->Coeffs, 0, operands.size());
+
+    // SSUM-4 : empty -> 0, one term -> that term, otherwise a sum
+    return buildSum(std::move(simplified_terms));
 }
 
-std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::simplify_sum_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands) {
-    //SSUMREC-1 : Two operands, and neither is a sum
-    if (operands.size() == 2 && !isSum(operands[0].get()) && !isSum(operands[1].get())) {
-        auto& u1 = operands[0];
-        auto& u2 = operands[1];
+// Operands in [first, last) as a sorted list of (coefficient, term) with like terms combined
+SimplifyVisitor::TermList SimplifyVisitor::simplify_sum_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands, const std::vector<Rational>& coeffs, size_t first, size_t last) {
+    auto coeffAt = [&](size_t i) { return coeffs.empty() ? Rational(1) : coeffs[i]; };
 
-        if ((u1->getKind() == InfixKind::NUM || u1->getKind() == InfixKind::FRACTION) && (u2->getKind() == InfixKind::NUM || u2->getKind() == InfixKind::FRACTION)) {
-            std::vector<std::unique_ptr<ExpressionNode>> operands;
-            operands.push_back(std::move(u1));
-            operands.push_back(std::move(u2));
-            auto sum = simplify_rne(createSum(std::move(operands)));
-
-            // If sum = 0, then, (sum identity u + 0 = u)
-            if (sum->getKind() == InfixKind::NUM) {
-                auto P = dynamic_cast<NumberExpressionNode*>(sum.get());
-
-                if ( P->Value == 0) {
-                    // std::cout << P->Value << std::endl;
-                    return {};
-                } 
-                // and if sum != 0, then
-                else {
-                    std::vector<std::unique_ptr<ExpressionNode>> result;
-                    result.push_back(createNumber(P->Value));
-                    return result;
-                }
-            
-            } else if (sum->getKind() == InfixKind::FRACTION) {
-                std::vector<std::unique_ptr<ExpressionNode>> result;
-                result.push_back(std::move(sum));
-                return result;
-            }
+    if (last - first == 1) {
+        return sumTerms(std::move(operands[first]), coeffAt(first));
+    }
 
-        }
+    if (last - first == 2) {
+        auto p = sumTerms(std::move(operands[first]), coeffAt(first));
+        auto q = sumTerms(std::move(operands[first + 1]), coeffAt(first + 1));
 
-        
-        
-        // SSUMREC-1-2: Handle identity element 1
-        if (isZero(u1.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u2));
-            return result;
-        }
-        if (isZero(u2.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u1));
-            return result;
-        }
-        
-        // SSUMREC-1-3: Handle like terms (distributive property)
-        // x + x -> 2*x
-        // 2*x + x -> 3*x, and vice versa
-        // 2*x + 2*x -> 4*x
-        if ((u1->getKind() == InfixKind::VAR && u2->getKind() == InfixKind::VAR) || 
-            (u1->getKind() == InfixKind::MULTIPLY && u2->getKind() == InfixKind::VAR) ||
-            (u1->getKind() == InfixKind::VAR && u2->getKind() == InfixKind::MULTIPLY) ||
-            (u1->getKind() == InfixKind::MULTIPLY && u2->getKind() == InfixKind::MULTIPLY)) {
-
-            bool distribute = true;
-
-            if ((u1->getKind() == InfixKind::MULTIPLY && u2->getKind() == InfixKind::MULTIPLY)) {
-                const auto& u1_cast = dynamic_cast<const NaryExpressionNode*>(operands[0].get());
-                const auto& u2_cast = dynamic_cast<const NaryExpressionNode*>(operands[1].get());
-
-                distribute = !(isPlusNodeChild(u1_cast->Operands) || isPlusNodeChild(u2_cast->Operands));
-            }
-            
-            if ( distribute ) {
-                // Extract the base and coefficient of each term
-                std::unique_ptr<ExpressionNode> base1 = nullptr;
-                std::unique_ptr<ExpressionNode> coef1 = nullptr;
-                extractBaseAndCoefficient(u1.get(), base1, coef1);
-
-                std::unique_ptr<ExpressionNode> base2 = nullptr;
-                std::unique_ptr<ExpressionNode> coef2 = nullptr;
-                extractBaseAndCoefficient(u2.get(), base2, coef2);
-
-
-
-                // If the bases are the same, combine the coefficients
-                if (base1 && base2 && (base1->String() == base2->String())) {
-                    // Create a sum of the coefficients
-                    std::vector<std::unique_ptr<ExpressionNode>> sumOperands;
-                    
-                    // If coefficients exist, use them, otherwise use 1
-                    if (coef1) {
-                        sumOperands.push_back(std::move(coef1));
-                    } else {
-                        sumOperands.push_back(createNumber(1));
-                    }
-                    
-                    if (coef2) {
-                        sumOperands.push_back(std::move(coef2));
-                    } else {
-                        sumOperands.push_back(createNumber(1));
-                    }
-                    
-                    // Simplify the sum of coefficients
-                    auto simplifiedSum = simplify_sum(createSum(std::move(sumOperands)));
-                    
-                    // // Check if the sum of coefficients is zero
-                    // if (isZero(simplifiedSum.get())) {
-                    //     return {}; // Return empty vector (zero)
-                    // }
-                    // 
-                    // Create the product of the coefficient and the base
-                    std::vector<std::unique_ptr<ExpressionNode>> productOperands;
-                    productOperands.push_back(std::move(simplifiedSum));
-                    productOperands.push_back(std::move(base1));
-                    
-                    std::vector<std::unique_ptr<ExpressionNode>> result;
-                    auto prod = simplify_product(createProduct(std::move(productOperands)));
-                    result.push_back(std::move(prod));
-                    return result;
-                }
-                
-                
-                return std::move(operands);
-                
-            }
+        //SSUMREC-1 : Two operands, and neither is a sum. Which rule applies only depends on the kinds of u1 and u2, so look it up in the table
+        if (p.size() == 1 && q.size() == 1) {
+            PairRuleFn rule = sumRuleTable[kindIndex(p[0].Node.get())][kindIndex(q[0].Node.get())];
+            return (this->*rule)(p[0], q[0]);
         }
-        
-        
-        // SSUMREC-1-4: Check ordering
-        if (operandLessThan(u2.get(), u1.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u2));
-            result.push_back(std::move(u1));
-            return result;
+
+        // SSUMREC-2: Two operands, at least one is a sum, merge their terms
+        return merge_sums(p, q);
+    }
+
+    // SSUMREC-3: More than two operands. The book peels off u1 and merges it into the rest, splitting in half instead keeps it at n log n merges
+    size_t mid = first + (last - first) / 2;
+    auto p = simplify_sum_rec(operands, coeffs, first, mid);
+    auto q = simplify_sum_rec(operands, coeffs, mid, last);
+    return merge_sums(p, q);
+}
+
+// MSUM, p and q are both sorted lists of terms. Iterative so long sums don't recurse once per term
+SimplifyVisitor::TermList SimplifyVisitor::merge_sums(TermList& p, TermList& q) {
+    // MSUM-1, MSUM-2: one of them is empty
+    if (q.empty()) return std::move(p);
+    if (p.empty()) return std::move(q);
+
+    TermList result;
+    result.reserve(p.size() + q.size());
+
+    size_t i = 0;
+    size_t j = 0;
+
+    // MSUM-3: Both non-empty
+    while (i < p.size() && j < q.size()) {
+        const ExpressionNode* p1 = p[i].Node.get();
+
+        PairRuleFn rule = sumRuleTable[kindIndex(p[i].Node.get())][kindIndex(q[j].Node.get())];
+        TermList h = (this->*rule)(p[i], q[j]);
+
+        if (h.empty()) {
+            // MSUM-3-1: p1 + q1 = 0
+            i++;
+            j++;
+        } else if (h.size() == 1) {
+            // MSUM-3-2: combined into a single term
+            result.push_back(std::move(h[0]));
+            i++;
+            j++;
+        } else if (h[0].Node.get() == p1) {
+            // MSUM-3-3: [p1, q1], p1 goes first and q1 stays to be merged with the rest of p
+            result.push_back(std::move(h[0]));
+            q[j] = std::move(h[1]);
+            i++;
+        } else {
+            // MSUM-3-4: [q1, p1]
+            result.push_back(std::move(h[0]));
+            p[i] = std::move(h[1]);
+            j++;
         }
-        
-        // SSUMREC-1-5: Return as is
-        std::vector<std::unique_ptr<ExpressionNode>> result;
-        result.push_back(std::move(u1));
-        result.push_back(std::move(u2));
-        return result;
     }
 
-    // SSUMREC-2: Two operands, at least one is a sum
-    if (operands.size() == 2) {
-        auto& u1 = operands[0];
-        auto& u2 = operands[1];
-        
-        if (isSum(u1.get()) && isSum(u2.get())) {
-            // SSUMREC-2-1: Both are sums
-            auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-            auto* p2 = dynamic_cast<NaryExpressionNode*>(u2.get());
-            
-            auto p1_operands = getNaryOperands(p1);
-            auto p2_operands = getNaryOperands(p2);
-            
-            return merge_sums(p1_operands, p2_operands);
-        } else if (isSum(u1.get())) {
-            // SSUMREC-2-2: First is a sum
-            auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-            
-            auto p1_operands = getNaryOperands(p1);
-            std::vector<std::unique_ptr<ExpressionNode>> u2_vec;
-            u2_vec.push_back(std::move(u2));
-            
-            return merge_sums(p1_operands, u2_vec);
-        } else if (isSum(u2.get())) {
-            // SSUMREC-2-3: Second is a sum
-            auto* p2 = dynamic_cast<NaryExpressionNode*>(u2.get());
-            
-            std::vector<std::unique_ptr<ExpressionNode>> u1_vec;
-            u1_vec.push_back(std::move(u1));
-            auto p2_operands = getNaryOperands(p2);
-            
-            return merge_sums(u1_vec, p2_operands);
-        }
-    }
-
-    // SSUMREC-3: More than two operands
-    auto& u1 = operands[0];
-    
-    // Create a new vector with all but the first operand
-    std::vector<std::unique_ptr<ExpressionNode>> rest;
-    for (size_t i = 1; i < operands.size(); i++) {
-        rest.push_back(std::move(operands[i]));
+    for (; i < p.size(); i++) result.push_back(std::move(p[i]));
+    for (; j < q.size(); j++) result.push_back(std::move(q[j]));
+    return result;
+}
+
+// ---------------- SSUMREC-1 / SPRDREC-1 rule table ----------------
+// Each entry handles one (kind(u1), kind(u2)) pair of simplify_sum_rec/simplify_product_rec, so a pairwise step is a single indirect call
+// instead of re-checking getKind() through a chain of ifs. A new node kind only needs its row and column filling in here.
+// For sums the operands are (coefficient, term) and for products (exponent, base).
+
+constexpr SimplifyVisitor::PairRuleTable SimplifyVisitor::buildSumRules() {
+    PairRuleTable table {};
+    for (auto& row : table) row.fill(&SimplifyVisitor::sumRuleOrder);
+
+    constexpr InfixKind constants[] = {InfixKind::NUM, InfixKind::FRACTION};
+
+    for (InfixKind k : constants) {
+        for (InfixKind j : constants) table[static_cast<size_t>(k)][static_cast<size_t>(j)] = &SimplifyVisitor::sumRuleConstants;
     }
-    
-    // Apply simplify_sum_rec to rest
-    auto w = simplify_sum_rec(rest);
-    
-    if (isSum(u1.get())) {
-        // SSUMREC-3-1: First is a sum
-        auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-        auto p1_operands = getNaryOperands(p1);
-        
-        return merge_sums(p1_operands, w);
-    } else {
-        // SSUMREC-3-2: First is not a sum
-        std::vector<std::unique_ptr<ExpressionNode>> u1_vec;
-        u1_vec.push_back(std::move(u1));
-        
-        return merge_sums(u1_vec, w);
+
+    // only an integer can be the identity element 0
+    for (size_t j = 0; j < KIND_COUNT; j++) {
+        if (j == static_cast<size_t>(InfixKind::NUM) || j == static_cast<size_t>(InfixKind::FRACTION)) continue;
+        table[static_cast<size_t>(InfixKind::NUM)][j] = &SimplifyVisitor::sumRuleIdentity;
+        table[j][static_cast<size_t>(InfixKind::NUM)] = &SimplifyVisitor::sumRuleIdentity;
+    }
+
+    // like terms can only be equal if they're the same kind of node
+    for (size_t k = 0; k < KIND_COUNT; k++) {
+        if (k == static_cast<size_t>(InfixKind::NUM) || k == static_cast<size_t>(InfixKind::FRACTION)) continue;
+        table[k][k] = &SimplifyVisitor::sumRuleLikeTerms;
+    }
+
+    // a double and any number are added in doubles. And a product with a double in front is a like term of anything its other
+    // factors could be, 0.5x and x, so products against everything but numbers have that checked first
+    constexpr size_t REAL = static_cast<size_t>(InfixKind::REAL);
+    constexpr size_t MULTIPLY = static_cast<size_t>(InfixKind::MULTIPLY);
+    for (InfixKind k : constants) {
+        table[REAL][static_cast<size_t>(k)] = &SimplifyVisitor::sumRuleReals;
+        table[static_cast<size_t>(k)][REAL] = &SimplifyVisitor::sumRuleReals;
+    }
+    table[REAL][REAL] = &SimplifyVisitor::sumRuleReals;
+
+    for (size_t k = 0; k < KIND_COUNT; k++) {
+        if (k == static_cast<size_t>(InfixKind::NUM) || k == static_cast<size_t>(InfixKind::FRACTION) || k == REAL) continue;
+        table[MULTIPLY][k] = &SimplifyVisitor::sumRuleScaledTerms;
+        table[k][MULTIPLY] = &SimplifyVisitor::sumRuleScaledTerms;
     }
 
+    return table;
 }
 
-std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::merge_sums( std::vector<std::unique_ptr<ExpressionNode>>& p, std::vector<std::unique_ptr<ExpressionNode>>& q) {
-    // MSUM-1: q is empty
-    if (q.empty()) {
-        return std::move(p);
+constexpr SimplifyVisitor::PairRuleTable SimplifyVisitor::buildProductRules() {
+    PairRuleTable table {};
+    for (auto& row : table) row.fill(&SimplifyVisitor::productRuleOrder);
+
+    constexpr InfixKind constants[] = {InfixKind::NUM, InfixKind::FRACTION};
+
+    for (InfixKind k : constants) {
+        for (InfixKind j : constants) table[static_cast<size_t>(k)][static_cast<size_t>(j)] = &SimplifyVisitor::productRuleConstants;
     }
-    
-    // MSUM-2: p is empty
-    if (p.empty()) {
-        return std::move(q);
+
+    // only an integer can be the identity element 1
+    for (size_t j = 0; j < KIND_COUNT; j++) {
+        if (j == static_cast<size_t>(InfixKind::NUM) || j == static_cast<size_t>(InfixKind::FRACTION)) continue;
+        table[static_cast<size_t>(InfixKind::NUM)][j] = &SimplifyVisitor::productRuleIdentity;
+        table[j][static_cast<size_t>(InfixKind::NUM)] = &SimplifyVisitor::productRuleIdentity;
     }
-    
-    // MSUM-3: Both non-empty
-    auto& p1 = p[0];
-    auto& q1 = q[0];
-    
-    // Create operands for simplify_sum_rec
-    std::vector<std::unique_ptr<ExpressionNode>> pair;
-    
-    // We need to clone p1 and q1 to avoid losing them because of std::moveING unique pointers
-    // For p1
-    //! Add more cloning cases as you implement functionality for more nodes
-    std::unique_ptr<ExpressionNode> p1_clone;
-    p1_clone = clone_expr(p1);
-    if (!p1_clone) {
-        std::cerr << "p1_clone didn't clone" << std::endl;
-        return {};
+
+    for (size_t k = 0; k < KIND_COUNT; k++) {
+        if (k == static_cast<size_t>(InfixKind::NUM) || k == static_cast<size_t>(InfixKind::FRACTION)) continue;
+        table[k][k] = &SimplifyVisitor::productRuleSameBase;
     }
-    
-    // For q1
-    //! Add more cloning cases as you implement functionality for more nodes
-    std::unique_ptr<ExpressionNode> q1_clone;
-    q1_clone = clone_expr(q1);
-    if (!q1_clone) {
-        std::cerr << "q1_clone didnt' clone" << std::endl;
-        return {};
+
+    // a double and any number are multiplied in doubles
+    constexpr size_t REAL = static_cast<size_t>(InfixKind::REAL);
+    for (InfixKind k : constants) {
+        table[REAL][static_cast<size_t>(k)] = &SimplifyVisitor::productRuleReals;
+        table[static_cast<size_t>(k)][REAL] = &SimplifyVisitor::productRuleReals;
     }
+    table[REAL][REAL] = &SimplifyVisitor::productRuleReals;
 
-    pair.push_back(std::move(p1_clone));
-    pair.push_back(std::move(q1_clone));
+    return table;
+}
 
-    // check if its in the correct order
-    bool isOrderedBefore = operandLessThan(pair[0].get(), pair[1].get());
+constexpr SimplifyVisitor::PairRuleTable SimplifyVisitor::sumRuleTable = SimplifyVisitor::buildSumRules();
+constexpr SimplifyVisitor::PairRuleTable SimplifyVisitor::productRuleTable = SimplifyVisitor::buildProductRules();
 
-    // Apply simplify_sum_rec
-    auto h = simplify_sum_rec(pair);
 
-    bool isOrderedAfter;
-    
-    if (h.size() == 2) {
-        isOrderedAfter = operandLessThan(h[0].get(), h[1].get()); // should always be true
-    }
-    
-    if (h.empty()) {
-        // MSUM-3-1: Result is empty (p1_clone+q1_clone = 0)
-        auto p_rest = rest(p);
-        auto q_rest = rest(q);
-        return merge_sums(p_rest, q_rest);
-    } else if (h.size() == 1) {
-        // MSUM-3-2: Result is a single operand
-        auto p_rest = rest(p);
-        auto q_rest = rest(q);
-        auto result = merge_sums(p_rest, q_rest);
-        result.insert(result.begin(), std::move(h[0]));
-        return result;
-    } else if (h.size() == 2 && (isOrderedBefore == isOrderedAfter)) {
-        // MSUM-3-3: Result is [p1, q1] (original order)
-        auto p_rest = rest(p);
-        auto result = merge_sums(p_rest, q);
-        result.insert(result.begin(), std::move(p1));
-        p.erase(p.begin());  // Remove p1
+// SSUMREC-1-1: Both constants (integers or fractions, RNE's)
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleConstants(Term& u1, Term& u2) {
+    Rational sum = u1.Coeff * u1.Node->Key.Value + u2.Coeff * u2.Node->Key.Value;
+
+    // If sum = 0, then, (sum identity u + 0 = u)
+    TermList result;
+    if (sum.isZero()) return result;
+
+    result.push_back(Term{Rational(1), createRational(sum)});
+    return result;
+}
+
+// SSUMREC-1-2: Handle identity element 0
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleIdentity(Term& u1, Term& u2) {
+    TermList result;
+    if (isZero(u1.Node.get())) {
+        result.push_back(std::move(u2));
         return result;
-    } else if (h.size() == 2) {
-        // MSUM-3-4: Result is [q1, p1] (reversed order)
-        auto q_rest = rest(q);
-        auto result = merge_sums(p, q_rest);
-        result.insert(result.begin(), std::move(q1));
-        q.erase(q.begin());  // Remove q1
+    }
+    if (isZero(u2.Node.get())) {
+        result.push_back(std::move(u1));
         return result;
     }
-    
-    // This should not happen based on the algorithm
-    return {};
 
+    return sumRuleOrder(u1, u2);
 }
 
+// SSUMREC-1-3: Handle like terms (distributive property), only the coefficients need adding
+// x + x -> 2*x
+// 2*x + x -> 3*x, and vice versa
+// 2*x + 2*x -> 4*x
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleLikeTerms(Term& u1, Term& u2) {
+    if (operandCompare(u1.Node.get(), u2.Node.get()) != 0) {
+        return sumRuleOrder(u1, u2);
+    }
 
+    TermList result;
+    Rational c = u1.Coeff + u2.Coeff;
+    if (c.isZero()) return result;
 
-std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_product(std::unique_ptr<NaryExpressionNode> product) {
-    // Get the operands
-    std::vector<std::unique_ptr<ExpressionNode>> operands;
-    for (auto& op : product->Operands) {
-        operands.push_back(std::move(op));
-        
+    result.push_back(Term{c, std::move(u1.Node)});
+    return result;
+}
+
+// SSUMREC-1-4: Check ordering, SSUMREC-1-5: Return as is
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleOrder(Term& u1, Term& u2) {
+    TermList result;
+    if (compareTerms(u2, u1) < 0) {
+        result.push_back(std::move(u2));
+        result.push_back(std::move(u1));
+    } else {
+        result.push_back(std::move(u1));
+        result.push_back(std::move(u2));
+    }
+    return result;
+}
+
+// SSUMREC-1-1 with a double in it, added in doubles
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleReals(Term& u1, Term& u2) {
+    double sum = toDouble(u1.Coeff) * numericValue(u1.Node.get()) + toDouble(u2.Coeff) * numericValue(u2.Node.get());
+
+    TermList result;
+    if (sum == 0.0) return result;
+
+    result.push_back(Term{Rational(1), createReal(sum)});
+    return result;
+}
+
+// SSUMREC-1-3 for a product with a double in front. The book adds like terms by splitting each into term(u) and const(u) (p.g. 102),
+// 0.25x + 0.5x = 0.75x. Our constants are the coefficients, which a double can't be, so that split is done here instead
+SimplifyVisitor::TermList SimplifyVisitor::sumRuleScaledTerms(Term& u1, Term& u2) {
+    bool scaled1 = hasLeadingReal(u1.Node.get());
+    bool scaled2 = hasLeadingReal(u2.Node.get());
+    if (!scaled1 && !scaled2) {
+        return u1.Node->Key.Kind == u2.Node->Key.Kind ? sumRuleLikeTerms(u1, u2) : sumRuleOrder(u1, u2);
     }
+    if (compareScaledRest(u1.Node.get(), u2.Node.get()) != 0) {
+        return sumRuleOrder(u1, u2);
+    }
+
+    auto constOf = [](const Term& t, bool scaled) {
+        double c = toDouble(t.Coeff);
+        return scaled ? c * static_cast<const NaryExpressionNode*>(t.Node.get())->Operands[0]->Key.Real : c;
+    };
+    double c = constOf(u1, scaled1) + constOf(u2, scaled2);
+
+    TermList result;
+    if (c == 0.0) return result;
+
+    // back through sumTerms in case the double came out whole, 0.5x + 1.5x is the term 2x
+    return sumTerms(scaleReal(withoutLeadingReal(std::move(u1.Node)), c), Rational(1));
+}
+
+
+std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_product(std::unique_ptr<NaryExpressionNode> product) {
+    auto& operands = product->Operands;
     
     // SPRD-1: If any operand is Undefined, return Undefined
     for (const auto& op : operands) {
@@ -866,25 +621,7 @@ std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_product(std::unique_pt
             return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
         }
     }
-    // std::cout << "Operands size before SPRD-2: " << operands.size() << std::endl;
-    // // SPRD-2: If any operand is 0, return 0
-    // // Debug information
-    // std::cout << "operands vector address: " << &operands << std::endl;
-    // std::cout << "operands size: " << operands.size() << std::endl;
-
-    // // Extra cautious iteration
-    // for (size_t i = 0; i < operands.size(); ++i) {
-    //     std::cout << "Processing index " << i << std::endl;
-    //     // Check if the unique_ptr at this index is valid before doing anything with it
-    //     if (operands[i]) {
-    //         std::cout << "Valid pointer at index " << i << std::endl;
-    //         if (isZero(operands[i].get())) {
-    //             return createNumber(0);
-    //         }
-    //     } else {
-    //         std::cout << "NULL pointer at index " << i << std::endl;
-    //     }
-    // }
+
     // SPRD-2: If any operarnd is 0, return 0
     for (const auto& op : operands) {
         if (op && isZero(op.get())) {
@@ -893,349 +630,576 @@ std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_product(std::unique_pt
     }
     
     // SPRD-3: If only one operand, return it
-    if (operands.size() == 1) {
+    if (operands.size() == 1 && product->coeff(0).isOne()) {
         return std::move(operands[0]);
     }
     
     // SPRD-4: Apply simplify_product_rec
-    auto simplified_operands = simplify_product_rec(operands);
+    auto simplified_factors = simplify_product_rec(operands, product->Coeffs, 0, operands.size());
     
-    // Handle the three cases from SPRD-4
-    if (simplified_operands.empty()) {
-        // SPRD-4-3: If empty, return 1
-        return createNumber(1);
-    } else if (simplified_operands.size() == 1) {
-        // SPRD-4-1: If one operand, return it
-        return std::move(simplified_operands[0]);
-    } else {
-        // SPRD-4-2: If multiple operands, construct product
-        return std::make_unique<NaryExpressionNode>(
-            product->Tok, 
-            product->Operator, 
-            product->Kind, 
-            std::move(simplified_operands)
-        );
-    }
+    // empty -> 1, one factor -> that factor, otherwise a product
+    return buildProduct(std::move(simplified_factors));
 }
 
-std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::simplify_product_rec(
-    std::vector<std::unique_ptr<ExpressionNode>>& operands) {
-    
-    // Base case: empty list or single operand
-    //* thought i was smart adding this, when the book already handles this in the simplify_product function
-    // if (operands.empty()) {
-    //     return {};
-    // }
-    // if (operands.size() == 1) {
-    //     std::vector<std::unique_ptr<ExpressionNode>> result;
-    //     result.push_back(std::move(operands[0]));
-    //     return result;
-    // }
-    
-    // SPRDREC-1: Two operands, neither is a product
-    if (operands.size() == 2 && !isProduct(operands[0].get()) && !isProduct(operands[1].get())) {
-        auto& u1 = operands[0];
-        auto& u2 = operands[1];
-        
-        // SPRDREC-1-1: Both constants (either integers or fractions, RNE's)
-        // // first need to check if u1 and u2 are fractions
-        // bool u1_is_fraction;
-        // bool u2_is_fraction;
-        // if (u1->getKind() == InfixKind::DIVIDE) {
-        //     // Check if both operands are integers 
-        //     auto expr = dynamic_cast<InfixExpressionNode*>(u1.get());
-        //     bool left_is_integer = isInteger(expr->Left.get());
-        //     bool right_is_integer = isInteger(expr->Right.get());
-
-        //     u1_is_fraction = (left_is_integer && right_is_integer);
-        // }
-
-        // if (u2->getKind() == InfixKind::DIVIDE) {
-        //     // Check if both operands are integers 
-        //     auto expr = dynamic_cast<InfixExpressionNode*>(u2.get());
-        //     bool left_is_integer = isInteger(expr->Left.get());
-        //     bool right_is_integer = isInteger(expr->Right.get());
-
-        //     u2_is_fraction = (left_is_integer && right_is_integer);
-        // }
-
-        // then check if they are either num or fractions
-        // if ((u1->getKind() == InfixKind::NUM || u1_is_fraction) && (u2->getKind() == InfixKind::NUM || u2_is_fraction)) {
-        if ((u1->getKind() == InfixKind::NUM || u1->getKind() == InfixKind::FRACTION) && (u2->getKind() == InfixKind::NUM || u2->getKind() == InfixKind::FRACTION)) {
-            std::vector<std::unique_ptr<ExpressionNode>> operands;
-            operands.push_back(std::move(u1));
-            operands.push_back(std::move(u2));
-            auto product = simplify_rne(createProduct(std::move(operands)));
-
-            // If product = 1, then
-            if (product->getKind() == InfixKind::NUM) {
-                auto P = dynamic_cast<NumberExpressionNode*>(product.get());
-
-                if ( P->Value == 1) {
-                    return {};
-                } 
-                // and if product != 1, then
-                else {
-                    std::vector<std::unique_ptr<ExpressionNode>> result;
-                    result.push_back(createNumber(P->Value));
-                    return result;
-                }
-                // fraction can be anything we don't really care, 1/1 will evaluate to a NumberNode equalling 1 so it will trigger the if statement above
-            } else if (product->getKind() == InfixKind::FRACTION) {
-                std::vector<std::unique_ptr<ExpressionNode>> result;
-                result.push_back(std::move(product));
-                return result;
-            }
+// Operands in [first, last) as a sorted list of (exponent, base) with equal bases combined
+SimplifyVisitor::TermList SimplifyVisitor::simplify_product_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands, const std::vector<Rational>& exponents, size_t first, size_t last) {
+    auto exponentAt = [&](size_t i) { return exponents.empty() ? Rational(1) : exponents[i]; };
 
-            
-            
-            // auto n1 = dynamic_cast<NumberExpressionNode*>(u1.get());
-            // auto n2 = dynamic_cast<NumberExpressionNode*>(u2.get());
-            
-            // if (n1 && n2) {
-            //     int product_value = n1->Value * n2->Value;
-                
-            //     if (product_value == 1) {
-            //         return {}; // Empty list for 1
-            //     } else {
-            //         std::vector<std::unique_ptr<ExpressionNode>> result;
-            //         result.push_back(createNumber(product_value));
-            //         return result;
-            //     }
-            // }
-        }
-        
-        // SPRDREC-1-2: Handle identity element 1
-        if (isOne(u1.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u2));
-            return result;
-        }
-        if (isOne(u2.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u1));
-            return result;
-        }
-        
-        // SPRDREC-1-3: Handle powers with same base
-        // (Powers not implemented yet)
-        
-        // SPRDREC-1-4: Check ordering
-        if (operandLessThan(u2.get(), u1.get())) {
-            std::vector<std::unique_ptr<ExpressionNode>> result;
-            result.push_back(std::move(u2));
-            result.push_back(std::move(u1));
-            return result;
-        }
-        
-        // SPRDREC-1-5: Return as is
-        std::vector<std::unique_ptr<ExpressionNode>> result;
-        result.push_back(std::move(u1));
-        result.push_back(std::move(u2));
-        return result;
+    if (last - first == 1) {
+        return productFactors(std::move(operands[first]), exponentAt(first));
     }
-    
-    // SPRDREC-2: Two operands, at least one is a product
-    if (operands.size() == 2) {
-        auto& u1 = operands[0];
-        auto& u2 = operands[1];
-        
-        if (isProduct(u1.get()) && isProduct(u2.get())) {
-            // SPRDREC-2-1: Both are products
-            auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-            auto* p2 = dynamic_cast<NaryExpressionNode*>(u2.get());
-            
-            auto p1_operands = getNaryOperands(p1);
-            auto p2_operands = getNaryOperands(p2);
-            
-            return merge_products(p1_operands, p2_operands);
-        } else if (isProduct(u1.get())) {
-            // SPRDREC-2-2: First is a product
-            auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-            
-            auto p1_operands = getNaryOperands(p1);
-            std::vector<std::unique_ptr<ExpressionNode>> u2_vec;
-            u2_vec.push_back(std::move(u2));
-            
-            return merge_products(p1_operands, u2_vec);
-        } else if (isProduct(u2.get())) {
-            // SPRDREC-2-3: Second is a product
-            auto* p2 = dynamic_cast<NaryExpressionNode*>(u2.get());
-            
-            std::vector<std::unique_ptr<ExpressionNode>> u1_vec;
-            u1_vec.push_back(std::move(u1));
-            auto p2_operands = getNaryOperands(p2);
-            
-            return merge_products(u1_vec, p2_operands);
+
+    if (last - first == 2) {
+        auto p = productFactors(std::move(operands[first]), exponentAt(first));
+        auto q = productFactors(std::move(operands[first + 1]), exponentAt(first + 1));
+
+        // SPRDREC-1: Two operands, neither is a product, same as SSUMREC-1
+        if (p.size() == 1 && q.size() == 1) {
+            PairRuleFn rule = productRuleTable[kindIndex(p[0].Node.get())][kindIndex(q[0].Node.get())];
+            return (this->*rule)(p[0], q[0]);
         }
+
+        // SPRDREC-2: Two operands, at least one is a product
+        return merge_products(p, q);
     }
-    
+
     // SPRDREC-3: More than two operands
-    auto& u1 = operands[0];
-    
-    // Create a new vector with all but the first operand
-    std::vector<std::unique_ptr<ExpressionNode>> rest;
-    for (size_t i = 1; i < operands.size(); i++) {
-        rest.push_back(std::move(operands[i]));
+    size_t mid = first + (last - first) / 2;
+    auto p = simplify_product_rec(operands, exponents, first, mid);
+    auto q = simplify_product_rec(operands, exponents, mid, last);
+    return merge_products(p, q);
+}
+
+// MPRD, same as merge_sums but with the product rules
+SimplifyVisitor::TermList SimplifyVisitor::merge_products(TermList& p, TermList& q) {
+    // MPRD-1, MPRD-2: one of them is empty
+    if (q.empty()) return std::move(p);
+    if (p.empty()) return std::move(q);
+
+    TermList result;
+    result.reserve(p.size() + q.size());
+
+    size_t i = 0;
+    size_t j = 0;
+
+    // MPRD-3: Both non-empty
+    while (i < p.size() && j < q.size()) {
+        const ExpressionNode* p1 = p[i].Node.get();
+
+        PairRuleFn rule = productRuleTable[kindIndex(p[i].Node.get())][kindIndex(q[j].Node.get())];
+        TermList h = (this->*rule)(p[i], q[j]);
+
+        if (h.empty()) {
+            // MPRD-3-1: p1 * q1 = 1
+            i++;
+            j++;
+        } else if (h.size() == 1) {
+            // MPRD-3-2: Result is a single operand
+            result.push_back(std::move(h[0]));
+            i++;
+            j++;
+        } else if (h[0].Node.get() == p1) {
+            // MPRD-3-3: Result is [p1, q1] (original order)
+            result.push_back(std::move(h[0]));
+            q[j] = std::move(h[1]);
+            i++;
+        } else {
+            // MPRD-3-4: Result is [q1, p1] (reversed order)
+            result.push_back(std::move(h[0]));
+            p[i] = std::move(h[1]);
+            j++;
+        }
     }
-    
-    // Apply simplify_product_rec to rest
-    auto w = simplify_product_rec(rest);
-    
-    if (isProduct(u1.get())) {
-        // SPRDREC-3-1: First is a product
-        auto* p1 = dynamic_cast<NaryExpressionNode*>(u1.get());
-        auto p1_operands = getNaryOperands(p1);
-        
-        return merge_products(p1_operands, w);
+
+    for (; i < p.size(); i++) result.push_back(std::move(p[i]));
+    for (; j < q.size(); j++) result.push_back(std::move(q[j]));
+    return result;
+}
+
+// SPRDREC-1-1: Both constants (either integers or fractions, RNE's)
+SimplifyVisitor::TermList SimplifyVisitor::productRuleConstants(Term& u1, Term& u2) {
+    // 2^(1/2) * 2^(1/2), only combine the exponents. A 1 is still the identity, 2^(1/2) * 1 is 2^(1/2)
+    if (!u1.Coeff.isOne() || !u2.Coeff.isOne()) {
+        if (isOne(u1.Node.get()) || isOne(u2.Node.get())) return productRuleIdentity(u1, u2);
+        return productRuleSameBase(u1, u2);
+    }
+
+    Rational product = u1.Node->Key.Value * u2.Node->Key.Value;
+
+    // If product = 1, then
+    TermList result;
+    if (product.isOne()) return result;
+
+    // and if product != 1
+    result.push_back(Term{Rational(1), createRational(product)});
+    return result;
+}
+
+// SPRDREC-1-2: Handle identity element 1
+SimplifyVisitor::TermList SimplifyVisitor::productRuleIdentity(Term& u1, Term& u2) {
+    TermList result;
+    if (isOne(u1.Node.get())) {
+        result.push_back(std::move(u2));
+        return result;
+    }
+    if (isOne(u2.Node.get())) {
+        result.push_back(std::move(u1));
+        return result;
+    }
+
+    return productRuleOrder(u1, u2);
+}
+
+// SPRDREC-1-3: Handle powers with same base, x^a * x^b = x^(a+b)
+SimplifyVisitor::TermList SimplifyVisitor::productRuleSameBase(Term& u1, Term& u2) {
+    if (operandCompare(u1.Node.get(), u2.Node.get()) != 0) {
+        return productRuleOrder(u1, u2);
+    }
+
+    TermList result;
+    Rational e = u1.Coeff + u2.Coeff;
+    if (e.isZero()) return result;
+
+    // a number raised to a whole power is just a number again, unless it's too big to be one
+    Rational value;
+    if (u1.Node->Key.Rank == OrderRank::CONSTANT && e.isInteger() && powRational(u1.Node->Key.Value, e.num, value)) {
+        if (!value.isOne()) result.push_back(Term{Rational(1), createRational(value)});
+        return result;
+    }
+
+    result.push_back(Term{e, std::move(u1.Node)});
+    return result;
+}
+
+// SPRDREC-1-4: Check ordering, SPRDREC-1-5: Return as is
+SimplifyVisitor::TermList SimplifyVisitor::productRuleOrder(Term& u1, Term& u2) {
+    TermList result;
+    if (compareTerms(u2, u1) < 0) {
+        result.push_back(std::move(u2));
+        result.push_back(std::move(u1));
     } else {
-        // SPRDREC-3-2: First is not a product
-        std::vector<std::unique_ptr<ExpressionNode>> u1_vec;
-        u1_vec.push_back(std::move(u1));
-        
-        return merge_products(u1_vec, w);
+        result.push_back(std::move(u1));
+        result.push_back(std::move(u2));
     }
+    return result;
 }
 
-std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::merge_products(
-    std::vector<std::unique_ptr<ExpressionNode>>& p, 
-    std::vector<std::unique_ptr<ExpressionNode>>& q) {
-    
-    // MPRD-1: q is empty
-    if (q.empty()) {
-        return std::move(p);
+// SPRDREC-1-1 with a double in it, multiplied in doubles. A power with no real value, (-0.5)^(1/2), is left as it is
+SimplifyVisitor::TermList SimplifyVisitor::productRuleReals(Term& u1, Term& u2) {
+    auto a = realPower(u1.Node.get(), u1.Coeff);
+    auto b = realPower(u2.Node.get(), u2.Coeff);
+    if (!a || !b) return productRuleOrder(u1, u2);
+
+    double product = numericValue(a.get()) * numericValue(b.get());
+
+    TermList result;
+    if (product == 1.0) return result;
+
+    result.push_back(Term{Rational(1), createReal(product)});
+    return result;
+}
+
+// SPOW, p.g. 95. v^w where v and w are already simplified
+std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_power(std::unique_ptr<ExpressionNode> v, std::unique_ptr<ExpressionNode> w) {
+    // SPOW-1: If either is Undefined, return Undefined
+    if (isUndefined(v.get()) || isUndefined(w.get())) {
+        Token undefinedTok{token::VAR, "Undefined"};
+        return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
     }
-    
-    // MPRD-2: p is empty
-    if (p.empty()) {
-        return std::move(q);
+
+    // SPOW-2: 0^w is 0 for a positive constant w, Undefined otherwise
+    if (isZero(v.get())) {
+        if (w->Key.Rank == OrderRank::CONSTANT && w->Key.Value.num > 0) return createNumber(0);
+        if (w->Key.Rank == OrderRank::REAL && w->Key.Real > 0.0) return createNumber(0);
+
+        Token undefinedTok{token::VAR, "Undefined"};
+        return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
     }
-    
-    // MPRD-3: Both non-empty
-    auto& p1 = p[0];
-    auto& q1 = q[0];
-    
-    // Create operands for simplify_product_rec
-    std::vector<std::unique_ptr<ExpressionNode>> pair;
-    
-    // We need to clone p1 and q1 to avoid losing them
-    // For p1
-    //! Add more cloning cases as you implement functionality for more nodes
-    std::unique_ptr<ExpressionNode> p1_clone;
-    p1_clone = clone_expr(p1);
-    if (!p1_clone) {
-        std::cerr << "p1_clone didn't clone" << std::endl;
-        return {};
+
+    // SPOW-3: 1^w = 1
+    if (isOne(v.get())) return createNumber(1);
+
+    // SPOW-4: integer exponent
+    if (w->Key.Kind == InfixKind::NUM) {
+        return simplify_integer_power(std::move(v), w->Key.Value.num);
     }
-    // if (p1->getKind() == InfixKind::NUM) {
-    //     auto* num = dynamic_cast<NumberExpressionNode*>(p1.get());
-    //     p1_clone = std::make_unique<NumberExpressionNode>(num->Tok, num->Value, num->Kind);
-    // } else if (p1->getKind() == InfixKind::VAR) {
-    //     auto* var = dynamic_cast<VariableExpressionNode*>(p1.get());
-    //     p1_clone = std::make_unique<VariableExpressionNode>(var->Value, var->Tok, var->Kind);
-    // } else if (p1->getKind() == InfixKind::FRACTION) {
-    //     auto* frac = dynamic_cast<InfixExpressionNode*>(p1.get());
-    //     auto* frac_numerator = dynamic_cast<NumberExpressionNode*>(frac->Left.get());
-    //     auto* frac_denominator = dynamic_cast<NumberExpressionNode*>(frac->Right.get());
-    //     p1_clone = std::make_unique<InfixExpressionNode>(frac->Tok,'/', frac->Kind,  createNumber(frac_numerator->Value), createNumber(frac_denominator->Value));
-    // } 
-    
-    
-    // For q1
-    //! Add more cloning cases as you implement functionality for more nodes
-    std::unique_ptr<ExpressionNode> q1_clone;
-    q1_clone = clone_expr(q1);
-    if (!q1_clone) {
-        std::cerr << "q1_clone didnt' clone" << std::endl;
-        return {};
+
+    // fractional exponent, kept as the exponent annotation of a one factor product
+    if (w->Key.Kind == InfixKind::FRACTION) {
+        return buildProduct(productFactors(std::move(v), w->Key.Value));
+    }
+
+    // a double exponent on a number is evaluated, on anything else it stays like a symbolic one
+    if (w->Key.Rank == OrderRank::REAL && isNumeric(v.get())) {
+        double p = std::pow(numericValue(v.get()), w->Key.Real);
+        if (!std::isnan(p)) return createReal(p);
     }
-    // if (q1->getKind() == InfixKind::NUM) {
-    //     auto* num = dynamic_cast<NumberExpressionNode*>(q1.get());
-    //     q1_clone = std::make_unique<NumberExpressionNode>(num->Tok, num->Value, num->Kind);
-    // } else if (q1->getKind() == InfixKind::VAR) {
-    //     auto* var = dynamic_cast<VariableExpressionNode*>(q1.get());
-    //     q1_clone = std::make_unique<VariableExpressionNode>(var->Value, var->Tok, var->Kind);
-    // } else if (q1->getKind() == InfixKind::FRACTION) {
-    //     auto* frac = dynamic_cast<InfixExpressionNode*>(q1.get());
-    //     auto* frac_numerator = dynamic_cast<NumberExpressionNode*>(frac->Left.get());
-    //     auto* frac_denominator = dynamic_cast<NumberExpressionNode*>(frac->Right.get());
-    //     q1_clone = std::make_unique<InfixExpressionNode>(frac->Tok,'/', frac->Kind, createNumber(frac_numerator->Value), createNumber(frac_denominator->Value));
-    // } 
-    
-    // std::cout << "p1: " << p1->String() << std::endl;
-    // std::cout << "q1: " << q1->String()<< std::endl;
-    // std::cout << "p1 clone: " << q1_clone->String() << std::endl;
-    // std::cout << "q2 clone: " << q1_clone->String()<< std::endl;
-    pair.push_back(std::move(p1_clone));
-    pair.push_back(std::move(q1_clone));
-    // std::cout << "pair[0] " << pair[0].get()->String()<< std::endl;
-    // std::cout << "pair[1] " << pair[1].get()->String()<< std::endl;
 
-    // check if its in the correct order
-    bool isOrderedBefore = operandLessThan(pair[0].get(), pair[1].get());
+    // SPOW-5: symbolic exponent, nothing to do
+    Token powToken{token::POW, "^"};
+    return std::make_unique<InfixExpressionNode>(powToken, '^', InfixKind::POWER, std::move(v), std::move(w));
+}
+
+// SINTPOW, p.g. 96. v^n for an integer n
+std::unique_ptr<ExpressionNode> SimplifyVisitor::simplify_integer_power(std::unique_ptr<ExpressionNode> v, i64 n) {
+    // SINTPOW-1: v is an integer or fraction, evaluate by repeated squaring. One that doesn't fit in 64 bits stays a power
+    if (v->Key.Rank == OrderRank::CONSTANT) {
+        if (v->Key.Value.isZero() && n < 0) {
+            Token undefinedTok{token::VAR, "Undefined"};
+            return std::make_unique<VariableExpressionNode>("Undefined", undefinedTok, InfixKind::VAR);
+        }
+        Rational value;
+        if (powRational(v->Key.Value, n, value)) return createRational(value);
+    }
 
-    // Apply simplify_product_rec
-    auto h = simplify_product_rec(pair);
+    // SINTPOW-2, SINTPOW-3: v^0 = 1, v^1 = v
+    if (n == 0) return createNumber(1);
+    if (n == 1) return v;
 
+    // SINTPOW-4, SINTPOW-5: (r^s)^n = r^(s*n) and (a*b)^n = a^n * b^n, both are just scaling the exponent annotations.
+    // sums are left alone, (a + b)^n only gets multiplied out by expand_tree
+    return buildProduct(productFactors(std::move(v), Rational(n)));
+}
 
-    bool isOrderedAfter;
-    
-    if (h.size() == 2) {
-        isOrderedAfter = operandLessThan(h[0].get(), h[1].get()); // should always be true
+// ---------------- annotated operands ----------------
+
+// u (scaled by c) as terms of a sum. A sum gives up its own terms, and a product with a number in front becomes (number, rest of the product)
+SimplifyVisitor::TermList SimplifyVisitor::sumTerms(std::unique_ptr<ExpressionNode> u, const Rational& c) {
+    TermList terms;
+
+    if (isSum(u.get())) {
+        auto* sum = static_cast<NaryExpressionNode*>(u.get());
+        terms.reserve(sum->Operands.size());
+        for (size_t i = 0; i < sum->Operands.size(); i++) {
+            auto& op = sum->Operands[i];
+            if (op->Key.Rank == OrderRank::CONSTANT) {
+                // constants keep their value in the node
+                Rational value = op->Key.Value * sum->coeff(i) * c;
+                terms.push_back(Term{Rational(1), createRational(value)});
+            } else if (op->Key.Rank == OrderRank::REAL || hasLeadingReal(op.get())) {
+                // and so do doubles, the one in front of a product included
+                for (auto& term : sumTerms(std::move(op), sum->coeff(i) * c)) terms.push_back(std::move(term));
+            } else {
+                terms.push_back(Term{sum->coeff(i) * c, std::move(op)});
+            }
+        }
+        return terms;
     }
-    // std::cout << "h[0] " << h[0].get()->String()<< std::endl;
-    // std::cout << "h[1] " << h[1].get()->String()<< std::endl;
-    
-    // // Create vectors for recursive calls
-    // std::vector<std::unique_ptr<ExpressionNode>> p_rest;
-    // for (size_t i = 1; i < p.size(); i++) {
-    //     p_rest.push_back(std::move(p[i]));
-    // }
-    
-    // std::vector<std::unique_ptr<ExpressionNode>> q_rest;
-    // for (size_t i = 1; i < q.size(); i++) {
-    //     q_rest.push_back(std::move(q[i]));
-    // }
-    
-    if (h.empty()) {
-        // MPRD-3-1: Result is empty (p1*q1 = 1)
-        auto p_rest = rest(p);
-        auto q_rest = rest(q);
-        return merge_products(p_rest, q_rest);
-    } else if (h.size() == 1) {
-        // MPRD-3-2: Result is a single operand
-        auto p_rest = rest(p);
-        auto q_rest = rest(q);
-        auto result = merge_products(p_rest, q_rest);
-        result.insert(result.begin(), std::move(h[0]));
-        return result;
-    } else if (h.size() == 2 && (isOrderedBefore == isOrderedAfter)) {
-        // MPRD-3-3: Result is [p1, q1] (original order)
-        auto p_rest = rest(p);
-        auto result = merge_products(p_rest, q);
-        result.insert(result.begin(), std::move(p1));
-        p.erase(p.begin());  // Remove p1
-        return result;
-    } else if (h.size() == 2) {
-        // MPRD-3-4: Result is [q1, p1] (reversed order)
-        auto q_rest = rest(q);
-        auto result = merge_products(p, q_rest);
-        result.insert(result.begin(), std::move(q1));
-        q.erase(q.begin());  // Remove q1
-        return result;
+
+    if (u->Key.Rank == OrderRank::CONSTANT) {
+        terms.push_back(Term{Rational(1), c.isOne() ? std::move(u) : createRational(u->Key.Value * c)});
+        return terms;
     }
-    
-    // This should not happen based on the algorithm
-    return {};
+
+    // c goes onto the double, which might come out whole and then be a coefficient after all
+    if (u->Key.Rank == OrderRank::REAL || hasLeadingReal(u.get())) {
+        if (c.isOne()) {
+            terms.push_back(Term{Rational(1), std::move(u)});
+            return terms;
+        }
+        return sumTerms(scaleReal(std::move(u), toDouble(c)), Rational(1));
+    }
+
+    if (isProduct(u.get())) {
+        auto* prod = static_cast<NaryExpressionNode*>(u.get());
+        if (prod->Operands.size() > 1 && prod->Operands[0]->Key.Rank == OrderRank::CONSTANT && prod->coeff(0).isOne()) {
+            Rational coeff = prod->Operands[0]->Key.Value * c;
+
+            std::vector<std::unique_ptr<ExpressionNode>> rest_operands;
+            std::vector<Rational> rest_exponents;
+            for (size_t i = 1; i < prod->Operands.size(); i++) {
+                rest_operands.push_back(std::move(prod->Operands[i]));
+                rest_exponents.push_back(prod->coeff(i));
+            }
+
+            // a number times a sum inside another sum is flattened into it, c(a + b) + d = ca + cb + d. On its own the product keeps the
+            // number as a factor (see buildProduct), the same whichever order the factors came in
+            if (rest_operands.size() == 1 && rest_exponents[0].isOne()) {
+                if (isSum(rest_operands[0].get())) return sumTerms(std::move(rest_operands[0]), coeff);
+                terms.push_back(Term{coeff, std::move(rest_operands[0])});
+                return terms;
+            }
+
+            terms.push_back(Term{coeff, createProduct(std::move(rest_operands), withoutOnes(std::move(rest_exponents)))});
+            return terms;
+        }
+    }
+
+    terms.push_back(Term{c, std::move(u)});
+    return terms;
+}
+
+// u (raised to e) as factors of a product. A product gives up its own factors
+SimplifyVisitor::TermList SimplifyVisitor::productFactors(std::unique_ptr<ExpressionNode> u, const Rational& e) {
+    TermList factors;
+
+    // (a * b)^e = a^e * b^e, only true in general for whole exponents
+    if (isProduct(u.get()) && e.isInteger()) {
+        auto* prod = static_cast<NaryExpressionNode*>(u.get());
+        factors.reserve(prod->Operands.size());
+        for (size_t i = 0; i < prod->Operands.size(); i++) {
+            Rational exponent = prod->coeff(i) * e;
+            auto& op = prod->Operands[i];
+
+            Rational power;
+            if (op->Key.Rank == OrderRank::CONSTANT && exponent.isInteger() && powRational(op->Key.Value, exponent.num, power)) {
+                // numbers get evaluated, (2x)^3 = 8x^3
+                if (!power.isOne()) factors.push_back(Term{Rational(1), createRational(power)});
+            } else if (auto value = op->Key.Rank == OrderRank::REAL ? realPower(op.get(), exponent) : nullptr) {
+                if (!isOne(value.get())) factors.push_back(Term{Rational(1), std::move(value)});
+            } else {
+                factors.push_back(Term{exponent, std::move(op)});
+            }
+        }
+        return factors;
+    }
+
+    // powRational won't do 0^-n, simplify_power turns that into Undefined, or a power too big for 64 bits, that one stays a power
+    Rational power;
+    if (u->Key.Rank == OrderRank::CONSTANT && e.isInteger() && !e.isOne() && powRational(u->Key.Value, e.num, power)) {
+        factors.push_back(Term{Rational(1), createRational(power)});
+        return factors;
+    }
+
+    // a double to any power is a double again, and in doubles so is any number to a fractional power, 2^(1/2) = 1.414..
+    bool real_power = u->Key.Rank == OrderRank::REAL || (Domain == NumericDomain::DOUBLE && u->Key.Rank == OrderRank::CONSTANT);
+    if (real_power && !e.isOne()) {
+        if (auto value = realPower(u.get(), e)) {
+            factors.push_back(Term{Rational(1), std::move(value)});
+            return factors;
+        }
+    }
+
+    factors.push_back(Term{e, std::move(u)});
+    return factors;
+}
+
+// a coefficient or exponent that didn't fit in 64 bits, or a number that didn't and so came out Undefined
+bool SimplifyVisitor::overflowed(const TermList& terms) const {
+    for (const auto& term : terms) {
+        if (term.Coeff.isOverflow() || isUndefined(term.Node.get())) return true;
+    }
+    return false;
+}
+
+// SSUM-4 : empty -> 0, one term -> that term (scaled), otherwise a sum with the coefficients kept as annotations
+std::unique_ptr<ExpressionNode> SimplifyVisitor::buildSum(TermList terms) {
+    if (terms.empty()) return createNumber(0);
+    if (overflowed(terms)) return createVariable("Undefined");
+    if (terms.size() == 1) return scale(std::move(terms[0].Node), terms[0].Coeff);
+
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<Rational> coeffs;
+    operands.reserve(terms.size());
+    coeffs.reserve(terms.size());
+    for (auto& term : terms) {
+        operands.push_back(std::move(term.Node));
+        coeffs.push_back(term.Coeff);
+    }
+
+    return createSum(std::move(operands), withoutOnes(std::move(coeffs)));
+}
+
+// SPRD-4 : empty -> 1, one factor -> that factor, otherwise a product with the exponents kept as annotations. A number next to a sum
+// isn't distributed, that would depend on which factors got multiplied first, expand does it
+std::unique_ptr<ExpressionNode> SimplifyVisitor::buildProduct(TermList factors) {
+    if (factors.empty()) return createNumber(1);
+    if (overflowed(factors)) return createVariable("Undefined");
+    if (factors.size() == 1 && factors[0].Coeff.isOne()) return std::move(factors[0].Node);
+
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<Rational> exponents;
+    operands.reserve(factors.size());
+    exponents.reserve(factors.size());
+    for (auto& factor : factors) {
+        operands.push_back(std::move(factor.Node));
+        exponents.push_back(factor.Coeff);
+    }
+
+    return createProduct(std::move(operands), withoutOnes(std::move(exponents)));
+}
+
+// c . u, done by updating numbers wherever possible instead of building a product and simplifying it
+std::unique_ptr<ExpressionNode> SimplifyVisitor::scale(std::unique_ptr<ExpressionNode> u, const Rational& c) {
+    if (c.isOne() || isUndefined(u.get())) return u;
+    if (c.isZero()) return createNumber(0);
+
+    if (u->Key.Rank == OrderRank::CONSTANT) {
+        return createRational(u->Key.Value * c);
+    }
+    if (u->Key.Rank == OrderRank::REAL || hasLeadingReal(u.get())) {
+        return scaleReal(std::move(u), toDouble(c));
+    }
+
+    // every coefficient gets multiplied, the constant term (if there is one) holds its value in the node. Into a new sum rather than
+    // u's own Coeffs, u's synopsis may already be cached and its hash has the old coefficients in it
+    if (isSum(u.get())) {
+        auto* sum = static_cast<NaryExpressionNode*>(u.get());
+        std::vector<std::unique_ptr<ExpressionNode>> operands;
+        std::vector<Rational> coeffs;
+        operands.reserve(sum->Operands.size());
+        coeffs.reserve(sum->Operands.size());
+
+        for (size_t i = 0; i < sum->Operands.size(); i++) {
+            auto& op = sum->Operands[i];
+            if (op->Key.Rank == OrderRank::CONSTANT) {
+                operands.push_back(createRational(op->Key.Value * c));
+                coeffs.push_back(Rational(1));
+            } else if (op->Key.Rank == OrderRank::REAL || hasLeadingReal(op.get())) {
+                // the same term scaled, so still in the same place in the sum. It's sumTerms that says where the number ends up
+                Term term = std::move(sumTerms(std::move(op), sum->coeff(i) * c)[0]);
+                operands.push_back(std::move(term.Node));
+                coeffs.push_back(term.Coeff);
+            } else {
+                operands.push_back(std::move(op));
+                coeffs.push_back(sum->coeff(i) * c);
+            }
+            if (coeffs.back().isOverflow() || isUndefined(operands.back().get())) return createVariable("Undefined");
+        }
+        return createSum(std::move(operands), withoutOnes(std::move(coeffs)));
+    }
+
+    // the number at the front of a product (constants always sort first) absorbs c
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<Rational> exponents;
+    if (isProduct(u.get())) {
+        auto* prod = static_cast<NaryExpressionNode*>(u.get());
+        size_t start = 0;
+        Rational coeff = c;
+        if (prod->Operands[0]->Key.Rank == OrderRank::CONSTANT && prod->coeff(0).isOne()) {
+            coeff = prod->Operands[0]->Key.Value * c;
+            start = 1;
+        }
+
+        if (!coeff.isOne()) {
+            operands.push_back(createRational(coeff));
+            exponents.push_back(Rational(1));
+        }
+        for (size_t i = start; i < prod->Operands.size(); i++) {
+            operands.push_back(std::move(prod->Operands[i]));
+            exponents.push_back(prod->coeff(i));
+        }
+
+        if (operands.size() == 1 && exponents[0].isOne()) return std::move(operands[0]);
+    } else {
+        operands.push_back(createRational(c));
+        operands.push_back(std::move(u));
+        exponents.assign(2, Rational(1));
+    }
+
+    return createProduct(std::move(operands), withoutOnes(std::move(exponents)));
+}
+
+std::unique_ptr<ExpressionNode> SimplifyVisitor::negate(std::unique_ptr<ExpressionNode> u) {
+    return scale(std::move(u), Rational(-1));
 }
 
-std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::rest(std::vector<std::unique_ptr<ExpressionNode>>& a) {
-    std::vector<std::unique_ptr<ExpressionNode>> rest;
-    for (size_t i = 1; i < a.size(); i++) {
-        rest.push_back(std::move(a[i]));
+// r . u for a double r. It goes onto the number in front of a product (or becomes one), and a sum has it taken to every term
+std::unique_ptr<ExpressionNode> SimplifyVisitor::scaleReal(std::unique_ptr<ExpressionNode> u, double r) {
+    if (r == 1.0 || isUndefined(u.get())) return u;
+    if (r == 0.0) return createNumber(0);
+    if (isNumeric(u.get())) return createReal(numericValue(u.get()) * r);
+
+    if (isSum(u.get())) {
+        auto* sum = static_cast<NaryExpressionNode*>(u.get());
+        std::vector<std::unique_ptr<ExpressionNode>> operands;
+        operands.reserve(sum->Operands.size());
+        for (size_t i = 0; i < sum->Operands.size(); i++) {
+            operands.push_back(scaleReal(std::move(sum->Operands[i]), toDouble(sum->coeff(i)) * r));
+        }
+        return simplify_sum(createSum(std::move(operands)));
+    }
+
+    double lead = r;
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<Rational> exponents;
+    if (isProduct(u.get())) {
+        auto* prod = static_cast<NaryExpressionNode*>(u.get());
+        size_t start = 0;
+        if (isNumeric(prod->Operands[0].get()) && prod->coeff(0).isOne()) {
+            lead *= numericValue(prod->Operands[0].get());
+            start = 1;
+        }
+        for (size_t i = start; i < prod->Operands.size(); i++) {
+            operands.push_back(std::move(prod->Operands[i]));
+            exponents.push_back(prod->coeff(i));
+        }
+    } else {
+        operands.push_back(std::move(u));
+        exponents.push_back(Rational(1));
+    }
+
+    if (lead == 0.0) return createNumber(0);
+    if (lead != 1.0) {
+        operands.insert(operands.begin(), createReal(lead));
+        exponents.insert(exponents.begin(), Rational(1));
     }
+    if (operands.size() == 1 && exponents[0].isOne()) return std::move(operands[0]);
+    return createProduct(std::move(operands), withoutOnes(std::move(exponents)));
+}
 
-    return rest;
+// u^e as a double, nullptr if u isn't a number or the answer isn't a real number
+std::unique_ptr<ExpressionNode> SimplifyVisitor::realPower(const ExpressionNode* u, const Rational& e) {
+    if (!isNumeric(u)) return nullptr;
+    double value = numericValue(u);
+    if (!e.isOne()) value = std::pow(value, toDouble(e));
+    if (std::isnan(value) || std::isinf(value)) return nullptr;
+    return createReal(value);
+}
+
+// a product of more than one factor with a double in front (which simplify_product always puts first)
+bool SimplifyVisitor::hasLeadingReal(const ExpressionNode* u) const {
+    if (!isProduct(u)) return false;
+    auto* prod = static_cast<const NaryExpressionNode*>(u);
+    return prod->Operands.size() > 1 && prod->Operands[0]->Key.Rank == OrderRank::REAL && prod->coeff(0).isOne();
+}
+
+// u with the double in front taken off
+std::unique_ptr<ExpressionNode> SimplifyVisitor::withoutLeadingReal(std::unique_ptr<ExpressionNode> u) {
+    if (!hasLeadingReal(u.get())) return u;
+
+    auto* prod = static_cast<NaryExpressionNode*>(u.get());
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<Rational> exponents;
+    for (size_t i = 1; i < prod->Operands.size(); i++) {
+        operands.push_back(std::move(prod->Operands[i]));
+        exponents.push_back(prod->coeff(i));
+    }
+    if (operands.size() == 1 && exponents[0].isOne()) return std::move(operands[0]);
+    return createProduct(std::move(operands), withoutOnes(std::move(exponents)));
+}
+
+// u against v as if neither had a double in front, 0 when they're like terms. A product is compared by its operands (O-3, O-8)
+int SimplifyVisitor::compareScaledRest(const ExpressionNode* u, const ExpressionNode* v) const {
+    size_t skip_u = hasLeadingReal(u);
+    size_t skip_v = hasLeadingReal(v);
+    auto* u_prod = isProduct(u) ? static_cast<const NaryExpressionNode*>(u) : nullptr;
+    auto* v_prod = isProduct(v) ? static_cast<const NaryExpressionNode*>(v) : nullptr;
+    const Rational* cu = u_prod && annotations(u_prod) ? annotations(u_prod) + skip_u : nullptr;
+    const Rational* cv = v_prod && annotations(v_prod) ? annotations(v_prod) + skip_v : nullptr;
+
+    if (u_prod && v_prod) {
+        return compareOperandSequences(u_prod->Operands.data() + skip_u, cu, u_prod->Operands.size() - skip_u,
+                                       v_prod->Operands.data() + skip_v, cv, v_prod->Operands.size() - skip_v);
+    }
+    if (u_prod) return compareOperandSequences(u_prod->Operands.data() + skip_u, cu, u_prod->Operands.size() - skip_u, v);
+    if (v_prod) return -compareOperandSequences(v_prod->Operands.data() + skip_v, cv, v_prod->Operands.size() - skip_v, u);
+    return operandCompare(u, v);
+}
+
+// order terms by their node first and coefficient/exponent second, x < 2x < x^2 
+int SimplifyVisitor::compareTerms(const Term& a, const Term& b) const {
+    int c = operandCompare(a.Node.get(), b.Node.get());
+    if (c != 0) return c;
+    return compareRational(a.Coeff, b.Coeff);
+}
+
+// annotations that are all 1 are stored as an empty vector
+std::vector<Rational> SimplifyVisitor::withoutOnes(std::vector<Rational> coeffs) {
+    for (const auto& c : coeffs) {
+        if (!c.isOne()) return coeffs;
+    }
+    return {};
 }
 
 // Helper method implementations
@@ -1249,29 +1213,22 @@ bool SimplifyVisitor::isUndefined(const ExpressionNode* node) const {
 }
 
 bool SimplifyVisitor::isZero(const ExpressionNode* node) const {
-    if (node->getKind() == InfixKind::NUM) {
-        auto* num = dynamic_cast<const NumberExpressionNode*>(node);
-        return num && num->Value == 0;
-    }
-    return false;
+    return node->Key.Kind == InfixKind::NUM && node->Key.Value.isZero();
 }
 
 bool SimplifyVisitor::isOne(const ExpressionNode* node) const {
-    if (node->getKind() == InfixKind::NUM) {
-        auto* num = dynamic_cast<const NumberExpressionNode*>(node);
-        return num && num->Value == 1;
-    }
-    return false;
+    return node->Key.Kind == InfixKind::NUM && node->Key.Value.isOne();
 }
 
-std::unique_ptr<NaryExpressionNode> SimplifyVisitor::createProduct(std::vector<std::unique_ptr<ExpressionNode>> operands) {
+std::unique_ptr<NaryExpressionNode> SimplifyVisitor::createProduct(std::vector<std::unique_ptr<ExpressionNode>> operands, std::vector<Rational> exponents) {
     Token prodToken{token::MULT, "*"};
 
     return std::make_unique<NaryExpressionNode>(
         prodToken,
         '*',
         InfixKind::MULTIPLY,
-        std::move(operands)
+        std::move(operands),
+        std::move(exponents)
     );
 }
 
@@ -1287,14 +1244,15 @@ std::unique_ptr<InfixExpressionNode> SimplifyVisitor::createQuotient(std::unique
     );
 }
 
-std::unique_ptr<NaryExpressionNode> SimplifyVisitor::createSum(std::vector<std::unique_ptr<ExpressionNode>> operands) const {
+std::unique_ptr<NaryExpressionNode> SimplifyVisitor::createSum(std::vector<std::unique_ptr<ExpressionNode>> operands, std::vector<Rational> coeffs) const {
     Token sumToken{token::PLUS, "+"};
 
     return std::make_unique<NaryExpressionNode>(
         sumToken,
         '+',
         InfixKind::PLUS,
-        std::move(operands)
+        std::move(operands),
+        std::move(coeffs)
     );
 }
 
@@ -1310,11 +1268,29 @@ std::unique_ptr<InfixExpressionNode> SimplifyVisitor::createDifference(std::uniq
     );
 }
 
-std::unique_ptr<NumberExpressionNode> SimplifyVisitor::createNumber(int value) {
+std::unique_ptr<NumberExpressionNode> SimplifyVisitor::createNumber(i64 value) {
     Token tok{token::INT, std::to_string(value)};
     return std::make_unique<NumberExpressionNode>(tok, value, InfixKind::NUM);
 }
 
+// integer or fraction node for r, or a double in place of the fraction when that's the domain. A number too big for 64 bits is
+// Undefined, better than one that wrapped
+std::unique_ptr<ExpressionNode> SimplifyVisitor::createRational(const Rational& r) {
+    if (r.isOverflow()) return createVariable("Undefined");
+    if (r.isInteger()) return createNumber(r.num);
+    if (Domain == NumericDomain::DOUBLE) return createReal(toDouble(r));
+    return createFraction(r.num, r.den);
+}
+
+// a double node, or an integer when it's a whole number small enough to be exact, so 0.5 + 0.5 is the 1 the identity rules look for
+std::unique_ptr<ExpressionNode> SimplifyVisitor::createReal(double value) {
+    const double EXACT = 9007199254740992.0;    // 2^53
+    if (value == std::trunc(value) && std::abs(value) < EXACT) return createNumber(static_cast<i64>(value));
+
+    Token tok{token::INT, realLiteral(value)};
+    return std::make_unique<NumberExpressionNode>(tok, value);
+}
+
 std::unique_ptr<VariableExpressionNode> SimplifyVisitor::createVariable(const std::string& name) const {
     Token tok{token::VAR, name};
     
@@ -1336,380 +1312,968 @@ std::vector<std::unique_ptr<ExpressionNode>> SimplifyVisitor::getNaryOperands(Na
         return {};
     }
     
+    // hand back plain operands, so the coefficients/exponents get folded into them rather than lost
     std::vector<std::unique_ptr<ExpressionNode>> result;
-    for (auto& op : expr->Operands) {
-        result.push_back(std::move(op));
+    for (size_t i = 0; i < expr->Operands.size(); i++) {
+        Rational c = expr->coeff(i);
+        if (c.isOne()) {
+            result.push_back(std::move(expr->Operands[i]));
+        } else if (expr->getKind() == InfixKind::PLUS) {
+            result.push_back(scale(std::move(expr->Operands[i]), c));
+        } else {
+            std::vector<std::unique_ptr<ExpressionNode>> base;
+            base.push_back(std::move(expr->Operands[i]));
+            result.push_back(createProduct(std::move(base), {c}));
+        }
     }
+    expr->Operands.clear();
+    expr->Coeffs.clear();
     return result;
 }
 
 bool SimplifyVisitor::operandLessThan(const ExpressionNode* u, const ExpressionNode* v) const {
-    // Based on the ◁ operator described in the book
+    return operandCompare(u, v) < 0;
+}
 
-    // O-1 : when both u and v are constants (integers or fractions), then order in ascending order, return u < v
-    if ((u->getKind() == InfixKind::NUM || u->getKind() == InfixKind::FRACTION) && 
-        (v->getKind() == InfixKind::NUM || v->getKind() == InfixKind::FRACTION)) {
+// Three way version of the ◁ operator described in the book, returns -1 if u ◁ v, 1 if v ◁ u and 0 if u and v are the same expression.
+// Only reads the cached OrderKeys and child pointers, so no String() building, no temporary nodes and no dynamic_casts
+int SimplifyVisitor::operandCompare(const ExpressionNode* u, const ExpressionNode* v) const {
+    const OrderKey& ku = u->Key;
+    const OrderKey& kv = v->Key;
 
-        int u_value, v_value;
+    // O-1 : when both u and v are constants (integers or fractions), then order in ascending order
+    if (ku.Rank == OrderRank::CONSTANT && kv.Rank == OrderRank::CONSTANT) {
+        return compareRational(ku.Value, kv.Value);
+    }
 
-        // Extract numeric value for u
-        if (u->getKind() == InfixKind::NUM) {
-            const auto* u_cast = dynamic_cast<const NumberExpressionNode*>(u);
-            if (!u_cast) return false; 
-            u_value = u_cast->Value;
-        } else { 
-            u_value = getNumerator(u) / getDenominator(u);
-        }
-    
-        // Extract numeric value for v
-        if (v->getKind() == InfixKind::NUM) {
-            const auto* v_cast = dynamic_cast<const NumberExpressionNode*>(v);
-            if (!v_cast) return false; 
-            v_value = v_cast->Value;
-        } else { 
-            v_value = getNumerator(v) / getDenominator(v);
-        }
-    
-        return u_value < v_value;
+    // doubles by value too, an exact number first when they're equal
+    bool u_number = ku.Rank == OrderRank::CONSTANT || ku.Rank == OrderRank::REAL;
+    bool v_number = kv.Rank == OrderRank::CONSTANT || kv.Rank == OrderRank::REAL;
+    if (u_number && v_number) {
+        double a = ku.Rank == OrderRank::REAL ? ku.Real : toDouble(ku.Value);
+        double b = kv.Rank == OrderRank::REAL ? kv.Real : toDouble(kv.Value);
+        if (a != b) return (a < b) ? -1 : 1;
+        if (ku.Rank != kv.Rank) return (ku.Rank == OrderRank::CONSTANT) ? -1 : 1;
+        return 0;
     }
 
+    // O-7 : when u is an integer, fraction or double and v is of any other type, then u always comes before v.
+    if (u_number) return -1;
+    if (v_number) return 1;
+
     // 0-2 : when both u and v are symbols, then use lexicographical order. 0, 1,..., 9, A, B, . . . , Z, a, b, . . . , z
-    if (u->getKind() == InfixKind::VAR && v->getKind() == InfixKind::VAR) {
-        return u->String() < v->String();
+    if (ku.Rank == OrderRank::SYMBOL && kv.Rank == OrderRank::SYMBOL) {
+        if (ku.Symbol == kv.Symbol) return 0;
+        return symbolRank(ku.Symbol) < symbolRank(kv.Symbol) ? -1 : 1;
     }
 
-    // O-3 : when u and v are either both products or sums with operands, u1, u2, ..., um and v1, v1, ..., vn
-    if ((u->getKind() == InfixKind::MULTIPLY && v->getKind() == InfixKind::MULTIPLY) || (u->getKind() == InfixKind::PLUS && v->getKind() == InfixKind::PLUS)) {
-        const auto* u_cast = dynamic_cast<const NaryExpressionNode*>(u);
-        const auto* v_cast = dynamic_cast<const NaryExpressionNode*>(v);
-        int m  = u_cast->Operands.size();
-        int n = v_cast->Operands.size();
-        int min_size = std::min(m, n);
-        
-        // O-3-2 : if the last operands of u and v are not equal then move left     e.g. a + c + d < b + c + d
-        for (int j = 0; j < min_size; j++) {
-            if (u_cast->Operands[m - 1 - j]->String() != v_cast->Operands[n - 1 - j]->String()) {
-                // O-3-1 : if the last operands of u and v are not equal then recurse the last operands, which will determine the order.    e.g. a + b < a + c
-                return operandLessThan(u_cast->Operands[m - 1 - j].get(), v_cast->Operands[n - 1 - j].get());
-            }
-        }
+    // O-3 : when u and v are either both products or both sums, compare operands from the last one backwards
+    if ((ku.Rank == OrderRank::PRODUCT || ku.Rank == OrderRank::SUM) && ku.Rank == kv.Rank) {
+        auto* u_nary = static_cast<const NaryExpressionNode*>(u);
+        auto* v_nary = static_cast<const NaryExpressionNode*>(v);
+        return compareOperandSequences(u_nary->Operands.data(), annotations(u_nary), u_nary->Operands.size(),
+                                       v_nary->Operands.data(), annotations(v_nary), v_nary->Operands.size());
+    }
 
-        // O-3-3 : if all operands are equal, then compare length       e.g. c + d < b + c + d
-        return m < n;
+    // O-8 : when u is a product and v is anything else, compare u to the product ·(v)
+    if (ku.Rank == OrderRank::PRODUCT) {
+        auto* u_nary = static_cast<const NaryExpressionNode*>(u);
+        return compareOperandSequences(u_nary->Operands.data(), annotations(u_nary), u_nary->Operands.size(), v);
     }
 
-    // O-7 : when u is an integer or fraction and v is of any other type, then u always comes before v.
-    if ((u->getKind() == InfixKind::NUM || u->getKind() == InfixKind::FRACTION) && !(v->getKind() == InfixKind::NUM || v->getKind() == InfixKind::FRACTION)) {
-        return true;
+    // O-10 : when u is a sum, and v is a symbol (or anything else that isn't a product), compare u to the sum +(v)
+    if (ku.Rank == OrderRank::SUM && kv.Rank != OrderRank::PRODUCT) {
+        auto* u_nary = static_cast<const NaryExpressionNode*>(u);
+        return compareOperandSequences(u_nary->Operands.data(), annotations(u_nary), u_nary->Operands.size(), v);
     }
 
-    // O-10 : when u is a sum, and v is a symbol
-    if ((u->getKind() == InfixKind::PLUS) && (v->getKind() == InfixKind::VAR)) {
-        std::vector<std::unique_ptr<ExpressionNode>> operands;
-        operands.push_back(createVariable(v->TokenLiteral()));
-        auto v_sum = createSum(std::move(operands));
+    // Kinds the book doesn't order (quotients, differences, prefix), group them after everything else and compare children left to right
+    if (ku.Rank == OrderRank::OTHER && kv.Rank == OrderRank::OTHER) {
+        if (ku.Kind != kv.Kind) return (ku.Kind < kv.Kind) ? -1 : 1;
+
+        const ExpressionNode* u_left = nullptr;
+        const ExpressionNode* v_left = nullptr;
+        const ExpressionNode* u_right = nullptr;
+        const ExpressionNode* v_right = nullptr;
+
+        if (ku.Kind == InfixKind::PRE_MINUS) {
+            u_right = static_cast<const PrefixExpressionNode*>(u)->Right.get();
+            v_right = static_cast<const PrefixExpressionNode*>(v)->Right.get();
+        } else {
+            u_left = static_cast<const InfixExpressionNode*>(u)->Left.get();
+            v_left = static_cast<const InfixExpressionNode*>(v)->Left.get();
+            u_right = static_cast<const InfixExpressionNode*>(u)->Right.get();
+            v_right = static_cast<const InfixExpressionNode*>(v)->Right.get();
+        }
 
-        return operandLessThan(u, v_sum.get());
+        if (u_left && v_left) {
+            int c = operandCompare(u_left, v_left);
+            if (c != 0) return c;
+        }
+        if (u_right && v_right) return operandCompare(u_right, v_right);
+        return 0;
     }
+    if (ku.Rank == OrderRank::OTHER && kv.Rank == OrderRank::SYMBOL) return 1;
 
     // O-13 : if none of the rules above are satisfied, then we simply flip u and v
-    return !operandLessThan(v, u);
+    return -operandCompare(v, u);
+}
+
+// O-3 helper, u = [u1 ... um] and v = [v1 ... vn]. cu and cv are the coefficients/exponents of the operands, nullptr when they're all 1
+int SimplifyVisitor::compareOperandSequences(const std::unique_ptr<ExpressionNode>* u, const Rational* cu, size_t m, const std::unique_ptr<ExpressionNode>* v, const Rational* cv, size_t n) const {
+    size_t min_size = std::min(m, n);
+
+    // O-3-1 : the first pair (from the end) of operands that aren't equal decides the order       e.g. a + b < a + c
+    // an operand is its node and its annotation together, so x + y < x + 2y
+    for (size_t j = 0; j < min_size; j++) {
+        size_t i = m - 1 - j;
+        size_t k = n - 1 - j;
+        int c = operandCompare(u[i].get(), v[k].get());
+        if (c != 0) return c;
+
+        c = compareRational(cu ? cu[i] : Rational(1), cv ? cv[k] : Rational(1));
+        if (c != 0) return c;
+    }
+
+    // O-3-3 : if all operands are equal, then compare length       e.g. c + d < b + c + d
+    return (m < n) ? -1 : (m > n);
+}
+
+// same as above but against a single operand that isn't owned by a node, O-8 and O-10
+int SimplifyVisitor::compareOperandSequences(const std::unique_ptr<ExpressionNode>* u, const Rational* cu, size_t m, const ExpressionNode* v) const {
+    int c = operandCompare(u[m - 1].get(), v);
+    if (c != 0) return c;
+
+    c = compareRational(cu ? cu[m - 1] : Rational(1), Rational(1));
+    if (c != 0) return c;
+
+    return (m > 1);
 }
 
 
 std::unique_ptr<ExpressionNode> SimplifyVisitor::clone_expr(std::unique_ptr<ExpressionNode>& expr) {
+    return clone_expr(static_cast<const ExpressionNode*>(expr.get()));
+}
 
-   
+std::unique_ptr<ExpressionNode> SimplifyVisitor::clone_expr(const ExpressionNode* expr) {
     switch (expr->getKind()) {
         case InfixKind::NUM: {
-            auto* num = dynamic_cast<NumberExpressionNode*>(expr.get());
-            if (num) {
-                return std::make_unique<NumberExpressionNode>(num->Tok, num->Value, num->Kind);
-            }
-            break;
+            auto* num = static_cast<const NumberExpressionNode*>(expr);
+            return std::make_unique<NumberExpressionNode>(num->Tok, num->Value, num->Kind);
+        }
+
+        case InfixKind::REAL: {
+            auto* num = static_cast<const NumberExpressionNode*>(expr);
+            return std::make_unique<NumberExpressionNode>(num->Tok, num->Real);
         }
 
         case InfixKind::VAR: {
-            auto* var = dynamic_cast<VariableExpressionNode*>(expr.get());
-            if (var) {   
-                return std::make_unique<VariableExpressionNode>(var->Value, var->Tok, var->Kind);
-            }
-            break;
+            auto* var = static_cast<const VariableExpressionNode*>(expr);
+            Token tok = var->Tok;
+            return std::make_unique<VariableExpressionNode>(var->Value, tok, var->Kind);
+        }
+
+        case InfixKind::PRE_MINUS: {
+            auto* prefix = static_cast<const PrefixExpressionNode*>(expr);
+            Token tok = prefix->Tok;
+            return std::make_unique<PrefixExpressionNode>(prefix->Operator, tok, prefix->Kind, clone_expr(prefix->Right.get()));
         }
 
-        case InfixKind::FRACTION: {
-            auto* frac = dynamic_cast<InfixExpressionNode*>(expr.get());
-            auto* frac_numerator = dynamic_cast<NumberExpressionNode*>(frac->Left.get());
-            auto* frac_denominator = dynamic_cast<NumberExpressionNode*>(frac->Right.get());
-            if (frac || frac_numerator || frac_denominator) {
-                return std::make_unique<InfixExpressionNode>(frac->Tok,'/', frac->Kind,  createNumber(frac_numerator->Value), createNumber(frac_denominator->Value));
+        case InfixKind::FRACTION:
+        case InfixKind::DIFFERENCE:
+        case InfixKind::DIVIDE:
+        case InfixKind::POWER: {
+            auto* infix = static_cast<const InfixExpressionNode*>(expr);
+            Token tok = infix->Tok;
+            return std::make_unique<InfixExpressionNode>(tok, infix->Operator, infix->Kind, clone_expr(infix->Left.get()), clone_expr(infix->Right.get()));
+        }
+
+        case InfixKind::MULTIPLY:
+        case InfixKind::PLUS: {
+            auto* nary = static_cast<const NaryExpressionNode*>(expr);
+            std::vector<std::unique_ptr<ExpressionNode>> operands;
+            for (const auto& op : nary->Operands) {
+                operands.push_back(clone_expr(op.get()));
             }
-            break;
+            Token tok = nary->Tok;
+            return std::make_unique<NaryExpressionNode>(tok, nary->Operator, nary->Kind, std::move(operands), nary->Coeffs);
         }
+    }
 
-        case InfixKind::DIVIDE: {
-            auto* div = dynamic_cast<InfixExpressionNode*>(expr.get());
-            if (div) {
-                return std::make_unique<InfixExpressionNode>(
-                    div->Tok,
-                    div->Operator,
-                    div->Kind,
-                    clone_expr(div->Left),
-                    clone_expr(div->Right)
-                );
+    return nullptr;
+}
+
+// ---------------- expansion ----------------
+// Multiplies out products of sums and whole powers of sums at any depth. Rather than building and re-simplifying a tree after every
+// distribution, the expression is turned into a table of monomial -> coefficient, where a monomial is a list of (atom, exponent) pairs.
+// Atoms are whatever can't be multiplied out (symbols, x^y, non constant quotients, ...), interned so a monomial is just ints and rationals.
+// The tree is only rebuilt once at the end.
+
+size_t SimplifyVisitor::MonomialHash::operator()(const Monomial& m) const {
+    size_t h = m.Factors.size();
+    for (const auto& [atom, e] : m.Factors) {
+        h ^= std::hash<i64>{}((static_cast<i64>(atom) << 32) ^ e.num ^ (e.den << 16)) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+// atoms are simplified already, so equal atoms are the same tree. One seen before is found by its synopsis hash and confirmed with
+// sameTree, like cse.cpp does, without printing anything
+int SimplifyVisitor::AtomTable::intern(std::unique_ptr<ExpressionNode> node) {
+    auto& ids = Ids[node->getSynopsis().Hash];
+    for (int id : ids) {
+        if (sameTree(Nodes[id].get(), node.get())) return id;
+    }
+
+    int id = static_cast<int>(Nodes.size());
+    ids.push_back(id);
+    Nodes.push_back(std::move(node));
+    return id;
+}
+
+// a * b, exponents of the same atom add up
+SimplifyVisitor::Monomial SimplifyVisitor::multiply_monomials(const Monomial& a, const Monomial& b) {
+    Monomial result;
+    result.Factors.reserve(a.Factors.size() + b.Factors.size());
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.Factors.size() && j < b.Factors.size()) {
+        if (a.Factors[i].first < b.Factors[j].first) {
+            result.Factors.push_back(a.Factors[i++]);
+        } else if (b.Factors[j].first < a.Factors[i].first) {
+            result.Factors.push_back(b.Factors[j++]);
+        } else {
+            Rational e = a.Factors[i].second + b.Factors[j].second;
+            if (!e.isZero()) result.Factors.emplace_back(a.Factors[i].first, e);
+            i++;
+            j++;
+        }
+    }
+    for (; i < a.Factors.size(); i++) result.Factors.push_back(a.Factors[i]);
+    for (; j < b.Factors.size(); j++) result.Factors.push_back(b.Factors[j]);
+    return result;
+}
+
+void SimplifyVisitor::add_term(ExpandedSum& sum, Monomial m, const Rational& c) {
+    if (c.isZero()) return;
+
+    auto [it, inserted] = sum.try_emplace(std::move(m), c);
+    if (!inserted) {
+        it->second += c;
+        if (it->second.isZero()) sum.erase(it);
+    }
+}
+
+// every term of p times every term of q
+SimplifyVisitor::ExpandedSum SimplifyVisitor::multiply_expanded(const ExpandedSum& p, const ExpandedSum& q) {
+    ExpandedSum result;
+    result.reserve(p.size() * q.size());
+
+    for (const auto& [pm, pc] : p) {
+        for (const auto& [qm, qc] : q) {
+            add_term(result, multiply_monomials(pm, qm), pc * qc);
+        }
+    }
+    return result;
+}
+
+// (t1 + ... + tm)^n as the sum over k1 + ... + km = n of  n!/(k1! ... km!) t1^k1 ... tm^km
+// each term is built directly with its multinomial coefficient instead of multiplying the sum by itself n times
+SimplifyVisitor::ExpandedSum SimplifyVisitor::power_expanded(const ExpandedSum& base, i64 n) {
+    std::vector<std::pair<Monomial, Rational>> terms(base.begin(), base.end());
+    size_t m = terms.size();
+
+    ExpandedSum result;
+    if (m == 0) return result;
+
+    // t^k, the exponents of the monomial get multiplied by k
+    auto monomialPower = [](const Monomial& t, i64 k) {
+        Monomial r = t;
+        for (auto& factor : r.Factors) factor.second *= Rational(k);
+        return r;
+    };
+
+    // choose k_i for each term in turn, the coefficient builds up as C(remaining, k_i) * c_i^k_i
+    auto choose = [&](auto& self, size_t i, i64 remaining, const Monomial& mono, const Rational& coeff) -> void {
+        if (i == m - 1) {
+            Monomial last = (remaining == 0) ? mono : multiply_monomials(mono, monomialPower(terms[i].first, remaining));
+            add_term(result, std::move(last), coeff * powRational(terms[i].second, remaining));
+            return;
+        }
+
+        Rational binomial(1);
+        for (i64 k = 0; k <= remaining; k++) {
+            if (k > 0) binomial = binomial * Rational(remaining - k + 1) / Rational(k);
+            Monomial next = (k == 0) ? mono : multiply_monomials(mono, monomialPower(terms[i].first, k));
+            self(self, i + 1, remaining - k, next, coeff * binomial * powRational(terms[i].second, k));
+        }
+    };
+    choose(choose, 0, n, Monomial{}, Rational(1));
+
+    return result;
+}
+
+// u as a table of monomials, u is consumed
+SimplifyVisitor::ExpandedSum SimplifyVisitor::expand_terms(std::unique_ptr<ExpressionNode>& u, AtomTable& atoms) {
+    ExpandedSum result;
+
+    if (u->Key.Rank == OrderRank::CONSTANT) {
+        add_term(result, Monomial{}, u->Key.Value);
+        return result;
+    }
+
+    switch (u->getKind()) {
+        case InfixKind::PLUS: {
+            auto* sum = static_cast<NaryExpressionNode*>(u.get());
+            for (size_t i = 0; i < sum->Operands.size(); i++) {
+                Rational c = sum->coeff(i);
+                for (auto& [m, tc] : expand_terms(sum->Operands[i], atoms)) {
+                    add_term(result, m, tc * c);
+                }
             }
+            return result;
         }
 
         case InfixKind::MULTIPLY: {
-            auto* prod = dynamic_cast<NaryExpressionNode*>(expr.get());
+            auto* prod = static_cast<NaryExpressionNode*>(u.get());
+            add_term(result, Monomial{}, Rational(1));
+
+            for (size_t i = 0; i < prod->Operands.size(); i++) {
+                Rational e = prod->coeff(i);
+                auto& op = prod->Operands[i];
+
+                ExpandedSum factor;
+                if (e.isInteger() && e.num > 0) {
+                    // whole positive power, multiply it out. If the coefficients don't fit in 64 bits the power stays as it was,
+                    // an atom like the ones below
+                    std::unique_ptr<ExpressionNode> unexpanded = e.num > 1 ? clone_expr(op.get()) : nullptr;
+                    factor = expand_terms(op, atoms);
+                    if (e.num > 1) factor = power_expanded(factor, e.num);
+                    if (std::any_of(factor.begin(), factor.end(), [](const auto& term) { return term.second.isOverflow(); })) {
+                        factor.clear();
+                        Monomial m;
+                        m.Factors.emplace_back(atoms.intern(std::move(unexpanded)), e);
+                        add_term(factor, std::move(m), Rational(1));
+                    }
+                } else {
+                    // (a + b)^(-1), x^(1/2), ... stay as they are
+                    Monomial m;
+                    m.Factors.emplace_back(atoms.intern(std::move(op)), e);
+                    add_term(factor, std::move(m), Rational(1));
+                }
 
-            std::vector<std::unique_ptr<ExpressionNode>> operands;
+                result = multiply_expanded(result, factor);
+            }
+            return result;
+        }
 
-            for (auto& op : prod->Operands) {
-                operands.push_back(clone_expr(op));
+        case InfixKind::DIVIDE: {
+            // dividing by a number is multiplying every term by its reciprocal
+            auto* div = static_cast<InfixExpressionNode*>(u.get());
+            if (div->Right->Key.Rank == OrderRank::CONSTANT && !div->Right->Key.Value.isZero()) {
+                Rational r = Rational(1) / div->Right->Key.Value;
+                for (auto& [m, c] : expand_terms(div->Left, atoms)) {
+                    add_term(result, m, c * r);
+                }
+                return result;
             }
+            break;
+        }
+    }
+
+    // anything else is an atom
+    Monomial m;
+    m.Factors.emplace_back(atoms.intern(std::move(u)), Rational(1));
+    add_term(result, std::move(m), Rational(1));
+    return result;
+}
 
-            if (prod) {
-                return std::make_unique<NaryExpressionNode>(
-                    prod->Tok,
-                    prod->Operator,
-                    prod->Kind,
-                    std::move(operands)
-                );
+// back to a simplified tree, the atoms are put in canonical order once and the monomials are built straight from their ranks
+std::unique_ptr<ExpressionNode> SimplifyVisitor::build_expanded(ExpandedSum& terms, AtomTable& atoms) {
+    size_t atom_count = atoms.Nodes.size();
+
+    // rank of each atom under the order relation, a monomial sorted by rank is already a simplified product
+    std::vector<int> by_order(atom_count);
+    for (size_t i = 0; i < atom_count; i++) by_order[i] = static_cast<int>(i);
+    std::sort(by_order.begin(), by_order.end(), [&](int a, int b) { return operandCompare(atoms.Nodes[a].get(), atoms.Nodes[b].get()) < 0; });
+
+    std::vector<int> rank(atom_count);
+    for (size_t r = 0; r < atom_count; r++) rank[by_order[r]] = static_cast<int>(r);
+
+    // monomials as (rank, exponent) lists with numbers folded into the coefficient
+    std::vector<RankedTerm> ranked;
+    ranked.reserve(terms.size());
+    Rational constant(0);
+
+    for (auto& [m, c] : terms) {
+        RankedTerm term{{}, c};
+        term.Factors.reserve(m.Factors.size());
+        for (const auto& [atom, e] : m.Factors) {
+            // 2^(1/2) * 2^(1/2), a number again, 2^70 isn't
+            Rational power;
+            if (atoms.Nodes[atom]->Key.Rank == OrderRank::CONSTANT && e.isInteger() && powRational(atoms.Nodes[atom]->Key.Value, e.num, power)) {
+                term.Coeff *= power;
+                continue;
             }
+            term.Factors.emplace_back(rank[atom], e);
         }
 
-        case InfixKind::PLUS: {
-            auto* sum = dynamic_cast<NaryExpressionNode*>(expr.get());
+        if (term.Factors.empty()) {
+            constant += term.Coeff;
+            continue;
+        }
+        std::sort(term.Factors.begin(), term.Factors.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        ranked.push_back(std::move(term));
+    }
 
-            std::vector<std::unique_ptr<ExpressionNode>> operands;
+    std::vector<std::unique_ptr<ExpressionNode>> atoms_by_rank;
+    atoms_by_rank.reserve(atom_count);
+    for (size_t r = 0; r < atom_count; r++) atoms_by_rank.push_back(std::move(atoms.Nodes[by_order[r]]));
+
+    return build_ranked_sum(ranked, constant, atoms_by_rank);
+}
+
+// A sum of monomials over atoms that are already in canonical order, the factors of each term sorted by rank.
+// Every monomial is distinct, so rather than going through simplify_product/simplify_sum (and merging terms that can't combine)
+// the terms are sorted with O-3/O-8 on the ranks: compare factors from the last one backwards, then length, then the coefficient.
+// Same order compareTerms would give on the built nodes, without touching any nodes
+std::unique_ptr<ExpressionNode> SimplifyVisitor::build_ranked_sum(std::vector<RankedTerm>& ranked, const Rational& constant, std::vector<std::unique_ptr<ExpressionNode>>& atoms_by_rank) {
+    std::sort(ranked.begin(), ranked.end(), [](const RankedTerm& a, const RankedTerm& b) {
+        size_t m = a.Factors.size();
+        size_t n = b.Factors.size();
+        for (size_t j = 0; j < std::min(m, n); j++) {
+            const auto& fa = a.Factors[m - 1 - j];
+            const auto& fb = b.Factors[n - 1 - j];
+            if (fa.first != fb.first) return fa.first < fb.first;
+            int c = compareRational(fa.second, fb.second);
+            if (c != 0) return c < 0;
+        }
+        if (m != n) return m < n;
+        return compareRational(a.Coeff, b.Coeff) < 0;
+    });
+
+    TermList sum_terms;
+    sum_terms.reserve(ranked.size() + 1);
 
-            for (auto& op : sum->Operands) {
-                operands.push_back(clone_expr(op));
+    // constants come first under O-7
+    if (!constant.isZero()) {
+        sum_terms.push_back(Term{Rational(1), createRational(constant)});
+    }
+
+    for (auto& term : ranked) {
+        if (term.Factors.size() == 1 && term.Factors[0].second.isOne()) {
+            sum_terms.push_back(Term{term.Coeff, clone_expr(atoms_by_rank[term.Factors[0].first])});
+            continue;
+        }
+
+        std::vector<std::unique_ptr<ExpressionNode>> operands;
+        std::vector<Rational> exponents;
+        operands.reserve(term.Factors.size());
+        exponents.reserve(term.Factors.size());
+        for (const auto& [r, e] : term.Factors) {
+            operands.push_back(clone_expr(atoms_by_rank[r]));
+            exponents.push_back(e);
+        }
+        sum_terms.push_back(Term{term.Coeff, createProduct(std::move(operands), withoutOnes(std::move(exponents)))});
+    }
+
+    return buildSum(std::move(sum_terms));
+}
+
+// ---------------- polynomial path ----------------
+// When the whole expression is a polynomial in its symbols (numbers, symbols, sums, whole non negative powers and division by numbers)
+// the expansion is done with the packed Polynomial type instead, sums are merges and products are heap multiplications.
+
+// false if u isn't a polynomial, otherwise adds the symbols in it
+bool SimplifyVisitor::collect_polynomial_symbols(const ExpressionNode* u, std::vector<int>& symbols) const {
+    if (u->Key.Rank == OrderRank::CONSTANT) return true;
+
+    switch (u->getKind()) {
+        case InfixKind::VAR:
+            if (isUndefined(u)) return false;
+            symbols.push_back(u->Key.Symbol);
+            return true;
+
+        case InfixKind::PLUS:
+        case InfixKind::MULTIPLY: {
+            auto* nary = static_cast<const NaryExpressionNode*>(u);
+            for (size_t i = 0; i < nary->Operands.size(); i++) {
+                Rational e = nary->coeff(i);
+                if (u->getKind() == InfixKind::MULTIPLY && !(e.isInteger() && e.num >= 0)) return false;
+                if (!collect_polynomial_symbols(nary->Operands[i].get(), symbols)) return false;
             }
+            return true;
+        }
 
-            if (sum) {
-                return std::make_unique<NaryExpressionNode>(
-                    sum->Tok,
-                    sum->Operator,
-                    sum->Kind,
-                    std::move(operands)
-                );
+        case InfixKind::DIVIDE: {
+            auto* div = static_cast<const InfixExpressionNode*>(u);
+            if (div->Right->Key.Rank != OrderRank::CONSTANT || div->Right->Key.Value.isZero()) return false;
+            return collect_polynomial_symbols(div->Left.get(), symbols);
+        }
+
+        default:
+            return false;
+    }
+}
+
+// u has already passed collect_polynomial_symbols, var_of maps a symbol id to its variable number
+Polynomial SimplifyVisitor::to_polynomial(const ExpressionNode* u, const std::unordered_map<int, int>& var_of, int nvars) const {
+    if (u->Key.Rank == OrderRank::CONSTANT) return Polynomial::constant(nvars, u->Key.Value);
+
+    switch (u->getKind()) {
+        case InfixKind::VAR:
+            return Polynomial::variable(nvars, var_of.at(u->Key.Symbol));
+
+        case InfixKind::PLUS: {
+            auto* sum = static_cast<const NaryExpressionNode*>(u);
+            Polynomial result(nvars);
+            for (size_t i = 0; i < sum->Operands.size(); i++) {
+                result = result + to_polynomial(sum->Operands[i].get(), var_of, nvars).scale(sum->coeff(i));
             }
+            return result;
+        }
+
+        case InfixKind::MULTIPLY: {
+            auto* prod = static_cast<const NaryExpressionNode*>(u);
+            Polynomial result = Polynomial::constant(nvars, Rational(1));
+            for (size_t i = 0; i < prod->Operands.size(); i++) {
+                Polynomial factor = to_polynomial(prod->Operands[i].get(), var_of, nvars);
+                i64 e = prod->coeff(i).num;
+                result = result * (e == 1 ? factor : factor.pow(e));
+            }
+            return result;
+        }
+
+        default: {
+            auto* div = static_cast<const InfixExpressionNode*>(u);
+            return to_polynomial(div->Left.get(), var_of, nvars).scale(Rational(1) / div->Right->Key.Value);
         }
-        
- 
     }
+}
 
-    return nullptr;
+// the symbols of u in name order, false if u isn't a polynomial or is too big for the packed exponents
+bool SimplifyVisitor::polynomial_variables(const ExpressionNode* u, std::vector<int>& symbols) const {
+    if (!collect_polynomial_symbols(u, symbols)) return false;
 
+    std::sort(symbols.begin(), symbols.end(), [](int a, int b) { return symbolRank(a) < symbolRank(b); });
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+    // every sub expression has degree <= the whole thing, so if that fits in a packed field nothing can overflow
+    int nvars = static_cast<int>(symbols.size());
+    return nvars <= 32 && u->getSynopsis().Degree <= Polynomial(nvars).maxExponent();
+}
+
+// back to a simplified tree, symbols are numbered in name order so the variable number is the rank under O-2
+std::unique_ptr<ExpressionNode> SimplifyVisitor::from_polynomial(const Polynomial& p, const std::vector<int>& symbols) {
+    std::vector<std::unique_ptr<ExpressionNode>> variables;
+    variables.reserve(symbols.size());
+    for (int symbol : symbols) variables.push_back(createVariable(symbolName(symbol)));
+
+    std::vector<RankedTerm> ranked;
+    ranked.reserve(p.size());
+    Rational constant(0);
+
+    for (const auto& term : p.Terms) {
+        if (term.Exps == 0) {
+            constant = term.Coeff;
+            continue;
         }
 
-void SimplifyVisitor::extractBaseAndCoefficient(ExpressionNode* expr, std::unique_ptr<ExpressionNode>& base_out, std::unique_ptr<ExpressionNode>& coef_out) {
-    if (expr->getKind() == InfixKind::VAR) {
-        // For a variable, base is the variable itself and coefficient is 1 (implicit)
-        base_out = createVariable(expr->TokenLiteral());
-        coef_out = nullptr; // Indicates coefficient of 1
-    } else if (expr->getKind() == InfixKind::MULTIPLY) {
-        auto* prod = dynamic_cast<NaryExpressionNode*>(expr);
-        auto operands = getNaryOperands(prod);
-        
-        // For a product, check if the first operand is a number/fraction (RNE) and the second is a variable (they will be ordered this way because of simplify_product)
-        if (operands.size() >= 2) { //TODO: loop through and multiply all the numbers together if there are more than one, and pass that in 
-            if ((operands[0]->getKind() == InfixKind::NUM || 
-                 operands[0]->getKind() == InfixKind::FRACTION) && 
-                operands[1]->getKind() == InfixKind::VAR) {
-
-                
-                // if (operands.size() > 2) {
-                    // if (operands[0]->getKind() == InfixKind::NUM) {
-                    //     auto num = dynamic_cast<NumberExpressionNode*>(operands[0].get());
-                    //     int value = -1 * num->Value;
-                    //     operands[0] = createNumber(value);
-                    // } 
-                    //else {
-                    //     auto frac = dynamic_cast<InfixExpressionNode*>(operands[0].get());
-                    //     int num = -1 * frac->L;
-                    //     int denom = 
-                    //     operands[0] = createNumber(value);
-                    // }
-                    
-                //     }
-                
-                // Create copies of the coefficient and base
-                if (operands[0]->getKind() == InfixKind::NUM) {
-                    // auto num = dynamic_cast<NumberExpressionNode*>(operands[0].get());
-                    // coef_out = createNumber(num->Value);
-                    coef_out = clone_expr(operands[0]);
-                } else {
-                    // Handle fraction case by creating a new fraction
-                    // auto frac = dynamic_cast<InfixExpressionNode*>(operands[0].get());
-                    // coef_out = createFraction(frac->Left->Value, frac->Right);
-                    coef_out = clone_expr(operands[0]);
-                }
-                
-                // base_out = createVariable(operands[1]->TokenLiteral());
-                base_out = clone_expr(operands[1]);
-                } else {
-                    std::cerr << "Not NUM||FRAC/VAR" << std::endl;
-                    return;
-                
-                // // For now, just create a copy of the whole expression as the base
-                // // This is a simplified approach
-                // std::vector<std::unique_ptr<ExpressionNode>> clonedOperands;
-                // for (const auto& op : operands) {
-                //     clonedOperands.push_back(clone_expr(const_cast<std::unique_ptr<ExpressionNode>&>(op)));
-                // }
-                // base_out = createProduct(std::move(clonedOperands));
-                // coef_out = nullptr;
+        RankedTerm ranked_term{{}, term.Coeff};
+        for (int var = 0; var < p.NumVars; var++) {
+            int e = p.exponent(term.Exps, var);
+            if (e > 0) ranked_term.Factors.emplace_back(var, Rational(e));
+        }
+        ranked.push_back(std::move(ranked_term));
+    }
+
+    return build_ranked_sum(ranked, constant, variables);
+}
+
+// Algebraic expand, distributes every product over sums and multiplies out whole powers of sums
+std::unique_ptr<ExpressionNode> SimplifyVisitor::expand_tree(std::unique_ptr<ExpressionNode>& expr) {
+    // nothing to distribute anywhere below, don't bother
+    if (!expr->getSynopsis().Expandable) return std::move(expr);
+
+    std::vector<int> symbols;
+    if (polynomial_variables(expr.get(), symbols)) {
+        int nvars = static_cast<int>(symbols.size());
+        std::unordered_map<int, int> var_of;
+        for (int var = 0; var < nvars; var++) var_of[symbols[var]] = var;
+
+        // (x + 1)^70 has coefficients past 64 bits, it's left as the power it was rather than multiplied out wrong
+        Polynomial p = to_polynomial(expr.get(), var_of, nvars);
+        if (p.overflowed()) return std::move(expr);
+        return from_polynomial(p, symbols);
+    }
+
+    AtomTable atoms;
+    ExpandedSum terms = expand_terms(expr, atoms);
+
+    // a double can't be a monomial's coefficient so it's an atom like any other, 0.5^2 x^2 is folded and added to its like terms after
+    bool reals = std::any_of(atoms.Nodes.begin(), atoms.Nodes.end(), [](const auto& atom) { return atom->Key.Rank == OrderRank::REAL; });
+    auto expanded = build_expanded(terms, atoms);
+    return reals ? automatic_simplify(std::move(expanded)) : std::move(expanded);
+}
+
+// Rational function normalisation. When u and v are both polynomials the factors of the two products are compared pairwise and
+// whatever each pair has in common (their gcd) is divided out, until no pair shares anything. Working on the bases means
+// (x + 1)^10 / (x + 1)^9 never has to expand a power. nullptr if nothing cancels, then the caller keeps u / v as it was
+std::unique_ptr<ExpressionNode> SimplifyVisitor::cancel_quotient(const std::unique_ptr<ExpressionNode>& u, const std::unique_ptr<ExpressionNode>& v) {
+    std::vector<int> symbols;
+    if (!collect_polynomial_symbols(u.get(), symbols) || !collect_polynomial_symbols(v.get(), symbols)) return nullptr;
+    std::sort(symbols.begin(), symbols.end(), [](int a, int b) { return symbolRank(a) < symbolRank(b); });
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+    int nvars = static_cast<int>(symbols.size());
+    if (nvars == 0 || nvars > 32) return nullptr;
+    int max_degree = Polynomial(nvars).maxExponent();
+    if (u->getSynopsis().Degree > max_degree || v->getSynopsis().Degree > max_degree) return nullptr;
+
+    std::unordered_map<int, int> var_of;
+    for (int var = 0; var < nvars; var++) var_of[symbols[var]] = var;
+
+    struct PolyFactor {
+        Polynomial Base;
+        i64 Power;
+    };
+    auto factorsOf = [&](const ExpressionNode* w) {
+        std::vector<PolyFactor> factors;
+        if (w->getKind() == InfixKind::MULTIPLY) {
+            auto* prod = static_cast<const NaryExpressionNode*>(w);
+            for (size_t i = 0; i < prod->Operands.size(); i++) {
+                factors.push_back(PolyFactor{to_polynomial(prod->Operands[i].get(), var_of, nvars), prod->coeff(i).num});
             }
         } else {
-            std::cout << "Functionality for this to be added with time but not needed here, only RNE*Var pairs exist." << std::endl;
-            // // Create a copy of the whole expression as the base
-            // std::vector<std::unique_ptr<ExpressionNode>> clonedOperands;
-            // for (const auto& op : operands) {
-            //     clonedOperands.push_back(clone_expr(const_cast<std::unique_ptr<ExpressionNode>&>(op)));
-            // }
-            // base_out = createProduct(std::move(clonedOperands));
-            // coef_out = nullptr;
+            factors.push_back(PolyFactor{to_polynomial(w, var_of, nvars), 1});
         }
-    } else {
-        std::cerr << "Can't extract base and coefficient" <<std::endl;
+        return factors;
+    };
+    std::vector<PolyFactor> num = factorsOf(u.get());
+    std::vector<PolyFactor> den = factorsOf(v.get());
+    auto overflowed = [](const std::vector<PolyFactor>& factors) {
+        return std::any_of(factors.begin(), factors.end(), [](const PolyFactor& f) { return f.Base.overflowed(); });
+    };
+    if (overflowed(num) || overflowed(den)) return nullptr;
+
+    // every cancellation takes at least one off the degree of the denominator, so this stops
+    bool cancelled = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (size_t i = 0; i < num.size() && !progress; i++) {
+            for (size_t j = 0; j < den.size() && !progress; j++) {
+                if (num[i].Power == 0 || den[j].Power == 0 || num[i].Base.isConstant() || den[j].Base.isConstant()) continue;
+
+                Polynomial g = ::gcd(num[i].Base, den[j].Base);
+                if (g.isConstant()) continue;
+
+                // g^p / g^q leaves g^(p - q) on whichever side had more
+                i64 p = num[i].Power;
+                i64 q = den[j].Power;
+                Polynomial rest;
+                divide(num[i].Base, g, rest);
+                num[i].Base = rest;
+                divide(den[j].Base, g, rest);
+                den[j].Base = rest;
+                if (p > q) num.push_back(PolyFactor{g, p - q});
+                if (q > p) den.push_back(PolyFactor{g, q - p});
+
+                progress = cancelled = true;
+            }
+        }
+    }
+    if (!cancelled) return nullptr;
+
+    // every number ends up in one coefficient on top, the bases underneath are made monic so the sign and scale go with it
+    Rational c(1);
+    auto constantOf = [](const Polynomial& p) { return p.isZero() ? Rational(0) : p.Terms[0].Coeff; };
+    for (auto& f : num) {
+        if (!f.Base.isConstant()) continue;
+        c *= powRational(constantOf(f.Base), f.Power);
+        f.Power = 0;
     }
+    for (auto& f : den) {
+        Rational lead = constantOf(f.Base);
+        c = c / powRational(lead, f.Power);
+        if (f.Base.isConstant()) f.Power = 0;
+        else f.Base.makeMonic();
+    }
+    if (c.isOverflow()) return nullptr;
+
+    auto productOf = [&](std::vector<PolyFactor>& factors, const Rational& coeff) {
+        std::vector<std::unique_ptr<ExpressionNode>> operands;
+        std::vector<Rational> exponents;
+        operands.push_back(createRational(coeff));
+        exponents.push_back(Rational(1));
+        for (auto& f : factors) {
+            if (f.Power == 0) continue;
+            operands.push_back(from_polynomial(f.Base, symbols));
+            exponents.push_back(Rational(f.Power));
+        }
+        return simplify_product(createProduct(std::move(operands), std::move(exponents)));
+    };
 
+    auto numerator = productOf(num, c);
+    auto denominator = productOf(den, Rational(1));
+    if (isOne(denominator.get())) return numerator;
+    return createQuotient(std::move(numerator), std::move(denominator));
 }
 
-// Expand linear equation: multiplication node with operands, num, and plus node
-std::unique_ptr<ExpressionNode> SimplifyVisitor::expand_tree(std::unique_ptr<ExpressionNode>& expr) {
-    switch (expr->getKind()) {
-        case InfixKind::MULTIPLY : {
-            auto prod = dynamic_cast<NaryExpressionNode*>(expr.get());
-            if ((prod->Operands[0]->getKind() == InfixKind::NUM || prod->Operands[0]->getKind() == InfixKind::FRACTION) && prod->Operands[1]->getKind() == InfixKind::PLUS) {
-                
-                auto plus_node = dynamic_cast<NaryExpressionNode*>(prod->Operands[1].get());
-
-
-                std::vector<std::unique_ptr<ExpressionNode>> sum_operands;
-                int a;
-                int a_numtr;
-                int a_denom;
-                bool is_num = false;
-                if (prod->Operands[0]->getKind() == InfixKind::NUM) {
-                    a = dynamic_cast<NumberExpressionNode*>(prod->Operands[0].get())->Value;
-                    is_num = true;
+// Lazy expand_tree for polynomials, the terms come out one at a time in lex order of the variables (sorted by name) and the result
+// is never built. Sums are merged and products of powers multiplied out as they're read, only the bases of the powers get expanded
+// up front. nullptr if expr isn't something the polynomial path can take
+std::unique_ptr<TermStream> SimplifyVisitor::expand_stream(const std::unique_ptr<ExpressionNode>& expr, std::vector<std::string>& variables) {
+    std::vector<int> symbols;
+    if (!polynomial_variables(expr.get(), symbols)) return nullptr;
+
+    int nvars = static_cast<int>(symbols.size());
+    std::unordered_map<int, int> var_of;
+    variables.clear();
+    for (int var = 0; var < nvars; var++) {
+        var_of[symbols[var]] = var;
+        variables.push_back(symbolName(symbols[var]));
+    }
+
+    return stream_terms(expr.get(), Rational(1), var_of, nvars);
+}
+
+// c * u as a stream
+std::unique_ptr<TermStream> SimplifyVisitor::stream_terms(const ExpressionNode* u, const Rational& c, const std::unordered_map<int, int>& var_of, int nvars) const {
+    if (u->Key.Rank != OrderRank::CONSTANT) {
+        switch (u->getKind()) {
+            case InfixKind::PLUS: {
+                auto* sum = static_cast<const NaryExpressionNode*>(u);
+                std::vector<std::unique_ptr<TermStream>> streams;
+                for (size_t i = 0; i < sum->Operands.size(); i++) {
+                    streams.push_back(stream_terms(sum->Operands[i].get(), c * sum->coeff(i), var_of, nvars));
                 }
-                else {
-                    a_numtr = getNumerator(prod->Operands[0].get());
-                    a_denom = getDenominator(prod->Operands[0].get());
+                return std::make_unique<SumStream>(std::move(streams));
+            }
+
+            case InfixKind::MULTIPLY: {
+                auto* prod = static_cast<const NaryExpressionNode*>(u);
+                std::vector<PowerFactor> factors;
+                for (size_t i = 0; i < prod->Operands.size(); i++) {
+                    auto base = std::make_shared<const Polynomial>(to_polynomial(prod->Operands[i].get(), var_of, nvars));
+                    factors.push_back(PowerFactor{base, prod->coeff(i).num});
                 }
+                return std::make_unique<ProductStream>(nvars, c, std::move(factors));
+            }
 
-                // auto b = plus_node->Operands[0].get();
-                
-                
-                if (plus_node->Operands[0]->getKind() == InfixKind::NUM || plus_node->Operands[0]->getKind() == InfixKind::FRACTION ) {
-                    std::vector<std::unique_ptr<ExpressionNode>> prod_operands;
-                    prod_operands.push_back(std::move( prod->Operands[0] ));
-                    prod_operands.push_back(std::move( plus_node->Operands[0] ));
-                        
-                    auto op1 = simplify_product(createProduct(std::move(prod_operands)));
-
-                    if (plus_node->Operands[1]->getKind() != InfixKind::MULTIPLY) {
-
-                        is_num ? prod_operands.push_back(createNumber(a)) : prod_operands.push_back(createFraction(a_numtr, a_denom));
-                        prod_operands.push_back(std::move( plus_node->Operands[1] ));
-                        
-                        sum_operands.push_back(std::move( op1 ));
-                        sum_operands.push_back( createProduct(std::move( prod_operands )) );
-                        
-                        
-                        
-                    } else {
-                        auto& child_operands = dynamic_cast<NaryExpressionNode*>(plus_node->Operands[1].get())->Operands;
-                        is_num ? child_operands.push_back(createNumber(a)) : child_operands.push_back(createFraction(a_numtr, a_denom));
-
-                        auto op2 = simplify_product(createProduct(std::move(child_operands)));
-
-                        sum_operands.push_back(std::move(op1));
-                        sum_operands.push_back(std::move(op2));
-                    }
+            case InfixKind::DIVIDE: {
+                auto* div = static_cast<const InfixExpressionNode*>(u);
+                return stream_terms(div->Left.get(), c / div->Right->Key.Value, var_of, nvars);
+            }
+
+            default:
+                break;
+        }
+    }
+
+    Polynomial p = to_polynomial(u, var_of, nvars);
+    return std::make_unique<PolynomialStream>(std::move(p.scale(c)));
+}
+
+
+// ---------------- equations ----------------
+
+// adds c * u to form, false if u isn't linear in its symbols
+bool SimplifyVisitor::to_linear(const ExpressionNode* u, const Rational& c, LinearForm& form) const {
+    if (u->Key.Rank == OrderRank::CONSTANT) {
+        form.Constant += c * u->Key.Value;
+        return true;
+    }
+
+    switch (u->getKind()) {
+        case InfixKind::VAR:
+            if (isUndefined(u)) return false;
+            form.addTerm(u->Key.Symbol, c);
+            return true;
 
-                    return createSum(std::move(sum_operands));
+        case InfixKind::PLUS: {
+            auto* sum = static_cast<const NaryExpressionNode*>(u);
+            for (size_t i = 0; i < sum->Operands.size(); i++) {
+                if (!to_linear(sum->Operands[i].get(), c * sum->coeff(i), form)) return false;
+            }
+            return true;
+        }
 
-                } 
+        case InfixKind::MULTIPLY: {
+            // numbers times at most one linear factor to the first power
+            auto* prod = static_cast<const NaryExpressionNode*>(u);
+            Rational k = c;
+            const ExpressionNode* linear = nullptr;
+            for (size_t i = 0; i < prod->Operands.size(); i++) {
+                const ExpressionNode* op = prod->Operands[i].get();
+                Rational value;
+                if (op->Key.Rank == OrderRank::CONSTANT && prod->coeff(i).isInteger()) {
+                    if (!powRational(op->Key.Value, prod->coeff(i).num, value)) return false;
+                    k *= value;
+                } else if (!linear && prod->coeff(i).isOne()) {
+                    linear = op;
+                } else {
+                    return false;
+                }
+            }
+            if (!linear) {
+                form.Constant += k;
+                return true;
             }
+            return to_linear(linear, k, form);
         }
+
+        case InfixKind::DIVIDE: {
+            auto* div = static_cast<const InfixExpressionNode*>(u);
+            if (div->Right->Key.Rank != OrderRank::CONSTANT || div->Right->Key.Value.isZero()) return false;
+            return to_linear(div->Left.get(), c / div->Right->Key.Value, form);
+        }
+
+        default:
+            return false;
     }
+}
 
-    return std::move(expr);
+// the simplified sum, constant first then the symbols in name order (O-7, O-2)
+std::unique_ptr<ExpressionNode> SimplifyVisitor::from_linear(const LinearForm& form) {
+    std::vector<std::pair<int, Rational>> terms = form.Coeffs;
+    std::sort(terms.begin(), terms.end(), [](const auto& a, const auto& b) { return symbolRank(a.first) < symbolRank(b.first); });
+
+    TermList sum_terms;
+    sum_terms.reserve(terms.size() + 1);
+    if (!form.Constant.isZero()) sum_terms.push_back(Term{Rational(1), createRational(form.Constant)});
+    for (const auto& [symbol, c] : terms) {
+        sum_terms.push_back(Term{c, createVariable(symbolName(symbol))});
+    }
+    return buildSum(std::move(sum_terms));
 }
 
+// left = right as left - right = 0, false if either side isn't linear
+bool SimplifyVisitor::linear_equation(const std::unique_ptr<ExpressionNode>& left, const std::unique_ptr<ExpressionNode>& right, LinearForm& form) const {
+    form = LinearForm();
+    if (!to_linear(left.get(), Rational(1), form) || !to_linear(right.get(), Rational(-1), form)) return false;
 
-void SimplifyVisitor::rearrange_left(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right) {
-    
-    if (left->getKind() == InfixKind::NUM || left->getKind() == InfixKind::FRACTION) {
-        if (right->getKind() == InfixKind::PLUS) {
-            auto right_cast = dynamic_cast<NaryExpressionNode*>(right.get());
-            right_cast->Operands.push_back(std::move( left ));
-            right = std::move(simplify_sum(createSum(std::move(right_cast->Operands))));
-        } else {
-            std::vector<std::unique_ptr<ExpressionNode>> sum_operands;
-            sum_operands.push_back(std::move(left));
-            sum_operands.push_back(std::move(right));
-            right = std::move(simplify_sum(createSum(std::move(sum_operands))));
-        }
-    } else if (left->getKind() == InfixKind::PLUS) {
-        auto left_cast = dynamic_cast<NaryExpressionNode*>(left.get());
-        rearrange_left(left_cast->Operands[0], right);
-        left = std::move(simplify_sum(createSum(std::move(left_cast->Operands))));
-    
+    // numbers that got too big, the equation is left to the general path which says Undefined
+    if (form.Constant.isOverflow()) return false;
+    return std::none_of(form.Coeffs.begin(), form.Coeffs.end(), [](const auto& term) { return term.second.isOverflow(); });
+}
+
+// form = 0 solved for symbol, x if no symbol is given and x is in there, otherwise the first in name order. left becomes the symbol
+// and right its value. False (and left and right untouched) when there's nothing to solve for, i.e. the equation reads k = 0
+bool SimplifyVisitor::solve_linear(const LinearForm& form, std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right, int symbol) {
+    if (form.isConstant()) return false;
+
+    if (symbol < 0) {
+        symbol = form.Coeffs[0].first;
+        for (const auto& term : form.Coeffs) {
+            if (symbolName(term.first) == "x") {
+                symbol = term.first;
+                break;
+            }
+            if (symbolRank(term.first) < symbolRank(symbol)) symbol = term.first;
+        }
     }
+    if (form.coefficient(symbol).isZero()) return false;
 
- 
-    if (!left) {
-        left = createNumber(0);
-    } 
-    if (!right) {
-        right = createNumber(0);
+    left = createVariable(symbolName(symbol));
+    right = from_linear(form.solveFor(symbol));
+    return true;
+}
+
+// u - v, simplified
+std::unique_ptr<ExpressionNode> SimplifyVisitor::subtract(std::unique_ptr<ExpressionNode> u, std::unique_ptr<ExpressionNode> v) {
+    std::vector<std::unique_ptr<ExpressionNode>> operands;
+    operands.push_back(std::move(u));
+    operands.push_back(std::move(v));
+    return simplify_sum(createSum(std::move(operands), {Rational(1), Rational(-1)}));
+}
+
+// the terms of u free of every symbol, and the others. Either is null when there aren't any
+void SimplifyVisitor::split_constant_terms(std::unique_ptr<ExpressionNode> u, std::unique_ptr<ExpressionNode>& constant, std::unique_ptr<ExpressionNode>& rest) {
+    TermList constant_terms;
+    TermList other_terms;
+    for (auto& term : sumTerms(std::move(u), Rational(1))) {
+        if (isConstantExpr(term.Node.get())) constant_terms.push_back(std::move(term));
+        else other_terms.push_back(std::move(term));
     }
+
+    // both halves keep the order they had, so they're still simplified sums
+    constant = constant_terms.empty() ? nullptr : buildSum(std::move(constant_terms));
+    rest = other_terms.empty() ? nullptr : buildSum(std::move(other_terms));
 }
 
-void SimplifyVisitor::rearrange_right(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right) {
-    if (right->getKind() == InfixKind::VAR || right->getKind() == InfixKind::MULTIPLY) {
-        if (left->getKind() == InfixKind::PLUS) {
-            auto left_cast = dynamic_cast<NaryExpressionNode*>(left.get());
-            left_cast->Operands.push_back(std::move( right ));
-            left = std::move(simplify_sum(createSum(std::move(left_cast->Operands))));
-        } else {
-            std::vector<std::unique_ptr<ExpressionNode>> sum_operands;
-            sum_operands.push_back(std::move(right));
-            sum_operands.push_back(std::move(left));
-            left = std::move(simplify_sum(createSum(std::move(sum_operands))));
-        }
-    } else if (right->getKind() == InfixKind::PLUS) {
-        auto right_cast = dynamic_cast<NaryExpressionNode*>(right.get());
-        rearrange_right(left, right_cast->Operands[1]);
-        right = std::move(simplify_sum(createSum(std::move(right_cast->Operands))));
+// moves the constant terms on the left over to the right
+void SimplifyVisitor::rearrange_left(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right) {
+    LinearForm l;
+    LinearForm r;
+    if (to_linear(left.get(), Rational(1), l) && to_linear(right.get(), Rational(1), r)) {
+        r.Constant -= l.Constant;
+        l.Constant = Rational(0);
+        left = from_linear(l);
+        right = from_linear(r);
+        return;
     }
 
- 
-    if (!left) {
-        left = createNumber(0);
-    } 
-    if (!right) {
-        right = createNumber(0);
+    std::unique_ptr<ExpressionNode> constant;
+    std::unique_ptr<ExpressionNode> rest;
+    split_constant_terms(std::move(left), constant, rest);
+    left = rest ? std::move(rest) : createNumber(0);
+    if (constant) right = subtract(std::move(right), std::move(constant));
+}
+
+// moves the terms with symbols on the right over to the left
+void SimplifyVisitor::rearrange_right(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right) {
+    LinearForm l;
+    LinearForm r;
+    if (to_linear(left.get(), Rational(1), l) && to_linear(right.get(), Rational(1), r)) {
+        LinearForm constant;
+        constant.Constant = r.Constant;
+        l = l - (r - constant);
+        left = from_linear(l);
+        right = from_linear(constant);
+        return;
     }
 
-   
+    std::unique_ptr<ExpressionNode> constant;
+    std::unique_ptr<ExpressionNode> rest;
+    split_constant_terms(std::move(right), constant, rest);
+    right = constant ? std::move(constant) : createNumber(0);
+    if (rest) left = subtract(std::move(left), std::move(rest));
 }
 
 void SimplifyVisitor::solve_x(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right) {
-    if (left->getKind() == InfixKind::VAR) {
-        return;
-    } else if( left->getKind() == InfixKind::MULTIPLY) {
-        auto left_cast = dynamic_cast<NaryExpressionNode*>(left.get());
-        int left_coeff = dynamic_cast<NumberExpressionNode*>(left_cast->Operands[0].get())->Value;
-        right = simplify_rne(createQuotient(createNumber(left_coeff), std::move(right)));
-        left = std::move(createVariable(left_cast->Operands[1]->TokenLiteral()));
+    // a linear equation is one division whatever shape it's in
+    LinearForm form;
+    if (linear_equation(left, right, form) && solve_linear(form, left, right)) return;
+
+    // the variable we're isolating lives on whichever side isn't constant
+    if (isConstantExpr(left.get()) && !isConstantExpr(right.get())) {
+        std::swap(left, right);
+    }
+
+    if (left->getKind() == InfixKind::MULTIPLY) {
+        auto left_operands = getNaryOperands(static_cast<NaryExpressionNode*>(left.get()));
+
+        // split the product into the constant coefficient and the part holding the variable, using the synopsis rather than assuming Operands[0] is a number
+        std::vector<std::unique_ptr<ExpressionNode>> coeff_operands;
+        std::vector<std::unique_ptr<ExpressionNode>> var_operands;
+        for (auto& op : left_operands) {
+            if (isConstantExpr(op.get())) {
+                coeff_operands.push_back(std::move(op));
+            } else {
+                var_operands.push_back(std::move(op));
+            }
+        }
+
+        if (coeff_operands.empty()) {
+            left = simplify_product(createProduct(std::move(var_operands)));
+            return;
+        }
+
+        auto coeff = simplify_product(createProduct(std::move(coeff_operands)));
+        right = automatic_simplify(createQuotient(std::move(right), std::move(coeff)));
+        left = simplify_product(createProduct(std::move(var_operands)));
         return;
     }
 }
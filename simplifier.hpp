@@ -3,12 +3,25 @@
 
 #include "ast.hpp"
 #include "visitors.hpp"
+#include "polynomial.hpp"
+#include "termstream.hpp"
+#include "linear.hpp"
 #include <memory>
 #include <algorithm>
+#include <array>
+#include <unordered_map>
+
+// What numbers are folded in. EXACT keeps every constant an integer or a fraction in lowest terms, decimals included (0.25 is 1/4).
+// DOUBLE folds anything that isn't a whole number with hardware doubles instead, 1/3 is 0.333.. and 2^(1/2) is 1.414.., no gcds and no
+// exact fractions to carry around, for when an approximate answer is all that's wanted. Coefficients in a sum and exponents in a product
+// are still Rationals either way, a double that has to scale a term goes in front of it as a factor, 0.5x is the product [0.5, x]
+enum class NumericDomain {EXACT, DOUBLE};
 
 class SimplifyVisitor : public ExprMutableVisitor {
     public:
-        SimplifyVisitor() = default;
+        explicit SimplifyVisitor(NumericDomain domain = NumericDomain::EXACT) : Domain(domain) {}
+
+        NumericDomain domain() const { return Domain; }
 
         void visit(NumberExpressionNode& node) override;
         void visit(VariableExpressionNode& node) override;
@@ -19,39 +32,143 @@ class SimplifyVisitor : public ExprMutableVisitor {
         
         std::unique_ptr<ExpressionNode> getResult() { return std::move(result); }
         std::unique_ptr<ExpressionNode> expand_tree(std::unique_ptr<ExpressionNode>& expr);
+        std::unique_ptr<TermStream> expand_stream(const std::unique_ptr<ExpressionNode>& expr, std::vector<std::string>& variables);
         std::unique_ptr<ExpressionNode> clone_expr(std::unique_ptr<ExpressionNode>& expr);
+        std::unique_ptr<ExpressionNode> clone_expr(const ExpressionNode* expr);
         void rearrange_left(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right);
         void rearrange_right(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right);
         void solve_x(std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right);
 
+        // linear equations go through a LinearForm instead, converted once and solved with one division
+        bool linear_equation(const std::unique_ptr<ExpressionNode>& left, const std::unique_ptr<ExpressionNode>& right, LinearForm& form) const;
+        bool solve_linear(const LinearForm& form, std::unique_ptr<ExpressionNode>& left, std::unique_ptr<ExpressionNode>& right, int symbol = -1);
+
         ~SimplifyVisitor() = default;
 
     private:
+        friend class Differentiator;        // builds derivatives out of simplified pieces with simplify_sum and the rest
+
         std::unique_ptr<ExpressionNode> result;
+        NumericDomain Domain;
+
+        // an operand of a sum or product together with its annotation, the coefficient in a sum and the exponent in a product
+        struct Term {
+            Rational Coeff;
+            std::unique_ptr<ExpressionNode> Node;
+        };
+        using TermList = std::vector<Term>;
+
+        // expansion works on monomial -> coefficient tables instead of trees. A monomial is (atom id, exponent) pairs sorted by atom id
+        struct Monomial {
+            std::vector<std::pair<int, Rational>> Factors;
+            bool operator==(const Monomial& other) const { return Factors == other.Factors; }
+        };
+        struct MonomialHash {
+            size_t operator()(const Monomial& m) const;
+        };
+        using ExpandedSum = std::unordered_map<Monomial, Rational, MonomialHash>;
+
+        // the parts of an expression that can't be multiplied out, numbered so monomials don't hold nodes
+        struct AtomTable {
+            std::vector<std::unique_ptr<ExpressionNode>> Nodes;
+            std::unordered_map<u64, std::vector<int>> Ids;       // synopsis hash -> the atoms with it, almost always one
+            int intern(std::unique_ptr<ExpressionNode> node);
+        };
+
+        ExpandedSum expand_terms(std::unique_ptr<ExpressionNode>& u, AtomTable& atoms);
+        ExpandedSum multiply_expanded(const ExpandedSum& p, const ExpandedSum& q);
+        ExpandedSum power_expanded(const ExpandedSum& base, i64 n);
+        std::unique_ptr<ExpressionNode> build_expanded(ExpandedSum& terms, AtomTable& atoms);
+
+        // a monomial over atoms numbered in canonical order, (rank, exponent) sorted by rank
+        struct RankedTerm {
+            std::vector<std::pair<int, Rational>> Factors;
+            Rational Coeff;
+        };
+        std::unique_ptr<ExpressionNode> build_ranked_sum(std::vector<RankedTerm>& ranked, const Rational& constant, std::vector<std::unique_ptr<ExpressionNode>>& atoms_by_rank);
+
+        // polynomial path of expand_tree
+        bool collect_polynomial_symbols(const ExpressionNode* u, std::vector<int>& symbols) const;
+        bool polynomial_variables(const ExpressionNode* u, std::vector<int>& symbols) const;
+        Polynomial to_polynomial(const ExpressionNode* u, const std::unordered_map<int, int>& var_of, int nvars) const;
+        std::unique_ptr<ExpressionNode> from_polynomial(const Polynomial& p, const std::vector<int>& symbols);
+        // linear forms
+        bool to_linear(const ExpressionNode* u, const Rational& c, LinearForm& form) const;
+        std::unique_ptr<ExpressionNode> from_linear(const LinearForm& form);
+        void split_constant_terms(std::unique_ptr<ExpressionNode> u, std::unique_ptr<ExpressionNode>& constant, std::unique_ptr<ExpressionNode>& rest);
+        std::unique_ptr<ExpressionNode> subtract(std::unique_ptr<ExpressionNode> u, std::unique_ptr<ExpressionNode> v);
+
+        std::unique_ptr<ExpressionNode> cancel_quotient(const std::unique_ptr<ExpressionNode>& u, const std::unique_ptr<ExpressionNode>& v);
+        std::unique_ptr<TermStream> stream_terms(const ExpressionNode* u, const Rational& c, const std::unordered_map<int, int>& var_of, int nvars) const;
+        static Monomial multiply_monomials(const Monomial& a, const Monomial& b);
+        static void add_term(ExpandedSum& sum, Monomial m, const Rational& c);
+
+        // SSUMREC-1/SPRDREC-1 pair rules, indexed by [kind(u1)][kind(u2)]
+        using PairRuleFn = TermList (SimplifyVisitor::*)(Term&, Term&);
+        using PairRuleTable = std::array<std::array<PairRuleFn, KIND_COUNT>, KIND_COUNT>;
+
+        static constexpr PairRuleTable buildSumRules();
+        static constexpr PairRuleTable buildProductRules();
+        static const PairRuleTable sumRuleTable;
+        static const PairRuleTable productRuleTable;
+
+        static size_t kindIndex(const ExpressionNode* node) { return static_cast<size_t>(node->Key.Kind); }
+
+        TermList sumRuleConstants(Term& u1, Term& u2);
+        TermList sumRuleIdentity(Term& u1, Term& u2);
+        TermList sumRuleLikeTerms(Term& u1, Term& u2);
+        TermList sumRuleOrder(Term& u1, Term& u2);
+        TermList sumRuleReals(Term& u1, Term& u2);
+        TermList sumRuleScaledTerms(Term& u1, Term& u2);
+        TermList productRuleConstants(Term& u1, Term& u2);
+        TermList productRuleIdentity(Term& u1, Term& u2);
+        TermList productRuleSameBase(Term& u1, Term& u2);
+        TermList productRuleOrder(Term& u1, Term& u2);
+        TermList productRuleReals(Term& u1, Term& u2);
 
         // keeping the functions names and case the same as in the book so I know whats from the book and not
         std::unique_ptr<ExpressionNode> automatic_simplify(std::unique_ptr<ExpressionNode> expr); //pg 92
         std::unique_ptr<ExpressionNode> simplify_product(std::unique_ptr<NaryExpressionNode> product); // p.g.97
-        std::vector<std::unique_ptr<ExpressionNode>> simplify_product_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands); //p.g. 98
-        std::vector<std::unique_ptr<ExpressionNode>> merge_products( std::vector<std::unique_ptr<ExpressionNode>>& p, std::vector<std::unique_ptr<ExpressionNode>>& q); // p.g. 102
+        TermList simplify_product_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands, const std::vector<Rational>& exponents, size_t first, size_t last); //p.g. 98
+        TermList merge_products(TermList& p, TermList& q); // p.g. 102
 
-        std::unique_ptr<ExpressionNode> simplify_sum(std::unique_ptr<NaryExpressionNode> sum);
-        std::vector<std::unique_ptr<ExpressionNode>> simplify_sum_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands);
-        std::vector<std::unique_ptr<ExpressionNode>> merge_sums( std::vector<std::unique_ptr<ExpressionNode>>& p, std::vector<std::unique_ptr<ExpressionNode>>& q); // p.g. 102
+        std::unique_ptr<ExpressionNode> simplify_power(std::unique_ptr<ExpressionNode> v, std::unique_ptr<ExpressionNode> w); // p.g. 95
+        std::unique_ptr<ExpressionNode> simplify_integer_power(std::unique_ptr<ExpressionNode> v, i64 n); // p.g. 96
 
-        void extractBaseAndCoefficient(ExpressionNode* expr, std::unique_ptr<ExpressionNode>& base_out, std::unique_ptr<ExpressionNode>& coef_out);
-        bool isPlusNodeChild(const std::vector<std::unique_ptr<ExpressionNode>>& operands);
+        std::unique_ptr<ExpressionNode> simplify_sum(std::unique_ptr<NaryExpressionNode> sum);
+        TermList simplify_sum_rec(std::vector<std::unique_ptr<ExpressionNode>>& operands, const std::vector<Rational>& coeffs, size_t first, size_t last);
+        TermList merge_sums(TermList& p, TermList& q); // p.g. 102
+
+        // moving between nodes and annotated operand lists
+        TermList sumTerms(std::unique_ptr<ExpressionNode> u, const Rational& c);
+        TermList productFactors(std::unique_ptr<ExpressionNode> u, const Rational& e);
+        std::unique_ptr<ExpressionNode> buildSum(TermList terms);
+        std::unique_ptr<ExpressionNode> buildProduct(TermList factors);
+        bool overflowed(const TermList& terms) const;
+        std::unique_ptr<ExpressionNode> scale(std::unique_ptr<ExpressionNode> u, const Rational& c);
+        std::unique_ptr<ExpressionNode> negate(std::unique_ptr<ExpressionNode> u);
+
+        // doubles, see NumericDomain
+        std::unique_ptr<ExpressionNode> scaleReal(std::unique_ptr<ExpressionNode> u, double r);
+        std::unique_ptr<ExpressionNode> realPower(const ExpressionNode* u, const Rational& e);
+        std::unique_ptr<ExpressionNode> withoutLeadingReal(std::unique_ptr<ExpressionNode> u);
+        bool hasLeadingReal(const ExpressionNode* u) const;
+        int compareScaledRest(const ExpressionNode* u, const ExpressionNode* v) const;
+        int compareTerms(const Term& a, const Term& b) const;
+        static std::vector<Rational> withoutOnes(std::vector<Rational> coeffs);
 
         bool isUndefined(const ExpressionNode* node) const;
 
         bool isZero(const ExpressionNode*) const;
 
         bool isOne(const ExpressionNode* node) const;
-        std::unique_ptr<NaryExpressionNode> createProduct(std::vector<std::unique_ptr<ExpressionNode>> operands);
-        std::unique_ptr<NaryExpressionNode> createSum(std::vector<std::unique_ptr<ExpressionNode>> operands) const;
+        std::unique_ptr<NaryExpressionNode> createProduct(std::vector<std::unique_ptr<ExpressionNode>> operands, std::vector<Rational> exponents = {});
+        std::unique_ptr<NaryExpressionNode> createSum(std::vector<std::unique_ptr<ExpressionNode>> operands, std::vector<Rational> coeffs = {}) const;
         std::unique_ptr<InfixExpressionNode> createQuotient(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
         std::unique_ptr<InfixExpressionNode> createDifference(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
-        std::unique_ptr<NumberExpressionNode> createNumber(int value); 
+        std::unique_ptr<NumberExpressionNode> createNumber(i64 value); 
+        std::unique_ptr<ExpressionNode> createRational(const Rational& r);
+        std::unique_ptr<ExpressionNode> createReal(double value);
         std::unique_ptr<VariableExpressionNode> createVariable(const std::string& value) const;
 
 
@@ -69,18 +186,16 @@ class SimplifyVisitor : public ExprMutableVisitor {
         std::unique_ptr<ExpressionNode> evaluate_quotient(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
         std::unique_ptr<ExpressionNode> evaluate_sum(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
         std::unique_ptr<ExpressionNode> evaluate_difference(std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
-        std::unique_ptr<InfixExpressionNode> createFraction(int numerator, int denominator);
+        std::unique_ptr<InfixExpressionNode> createFraction(i64 numerator, i64 denominator);
         bool isInteger(const ExpressionNode* node);
-        int getintValue(const ExpressionNode* node) const;
-        int getNumerator(const ExpressionNode* node) const;
-        int getDenominator(const ExpressionNode* node) const;
-        int gcd(int a, int b);
 
 
         // order relation, decides order of simplified expressions (commutative transformation)
         bool operandLessThan(const ExpressionNode* u, const ExpressionNode* v) const; //p.g.84
-
-        std::vector<std::unique_ptr<ExpressionNode>> rest(std::vector<std::unique_ptr<ExpressionNode>>& a);
+        int operandCompare(const ExpressionNode* u, const ExpressionNode* v) const;
+        int compareOperandSequences(const std::unique_ptr<ExpressionNode>* u, const Rational* cu, size_t m, const std::unique_ptr<ExpressionNode>* v, const Rational* cv, size_t n) const;
+        int compareOperandSequences(const std::unique_ptr<ExpressionNode>* u, const Rational* cu, size_t m, const ExpressionNode* v) const;
+        static const Rational* annotations(const NaryExpressionNode* node) { return node->Coeffs.empty() ? nullptr : node->Coeffs.data(); }
 
 
         
@@ -89,6 +204,6 @@ class SimplifyVisitor : public ExprMutableVisitor {
 
 
 // entry point function that calls visitor
-std::unique_ptr<ExpressionNode> automatic_simplify(std::unique_ptr<ExpressionNode> expr);
+std::unique_ptr<ExpressionNode> automatic_simplify(std::unique_ptr<ExpressionNode> expr, NumericDomain domain = NumericDomain::EXACT);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,670 @@
+/*
+system.cpp
+*/
+
+#include "system.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+using u128 = unsigned __int128;
+
+// 0 if there's nothing in col, for the integer rows and the ones mod the primes
+template<typename T>
+static T entry(const std::vector<std::pair<int, T>>& entries, int col) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), col, [](const auto& e, int c) { return e.first < c; });
+    return (it != entries.end() && it->first == col) ? it->second : T{};
+}
+
+// form = 0 as integers, (symbol, coefficient) sum = rhs, times the lcm of the denominators. False if that doesn't fit
+static bool integerRow(const LinearForm& form, std::vector<std::pair<int, i64>>& terms, i64& rhs) {
+    i128 lcm = form.Constant.den;
+    for (const auto& [symbol, c] : form.Coeffs) {
+        lcm = lcm / gcd_i128(lcm, c.den) * c.den;
+        if (!fitsI64(lcm)) return false;
+    }
+
+    for (const auto& [symbol, c] : form.Coeffs) {
+        i128 v = static_cast<i128>(c.num) * (lcm / c.den);
+        if (!fitsI64(v)) return false;
+        terms.emplace_back(symbol, static_cast<i64>(v));
+    }
+    i128 r = -static_cast<i128>(form.Constant.num) * (lcm / form.Constant.den);
+    if (!fitsI64(r)) return false;
+    rhs = static_cast<i64>(r);
+    return true;
+}
+
+// ---------------- arithmetic mod a prime ----------------
+
+// primes just under 2^62, so two residues add up without leaving the word
+static const u64 PRIMES[] = {4611686018427387847ULL, 4611686018427387817ULL, 4611686018427387787ULL, 4611686018427387761ULL};
+
+static u64 mulMod(u64 a, u64 b, u64 p) { return static_cast<u64>(static_cast<u128>(a) * b % p); }
+static u64 subMod(u64 a, u64 b, u64 p) { return a >= b ? a - b : a + p - b; }
+
+static u64 toMod(i64 v, u64 p) {
+    i64 r = v % static_cast<i64>(p);
+    return static_cast<u64>(r < 0 ? r + static_cast<i64>(p) : r);
+}
+
+static u64 powMod(u64 b, u64 e, u64 p) {
+    u64 r = 1;
+    while (e > 0) {
+        if (e & 1) r = mulMod(r, b, p);
+        b = mulMod(b, b, p);
+        e >>= 1;
+    }
+    return r;
+}
+
+// Fermat, p is prime and a isn't 0
+static u64 inverseMod(u64 a, u64 p) { return powMod(a, p - 2, p); }
+
+// x mod p and mod q as the one residue mod p q
+static u128 crt(u64 x_p, u64 p, u64 x_q, u64 q) {
+    u64 t = mulMod(subMod(x_q, x_p % q, q), inverseMod(p % q, q), q);
+    return x_p + static_cast<u128>(t) * p;
+}
+
+// Wang's rational reconstruction: the n / d that is x mod m with |n| and d at most sqrt(m / 2), found by running Euclid on (m, x)
+// until the remainder drops under that bound. There's at most one such fraction, false when there isn't one
+static bool reconstruct(u128 x, u128 m, Rational& out) {
+    u128 half = m / 2;
+    u128 bound = static_cast<u128>(std::sqrt(static_cast<double>(half)));
+    while (bound * bound > half) bound--;
+    while ((bound + 1) * (bound + 1) <= half) bound++;
+
+    i128 r0 = static_cast<i128>(m);
+    i128 r1 = static_cast<i128>(x);
+    i128 t0 = 0;
+    i128 t1 = 1;
+    while (r1 > static_cast<i128>(bound)) {
+        i128 q = r0 / r1;
+        std::swap(r0, r1);
+        r1 -= q * r0;
+        std::swap(t0, t1);
+        t1 -= q * t0;
+    }
+    if (t1 < 0) {
+        r1 = -r1;
+        t1 = -t1;
+    }
+    if (t1 == 0 || t1 > static_cast<i128>(bound) || gcd_i128(r1, t1) != 1) return false;
+    return narrowRational(r1, t1, out);
+}
+
+// ---------------- elimination mod a prime ----------------
+
+int SparseSystem::column(int symbol) {
+    auto it = ColumnOf.find(symbol);
+    if (it != ColumnOf.end()) return it->second;
+
+    int col = static_cast<int>(Symbols.size());
+    ColumnOf.emplace(symbol, col);
+    Symbols.push_back(symbol);
+    ColumnRows.emplace_back();
+    ColumnCount.push_back(0);
+    return col;
+}
+
+bool SparseSystem::addEquation(const LinearForm& form) {
+    std::vector<std::pair<int, i64>> terms;
+    IntegerRow row;
+    if (!integerRow(form, terms, row.Rhs)) return false;
+
+    for (const auto& [symbol, v] : terms) row.Entries.emplace_back(column(symbol), v);
+    // columns are numbered as symbols turn up, not in symbol order
+    std::sort(row.Entries.begin(), row.Entries.end());
+
+    size_t index = Rows.size();
+    for (const auto& [col, v] : row.Entries) {
+        ColumnCount[col]++;
+        ColumnRows[col].push_back(index);
+    }
+    Rows.push_back(std::move(row));
+    return true;
+}
+
+// Maximum matching of rows to columns, then the strongly connected parts of "the row matched to this column uses that column". Those
+// are the diagonal blocks of the block triangular form, and Tarjan finishes a part only after everything it depends on, so the blocks
+// come out in the order to solve them. Going in that order nothing outside a block is touched until its unknowns are eliminated, the
+// fill stays in the rows that use them, and once a block is done its pivots are out of those rows again.
+// Rows and columns left out of the matching aren't in any block
+std::vector<std::vector<size_t>> SparseSystem::blocks() {
+    size_t nrows = Rows.size();
+    size_t ncols = Symbols.size();
+    std::vector<long> row_of(ncols, -1);
+    std::vector<int> col_of(nrows, -1);
+
+    // cheap pass first, most rows get a column without any searching. The free column in the fewest rows is the one least likely
+    // to be wanted by another row
+    for (size_t i = 0; i < nrows; i++) {
+        int best = -1;
+        for (const auto& [col, v] : Rows[i].Entries) {
+            if (row_of[col] < 0 && (best < 0 || ColumnCount[col] < ColumnCount[best])) best = col;
+        }
+        if (best >= 0) {
+            row_of[best] = static_cast<long>(i);
+            col_of[i] = best;
+        }
+    }
+
+    // augmenting paths for the rest, looking for a free column in the row before going any deeper. The path is kept on a stack of
+    // (row, next entry to try) rather than recursed along, it can go through every row of the system
+    struct Step {
+        size_t Row;
+        size_t Next;
+    };
+    std::vector<size_t> seen(ncols, SIZE_MAX);
+    std::vector<Step> path;
+    for (size_t start = 0; start < nrows; start++) {
+        if (col_of[start] >= 0) continue;
+
+        int free_col = -1;
+        path.assign(1, Step{start, 0});
+        while (!path.empty()) {
+            Step& step = path.back();
+            const auto& entries = Rows[step.Row].Entries;
+            if (step.Next == 0) {
+                auto it = std::find_if(entries.begin(), entries.end(), [&](const auto& e) { return row_of[e.first] < 0; });
+                if (it != entries.end()) {
+                    free_col = it->first;
+                    break;
+                }
+            }
+
+            while (step.Next < entries.size() && seen[entries[step.Next].first] == start) step.Next++;
+            if (step.Next == entries.size()) {
+                path.pop_back();
+                continue;
+            }
+            int col = entries[step.Next++].first;
+            seen[col] = start;
+            path.push_back(Step{static_cast<size_t>(row_of[col]), 0});
+        }
+        if (free_col < 0) continue;
+
+        // the last row takes the free column, every row before it the column it went through to get to the next one
+        int col = free_col;
+        for (size_t k = path.size(); k-- > 0;) {
+            row_of[col] = static_cast<long>(path[k].Row);
+            col_of[path[k].Row] = col;
+            if (k > 0) col = Rows[path[k - 1].Row].Entries[path[k - 1].Next - 1].first;
+        }
+    }
+
+    // Tarjan over the matched rows, with its own stack of (row, next entry) for the same reason
+    std::vector<std::vector<size_t>> result;
+    std::vector<long> index(nrows, -1);
+    std::vector<long> low(nrows, 0);
+    std::vector<bool> on_stack(nrows, false);
+    std::vector<size_t> stack;
+    std::vector<Step> calls;
+    long counter = 0;
+
+    auto enter = [&](size_t i) {
+        index[i] = low[i] = counter++;
+        stack.push_back(i);
+        on_stack[i] = true;
+        calls.push_back(Step{i, 0});
+    };
+    for (size_t root = 0; root < nrows; root++) {
+        if (col_of[root] < 0 || index[root] >= 0) continue;
+
+        enter(root);
+        while (!calls.empty()) {
+            Step& call = calls.back();
+            size_t i = call.Row;
+            const auto& entries = Rows[i].Entries;
+            if (call.Next < entries.size()) {
+                int col = entries[call.Next++].first;
+                if (row_of[col] < 0) continue;
+                size_t j = static_cast<size_t>(row_of[col]);
+                if (index[j] < 0) enter(j);
+                else if (on_stack[j]) low[i] = std::min(low[i], index[j]);
+                continue;
+            }
+
+            // everything i uses is finished
+            if (low[i] == index[i]) {
+                std::vector<size_t> block;
+                size_t j;
+                do {
+                    j = stack.back();
+                    stack.pop_back();
+                    on_stack[j] = false;
+                    block.push_back(j);
+                } while (j != i);
+                result.push_back(std::move(block));
+            }
+            calls.pop_back();
+            if (!calls.empty()) low[calls.back().Row] = std::min(low[calls.back().Row], low[i]);
+        }
+    }
+
+    BlockOf.assign(ncols, -1);
+    for (size_t b = 0; b < result.size(); b++) {
+        for (size_t i : result[b]) BlockOf[col_of[i]] = static_cast<int>(b);
+    }
+    return result;
+}
+
+// the rows mod prime, coefficients that are a multiple of it dropped, and the column counts to go with them
+SparseSystem::Reduction SparseSystem::reduction(u64 prime) const {
+    Reduction r;
+    r.Prime = prime;
+    r.Rows.reserve(Rows.size());
+    r.ColumnRows = ColumnRows;
+    r.ColumnCount.assign(Symbols.size(), 0);
+
+    for (const IntegerRow& row : Rows) {
+        ModRow reduced;
+        reduced.Rhs = toMod(row.Rhs, prime);
+        reduced.Entries.reserve(row.Entries.size());
+        for (const auto& [col, v] : row.Entries) {
+            u64 x = toMod(v, prime);
+            if (x == 0) continue;
+            reduced.Entries.emplace_back(col, x);
+            r.ColumnCount[col]++;
+        }
+        r.Rows.push_back(std::move(reduced));
+    }
+    return r;
+}
+
+// Markowitz over the given rows, kept to the shortest of them: the entry with the least (row count - 1) * (column count - 1), only
+// in columns of the block unless block is -1. Any nonzero residue is as good a pivot as any other, so that's all there is to it.
+// Empty rows are settled on the way, 0 = 0 is dropped and 0 = k means the system is inconsistent, pivot_row is that row then
+bool SparseSystem::choosePivot(Reduction& r, const std::vector<size_t>& rows, int block, size_t& pivot_row, int& pivot_col, SolveStatus& status) const {
+    auto inBlock = [&](int col) { return block < 0 || BlockOf[col] == block; };
+
+    std::vector<size_t> shortest;
+    size_t best_length = SIZE_MAX;
+    for (size_t i : rows) {
+        ModRow& row = r.Rows[i];
+        if (!row.Active) continue;
+
+        if (row.Entries.empty()) {
+            if (row.Rhs != 0) {
+                status = SolveStatus::INCONSISTENT;
+                pivot_row = i;
+                return false;
+            }
+            row.Active = false;
+            continue;
+        }
+
+        size_t length = row.Entries.size();
+        if (length > best_length) continue;
+        if (std::none_of(row.Entries.begin(), row.Entries.end(), [&](const auto& e) { return inBlock(e.first); })) continue;
+
+        if (length < best_length) {
+            best_length = length;
+            shortest.clear();
+        }
+        shortest.push_back(i);
+    }
+    if (shortest.empty()) return false;
+
+    i64 best_cost = INT64_MAX;
+    for (size_t i : shortest) {
+        for (const auto& [col, v] : r.Rows[i].Entries) {
+            if (!inBlock(col)) continue;
+            i64 cost = static_cast<i64>(best_length - 1) * (r.ColumnCount[col] - 1);
+            if (cost < best_cost) {
+                best_cost = cost;
+                pivot_row = i;
+                pivot_col = col;
+            }
+        }
+    }
+    return true;
+}
+
+// The pivot row is scaled so its entry in pivot_col is 1, then taken off every other active row that has pivot_col in it, as many
+// times as that row's entry says. pivot_col is gone from all of them after this, so its row list isn't needed again.
+// False if the entry is 0, which only happens when a second prime is following the pivots the first one chose
+bool SparseSystem::pivotOn(Reduction& r, size_t pivot_row, int pivot_col) const {
+    const u64 p = r.Prime;
+    ModRow& pivot = r.Rows[pivot_row];
+    u64 lead = entry(pivot.Entries, pivot_col);
+    if (lead == 0) return false;
+
+    u64 inverse = inverseMod(lead, p);
+    for (auto& [col, v] : pivot.Entries) v = mulMod(v, inverse, p);
+    pivot.Rhs = mulMod(pivot.Rhs, inverse, p);
+
+    std::vector<size_t> targets = std::move(r.ColumnRows[pivot_col]);
+    r.ColumnRows[pivot_col].clear();
+    std::vector<std::pair<int, u64>> merged;
+    for (size_t target : targets) {
+        if (target == pivot_row || !r.Rows[target].Active) continue;
+        ModRow& row = r.Rows[target];
+        u64 a = entry(row.Entries, pivot_col);
+        if (a == 0) continue;
+
+        // row - a * pivot, merging the two sorted lists. The columns it gains and loses keep the counts right
+        merged.clear();
+        merged.reserve(row.Entries.size() + pivot.Entries.size());
+        size_t i = 0;
+        size_t j = 0;
+        while (i < row.Entries.size() || j < pivot.Entries.size()) {
+            int col;
+            u64 v;
+            if (j == pivot.Entries.size() || (i < row.Entries.size() && row.Entries[i].first < pivot.Entries[j].first)) {
+                col = row.Entries[i].first;
+                v = row.Entries[i++].second;
+            } else if (i == row.Entries.size() || pivot.Entries[j].first < row.Entries[i].first) {
+                col = pivot.Entries[j].first;
+                v = subMod(0, mulMod(a, pivot.Entries[j++].second, p), p);
+                r.Fill++;
+                r.ColumnCount[col]++;
+                r.ColumnRows[col].push_back(target);
+            } else {
+                col = row.Entries[i].first;
+                v = subMod(row.Entries[i++].second, mulMod(a, pivot.Entries[j++].second, p), p);
+                if (v == 0) r.ColumnCount[col]--;
+            }
+            if (v != 0) merged.emplace_back(col, v);
+        }
+        row.Entries.swap(merged);
+        row.Rhs = subMod(row.Rhs, mulMod(a, pivot.Rhs, p), p);
+    }
+
+    pivot.Active = false;
+    for (const auto& [col, v] : pivot.Entries) r.ColumnCount[col]--;
+    r.Pivots.emplace_back(pivot_row, pivot_col);
+    return true;
+}
+
+// Every pivot the order gives, choosing them as it goes. INCONSISTENT with the row that says 0 = k, otherwise UNIQUE for finished,
+// the pivots taken say what's pinned down
+SolveStatus SparseSystem::reduce(Reduction& r, const std::vector<std::vector<size_t>>& order, size_t& inconsistent_row) const {
+    for (size_t b = 0; b < order.size(); b++) {
+        int block = b + 1 < order.size() ? static_cast<int>(b) : -1;
+        while (true) {
+            size_t k = 0;
+            int c = 0;
+            SolveStatus status = SolveStatus::UNIQUE;
+            if (!choosePivot(r, order[b], block, k, c, status)) {
+                if (status == SolveStatus::INCONSISTENT) {
+                    inconsistent_row = k;
+                    return status;
+                }
+                break;
+            }
+            pivotOn(r, k, c);
+        }
+    }
+    return SolveStatus::UNIQUE;
+}
+
+// mod the prime, every other column in a pivot row was either pivoted later or is free (and 0), and the pivot itself is 1
+std::vector<u64> SparseSystem::backSubstitute(const Reduction& r) const {
+    std::vector<u64> values(Symbols.size(), 0);
+    for (size_t step = r.Pivots.size(); step-- > 0;) {
+        const auto& [k, c] = r.Pivots[step];
+        const ModRow& row = r.Rows[k];
+        u64 x = row.Rhs;
+        for (const auto& [col, a] : row.Entries) {
+            if (col != c && values[col] != 0) x = subMod(x, mulMod(a, values[col], r.Prime), r.Prime);
+        }
+        values[c] = x;
+    }
+    return values;
+}
+
+// every equation as given holds exactly, false too if the check itself doesn't fit in 64 bits
+static bool satisfies(const std::vector<IntegerRow>& rows, const std::vector<Rational>& values) {
+    for (const IntegerRow& row : rows) {
+        Rational sum(0);
+        for (const auto& [col, a] : row.Entries) sum += Rational(a) * values[col];
+        if (sum.isOverflow() || sum != Rational(row.Rhs)) return false;
+    }
+    return true;
+}
+
+// The pivots are chosen mod the first prime of a pair and followed mod the second. If the second has a 0 where a pivot should be,
+// or doesn't agree the system is inconsistent, one of the two primes divides something it shouldn't and the next pair is tried.
+// With primes this size that's about n / 2^62 for n unknowns
+SystemSolution SparseSystem::solve() {
+    SystemSolution solution;
+
+    // the blocks in order, then whatever they didn't cover: spare equations, unmatched unknowns, and anything a block left behind
+    // because its numbers cancelled
+    std::vector<std::vector<size_t>> order = blocks();
+    std::vector<size_t> all(Rows.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = i;
+    order.push_back(std::move(all));
+
+    for (size_t attempt = 0; attempt + 1 < std::size(PRIMES); attempt++) {
+        u64 p = PRIMES[attempt];
+        u64 q = PRIMES[attempt + 1];
+        Reduction first = reduction(p);
+        size_t bad_row = 0;
+        SolveStatus status = reduce(first, order, bad_row);
+
+        Reduction second = reduction(q);
+        bool followed = std::all_of(first.Pivots.begin(), first.Pivots.end(), [&](const auto& pivot) {
+            return pivotOn(second, pivot.first, pivot.second);
+        });
+        if (!followed) continue;
+
+        if (status == SolveStatus::INCONSISTENT) {
+            if (!second.Rows[bad_row].Entries.empty() || second.Rows[bad_row].Rhs == 0) continue;
+            solution.Status = status;
+            return solution;
+        }
+
+        // both residues of each value, joined up and read back as a fraction
+        std::vector<u64> x_p = backSubstitute(first);
+        std::vector<u64> x_q = backSubstitute(second);
+        u128 m = static_cast<u128>(p) * q;
+        size_t n = Symbols.size();
+        std::vector<Rational> values(n, Rational(0));
+        std::vector<bool> pinned(n, false);
+        for (const auto& [k, c] : first.Pivots) {
+            pinned[c] = true;
+            if (!reconstruct(crt(x_p[c], p, x_q[c], q), m, values[c])) {
+                solution.Status = SolveStatus::OVERFLOW;
+                return solution;
+            }
+        }
+        if (!satisfies(Rows, values)) {
+            solution.Status = SolveStatus::OVERFLOW;
+            return solution;
+        }
+
+        solution.Fill = first.Fill;
+        for (size_t col = 0; col < n; col++) {
+            solution.Values.emplace_back(Symbols[col], values[col]);
+            if (!pinned[col]) solution.FreeSymbols.push_back(Symbols[col]);
+        }
+        if (!solution.FreeSymbols.empty()) solution.Status = SolveStatus::UNDERDETERMINED;
+        return solution;
+    }
+
+    solution.Status = SolveStatus::OVERFLOW;
+    return solution;
+}
+
+// ---------------- incremental ----------------
+
+int IncrementalSystem::column(int symbol) {
+    auto it = ColumnOf.find(symbol);
+    if (it != ColumnOf.end()) return it->second;
+
+    int col = static_cast<int>(Symbols.size());
+    ColumnOf.emplace(symbol, col);
+    Symbols.push_back(symbol);
+    PivotRow.push_back(-1);
+    ColumnRows.emplace_back();
+    ColumnCount.push_back(0);
+    return col;
+}
+
+// drops the columns a turned away equation brought in, nothing else refers to them yet
+void IncrementalSystem::forgetColumns(size_t count) {
+    while (Symbols.size() > count) {
+        ColumnOf.erase(Symbols.back());
+        Symbols.pop_back();
+        PivotRow.pop_back();
+        ColumnRows.pop_back();
+        ColumnCount.pop_back();
+    }
+}
+
+// v mod both primes
+static Residues residues(i64 v) { return Residues{toMod(v, PRIMES[0]), toMod(v, PRIMES[1])}; }
+
+// row - a * pivot, a being row's entry in pivot_col and the pivot's 1, so pivot_col drops out. The columns it gains go in fills and
+// the ones that cancel (other than pivot_col) in cancelled. False if row has nothing in pivot_col
+static bool eliminate(const ResidueEntries& pivot, const Residues& pivot_rhs, int pivot_col, ResidueEntries& row, Residues& rhs,
+                      std::vector<int>& fills, std::vector<int>& cancelled) {
+    const u64 p = PRIMES[0];
+    const u64 q = PRIMES[1];
+    Residues a = entry(row, pivot_col);
+    if (a.isZero()) return false;
+
+    auto minus = [&](const Residues& x, const Residues& y) {
+        return Residues{subMod(x.P, mulMod(a.P, y.P, p), p), subMod(x.Q, mulMod(a.Q, y.Q, q), q)};
+    };
+
+    ResidueEntries merged;
+    merged.reserve(row.size() + pivot.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < row.size() || j < pivot.size()) {
+        int col;
+        Residues v;
+        if (j == pivot.size() || (i < row.size() && row[i].first < pivot[j].first)) {
+            col = row[i].first;
+            v = row[i++].second;
+        } else if (i == row.size() || pivot[j].first < row[i].first) {
+            col = pivot[j].first;
+            v = minus(Residues{}, pivot[j++].second);
+            if (col != pivot_col) fills.push_back(col);
+        } else {
+            col = row[i].first;
+            v = minus(row[i++].second, pivot[j++].second);
+            if (v.isZero() && col != pivot_col) cancelled.push_back(col);
+        }
+        if (col == pivot_col || v.isZero()) continue;
+        merged.emplace_back(col, v);
+    }
+    row.swap(merged);
+    rhs = minus(rhs, pivot_rhs);
+    return true;
+}
+
+SolveStatus IncrementalSystem::addEquation(const LinearForm& form) {
+    std::vector<std::pair<int, i64>> terms;
+    IntegerRow equation;
+    if (!integerRow(form, terms, equation.Rhs)) return SolveStatus::OVERFLOW;
+
+    size_t known = Symbols.size();
+    for (const auto& [symbol, v] : terms) equation.Entries.emplace_back(column(symbol), v);
+    std::sort(equation.Entries.begin(), equation.Entries.end());
+
+    // none of the coefficients is 0 mod either prime, they're both bigger than anything in 64 bits
+    Row row;
+    row.Rhs = residues(equation.Rhs);
+    for (const auto& [col, v] : equation.Entries) row.Entries.emplace_back(col, residues(v));
+
+    // substitute the pivots, their rows only bring in free columns so one pass does it
+    std::vector<int> fills;
+    std::vector<int> cancelled;
+    std::vector<int> solved;
+    for (const auto& [col, v] : row.Entries) {
+        if (PivotRow[col] >= 0) solved.push_back(col);
+    }
+    for (int col : solved) {
+        const Row& pivot = Rows[PivotRow[col]];
+        eliminate(pivot.Entries, pivot.Rhs, col, row.Entries, row.Rhs, fills, cancelled);
+    }
+
+    // 0 = 0 says nothing new, 0 = k can't be true. A number that isn't 0 mod one of the primes isn't 0 at all
+    if (row.Entries.empty()) {
+        forgetColumns(known);
+        if (!row.Rhs.isZero()) return SolveStatus::INCONSISTENT;
+        Equations.push_back(std::move(equation));
+        Accepted++;
+        return status();
+    }
+
+    // the free unknown in the fewest rows, out of the ones that can be divided by mod both primes
+    int c = -1;
+    for (const auto& [col, v] : row.Entries) {
+        if (v.P == 0 || v.Q == 0) continue;
+        if (c < 0 || ColumnCount[col] < ColumnCount[c]) c = col;
+    }
+    if (c < 0) {
+        // everything left is a multiple of one prime or the other, which isn't the same as 0 but can't be divided by either
+        forgetColumns(known);
+        return SolveStatus::OVERFLOW;
+    }
+
+    // scaled so the pivot is 1, then c out of every other row
+    Residues lead = entry(row.Entries, c);
+    Residues inverse {inverseMod(lead.P, PRIMES[0]), inverseMod(lead.Q, PRIMES[1])};
+    auto scaled = [&](const Residues& x) { return Residues{mulMod(x.P, inverse.P, PRIMES[0]), mulMod(x.Q, inverse.Q, PRIMES[1])}; };
+    for (auto& [col, v] : row.Entries) v = scaled(v);
+    row.Rhs = scaled(row.Rhs);
+
+    std::vector<size_t>& targets = ColumnRows[c];
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    for (size_t i : targets) {
+        fills.clear();
+        cancelled.clear();
+        if (!eliminate(row.Entries, row.Rhs, c, Rows[i].Entries, Rows[i].Rhs, fills, cancelled)) continue;
+
+        ColumnCount[c]--;
+        for (int col : fills) {
+            ColumnCount[col]++;
+            ColumnRows[col].push_back(i);
+        }
+        for (int col : cancelled) ColumnCount[col]--;
+    }
+    targets.clear();
+
+    size_t index = Rows.size();
+    for (const auto& [col, v] : row.Entries) {
+        ColumnCount[col]++;
+        if (col != c) ColumnRows[col].push_back(index);
+    }
+    row.Pivot = c;
+    PivotRow[c] = static_cast<long>(index);
+    Rows.push_back(std::move(row));
+    Equations.push_back(std::move(equation));
+    Pivots++;
+    Accepted++;
+    return status();
+}
+
+// One solution in full, the free unknowns 0 and every pivot its row's right hand side, read back from the residues and checked
+// exactly. Whatever's pinned down has that value in every solution, so once this one holds the pinned values are right
+bool IncrementalSystem::values(std::vector<std::pair<int, Rational>>& out) const {
+    out.clear();
+    const u64 p = PRIMES[0];
+    const u64 q = PRIMES[1];
+    std::vector<Rational> x(Symbols.size(), Rational(0));
+    for (const Row& row : Rows) {
+        if (!reconstruct(crt(row.Rhs.P, p, row.Rhs.Q, q), static_cast<u128>(p) * q, x[row.Pivot])) return false;
+    }
+    if (!satisfies(Equations, x)) return false;
+
+    for (const Row& row : Rows) {
+        if (row.Entries.size() == 1) out.emplace_back(Symbols[row.Pivot], x[row.Pivot]);
+    }
+    return true;
+}
+
+std::vector<int> IncrementalSystem::freeSymbols() const {
+    std::vector<int> result;
+    for (size_t col = 0; col < Symbols.size(); col++) {
+        if (PivotRow[col] < 0) result.push_back(Symbols[col]);
+    }
+    return result;
+}
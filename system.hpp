@@ -0,0 +1,149 @@
+/*
+system.hpp
+
+Exact solver for systems of linear equations, each one a LinearForm read as form = 0.
+
+The matrix is kept sparse, one row of (column, integer) pairs per equation. SparseSystem eliminates modulo a prime just under 2^62
+instead of over the integers: an entry stays one word however far the elimination goes, where fraction free integer rows double in
+size every few steps and a random sparse system outgrows 64 bits after a few dozen unknowns. The same pivots are then run modulo a
+second prime, the two answers are joined with the chinese remainder theorem, and each value is read back as the fraction n / d it is
+congruent to (rational reconstruction), which works as long as |n| and d are under about 2^61. The answer is checked exactly
+against the equations as they were given before it's returned, so a value too big to read back, or a prime that happened to divide
+something the elimination relied on, comes out as OVERFLOW and never as a wrong solution.
+
+The order matters more than anything for fill. The matrix is first put into block triangular form (a matching of equations to
+unknowns, then the strongly connected parts of what depends on what), and the blocks are eliminated in dependency order, so a row
+only ever picks up entries from the one block being worked on. Inside a block, and for whatever the blocks don't cover, pivots are
+picked by the Markowitz count, the fewest other entries in the pivot's row and column.
+
+The values are 64 bit Rationals like everywhere else, and so are the coefficients given. IncrementalSystem (see below) keeps its rows
+mod the first two primes the same way, so however the equations are ordered the working never outgrows a word either.
+*/
+
+#ifndef SYSTEM_HPP
+#define SYSTEM_HPP
+
+#include <vector>
+#include <unordered_map>
+#include "linear.hpp"
+
+// (column, coefficient) sorted by column, no zeros
+using SparseEntries = std::vector<std::pair<int, i64>>;
+
+// an equation as given, with the denominators cleared: Entries . x = Rhs
+struct IntegerRow {
+    SparseEntries Entries;
+    i64 Rhs {0};
+};
+
+// a number mod the two primes IncrementalSystem works with
+struct Residues {
+    u64 P {0};
+    u64 Q {0};
+
+    bool isZero() const { return P == 0 && Q == 0; }
+};
+
+// (column, coefficient) sorted by column, coefficients 0 mod both primes left out
+using ResidueEntries = std::vector<std::pair<int, Residues>>;
+
+enum class SolveStatus {UNIQUE, UNDERDETERMINED, INCONSISTENT, OVERFLOW};
+
+struct SystemSolution {
+    SolveStatus Status {SolveStatus::UNIQUE};
+    std::vector<std::pair<int, Rational>> Values;   // (symbol, value), free symbols are set to 0 so it's one particular solution
+    std::vector<int> FreeSymbols;                   // symbols nothing pins down, only for UNDERDETERMINED
+    size_t Fill {0};                                // entries created by elimination
+};
+
+class SparseSystem {
+    public:
+        // false if clearing the denominators overflows
+        bool addEquation(const LinearForm& form);
+        // the rows are left as they are, so solving again gives the same answer
+        SystemSolution solve();
+
+        size_t equations() const { return Rows.size(); }
+        size_t unknowns() const { return Symbols.size(); }
+
+    private:
+        // a row mod the prime, entries in [1, prime)
+        struct ModRow {
+            std::vector<std::pair<int, u64>> Entries;
+            u64 Rhs {0};
+            bool Active {true};
+        };
+
+        // the whole system mod one prime while it's being eliminated
+        struct Reduction {
+            u64 Prime {0};
+            std::vector<ModRow> Rows;
+            std::vector<std::vector<size_t>> ColumnRows;    // rows that had an entry in the column at some point
+            std::vector<int> ColumnCount;                   // entries in the column over active rows
+            std::vector<std::pair<size_t, int>> Pivots;     // (row, column) in the order they were taken
+            size_t Fill {0};
+        };
+
+        int column(int symbol);
+        std::vector<std::vector<size_t>> blocks();
+        Reduction reduction(u64 prime) const;
+        bool choosePivot(Reduction& r, const std::vector<size_t>& rows, int block, size_t& pivot_row, int& pivot_col, SolveStatus& status) const;
+        bool pivotOn(Reduction& r, size_t pivot_row, int pivot_col) const;
+        SolveStatus reduce(Reduction& r, const std::vector<std::vector<size_t>>& order, size_t& inconsistent_row) const;
+        std::vector<u64> backSubstitute(const Reduction& r) const;
+
+        std::vector<IntegerRow> Rows;
+        std::vector<int> Symbols;                   // symbol of each column
+        std::unordered_map<int, int> ColumnOf;
+        std::vector<std::vector<size_t>> ColumnRows;    // rows with an entry in the column
+        std::vector<int> ColumnCount;                   // entries in the column
+        std::vector<int> BlockOf;                       // diagonal block each column was matched into, -1 if none
+};
+
+// The same rows kept solved as equations come in one at a time, for when the answer is wanted after every one of them.
+// Every pivot unknown appears in its own row and nowhere else, with coefficient 1, so each row reads pivot = rhs - the free unknowns
+// in it and a row with nothing but its pivot is a value. A new equation has the pivots in it substituted from their rows, takes one
+// of the free unknowns left in it as its own pivot (the one in the fewest rows) and that unknown is cleared out of the rows that have
+// it. Nothing else is looked at, so the work goes with the equation's nonzeros and the rows they touch, not the size of the system.
+// The rows are kept mod two primes, like SparseSystem's, so the order the equations come in doesn't change the size of the numbers.
+// The values are read back from the residues and checked against the equations as given when they're asked for
+class IncrementalSystem {
+    public:
+        // UNIQUE or UNDERDETERMINED for the system with the equation in. An equation that contradicts the earlier ones is turned
+        // away as INCONSISTENT, as is one whose coefficients don't fit 64 bits once the denominators are cleared, or (about once in
+        // 2^62) one a prime can't tell from 0, both OVERFLOW. Either way nothing changes
+        SolveStatus addEquation(const LinearForm& form);
+
+        // UNIQUE once every unknown seen so far has a value
+        SolveStatus status() const { return Pivots == Symbols.size() ? SolveStatus::UNIQUE : SolveStatus::UNDERDETERMINED; }
+
+        // (symbol, value) for the unknowns pinned down so far. False if a value, pinned or not, doesn't read back as a 64 bit
+        // Rational, out is empty then
+        bool values(std::vector<std::pair<int, Rational>>& out) const;
+        std::vector<int> freeSymbols() const;                     // the unknowns no equation has been solved for
+
+        size_t equations() const { return Accepted; }
+        size_t unknowns() const { return Symbols.size(); }
+
+    private:
+        struct Row {
+            ResidueEntries Entries;
+            Residues Rhs;
+            int Pivot;
+        };
+
+        int column(int symbol);
+        void forgetColumns(size_t count);
+
+        std::vector<Row> Rows;
+        std::vector<IntegerRow> Equations;              // the ones taken, as given, to check the values against
+        std::vector<int> Symbols;
+        std::unordered_map<int, int> ColumnOf;
+        std::vector<long> PivotRow;                     // row solved for the column, -1 while it's free
+        std::vector<std::vector<size_t>> ColumnRows;    // rows that had an entry in the column at some point
+        std::vector<int> ColumnCount;                   // rows with an entry in the column now
+        size_t Pivots {0};
+        size_t Accepted {0};
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+termstream.cpp
+*/
+
+#include "termstream.hpp"
+#include <algorithm>
+
+bool PolynomialStream::next(PolyTerm& term) {
+    if (Index >= Poly.Terms.size()) return false;
+    term = Poly.Terms[Index++];
+    return true;
+}
+
+// ---------------- sums ----------------
+
+SumStream::SumStream(std::vector<std::unique_ptr<TermStream>> streams) : Streams(std::move(streams)) {
+    Heap.reserve(Streams.size());
+    for (size_t i = 0; i < Streams.size(); i++) {
+        PolyTerm term;
+        if (Streams[i]->next(term)) Heap.push_back(Head{term, i});
+    }
+    std::make_heap(Heap.begin(), Heap.end());
+}
+
+bool SumStream::next(PolyTerm& term) {
+    while (!Heap.empty()) {
+        u64 exps = Heap.front().Term.Exps;
+        Rational c(0);
+
+        // every stream whose next term has this monomial, each one moves on by a term
+        while (!Heap.empty() && Heap.front().Term.Exps == exps) {
+            std::pop_heap(Heap.begin(), Heap.end());
+            Head head = Heap.back();
+            Heap.pop_back();
+
+            c += head.Term.Coeff;
+            if (Streams[head.Stream]->next(head.Term)) {
+                Heap.push_back(head);
+                std::push_heap(Heap.begin(), Heap.end());
+            }
+        }
+
+        if (!c.isZero()) {
+            term = PolyTerm{c, exps};
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------- products ----------------
+
+ProductStream::ProductStream(int nvars, const Rational& coeff, std::vector<PowerFactor> factors, int var)
+    : Shape(nvars), Coeff(coeff), Var(var) {
+
+    // single terms just scale and shift everything, only the real sums need multiplying out
+    std::vector<PowerFactor> sums;
+    for (auto& factor : factors) {
+        if (factor.Power == 0) continue;
+        if (factor.Base->isZero()) {
+            Coeff = Rational(0);
+            break;
+        }
+        if (factor.Base->size() == 1) {
+            Coeff *= powRational(factor.Base->Terms[0].Coeff, factor.Power);
+            Offset += factor.Base->Terms[0].Exps * static_cast<u64>(factor.Power);
+        } else {
+            sums.push_back(std::move(factor));
+        }
+    }
+
+    if (Coeff.isZero()) {
+        Done = true;
+        return;
+    }
+    if (sums.empty()) {
+        Constant = true;
+        return;
+    }
+
+    // the earlier variables are gone already, skip ahead to the first one some term still has. A sum has two different monomials
+    // so there always is one
+    auto uses = [&](int v) {
+        for (const auto& factor : sums) {
+            for (const auto& term : factor.Base->Terms) {
+                if (Shape.exponent(term.Exps, v) > 0) return true;
+            }
+        }
+        return false;
+    };
+    while (!uses(Var)) Var++;
+
+    // terms are in lex order and nothing before Var is left, so each degree of Var is one run of terms
+    for (const auto& factor : sums) {
+        Split split;
+        split.Power = factor.Power;
+
+        std::shared_ptr<Polynomial> part;
+        for (const auto& term : factor.Base->Terms) {
+            int e = Shape.exponent(term.Exps, Var);
+            if (split.Degrees.empty() || split.Degrees.back() != e) {
+                part = std::make_shared<Polynomial>(nvars);
+                split.Degrees.push_back(e);
+                split.Parts.push_back(part);
+            }
+            part->Terms.push_back(PolyTerm{term.Coeff, term.Exps - Shape.varPower(Var, e)});
+        }
+        Splits.push_back(std::move(split));
+    }
+
+    SuffixMin.assign(Splits.size() + 1, 0);
+    SuffixMax.assign(Splits.size() + 1, 0);
+    for (size_t i = Splits.size(); i-- > 0;) {
+        SuffixMin[i] = SuffixMin[i + 1] + Splits[i].Power * Splits[i].Degrees.back();
+        SuffixMax[i] = SuffixMax[i + 1] + Splits[i].Power * Splits[i].Degrees.front();
+    }
+
+    Degree = SuffixMax[0];
+    MinDegree = SuffixMin[0];
+    startDegree();
+}
+
+// Every way of getting Var^degree: from factor i, groups g onwards, with count copies of the base still to place. A factor using
+// c_g copies of each group contributes (Power choose c_0, c_1, ...) * product of Parts[g]^c_g, which is a product in the later
+// variables and gets its own stream
+void ProductStream::addCombinations(size_t i, size_t g, i64 count, i64 degree, const Rational& coeff, std::vector<PowerFactor>& chosen,
+                                    std::vector<std::unique_ptr<TermStream>>& streams) {
+    if (i == Splits.size()) {
+        if (degree == 0) streams.push_back(std::make_unique<ProductStream>(Shape.NumVars, coeff, chosen, Var + 1));
+        return;
+    }
+
+    const Split& split = Splits[i];
+    i64 next_power = (i + 1 < Splits.size()) ? Splits[i + 1].Power : 0;
+
+    if (count == 0) {
+        addCombinations(i + 1, 0, next_power, degree, coeff, chosen, streams);
+        return;
+    }
+
+    // can what's left still make degree
+    if (degree < count * split.Degrees.back() + SuffixMin[i + 1]) return;
+    if (degree > count * split.Degrees[g] + SuffixMax[i + 1]) return;
+
+    // the last group takes whatever copies are left
+    if (g + 1 == split.Degrees.size()) {
+        chosen.push_back(PowerFactor{split.Parts[g], count});
+        addCombinations(i + 1, 0, next_power, degree - count * split.Degrees[g], coeff, chosen, streams);
+        chosen.pop_back();
+        return;
+    }
+
+    Rational binomial(1);
+    for (i64 c = 0; c <= count; c++) {
+        if (c > 0) {
+            binomial = binomial * Rational(count - c + 1) / Rational(c);
+            chosen.push_back(PowerFactor{split.Parts[g], c});
+        }
+        addCombinations(i, g + 1, count - c, degree - c * split.Degrees[g], coeff * binomial, chosen, streams);
+        if (c > 0) chosen.pop_back();
+    }
+}
+
+// the next degree down that can actually be made, Current is left empty once they run out
+void ProductStream::startDegree() {
+    Current.reset();
+    for (; Degree >= MinDegree; Degree--) {
+        std::vector<std::unique_ptr<TermStream>> streams;
+        std::vector<PowerFactor> chosen;
+        addCombinations(0, 0, Splits[0].Power, Degree, Coeff, chosen, streams);
+
+        if (streams.size() == 1) {
+            Current = std::move(streams[0]);
+            return;
+        }
+        if (!streams.empty()) {
+            Current = std::make_unique<SumStream>(std::move(streams));
+            return;
+        }
+    }
+}
+
+bool ProductStream::next(PolyTerm& term) {
+    if (Done) return false;
+
+    if (Constant) {
+        term = PolyTerm{Coeff, Offset};
+        Done = true;
+        return true;
+    }
+
+    while (Current) {
+        if (Current->next(term)) {
+            term.Exps += Shape.varPower(Var, static_cast<u64>(Degree)) + Offset;
+            return true;
+        }
+        Degree--;
+        startDegree();
+    }
+
+    Done = true;
+    return false;
+}
+
+// ---------------- consumers ----------------
+
+size_t drain(TermStream& stream, TermConsumer& consumer) {
+    size_t count = 0;
+    PolyTerm term;
+    while (stream.next(term)) {
+        consumer.consume(term);
+        count++;
+    }
+    consumer.finish();
+    return count;
+}
+
+TermPrinter::TermPrinter(std::ostream& out, std::vector<std::string> variables)
+    : Out(out), Variables(std::move(variables)), Shape(static_cast<int>(Variables.size())) {}
+
+// same shapes as an annotated sum operand, (3 * x * (y ^ 2)) and (x ^ 2)
+std::string TermPrinter::termString(const PolyTerm& term) const {
+    std::vector<std::string> factors;
+    for (int var = 0; var < Shape.NumVars; var++) {
+        int e = Shape.exponent(term.Exps, var);
+        if (e == 1) factors.push_back(Variables[var]);
+        else if (e > 1) factors.push_back("(" + Variables[var] + " ^ " + std::to_string(e) + ")");
+    }
+
+    if (factors.empty()) return term.Coeff.String();
+
+    std::string body;
+    for (size_t i = 0; i < factors.size(); i++) {
+        if (i > 0) body += " * ";
+        body += factors[i];
+    }
+
+    if (!term.Coeff.isOne()) return "(" + term.Coeff.String() + " * " + body + ")";
+    return factors.size() == 1 ? body : "(" + body + ")";
+}
+
+void TermPrinter::consume(const PolyTerm& term) {
+    Count++;
+    if (Count == 1) {
+        First = termString(term);
+        return;
+    }
+    if (Count == 2) Out << "(" << First;
+    Out << " + " << termString(term);
+}
+
+void TermPrinter::finish() {
+    if (Count == 0) Out << "0";
+    else if (Count == 1) Out << First;
+    else Out << ")";
+}
+
+void TermAggregator::consume(const PolyTerm& term) {
+    Count++;
+    CoeffSum += term.Coeff;
+
+    int degree = 0;
+    for (int var = 0; var < Shape.NumVars; var++) degree += Shape.exponent(term.Exps, var);
+    MaxDegree = std::max(MaxDegree, degree);
+}
@@ -0,0 +1,159 @@
+/*
+termstream.hpp
+
+Lazy expansion. A TermStream hands out the terms of an expanded polynomial one at a time in decreasing lex order (the same order as
+Polynomial::Terms) without ever holding the whole result, so something like (a + b + c + d)^30 can be written out or folded term by term.
+
+Products of powers are multiplied out one variable at a time: the coefficient of x^k is a sum of smaller products in the remaining
+variables, each of which is streamed the same way, and k counts down. The live state is one stream per way of making up the current
+degree at each level, which depends on the input and not on how many terms come out.
+*/
+
+#ifndef TERMSTREAM_HPP
+#define TERMSTREAM_HPP
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+#include "polynomial.hpp"
+
+class TermStream {
+    public:
+        virtual ~TermStream() = default;
+
+        // false once there are no terms left. Monomials come out strictly decreasing and never with a zero coefficient
+        virtual bool next(PolyTerm& term) = 0;
+
+        // for (const PolyTerm& term : stream), single pass
+        class Iterator {
+            public:
+                Iterator() = default;
+                explicit Iterator(TermStream* stream) : Stream(stream) { ++*this; }
+
+                const PolyTerm& operator*() const { return Current; }
+                const PolyTerm* operator->() const { return &Current; }
+                Iterator& operator++() {
+                    if (!Stream->next(Current)) Stream = nullptr;
+                    return *this;
+                }
+                bool operator!=(const Iterator& other) const { return Stream != other.Stream; }
+
+            private:
+                TermStream* Stream {nullptr};
+                PolyTerm Current;
+        };
+
+        Iterator begin() { return Iterator(this); }
+        Iterator end() { return Iterator(); }
+};
+
+// the terms of a Polynomial that's already been built
+class PolynomialStream : public TermStream {
+    public:
+        explicit PolynomialStream(Polynomial p) : Poly(std::move(p)) {}
+        bool next(PolyTerm& term) override;
+
+    private:
+        Polynomial Poly;
+        size_t Index {0};
+};
+
+// merge of several streams, like terms are added up as they meet and dropped if they cancel
+class SumStream : public TermStream {
+    public:
+        explicit SumStream(std::vector<std::unique_ptr<TermStream>> streams);
+        bool next(PolyTerm& term) override;
+
+    private:
+        struct Head {
+            PolyTerm Term;
+            size_t Stream;
+            bool operator<(const Head& other) const { return Term.Exps < other.Term.Exps; }
+        };
+
+        std::vector<std::unique_ptr<TermStream>> Streams;
+        std::vector<Head> Heap;     // max heap on the monomial, one entry per stream that isn't finished
+};
+
+struct PowerFactor {
+    std::shared_ptr<const Polynomial> Base;
+    i64 Power;
+};
+
+// Coeff * product of Base^Power over the factors, never multiplied out in full
+class ProductStream : public TermStream {
+    public:
+        ProductStream(int nvars, const Rational& coeff, std::vector<PowerFactor> factors, int var = 0);
+        bool next(PolyTerm& term) override;
+
+    private:
+        // a factor grouped by its degree in Var, Parts[g] is the coefficient of Var^Degrees[g], degrees decreasing
+        struct Split {
+            std::vector<int> Degrees;
+            std::vector<std::shared_ptr<const Polynomial>> Parts;
+            i64 Power;
+        };
+
+        void startDegree();
+        void addCombinations(size_t i, size_t g, i64 count, i64 degree, const Rational& coeff, std::vector<PowerFactor>& chosen,
+                             std::vector<std::unique_ptr<TermStream>>& streams);
+
+        Polynomial Shape;           // only for the packing
+        Rational Coeff;
+        u64 Offset {0};             // product of the single term factors, folded out up front
+        bool Constant {false};      // nothing left to multiply out, the only term is Coeff * Offset
+        bool Done {false};
+
+        int Var {0};
+        std::vector<Split> Splits;
+        std::vector<i64> SuffixMin, SuffixMax;      // least and most degree in Var the factors from i on can make
+        i64 Degree {0};                             // the degree of Var being streamed
+        i64 MinDegree {0};
+        std::unique_ptr<TermStream> Current;        // coefficient of Var^Degree
+};
+
+
+// Somewhere for streamed terms to go
+class TermConsumer {
+    public:
+        virtual ~TermConsumer() = default;
+        virtual void consume(const PolyTerm& term) = 0;
+        virtual void finish() {}
+};
+
+// pulls every term out of the stream into the consumer, returns how many there were
+size_t drain(TermStream& stream, TermConsumer& consumer);
+
+// writes the sum the way the tree printer would, e.g. ((x ^ 2) + (2 * x * y) + 1), keeping only the current term in memory
+class TermPrinter : public TermConsumer {
+    public:
+        TermPrinter(std::ostream& out, std::vector<std::string> variables);
+        void consume(const PolyTerm& term) override;
+        void finish() override;
+
+    private:
+        std::string termString(const PolyTerm& term) const;
+
+        std::ostream& Out;
+        std::vector<std::string> Variables;
+        Polynomial Shape;
+        std::string First;          // held back until we know whether the sum needs brackets
+        size_t Count {0};
+};
+
+// running totals over the terms: how many, the highest total degree and the sum of the coefficients (the value at all ones)
+class TermAggregator : public TermConsumer {
+    public:
+        explicit TermAggregator(int nvars) : Shape(nvars) {}
+        void consume(const PolyTerm& term) override;
+
+        size_t Count {0};
+        int MaxDegree {0};
+        Rational CoeffSum {0};
+
+    private:
+        Polynomial Shape;
+};
+
+#endif
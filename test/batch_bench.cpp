@@ -0,0 +1,93 @@
+/*
+batch_bench.cpp
+
+One row at a time through Bytecode::evaluate against evaluateBatch with each kernel, on one thread and on all of them. The bytes
+moved (every variable column read, the result column written) are compared with a loop that only reads the same columns and writes
+one, which is about as fast as memory goes.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/batch_bench Mathly/test/batch_bench.cpp Mathly/batch.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "..\batch.hpp"
+#include "fixtures.hpp"
+
+
+template<typename F>
+double timeMs(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main() {
+    const size_t n = size_t(1) << 22;
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<double> value(-2.0, 2.0);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> thread_counts = {1};
+    if (cores > 1) thread_counts.push_back(cores);
+    std::cout << n << " rows, best kernel " << batchKernelName(batchKernel()) << ", " << cores << " threads\n";
+
+    for (std::string text : {"3x^2 - 2x*y + y/4 - 7", "x^8 - 3x^7 + 2x^6 + x^5 - 9x^4 + 4x^3 - x^2 + 5x - 1", "(x + y + z)^4 / (1 + x^2)"}) {
+        auto expr = simplified(text);
+        Bytecode code;
+        code.compile(expr.get());
+        size_t vars = code.symbols().size();
+
+        std::vector<std::vector<double>> columns(vars, std::vector<double>(n));
+        for (auto& column : columns) {
+            for (auto& v : column) v = value(rng);
+        }
+        std::vector<const double*> pointers;
+        for (const auto& column : columns) pointers.push_back(column.data());
+        std::vector<double> out(n), expected(n);
+        double bytes = static_cast<double>((vars + 1) * n * sizeof(double));
+
+        std::cout << "\n" << text << ": " << code.size() << " instructions, " << code.registers() << " registers\n";
+        auto report = [&](const std::string& name, double ms) {
+            std::cout << "    " << name << ": " << ms << " ms, " << n / ms / 1000 << " M rows/s, " << bytes / ms / 1e6 << " GB/s\n";
+        };
+
+        // the floor, read the columns and write one
+        report("read and write only", timeMs([&]() {
+            for (size_t i = 0; i < n; i++) {
+                double sum = 0;
+                for (size_t v = 0; v < vars; v++) sum += pointers[v][i];
+                out[i] = sum;
+            }
+        }));
+
+        std::vector<double> row(vars);
+        report("one row at a time", timeMs([&]() {
+            for (size_t i = 0; i < n; i++) {
+                for (size_t v = 0; v < vars; v++) row[v] = pointers[v][i];
+                expected[i] = code.evaluate(row.data());
+            }
+        }));
+
+        for (BatchKernel kernel : {BatchKernel::SCALAR, BatchKernel::AVX2, BatchKernel::AVX512}) {
+            if (static_cast<int>(kernel) > static_cast<int>(batchKernel())) continue;
+            for (unsigned threads : thread_counts) {
+                double ms = timeMs([&]() { evaluateBatch(code, pointers.data(), n, out.data(), threads, kernel); });
+
+                size_t wrong = 0;
+                for (size_t i = 0; i < n; i++) {
+                    if (std::abs(out[i] - expected[i]) > 1e-9 * std::max(1.0, std::abs(expected[i]))) wrong++;
+                }
+                report(std::string("batch ") + batchKernelName(kernel) + ", " + std::to_string(threads) + " thread" + (threads > 1 ? "s" : "")
+                       + (wrong ? ", " + std::to_string(wrong) + " wrong" : ""), ms);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+batch_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/batch_test Mathly/test/batch_test.cpp Mathly/batch.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\batch.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// every kernel and the threaded split against evaluating one row at a time, n isn't a whole number of blocks so the short block
+// at the end gets checked too
+bool matchesOneAtATime(const std::string& text, size_t n, unsigned threads) {
+    auto expr = simplified(text);
+    Bytecode code;
+    if (!code.compile(expr.get())) return false;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> value(0.5, 2.0);
+    size_t vars = code.symbols().size();
+    std::vector<std::vector<double>> columns(vars, std::vector<double>(n));
+    for (auto& column : columns) {
+        for (auto& v : column) v = value(rng);
+    }
+    std::vector<const double*> pointers;
+    for (const auto& column : columns) pointers.push_back(column.data());
+
+    std::vector<double> expected(n), row(vars);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t v = 0; v < vars; v++) row[v] = columns[v][i];
+        expected[i] = code.evaluate(row.data());
+    }
+
+    for (BatchKernel kernel : {BatchKernel::SCALAR, BatchKernel::AVX2, BatchKernel::AVX512}) {
+        std::vector<double> out(n, -1.0);
+        evaluateBatch(code, pointers.data(), n, out.data(), threads, kernel);
+        for (size_t i = 0; i < n; i++) {
+            if (std::abs(out[i] - expected[i]) > 1e-9 * std::max(1.0, std::abs(expected[i]))) return false;
+        }
+    }
+    return true;
+}
+
+DEFINE_TEST(TestBatchMatchesBytecode) {
+    TEST(matchesOneAtATime("3x^2 - 2x*y + y/4 - 7", 1003, 1));
+    TEST(matchesOneAtATime("(x + 1)^5 * y^-3 - x^(1/2)", 517, 1));
+    TEST(matchesOneAtATime("x", 9, 1));
+    TEST(matchesOneAtATime("2/3", 5, 1));
+}
+
+DEFINE_TEST(TestBatchThreads) {
+    // big enough to be split even when the machine has one core
+    TEST(matchesOneAtATime("x^3 + x*y*z - 4z + 1", 200003, 4));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+bytecode_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/bytecode_test Mathly/test/bytecode_test.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <string>
+
+#include "..\bytecode.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// the values given by name, in whatever order the compiled code wants them
+std::vector<double> bind(const Bytecode& code, const std::vector<std::pair<std::string, double>>& values) {
+    std::vector<double> bound(code.symbols().size());
+    for (const auto& [name, v] : values) {
+        int slot = code.slot(internSymbol(name));
+        if (slot >= 0) bound[slot] = v;
+    }
+    return bound;
+}
+
+DEFINE_TEST(TestBytecodeDoubles) {
+    Bytecode code;
+    auto expr = simplified("3x^2 - 2x*y + y/4 - 7");
+    TEST(code.compile(expr.get()));
+    TEST_EQ(code.symbols().size(), 2U);
+
+    std::vector<double> v = bind(code, {{"x", 1.5}, {"y", -2.0}});
+    TEST(std::abs(code.evaluate(v.data()) - (3 * 2.25 + 6.0 - 0.5 - 7)) < 1e-12);
+
+    v = bind(code, {{"x", 0.0}, {"y", 8.0}});
+    TEST(std::abs(code.evaluate(v.data()) - (2.0 - 7)) < 1e-12);
+
+    // negative and fractional exponents
+    auto root = simplified("x^(1/2) + x^-2");
+    TEST(code.compile(root.get()));
+    double four = 4.0;
+    TEST(std::abs(code.evaluate(&four) - 2.0625) < 1e-12);
+
+    // nothing to evaluate, the constant is the result
+    auto number = simplified("2/3");
+    TEST(code.compile(number.get()));
+    TEST_EQ(code.size(), 0U);
+    TEST(std::abs(code.evaluate(nullptr) - 2.0 / 3.0) < 1e-12);
+}
+
+DEFINE_TEST(TestBytecodeExact) {
+    Bytecode code;
+    auto expr = simplified("x^3/3 - x/2 + 1/6");
+    TEST(code.compile(expr.get()));
+
+    Rational x(2, 3), result;
+    TEST(code.evaluate(&x, result));
+    TEST(result == Rational(8, 81) - Rational(1, 3) + Rational(1, 6));
+
+    // no exact value for a root, or for dividing by zero
+    auto root = simplified("x^(1/2)");
+    TEST(code.compile(root.get()));
+    x = Rational(4);
+    TEST(!code.evaluate(&x, result));
+
+    auto inverse = simplified("1/x");
+    TEST(code.compile(inverse.get()));
+    x = Rational(0);
+    TEST(!code.evaluate(&x, result));
+
+    // too big for 64 bits is turned down rather than wrapped
+    auto big = simplified("x^5");
+    TEST(code.compile(big.get()));
+    x = Rational(INT64_C(1) << 20);
+    TEST(!code.evaluate(&x, result));
+}
+
+DEFINE_TEST(TestBytecodeRegisters) {
+    Bytecode code;
+
+    // temporaries are reused, a long sum needs only a couple however many terms it has
+    auto sum = simplified("a*b + c*d + e*f + g*h + i*j + k*l");
+    TEST(code.compile(sum.get()));
+    TEST_EQ(code.symbols().size(), 12U);
+    TEST(code.registers() <= 12U + 2U);
+
+    // Undefined has no value
+    auto undefined = simplified("x/0");
+    TEST(!code.compile(undefined.get()));
+}
+
+DEFINE_TEST(TestBytecodeOptimize) {
+    Bytecode plain, optimized;
+
+    // Horner form, x(x(3x + 2) + 1) + 5
+    auto cubic = simplified("3x^3 + 2x^2 + x + 5");
+    TEST(plain.compile(cubic.get(), false));
+    TEST(optimized.compile(cubic.get()));
+    TEST_EQ(plain.operations(), 8U);
+    TEST_EQ(optimized.operations(), 6U);
+
+    Rational x(-7, 3), a, b;
+    TEST(plain.evaluate(&x, a) && optimized.evaluate(&x, b));
+    TEST(a == b);
+
+    // x y is pulled out of every term but the constant, and x^2 y is taken apart rather than computed as a power
+    auto both = simplified("x^2*y + x*y^2 + x*y + 3");
+    TEST(plain.compile(both.get(), false));
+    TEST(optimized.compile(both.get()));
+    TEST(optimized.operations() < plain.operations());
+
+    // a b is computed once, whether it's on its own or inside the sum
+    auto shared = simplified("(a*b)/(a*b + 1)");
+    TEST(optimized.compile(shared.get()));
+    TEST_EQ(optimized.operations(), 3U);
+    std::vector<double> v = bind(optimized, {{"a", 2.0}, {"b", 3.0}});
+    TEST(std::abs(optimized.evaluate(v.data()) - 6.0 / 7.0) < 1e-12);
+}
+
+DEFINE_TEST(TestBytecodeDoubleDomain) {
+    // decimals are exact unless asked otherwise
+    TEST_EQ(simplified("0.25x + 0.5x")->String(), "((3 / 4) * x)");
+    TEST_EQ(simplified("0.25x + 0.5x", NumericDomain::DOUBLE)->String(), "(0.75 * x)");
+
+    // like terms with a double in front of one of them, and a double that comes out whole goes back to being a coefficient
+    TEST_EQ(simplified("x + 0.5x + y", NumericDomain::DOUBLE)->String(), "((1.5 * x) + y)");
+    TEST_EQ(simplified("0.5x*y + 1.5y*x - 2", NumericDomain::DOUBLE)->String(), "(-2 + (2 * x * y))");
+    TEST_EQ(simplified("0.5x - x*0.5", NumericDomain::DOUBLE)->String(), "0");
+
+    // fractions and roots of numbers are folded, a double in front of a sum stays a factor like any other number
+    TEST_EQ(simplified("1/3 + 1/3", NumericDomain::DOUBLE)->String(), "0.66666666666666663");
+    TEST_EQ(simplified("2^(1/2) * 2^(1/2)", NumericDomain::DOUBLE)->String(), "2.0000000000000004");
+    TEST_EQ(simplified("0.5(x + 3)", NumericDomain::DOUBLE)->String(), "(0.5 * (3 + x))");
+
+    // doubles are constants for the bytecode, with no exact value
+    Bytecode code;
+    auto expr = simplified("0.1x^2 + x/3", NumericDomain::DOUBLE);
+    TEST(code.compile(expr.get()));
+    double x = 3.0;
+    TEST(std::abs(code.evaluate(&x) - (0.1 * 9.0 + 1.0)) < 1e-12);
+    Rational exact(3), result;
+    TEST(!code.evaluate(&exact, result));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/*
+cse_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/cse_test Mathly/test/cse_test.cpp Mathly/cse.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <string>
+
+#include "..\cse.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// the bindings put back in, last first so t12 is gone before t1 is looked for. Should give the tree's own String()
+std::string unshared(const SharedForm& form) {
+    std::string s = form.result();
+    for (size_t i = form.bindings().size(); i-- > 0;) {
+        const Binding& b = form.bindings()[i];
+        for (size_t at = s.find(b.Name); at != std::string::npos; at = s.find(b.Name, at + b.Text.size())) {
+            s.replace(at, b.Name.size(), b.Text);
+        }
+    }
+    return s;
+}
+
+DEFINE_TEST(TestSharedFormBindings) {
+    // nothing repeated, nothing named
+    auto plain = simplified("3x + y^2");
+    TEST(SharedForm(plain.get()).bindings().empty());
+    TEST_EQ(sharedString(plain.get()), plain->String());
+
+    auto square = parsed("(x + y) * (x + y) - (x + y)");
+    TEST_EQ(sharedString(square.get()), "let t1 = (x + y)\n((t1 * t1) - t1)");
+
+    // a binding uses the ones before it
+    auto nested = parsed("(a*b + 1)/(a*b) + -(a*b + 1)");
+    SharedForm form(nested.get());
+    TEST_EQ(form.bindings().size(), 2);
+    TEST_EQ(form.bindings()[0].Text, "(a * b)");
+    TEST_EQ(form.bindings()[1].Text, "(t1 + 1)");
+    TEST_EQ(form.bindings()[1].Uses, 2);
+    TEST_EQ(form.result(), "((t2 / t1) + (-t2))");
+
+    // annotated sums and products, a named product is a single factor of its term rather than spliced into it
+    auto annotated = simplified("(1 + a*b)/(a*b) - a*b - 1");
+    TEST_EQ(sharedString(annotated.get()), "let t1 = (a * b)\n(-1 + (-1 * t1) + ((1 + t1) / t1))");
+
+    // single numbers and variables are never worth a name
+    auto leaves = parsed("x*x + x");
+    TEST(SharedForm(leaves.get()).bindings().empty());
+}
+
+DEFINE_TEST(TestSharedFormSize) {
+    // every level has two copies of the one below, so the tree doubles each time while the bindings only grow by one
+    std::string text = "x + y";
+    for (int level = 0; level < 12; level++) text = "((" + text + ") + x) * ((" + text + ") - y)";
+    auto expr = parsed(text);
+
+    SharedForm form(expr.get());
+    std::string flat = expr->String();
+    TEST(form.String().size() * 100 < flat.size());
+    TEST_EQ(unshared(form), flat);
+
+    auto expanded = simplified("(x + 1)^3 * (x + 1)^3 / ((x + 1)^3 + y)");
+    TEST_EQ(unshared(SharedForm(expanded.get())), expanded->String());
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
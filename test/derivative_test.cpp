@@ -0,0 +1,134 @@
+/*
+derivative_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/derivative_test Mathly/test/derivative_test.cpp Mathly/derivative.cpp Mathly/gradient.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\derivative.hpp"
+#include "..\gradient.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// d/var of text printed, to compare against another expression simplified
+std::string derivative(const std::string& text, const std::string& var) {
+    auto expr = simplified(text);
+    return differentiate(expr.get(), var)->String();
+}
+
+// The derivative compiled and evaluated against the tape's gradient (see gradient.hpp) at random points, for every variable.
+// Values in [0.5, 2] keep clear of dividing by 0 and of negative bases under fractional powers
+bool matchesGradient(const std::string& text) {
+    auto expr = simplified(text);
+    GradientTape tape;
+    if (!tape.compile(expr.get())) return false;
+    size_t vars = tape.symbols().size();
+
+    std::vector<std::unique_ptr<ExpressionNode>> derivatives;
+    std::vector<Bytecode> codes(vars);
+    for (size_t s = 0; s < vars; s++) {
+        derivatives.push_back(differentiate(expr.get(), tape.symbols()[s]));
+        if (!codes[s].compile(derivatives[s].get())) return false;
+    }
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> value(0.5, 2.0);
+    std::vector<double> point(vars), grad(vars), by_slot;
+    for (int trial = 0; trial < 50; trial++) {
+        for (auto& p : point) p = value(rng);
+        tape.gradient(point.data(), grad.data());
+
+        for (size_t s = 0; s < vars; s++) {
+            // the derivative may have lost variables, or be a constant with none
+            by_slot.assign(codes[s].symbols().size(), 0.0);
+            for (size_t k = 0; k < by_slot.size(); k++) by_slot[k] = point[tape.slot(codes[s].symbols()[k])];
+            double d = codes[s].evaluate(by_slot.data());
+            if (std::abs(d - grad[s]) > 1e-9 * std::max(1.0, std::abs(grad[s]))) return false;
+        }
+    }
+    return true;
+}
+
+DEFINE_TEST(TestDerivativeRules) {
+    TEST_EQ(derivative("3x^2 + 2x + 1", "x"), simplified("6x + 2")->String());
+    TEST_EQ(derivative("x*y + y", "x"), "y");
+    TEST_EQ(derivative("x*y + y", "y"), simplified("1 + x")->String());
+    TEST_EQ(derivative("x^-2", "x"), simplified("-2x^-3")->String());
+    TEST_EQ(derivative("(x*y + 1)^3", "x"), simplified("3y(x*y + 1)^2")->String());
+    TEST_EQ(derivative("(x^2 + 1)^(1/2)", "x"), simplified("x(x^2 + 1)^(-1/2)")->String());
+    TEST_EQ(derivative("x^3*y^2*(x + y)^2", "x"), simplified("3x^2*y^2*(x + y)^2 + 2x^3*y^2*(x + y)")->String());
+    TEST_EQ(derivative("2^(1/2)*x", "x"), "(2 ^ (1 / 2))");
+
+    // a symbolic exponent is a constant as long as the variable isn't in it
+    TEST_EQ(derivative("x^y", "x"), simplified("y*x^(y - 1)")->String());
+    TEST_EQ(derivative("y^x", "x"), "Undefined");
+
+    // quotients come back as negative powers
+    TEST_EQ(derivative("y/x", "x"), simplified("-y*x^-2")->String());
+    TEST_EQ(derivative("x/y", "x"), simplified("y^-1")->String());
+
+    TEST_EQ(derivative("y^2 + 3", "x"), "0");
+    TEST_EQ(derivative("x", "x"), "1");
+    TEST_EQ(derivative("x/0", "x"), "Undefined");
+}
+
+DEFINE_TEST(TestDerivativeValues) {
+    TEST(matchesGradient("3x^3 + 2x^2 + x + 5"));
+    TEST(matchesGradient("x*y*z - x^2*y + z/y - 7"));
+    TEST(matchesGradient("(x + y)^3 - x^5 * y^-2"));
+    TEST(matchesGradient("(x + y)/(x^2 + 1) - 1/3"));
+    TEST(matchesGradient("x^(1/2) + (x*y + 1)^(3/2) - z^(-1/3)"));
+    TEST(matchesGradient("(x^2 + y)/(x - y^3)"));
+    TEST(matchesGradient("-(a - b)*(a + b)*(c - a)^2 + a*b*c*d"));
+}
+
+DEFINE_TEST(TestDerivativeShared) {
+    // every level has two copies of the one below, so the tree doubles each time. Differentiated copy by copy that'd be 2^levels
+    // derivatives of the innermost part, memoised it's a handful per level
+    const int levels = 10;
+    std::string text = "x + y";
+    for (int level = 0; level < levels; level++) text = "((" + text + ") + x) * ((" + text + ") - y)";
+    auto expr = simplified(text);
+
+    Differentiator dx(internSymbol("x"));
+    auto d = dx.derivative(expr.get());
+    TEST(dx.computed() <= 4 * levels);
+    TEST(d->getSynopsis().Size < 20 * expr->getSynopsis().Size);
+
+    // asking again for the same variable is all memo
+    size_t computed = dx.computed();
+    auto again = dx.derivative(expr.get());
+    TEST_EQ(dx.computed(), computed);
+    TEST(sameTree(d.get(), again.get()));
+
+    // and the value is right, kept small so the levels don't overflow
+    GradientTape tape;
+    TEST(tape.compile(expr.get()));
+    Bytecode code;
+    TEST(code.compile(d.get()));
+    std::vector<double> point(2), grad(2);
+    point[tape.slot(internSymbol("x"))] = 0.3;
+    point[tape.slot(internSymbol("y"))] = 0.2;
+    tape.gradient(point.data(), grad.data());
+    std::vector<double> by_slot(code.symbols().size());
+    for (size_t k = 0; k < by_slot.size(); k++) by_slot[k] = point[tape.slot(code.symbols()[k])];
+    double value = code.evaluate(by_slot.data());
+    double expected = grad[tape.slot(internSymbol("x"))];
+    TEST(std::abs(value - expected) <= 1e-9 * std::max(1.0, std::abs(expected)));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
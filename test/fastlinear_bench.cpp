@@ -0,0 +1,147 @@
+/*
+fastlinear_bench.cpp
+
+The full path (Lexer, Parser, SimplifyVisitor, expand_tree, linear_equation, solve_linear) against fastlinear on the same random
+single variable linear equations, checking they give the same answer every time. Then one equation shape with many different
+numbers, through the full path, the fast path and a PreparedLinear.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/fastlinear_bench Mathly/test/fastlinear_bench.cpp Mathly/fastlinear.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\parser.hpp"
+#include "..\simplifier.hpp"
+#include "..\fastlinear.hpp"
+
+
+// the steps main goes through, "" if they don't end in a solution
+std::string fullSolve(std::string left, std::string right) {
+    left.append("$");
+    right.append("$");
+
+    Lexer lexer(left);
+    Parser parser(lexer);
+    auto parsed = parser.parseLoop();
+    Lexer lexer2(right);
+    Parser parser2(lexer2);
+    auto parsed2 = parser2.parseLoop();
+    if (!parsed || !parsed2 || !parser.errors.empty() || !parser2.errors.empty()) return "";
+
+    SimplifyVisitor visitor;
+    parsed->accept(visitor);
+    auto simplified = visitor.getResult();
+    SimplifyVisitor visitor2;
+    parsed2->accept(visitor2);
+    auto simplified2 = visitor2.getResult();
+
+    simplified = visitor.expand_tree(simplified);
+    simplified2 = visitor2.expand_tree(simplified2);
+
+    LinearForm equation;
+    if (!visitor.linear_equation(simplified, simplified2, equation)) return "";
+    if (!visitor.solve_linear(equation, simplified, simplified2)) return "";
+    return simplified->String() + " = " + simplified2->String();
+}
+
+std::string fastSolve(const std::string& left, const std::string& right) {
+    LinearForm form;
+    Rational value;
+    if (!fastLinearEquation(left, right, form) || !fastLinearSolve(form, value)) return "";
+    return symbolName(form.Coeffs[0].first) + " = " + value.String();
+}
+
+// the everyday shapes, numbers 1 to 12
+std::vector<std::pair<std::string, std::string>> randomEquations(size_t count, std::mt19937& rng) {
+    std::uniform_int_distribution<int> number(1, 12);
+    std::uniform_int_distribution<int> shape(0, 4);
+    auto n = [&]() { return std::to_string(number(rng)); };
+
+    std::vector<std::pair<std::string, std::string>> equations;
+    for (size_t i = 0; i < count; i++) {
+        switch (shape(rng)) {
+            case 0: equations.emplace_back(n() + "(x+" + n() + ") - " + n(), n() + "x/" + n()); break;
+            case 1: equations.emplace_back(n() + "x + " + n(), n()); break;
+            case 2: equations.emplace_back(n() + " - " + n() + "x", n() + "(x - " + n() + ")"); break;
+            case 3: equations.emplace_back("(x + " + n() + ")/" + n(), n() + " - x/" + n()); break;
+            default: equations.emplace_back(n() + "(" + n() + "x - " + n() + ") + " + n(), n() + "x"); break;
+        }
+    }
+    return equations;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    auto equations = randomEquations(20000, rng);
+
+    std::vector<std::string> full;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& [left, right] : equations) full.push_back(fullSolve(left, right));
+    double full_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::string> fast;
+    start = std::chrono::steady_clock::now();
+    for (const auto& [left, right] : equations) fast.push_back(fastSolve(left, right));
+    double fast_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    size_t different = 0;
+    size_t declined = 0;
+    for (size_t i = 0; i < equations.size(); i++) {
+        if (fast[i].empty()) declined++;
+        else if (fast[i] != full[i]) different++;
+    }
+
+    std::cout << equations.size() << " equations\n";
+    std::cout << "full path: " << full_ms << " ms, " << equations.size() / full_ms * 1000 << " per second\n";
+    std::cout << "fast path: " << fast_ms << " ms, " << equations.size() / fast_ms * 1000 << " per second\n";
+    std::cout << "speedup " << full_ms / fast_ms << "x, " << declined << " left to the full path, " << different << " different\n";
+
+    // A(x+B) - C = Dx/E for many A..E
+    const size_t BINDINGS = 100000;
+    std::uniform_int_distribution<i64> number(1, 12);
+    std::vector<i64> params(BINDINGS * 5);
+    for (auto& p : params) p = number(rng);
+
+    std::vector<std::pair<std::string, std::string>> texts;
+    for (size_t i = 0; i < BINDINGS; i++) {
+        const i64* p = &params[i * 5];
+        texts.emplace_back(std::to_string(p[0]) + "(x+" + std::to_string(p[1]) + ") - " + std::to_string(p[2]),
+                           std::to_string(p[3]) + "x/" + std::to_string(p[4]));
+    }
+
+    full.clear();
+    start = std::chrono::steady_clock::now();
+    for (const auto& [left, right] : texts) full.push_back(fullSolve(left, right));
+    full_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    fast.clear();
+    start = std::chrono::steady_clock::now();
+    for (const auto& [left, right] : texts) fast.push_back(fastSolve(left, right));
+    fast_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<Rational> values(BINDINGS);
+    std::vector<bool> solved(BINDINGS);
+    start = std::chrono::steady_clock::now();
+    PreparedLinear prepared;
+    prepared.prepare("1(x+2) - 3", "4x/5");
+    for (size_t i = 0; i < BINDINGS; i++) solved[i] = prepared.solve(&params[i * 5], values[i]);
+    double prepared_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    different = 0;
+    declined = 0;
+    for (size_t i = 0; i < BINDINGS; i++) {
+        if (!solved[i]) declined++;
+        else if ("x = " + values[i].String() != full[i]) different++;
+    }
+
+    std::cout << "\n" << BINDINGS << " bindings of A(x+B) - C = Dx/E\n";
+    std::cout << "full path: " << full_ms << " ms\n";
+    std::cout << "fast path: " << fast_ms << " ms (text built up front)\n";
+    std::cout << "prepared:  " << prepared_ms << " ms, " << full_ms / prepared_ms << "x the full path, " << fast_ms / prepared_ms
+              << "x the fast path, " << declined << " left to the full path, " << different << " different\n";
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+fastlinear_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/fastlinear_test Mathly/test/fastlinear_test.cpp Mathly/fastlinear.cpp Mathly/linear.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp simpletest/simpletest.cpp
+
+#include <string>
+
+#include "..\fastlinear.hpp"
+#include "..\ast.hpp"
+#include "..\parser.hpp"
+#include "..\simplifier.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+// the solution as "x = value", or "" when the fast path turns it down
+std::string fastSolve(const std::string& left, const std::string& right) {
+    LinearForm form;
+    Rational value;
+    if (!fastLinearEquation(left, right, form) || !fastLinearSolve(form, value)) return "";
+    return symbolName(form.Coeffs[0].first) + " = " + value.String();
+}
+
+// the line the full path in main ends on: parsed, simplified, expanded and solved as a linear equation. "" if it isn't one
+std::string fullSolve(std::string left, std::string right) {
+    left.append("$");
+    right.append("$");
+    Lexer lexer(left);
+    Parser parser(lexer);
+    auto parsed = parser.parseLoop();
+    Lexer lexer2(right);
+    Parser parser2(lexer2);
+    auto parsed2 = parser2.parseLoop();
+
+    SimplifyVisitor visitor;
+    parsed->accept(visitor);
+    auto simplified = visitor.getResult();
+    simplified = visitor.expand_tree(simplified);
+    SimplifyVisitor visitor2;
+    parsed2->accept(visitor2);
+    auto simplified2 = visitor2.getResult();
+    simplified2 = visitor2.expand_tree(simplified2);
+
+    LinearForm equation;
+    if (!visitor.linear_equation(simplified, simplified2, equation) || !visitor.solve_linear(equation, simplified, simplified2)) return "";
+    return simplified->String() + " = " + simplified2->String();
+}
+
+DEFINE_TEST(TestFastLinearSolve) {
+    TEST_EQ(fastSolve("2x + 3", "7"), std::string("x = 2"));
+    TEST_EQ(fastSolve("3(x+2) - 4", "2x/5"), std::string("x = (-10 / 13)"));
+    TEST_EQ(fastSolve("4x", "-7$"), std::string("x = (-7 / 4)"));
+    TEST_EQ(fastSolve("-(y - 1)", "2^3 - y/2^-1"), std::string("y = 7"));
+
+    // implicit multiplication binds tighter than /, 2x/5 is (2x)/5 and 8/2y is 8/(2y) which isn't linear
+    TEST_EQ(fastSolve("x/2x", "1"), std::string(""));
+    TEST_EQ(fastSolve("10/5x + x", "6"), std::string(""));
+    TEST_EQ(fastSolve("10/5*x + x", "6"), std::string("x = 2"));
+
+    // -2^2 is -(2^2)
+    TEST_EQ(fastSolve("x", "-2^2"), std::string("x = -4"));
+}
+
+DEFINE_TEST(TestFastLinearMatchesFullPath) {
+    // main prints only the answer when the fast path takes an equation, none of the parsed, simplified and expanded lines the full
+    // path shows on the way. The answer is the same line the full path ends on
+    const std::pair<const char*, const char*> equations[] = {
+        {"2x + 3", "7"}, {"3(x+2) - 4", "2x/5"}, {"4x", "-7"}, {"-(y - 1)", "2^3 - y/2^-1"}, {"10/5*x + x", "6"}, {"x", "-2^2"},
+        {"x/3 + x/4", "1/12"}, {"-(2 - 3x)/7", "x + 1"}, {"2(3(z - 1) + 4)", "-z"}, {"1000000007x", "3"},
+    };
+    for (const auto& [left, right] : equations) {
+        TEST(!fastSolve(left, right).empty());
+        TEST_EQ(fastSolve(left, right), fullSolve(left, right));
+    }
+}
+
+DEFINE_TEST(TestFastLinearTurnsDown) {
+    TEST_EQ(fastSolve("x * x", "4"), std::string(""));          // not linear
+    TEST_EQ(fastSolve("x + y", "4"), std::string(""));          // two variables
+    TEST_EQ(fastSolve("2", "4"), std::string(""));              // no variable
+    TEST_EQ(fastSolve("x - x", "4"), std::string(""));          // nothing to solve for
+    TEST_EQ(fastSolve("x^2", "4"), std::string(""));
+    TEST_EQ(fastSolve("(x + 1)(x - 1)", "4"), std::string(""));  // the parser stops at the second bracket
+    TEST_EQ(fastSolve("x / 0", "4"), std::string(""));
+    TEST_EQ(fastSolve("x + 99999999999999999999", "4"), std::string(""));
+}
+
+DEFINE_TEST(TestPreparedLinear) {
+    PreparedLinear prepared;
+    TEST(prepared.prepare("3(x+2) - 4", "2x/5"));
+    TEST_EQ(prepared.parameters(), 5U);
+    TEST_EQ(symbolName(prepared.symbol()), std::string("x"));
+
+    // the numbers as written give the same as the fast path
+    Rational value;
+    TEST(prepared.solve(prepared.literals().data(), value));
+    TEST_EQ(value.String(), std::string("(-10 / 13)"));
+
+    // 1(x+1) - 1 = 3x/1  ->  x = 0, then 2(x+3) - 4 = 4x/2 has no x left
+    i64 zero[] = {1, 1, 1, 3, 1};
+    TEST(prepared.solve(zero, value));
+    TEST(value.isZero());
+    i64 degenerate[] = {2, 3, 4, 4, 2};
+    TEST(!prepared.solve(degenerate, value));
+
+    // dividing by zero only fails that one solve
+    i64 by_zero[] = {3, 2, 4, 2, 0};
+    TEST(!prepared.solve(by_zero, value));
+    TEST(prepared.solve(prepared.literals().data(), value));
+
+    // an exponent is a parameter too
+    TEST(prepared.prepare("x", "2^3 + 1"));
+    i64 powers[] = {3, 2, 1};
+    TEST(prepared.solve(powers, value));
+    TEST(value == Rational(10));
+
+    // no numbers make x * x or dividing by x linear
+    TEST(!prepared.prepare("x * 2x", "1"));
+    TEST(!prepared.prepare("3 / x", "1"));
+    TEST(!prepared.prepare("2^x", "8"));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+/*
+fixtures.hpp
+
+Helpers the tests and benches share for turning text into a tree. The text gets the "$" the parser stops at appended here, so
+callers pass the bare expression.
+*/
+
+#ifndef FIXTURES_HPP
+#define FIXTURES_HPP
+
+#include <memory>
+#include <string>
+
+#include "..\parser.hpp"
+#include "..\simplifier.hpp"
+
+// the tree as parsed, nothing done to it
+inline std::unique_ptr<ExpressionNode> parsed(std::string text) {
+    text.append("$");
+    Lexer lexer(text);
+    Parser parser(lexer);
+    return parser.parseLoop();
+}
+
+inline std::unique_ptr<ExpressionNode> simplified(std::string text, NumericDomain domain = NumericDomain::EXACT) {
+    auto expr = parsed(std::move(text));
+    SimplifyVisitor visitor(domain);
+    expr->accept(visitor);
+    return visitor.getResult();
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*
+gradient_bench.cpp
+
+The Rosenbrock function in more and more variables, sum of 100 (v[i+1] - v[i]^2)^2 + (1 - v[i])^2, compiled optimised and its
+gradient taken three ways: the tape's one reverse sweep, central differences (two evaluations per variable) and, for the cost of
+one evaluation to compare against, the bytecode on its own. Also checks the tape against the gradient worked out by hand.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/gradient_bench Mathly/test/gradient_bench.cpp Mathly/gradient.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\gradient.hpp"
+#include "fixtures.hpp"
+
+
+// variables are letters only, so aa, ab, ...
+std::string variable(int i) {
+    return std::string{static_cast<char>('a' + i / 26), static_cast<char>('a' + i % 26)};
+}
+
+std::string rosenbrock(int n) {
+    std::string text;
+    for (int i = 0; i + 1 < n; i++) {
+        if (i > 0) text += " + ";
+        text += "100(" + variable(i + 1) + " - " + variable(i) + "^2)^2 + (1 - " + variable(i) + ")^2";
+    }
+    return text;
+}
+
+template<typename F>
+double nsPerCall(size_t calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    const size_t work = 20000000;       // variables times calls, so every size takes about as long
+
+    for (int n : {2, 8, 32, 128, 512}) {
+        auto expr = simplified(rosenbrock(n));
+        Bytecode code;
+        GradientTape tape;
+        code.compile(expr.get());
+        tape.compile(expr.get());
+        size_t calls = work / n;
+
+        std::vector<double> point(n), grad(n), differences(n);
+        for (auto& p : point) p = value(rng);
+
+        double f = 0;
+        double eval_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) f = code.evaluate(point.data());
+        });
+        double tape_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) f = tape.gradient(point.data(), grad.data());
+        });
+
+        size_t difference_calls = std::max<size_t>(calls / n, 10);
+        double difference_ns = nsPerCall(difference_calls, [&]() {
+            for (size_t k = 0; k < difference_calls; k++) {
+                for (int s = 0; s < n; s++) {
+                    const double h = 1e-6;
+                    double x = point[s];
+                    point[s] = x + h;
+                    double up = code.evaluate(point.data());
+                    point[s] = x - h;
+                    double down = code.evaluate(point.data());
+                    point[s] = x;
+                    differences[s] = (up - down) / (2 * h);
+                }
+            }
+        });
+
+        // by hand, d/dv[i] = -400 v[i] (v[i+1] - v[i]^2) - 2 (1 - v[i]) + 200 (v[i] - v[i-1]^2)
+        std::vector<double> v(n);
+        for (int i = 0; i < n; i++) v[i] = point[tape.slot(internSymbol(variable(i)))];
+        double worst = 0, worst_difference = 0;
+        for (int i = 0; i < n; i++) {
+            double d = 0;
+            if (i + 1 < n) d += -400 * v[i] * (v[i + 1] - v[i] * v[i]) - 2 * (1 - v[i]);
+            if (i > 0) d += 200 * (v[i] - v[i - 1] * v[i - 1]);
+            int s = tape.slot(internSymbol(variable(i)));
+            worst = std::max(worst, std::abs(grad[s] - d) / std::max(1.0, std::abs(d)));
+            worst_difference = std::max(worst_difference, std::abs(differences[s] - d) / std::max(1.0, std::abs(d)));
+        }
+
+        std::cout << n << " variables, f = " << f << ", " << code.operations() << " operations, a tape of " << tape.size() << " steps\n"
+                  << "    evaluate " << eval_ns << " ns, gradient " << tape_ns << " ns (" << tape_ns / eval_ns << " evaluations), "
+                  << "differences " << difference_ns << " ns (" << difference_ns / eval_ns << " evaluations)\n"
+                  << "    tape within " << worst << " of the exact gradient, differences within " << worst_difference << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+gradient_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/gradient_test Mathly/test/gradient_test.cpp Mathly/gradient.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\gradient.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// the gradient at random points against central differences of the bytecode, compiled both ways. The values are kept in [0.5, 2]
+// so fractional powers and quotients stay away from where they blow up
+bool matchesDifferences(const std::string& text) {
+    auto expr = simplified(text);
+    for (bool optimize : {false, true}) {
+        Bytecode code;
+        GradientTape tape;
+        if (!code.compile(expr.get(), optimize) || !tape.compile(expr.get(), optimize)) return false;
+        if (tape.symbols() != code.symbols()) return false;
+
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> value(0.5, 2.0);
+        size_t vars = code.symbols().size();
+        std::vector<double> point(vars), grad(vars);
+
+        for (int trial = 0; trial < 50; trial++) {
+            for (auto& p : point) p = value(rng);
+            double f = tape.gradient(point.data(), grad.data());
+            if (std::abs(f - code.evaluate(point.data())) > 1e-12 * std::max(1.0, std::abs(f))) return false;
+
+            for (size_t i = 0; i < vars; i++) {
+                const double h = 1e-6;
+                double x = point[i];
+                point[i] = x + h;
+                double up = code.evaluate(point.data());
+                point[i] = x - h;
+                double down = code.evaluate(point.data());
+                point[i] = x;
+                double difference = (up - down) / (2 * h);
+                if (std::abs(grad[i] - difference) > 1e-6 * std::max(1.0, std::abs(difference))) return false;
+            }
+        }
+    }
+    return true;
+}
+
+DEFINE_TEST(TestGradientValues) {
+    // x^2 y + 3x at (2, 5): 2xy + 3 and x^2
+    auto expr = simplified("x^2*y + 3x");
+    GradientTape tape;
+    TEST(tape.compile(expr.get()));
+    int x = tape.slot(internSymbol("x")), y = tape.slot(internSymbol("y"));
+    TEST(x >= 0 && y >= 0);
+
+    std::vector<double> point(2), grad(2);
+    point[x] = 2.0;
+    point[y] = 5.0;
+    TEST_EQ(tape.gradient(point.data(), grad.data()), 26.0);
+    TEST_EQ(grad[x], 23.0);
+    TEST_EQ(grad[y], 4.0);
+
+    // a repeated value's adjoints add up
+    auto shared = simplified("(x + y)*(x + y) - y");
+    TEST(tape.compile(shared.get()));
+    point[tape.slot(internSymbol("x"))] = 1.0;
+    point[tape.slot(internSymbol("y"))] = 2.0;
+    TEST_EQ(tape.gradient(point.data(), grad.data()), 7.0);
+    TEST_EQ(grad[tape.slot(internSymbol("x"))], 6.0);
+    TEST_EQ(grad[tape.slot(internSymbol("y"))], 5.0);
+
+    // the expression being a variable on its own, no instructions at all
+    auto single = simplified("x");
+    TEST(tape.compile(single.get()));
+    TEST_EQ(tape.size(), 0);
+    double at = 3.0, d = 0.0;
+    TEST_EQ(tape.gradient(&at, &d), 3.0);
+    TEST_EQ(d, 1.0);
+
+    // a constant one, no variables to differentiate by
+    auto constant = simplified("2^3 + 1/4");
+    TEST(tape.compile(constant.get()));
+    TEST(tape.symbols().empty());
+    TEST_EQ(tape.gradient(nullptr, nullptr), 8.25);
+}
+
+DEFINE_TEST(TestGradientDifferences) {
+    TEST(matchesDifferences("3x^3 + 2x^2 + x + 5"));
+    TEST(matchesDifferences("x*y*z - x^2*y + z/y - 7"));
+    TEST(matchesDifferences("(x + y)^3 - x^5 * y^-2"));
+    TEST(matchesDifferences("(x + y)/(x^2 + 1) - 1/3"));
+    TEST(matchesDifferences("x^(1/2) + (x*y + 1)^(3/2) - z^(-1/3)"));
+    TEST(matchesDifferences("x^y + y^x"));
+    TEST(matchesDifferences("-(a - b)*(a + b)*(c - a)^2 + a*b*c*d"));
+}
+
+DEFINE_TEST(TestGradientManyVariables) {
+    // the sum of i * v_i^2 over 100 variables aa, ab, ..., the derivative by v_i is 2 i v_i, all from the one backward pass
+    auto name = [](int i) { return std::string{static_cast<char>('a' + i / 26), static_cast<char>('a' + i % 26)}; };
+    std::string text;
+    for (int i = 1; i <= 100; i++) text += (i > 1 ? " + " : "") + std::to_string(i) + "*" + name(i) + "^2";
+    auto expr = simplified(text);
+    GradientTape tape;
+    TEST(tape.compile(expr.get()));
+    TEST_EQ(tape.symbols().size(), 100);
+
+    std::vector<double> point(100), grad(100);
+    for (int i = 1; i <= 100; i++) point[tape.slot(internSymbol(name(i)))] = 0.25 * i;
+    tape.gradient(point.data(), grad.data());
+    bool all = true;
+    for (int i = 1; i <= 100; i++) all &= grad[tape.slot(internSymbol(name(i)))] == 2.0 * i * 0.25 * i;
+    TEST(all);
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
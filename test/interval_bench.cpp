@@ -0,0 +1,97 @@
+/*
+interval_bench.cpp
+
+The pruning loop: [-2, 2] x [-2, 2] cut into a grid of boxes and a dense random polynomial in x and y bounded over every one, the
+boxes whose bounds don't contain 0 being the ones that can be thrown out. Done by walking the tree and by the bytecode, compiled as
+the tree is and optimised, which give somewhat different bounds since they don't do the same operations.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/interval_bench Mathly/test/interval_bench.cpp Mathly/interval.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\interval.hpp"
+#include "..\bytecode.hpp"
+#include "fixtures.hpp"
+
+
+// every c x^i y^j with i + j <= degree
+std::string densePolynomial(int degree, std::mt19937& rng) {
+    std::uniform_int_distribution<int> coeff(-9, 9);
+    std::string text;
+    for (int i = 0; i <= degree; i++) {
+        for (int j = 0; i + j <= degree; j++) {
+            int c = coeff(rng);
+            if (c == 0) c = 1;
+            text += (text.empty() ? "" : (c < 0 ? " - " : " + ")) + std::to_string(text.empty() ? c : std::abs(c));
+            if (i > 0) text += "*x^" + std::to_string(i);
+            if (j > 0) text += "*y^" + std::to_string(j);
+        }
+    }
+    return text;
+}
+
+template<typename F>
+double nsPerCall(size_t calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    const int side = 1000;
+    const size_t boxes = side * side;
+    const double step = 4.0 / side;
+
+    int x = internSymbol("x"), y = internSymbol("y");
+
+    for (int degree : {2, 4, 8, 16}) {
+        auto expr = simplified(densePolynomial(degree, rng));
+        Bytecode code, plain;
+        code.compile(expr.get());
+        plain.compile(expr.get(), false);
+
+        std::vector<Interval> box(symbolCount());
+        auto cell = [&](size_t k, int symbol) {
+            size_t index = symbol == x ? k % side : k / side;
+            return Interval(-2.0 + index * step, -2.0 + (index + 1) * step);
+        };
+
+        size_t tree_kept = 0, plain_kept = 0, code_kept = 0;
+        double tree_ns = nsPerCall(boxes, [&]() {
+            for (size_t k = 0; k < boxes; k++) {
+                box[x] = cell(k, x);
+                box[y] = cell(k, y);
+                tree_kept += evaluateInterval(expr.get(), box).contains(0.0);
+            }
+        });
+
+        std::vector<Interval> slots(2);
+        double plain_ns = nsPerCall(boxes, [&]() {
+            for (size_t k = 0; k < boxes; k++) {
+                for (size_t s = 0; s < plain.symbols().size(); s++) slots[s] = cell(k, plain.symbols()[s]);
+                plain_kept += plain.bounds(slots.data()).contains(0.0);
+            }
+        });
+        double code_ns = nsPerCall(boxes, [&]() {
+            for (size_t k = 0; k < boxes; k++) {
+                for (size_t s = 0; s < code.symbols().size(); s++) slots[s] = cell(k, code.symbols()[s]);
+                code_kept += code.bounds(slots.data()).contains(0.0);
+            }
+        });
+
+        std::cout << "degree " << degree << ", " << boxes << " boxes, " << plain.operations() << " operations as it is, "
+                  << code.operations() << " optimised\n"
+                  << "    tree walk " << tree_ns << " ns a box (" << 1e3 / tree_ns << " M/s), " << tree_kept << " might be 0\n"
+                  << "    as it is: bytecode " << plain_ns << " ns (" << 1e3 / plain_ns << " M/s), " << plain_kept << " might be 0\n"
+                  << "    optimised: bytecode " << code_ns << " ns (" << 1e3 / code_ns << " M/s), " << code_kept << " might be 0\n";
+    }
+
+    return 0;
+}
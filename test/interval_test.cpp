@@ -0,0 +1,117 @@
+/*
+interval_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/interval_test Mathly/test/interval_test.cpp Mathly/interval.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\interval.hpp"
+#include "..\bytecode.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// the tree's bounds over x and y in the given ranges
+Interval bounds(const std::string& text, Interval x, Interval y = Interval()) {
+    int xs = internSymbol("x"), ys = internSymbol("y");
+    auto expr = simplified(text);
+    std::vector<Interval> box(symbolCount(), Interval::entire());
+    box[xs] = x;
+    box[ys] = y;
+    return evaluateInterval(expr.get(), box);
+}
+
+// Random boxes and random points in them, the value at every point has to be inside the bounds from both the tree and the
+// bytecode. The double evaluation does the same operations as the bytecode's interval one, so it can't get outside it even rounded
+bool encloses(const std::string& text) {
+    auto expr = simplified(text);
+    Bytecode code;
+    if (!code.compile(expr.get())) return false;
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> end(-3.0, 3.0), along(0.0, 1.0);
+    std::vector<Interval> box(symbolCount(), Interval::entire());
+    std::vector<Interval> slots(code.symbols().size());
+    std::vector<double> point(code.symbols().size());
+
+    for (int trial = 0; trial < 200; trial++) {
+        for (size_t s = 0; s < slots.size(); s++) {
+            double a = end(rng), b = end(rng);
+            slots[s] = Interval(std::min(a, b), std::max(a, b));
+            box[code.symbols()[s]] = slots[s];
+        }
+        Interval tree = evaluateInterval(expr.get(), box);
+        Interval compiled = code.bounds(slots.data());
+
+        for (int k = 0; k < 20; k++) {
+            for (size_t s = 0; s < slots.size(); s++) point[s] = slots[s].Lo + along(rng) * slots[s].width();
+            double v = code.evaluate(point.data());
+            if (std::isnan(v)) continue;
+            if (!compiled.contains(v)) return false;
+            if (!(tree.Lo <= v + 1e-9 * std::abs(v) && v - 1e-9 * std::abs(v) <= tree.Hi)) return false;
+        }
+    }
+    return true;
+}
+
+DEFINE_TEST(TestIntervalOperations) {
+    // outward by a step, never in
+    Interval third = exactInterval(Rational(1, 3));
+    TEST(third.Lo < 1.0 / 3.0 && 1.0 / 3.0 < third.Hi);
+    TEST(third.width() < 1e-15);
+    TEST(exactInterval(Rational(1, 2)).width() == 0.0);
+    Interval sum = Interval(0.1) + Interval(0.2);
+    TEST(sum.Lo < 0.1 + 0.2 && 0.1 + 0.2 < sum.Hi);
+
+    Interval product = Interval(-2.0, 3.0) * Interval(-1.0, 4.0);
+    TEST(product.Lo <= -8.0 && product.Lo > -8.0001 && product.Hi >= 12.0 && product.Hi < 12.0001);
+
+    // nothing to say when the divisor can be 0, half a line when it's at the end
+    TEST((Interval(1.0, 2.0) / Interval(-1.0, 1.0)).isEntire());
+    Interval half = Interval(1.0, 2.0) / Interval(0.0, 4.0);
+    TEST(half.Lo <= 0.25 && half.Lo > 0.2499 && half.Hi == std::numeric_limits<double>::infinity());
+
+    // even powers know they're not negative, odd ones keep the sign
+    Interval square = power(Interval(-1.0, 2.0), 2);
+    TEST(square.Lo == 0.0 && square.Hi >= 4.0 && square.Hi < 4.0001);
+    Interval cube = power(Interval(-2.0, 1.0), 3);
+    TEST(cube.Lo <= -8.0 && cube.Lo > -8.0001 && cube.Hi >= 1.0 && cube.Hi < 1.0001);
+    Interval inverse_square = power(Interval(-1.0, 1.0), -2);
+    TEST(inverse_square.Lo <= 1.0 && inverse_square.Lo > 0.9999 && inverse_square.Hi == std::numeric_limits<double>::infinity());
+    TEST(power(Interval(-1.0, 1.0), -1).isEntire());
+
+    Interval root = power(Interval(4.0, 9.0), exactInterval(Rational(1, 2)));
+    TEST(root.Lo <= 2.0 && root.Lo > 1.9999 && root.Hi >= 3.0 && root.Hi < 3.0001);
+    TEST(power(Interval(-4.0, 9.0), Interval(0.5)).isEntire());
+}
+
+DEFINE_TEST(TestIntervalExpressions) {
+    // x^2 from the annotation, not x*x, so it can't go below 0
+    Interval square = bounds("x^2 + 1", Interval(-1.0, 2.0));
+    TEST(square.Lo >= 0.9999 && square.Lo <= 1.0 && !square.contains(0.0));
+
+    // ruling out a root: x^2 - 2 is 0 at 1.414..
+    TEST(bounds("x^2 - 2", Interval(1.0, 1.5)).contains(0.0));
+    TEST(!bounds("x^2 - 2", Interval(1.5, 2.0)).contains(0.0));
+    TEST(!bounds("x*y - 1/2", Interval(1.0, 2.0), Interval(1.0, 3.0)).contains(0.0));
+    TEST(bounds("x/y", Interval(1.0, 2.0), Interval(-1.0, 1.0)).isEntire());
+
+    TEST(encloses("3x^2 - 2x*y + y/4 - 7"));
+    TEST(encloses("(x - y)^3 - x^5 * y^-2"));
+    TEST(encloses("(x + y)/(x^2 + 1) - 1/3"));
+    TEST(encloses("x^4 - 3x^3*y + 2x*y^2 - y^4 + 5"));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
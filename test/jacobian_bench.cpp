@@ -0,0 +1,68 @@
+/*
+jacobian_bench.cpp
+
+Growing sparse systems and the time to build their symbolic Jacobian, which should go with the number of nonzeros and not with
+rows times columns. Two kinds: the tridiagonal one from a discretised boundary value problem, v[i-1] - 2v[i] + v[i+1] + v[i]^3/10 = 1,
+and a scattered one where each equation has four unknowns picked at random plus a cubic of the first two unknowns that every
+equation shares, which the per column memo only differentiates once.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/jacobian_bench Mathly/test/jacobian_bench.cpp Mathly/jacobian.cpp Mathly/derivative.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\jacobian.hpp"
+#include "fixtures.hpp"
+
+
+// variables are letters only, so aaaa, aaab, ...
+std::string variable(int i) {
+    std::string name(4, 'a');
+    for (int k = 3; k >= 0; k--, i /= 26) name[k] = static_cast<char>('a' + i % 26);
+    return name;
+}
+
+std::string tridiagonal(int i, int n, std::mt19937&) {
+    std::string text = "-2" + variable(i) + " + " + variable(i) + "^3/10 - 1";
+    if (i > 0) text += " + " + variable(i - 1);
+    if (i + 1 < n) text += " + " + variable(i + 1);
+    return text;
+}
+
+std::string scattered(int, int n, std::mt19937& rng) {
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    std::string a = variable(pick(rng)), b = variable(pick(rng)), c = variable(pick(rng)), d = variable(pick(rng));
+    return a + "*" + b + "^2 - " + c + "/(" + d + "^2 + 1) + (" + variable(0) + " + " + variable(1) + ")^3";
+}
+
+template<typename F>
+double seconds(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+    std::mt19937 rng(2024);
+
+    for (auto [name, build] : {std::make_pair("tridiagonal", &tridiagonal), std::make_pair("scattered", &scattered)}) {
+        for (int n : {1000, 10000, 100000}) {
+            std::vector<std::unique_ptr<ExpressionNode>> system;
+            for (int i = 0; i < n; i++) system.push_back(simplified(build(i, n, rng)));
+            std::vector<const ExpressionNode*> equations;
+            for (const auto& e : system) equations.push_back(e.get());
+
+            SparseJacobian J;
+            double s = seconds([&]() { J = jacobian(equations); });
+            std::cout << name << ", " << n << " equations, " << J.columns() << " unknowns, " << J.nonzeros() << " nonzeros: " << s * 1e3
+                      << " ms, " << s * 1e9 / J.nonzeros() << " ns a nonzero\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+jacobian_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/jacobian_test Mathly/test/jacobian_test.cpp Mathly/jacobian.cpp Mathly/derivative.cpp Mathly/gradient.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\jacobian.hpp"
+#include "..\gradient.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// variables are letters only, so aaa, aab, ...
+std::string variable(int i) {
+    return std::string{static_cast<char>('a' + i / 676), static_cast<char>('a' + i / 26 % 26), static_cast<char>('a' + i % 26)};
+}
+
+// the entry printed, "0" for one that isn't stored
+std::string entryString(const SparseJacobian& J, size_t row, const std::string& var) {
+    int c = J.column(internSymbol(var));
+    const ExpressionNode* u = c < 0 ? nullptr : J.entry(row, c);
+    return u ? u->String() : "0";
+}
+
+DEFINE_TEST(TestJacobianPattern) {
+    std::vector<std::unique_ptr<ExpressionNode>> system;
+    system.push_back(simplified("x^2 + y^2 - 1"));
+    system.push_back(simplified("x*y - z"));
+    system.push_back(simplified("3z + 2"));
+    std::vector<const ExpressionNode*> equations;
+    for (const auto& e : system) equations.push_back(e.get());
+
+    SparseJacobian J = jacobian(equations);
+    TEST_EQ(J.rows(), 3);
+    TEST_EQ(J.columns(), 3);
+    TEST_EQ(J.nonzeros(), 6);
+    TEST_EQ(entryString(J, 0, "x"), simplified("2x")->String());
+    TEST_EQ(entryString(J, 0, "y"), simplified("2y")->String());
+    TEST_EQ(entryString(J, 0, "z"), "0");
+    TEST_EQ(entryString(J, 1, "x"), "y");
+    TEST_EQ(entryString(J, 1, "z"), "-1");
+    TEST_EQ(entryString(J, 2, "z"), "3");
+
+    // columns along a row go up
+    bool sorted = true;
+    for (size_t i = 0; i < J.rows(); i++) {
+        for (size_t k = J.RowStart[i] + 1; k < J.RowStart[i + 1]; k++) sorted &= J.Columns[k - 1] < J.Columns[k];
+    }
+    TEST(sorted);
+
+    // only y and x are unknowns, in that order, z is a parameter and the last row is left empty
+    SparseJacobian P = jacobian(equations, {internSymbol("y"), internSymbol("x")});
+    TEST_EQ(P.columns(), 2);
+    TEST_EQ(P.Symbols[0], internSymbol("y"));
+    TEST_EQ(P.nonzeros(), 4);
+    TEST_EQ(P.RowStart[3] - P.RowStart[2], 0);
+    TEST_EQ(entryString(P, 1, "y"), "x");
+    TEST_EQ(entryString(P, 1, "z"), "0");
+}
+
+DEFINE_TEST(TestJacobianValues) {
+    // a random sparse system, three unknowns out of 40 in each equation, with a part every equation shares. Each row's entries
+    // are checked against the tape's gradient of that equation (see gradient.hpp)
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> pick(0, 39), coeff(1, 5);
+    std::vector<std::unique_ptr<ExpressionNode>> system;
+    for (int i = 0; i < 60; i++) {
+        std::string a = variable(pick(rng)), b = variable(pick(rng)), c = variable(pick(rng));
+        std::string text = std::to_string(coeff(rng)) + a + "^2*" + b + " - (" + b + " + " + c + ")/(" + a + "^2 + 1) + (aaa + aab)^3";
+        system.push_back(simplified(text));
+    }
+    std::vector<const ExpressionNode*> equations;
+    for (const auto& e : system) equations.push_back(e.get());
+
+    SparseJacobian J = jacobian(equations);
+    std::uniform_real_distribution<double> value(0.5, 2.0);
+    std::vector<double> at(symbolCount());
+    for (auto& v : at) v = value(rng);
+
+    bool all = true;
+    size_t expected_nonzeros = 0;
+    for (size_t i = 0; i < J.rows(); i++) {
+        GradientTape tape;
+        TEST(tape.compile(equations[i]));
+        std::vector<double> point(tape.symbols().size()), grad(point.size());
+        for (size_t s = 0; s < point.size(); s++) point[s] = at[tape.symbols()[s]];
+        tape.gradient(point.data(), grad.data());
+        expected_nonzeros += point.size();
+
+        for (size_t s = 0; s < point.size(); s++) {
+            const ExpressionNode* u = J.entry(i, J.column(tape.symbols()[s]));
+            Bytecode code;
+            if (!u || !code.compile(u)) {
+                all = false;
+                continue;
+            }
+            std::vector<double> slots(code.symbols().size());
+            for (size_t k = 0; k < slots.size(); k++) slots[k] = at[code.symbols()[k]];
+            double d = code.evaluate(slots.data());
+            all &= std::abs(d - grad[s]) <= 1e-9 * std::max(1.0, std::abs(grad[s]));
+        }
+    }
+    TEST(all);
+    TEST_EQ(J.nonzeros(), expected_nonzeros);
+}
+
+DEFINE_TEST(TestJacobianLarge) {
+    // a discretised nonlinear boundary value problem, v[i-1] - 2v[i] + v[i+1] + v[i]^3/10 = 1, tridiagonal
+    const int n = 3000;
+    std::vector<std::unique_ptr<ExpressionNode>> system;
+    for (int i = 0; i < n; i++) {
+        std::string text = "-2" + variable(i) + " + " + variable(i) + "^3/10 - 1";
+        if (i > 0) text += " + " + variable(i - 1);
+        if (i + 1 < n) text += " + " + variable(i + 1);
+        system.push_back(simplified(text));
+    }
+    std::vector<const ExpressionNode*> equations;
+    for (const auto& e : system) equations.push_back(e.get());
+
+    std::vector<int> unknowns;
+    for (int i = 0; i < n; i++) unknowns.push_back(internSymbol(variable(i)));
+    SparseJacobian J = jacobian(equations, unknowns);
+    TEST_EQ(J.rows(), n);
+    TEST_EQ(J.columns(), n);
+    TEST_EQ(J.nonzeros(), 3 * n - 2);
+
+    TEST_EQ(J.entry(1234, 1234)->String(), "(-2 + ((3 / 10) * (" + variable(1234) + " ^ 2)))");
+    TEST_EQ(J.entry(1234, 1235)->String(), "1");
+    TEST(J.entry(1234, 1236) == nullptr);
+    TEST_EQ(J.RowStart[1] - J.RowStart[0], 2);
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/*
+jit_bench.cpp
+
+Dense random polynomials in x and y of increasing degree, each evaluated the same number of times by walking the tree (a visitor
+over the nodes, like the simplifier would), by the bytecode loop and by the JIT's machine code, the last two compiled as the tree
+is and optimised (Horner form). Also checks they all agree.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/jit_bench Mathly/test/jit_bench.cpp Mathly/jit.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\jit.hpp"
+#include "fixtures.hpp"
+#include "..\visitors.hpp"
+
+
+// the straightforward way, a virtual call per node and the values looked up by symbol id
+class TreeEvaluator : public ExprVisitor {
+    public:
+        explicit TreeEvaluator(const std::vector<double>& values) : Values(values) {}
+
+        double evaluate(const ExpressionNode& node) {
+            node.accept(*this);
+            return Result;
+        }
+
+        void visit(const NumberExpressionNode& node) override { Result = static_cast<double>(node.Value); }
+        void visit(const VariableExpressionNode& node) override { Result = Values[node.Key.Symbol]; }
+        void visit(const PrefixExpressionNode& node) override { Result = -evaluate(*node.Right); }
+
+        void visit(const InfixExpressionNode& node) override {
+            double left = evaluate(*node.Left);
+            double right = evaluate(*node.Right);
+            switch (node.Operator) {
+                case '+': Result = left + right; break;
+                case '-': Result = left - right; break;
+                case '*': Result = left * right; break;
+                case '/': Result = left / right; break;
+                default:  Result = std::pow(left, right); break;
+            }
+        }
+
+        void visit(const NaryExpressionNode& node) override {
+            bool sum = node.Kind == InfixKind::PLUS;
+            double acc = sum ? 0.0 : 1.0;
+            for (size_t i = 0; i < node.Operands.size(); i++) {
+                Rational c = node.coeff(i);
+                double v = evaluate(*node.Operands[i]);
+                double cd = static_cast<double>(c.num) / static_cast<double>(c.den);
+                if (sum) acc += cd * v;
+                else acc *= c.isOne() ? v : std::pow(v, cd);
+            }
+            Result = acc;
+        }
+
+    private:
+        const std::vector<double>& Values;
+        double Result {0};
+};
+
+// every c x^i y^j with i + j <= degree
+std::string densePolynomial(int degree, std::mt19937& rng) {
+    std::uniform_int_distribution<int> coeff(-9, 9);
+    std::string text;
+    for (int i = 0; i <= degree; i++) {
+        for (int j = 0; i + j <= degree; j++) {
+            int c = coeff(rng);
+            if (c == 0) c = 1;
+            text += (text.empty() ? "" : (c < 0 ? " - " : " + ")) + std::to_string(text.empty() ? c : std::abs(c));
+            if (i > 0) text += "*x^" + std::to_string(i);
+            if (j > 0) text += "*y^" + std::to_string(j);
+        }
+    }
+    return text;
+}
+
+template<typename F>
+double nsPerCall(size_t calls, F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    const size_t calls = 200000;
+
+    int x = internSymbol("x"), y = internSymbol("y");
+
+    for (int degree : {2, 4, 8, 16, 32}) {
+        auto expr = simplified(densePolynomial(degree, rng));
+        JitExpression jit, plain_jit;
+        Bytecode code, plain;
+        jit.compile(expr.get());
+        code.compile(expr.get());
+        plain_jit.compile(expr.get(), true, false);
+        plain.compile(expr.get(), false);
+
+        // the same points for all of them, by symbol for the tree and in slot order for the others (optimising can change the order)
+        std::vector<std::vector<double>> by_symbol(calls, std::vector<double>(symbolCount()));
+        std::vector<std::vector<double>> by_slot(calls, std::vector<double>(code.symbols().size()));
+        std::vector<std::vector<double>> by_plain_slot(calls, std::vector<double>(plain.symbols().size()));
+        for (size_t k = 0; k < calls; k++) {
+            by_symbol[k][x] = value(rng);
+            by_symbol[k][y] = value(rng);
+            for (size_t s = 0; s < code.symbols().size(); s++) by_slot[k][s] = by_symbol[k][code.symbols()[s]];
+            for (size_t s = 0; s < plain.symbols().size(); s++) by_plain_slot[k][s] = by_symbol[k][plain.symbols()[s]];
+        }
+
+        std::vector<double> tree_out(calls), code_out(calls), jit_out(calls), plain_out(calls);
+        double tree_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) {
+                TreeEvaluator walker(by_symbol[k]);
+                tree_out[k] = walker.evaluate(*expr);
+            }
+        });
+        double plain_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) plain_out[k] = plain.evaluate(by_plain_slot[k].data());
+        });
+        double plain_jit_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) plain_out[k] = plain_jit.evaluate(by_plain_slot[k].data());
+        });
+        double code_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) code_out[k] = code.evaluate(by_slot[k].data());
+        });
+        double jit_ns = nsPerCall(calls, [&]() {
+            for (size_t k = 0; k < calls; k++) jit_out[k] = jit.evaluate(by_slot[k].data());
+        });
+
+        double worst = 0;
+        size_t differ = 0;
+        for (size_t k = 0; k < calls; k++) {
+            worst = std::max(worst, std::abs(tree_out[k] - code_out[k]) / std::max(1.0, std::abs(tree_out[k])));
+            worst = std::max(worst, std::abs(tree_out[k] - plain_out[k]) / std::max(1.0, std::abs(tree_out[k])));
+            if (jit_out[k] != code_out[k]) differ++;
+        }
+
+        std::cout << "degree " << degree << ", " << expr->getSynopsis().Size << " nodes, " << plain.operations() << " operations as it is, "
+                  << code.operations() << " optimised, " << jit.codeSize() << " bytes of machine code" << (jit.isNative() ? "" : " (not native)") << "\n"
+                  << "    as it is: bytecode " << plain_ns << " ns, jit " << plain_jit_ns << " ns\n"
+                  << "    optimised: bytecode " << code_ns << " ns, jit " << jit_ns << " ns\n"
+                  << "    tree walk " << tree_ns << " ns (tree / optimised jit " << tree_ns / jit_ns << "x, optimised bytecode / jit " << code_ns / jit_ns << "x)\n"
+                  << "    tree against bytecode within " << worst << ", jit differs from bytecode " << differ << " times\n";
+    }
+
+    return 0;
+}
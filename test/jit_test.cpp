@@ -0,0 +1,83 @@
+/*
+jit_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/jit_test Mathly/test/jit_test.cpp Mathly/jit.cpp Mathly/bytecode.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\jit.hpp"
+#include "..\..\simpletest\simpletest.h"
+#include "fixtures.hpp"
+
+
+// the machine code against the bytecode on random values, exactly since they do the same operations in the same order
+bool matchesBytecode(const std::string& text) {
+    auto expr = simplified(text);
+    JitExpression jit;
+    Bytecode code;
+    if (!jit.compile(expr.get()) || !code.compile(expr.get())) return false;
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> value(-3.0, 3.0);
+    std::vector<double> values(code.symbols().size());
+    for (int trial = 0; trial < 100; trial++) {
+        for (auto& v : values) v = value(rng);
+        double expected = code.evaluate(values.data());
+        double got = jit.evaluate(values.data());
+        if (got != expected && !(std::isnan(got) && std::isnan(expected))) return false;
+    }
+    return true;
+}
+
+bool isNative(const std::string& text) {
+    auto expr = simplified(text);
+    JitExpression jit;
+    return jit.compile(expr.get()) && jit.isNative();
+}
+
+DEFINE_TEST(TestJitMatchesBytecode) {
+    TEST(matchesBytecode("3x^2 - 2x*y + y/4 - 7"));
+    TEST(matchesBytecode("-(x - y)/(x + 2) + x^-3 - y^0"));
+    TEST(matchesBytecode("x^13 * y^-2 + (x*y)^5"));
+    TEST(matchesBytecode("x"));
+    TEST(matchesBytecode("2/3"));
+
+    // enough live temporaries that some of them go to the spill array
+    TEST(matchesBytecode("(a+1)*(b - (c+1)*(d + (e+1)*(f - (g+1)*(h + (i+1)*(j - (k+1)*(l+1)))))) / (m + 2)"));
+}
+
+DEFINE_TEST(TestJitFallsBack) {
+#if defined(__x86_64__) || defined(_M_X64)
+    TEST(isNative("x^3 - x"));
+#endif
+
+    // a general power stays on the bytecode, with the same answer
+    TEST(!isNative("x^(1/2) + 1"));
+    auto expr = simplified("x^(1/2) + 1");
+    JitExpression jit;
+    TEST(jit.compile(expr.get()));
+    double four = 4.0;
+    TEST(jit.evaluate(&four) == 3.0);
+
+    // and so does everything when asked
+    auto cube = simplified("x^3");
+    TEST(jit.compile(cube.get(), false));
+    TEST(!jit.isNative());
+    double two = 2.0;
+    TEST(jit.evaluate(&two) == 8.0);
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -62,6 +62,19 @@ Date: 20/02/2025
 
     }
 
+    // a decimal point only counts with a digit after it
+    DEFINE_TEST(TestDecimalToken) {
+        std::string input = "0.25x + 12.5 * 3.$";
+        Lexer lexer = Lexer(input);
+        std::vector<Token> tokens = lexer.lex();
+
+        TEST(tokens[0].Type == token::INT && tokens[0].Literal == "0.25");
+        TEST(tokens[1].Type == token::VAR && tokens[1].Literal == "x");
+        TEST(tokens[3].Type == token::INT && tokens[3].Literal == "12.5");
+        TEST(tokens[5].Type == token::INT && tokens[5].Literal == "3");
+        TEST(tokens[6].Type == token::ILLEGAL);
+    }
+
 
 int main() {
     
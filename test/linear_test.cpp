@@ -0,0 +1,60 @@
+/*
+linear_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/linear_test Mathly/test/linear_test.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include "..\linear.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+// c0 + c1 s1 + c2 s2
+LinearForm form(i64 c0, int s1, Rational c1, int s2, Rational c2) {
+    LinearForm f;
+    f.Constant = Rational(c0);
+    f.addTerm(s1, c1).addTerm(s2, c2);
+    return f;
+}
+
+DEFINE_TEST(TestLinearFormArithmetic) {
+    LinearForm a = form(3, 0, Rational(2), 1, Rational(1, 2));
+    LinearForm b = form(1, 1, Rational(1, 2), 2, Rational(-1));
+
+    // symbol 1 cancels, 2 stays sorted after 0
+    LinearForm d = a - b;
+    TEST_EQ(d.Coeffs.size(), 2U);
+    TEST_EQ(d.Coeffs[0].first, 0);
+    TEST_EQ(d.Coeffs[1].first, 2);
+    TEST(d.coefficient(2) == Rational(1));
+    TEST(d.coefficient(1).isZero());
+    TEST(d.Constant == Rational(2));
+
+    LinearForm s = a + b;
+    TEST(s.coefficient(1) == Rational(1));
+    TEST(s.Constant == Rational(4));
+}
+
+DEFINE_TEST(TestLinearFormSolve) {
+    // 2x + y/2 + 3 = 0  ->  x = -y/4 - 3/2
+    LinearForm f = form(3, 0, Rational(2), 1, Rational(1, 2));
+    LinearForm x = f.solveFor(0);
+    TEST_EQ(x.Coeffs.size(), 1U);
+    TEST(x.coefficient(1) == Rational(-1, 4));
+    TEST(x.Constant == Rational(-3, 2));
+
+    // or for y
+    LinearForm y = f.solveFor(1);
+    TEST(y.coefficient(0) == Rational(-4));
+    TEST(y.Constant == Rational(-6));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
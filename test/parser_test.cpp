@@ -4,7 +4,7 @@ parser_test.cpp
 */
 
 
-// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/parser_test Mathly/test/parser_test.cpp
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/parser_test Mathly/test/parser_test.cpp Mathly/ast.cpp Mathly/visitors.cpp simpletest/simpletest.cpp
 
 #include <vector>
 #include <variant>
@@ -39,6 +39,33 @@ DEFINE_TEST(TestNumberExpression) {
     TEST( parsedExpr->TokenLiteral() == "1928378412" );
 }
 
+DEFINE_TEST(TestDecimalExpression) {
+    std::string input = "0.125$";
+
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(lexer);
+    std::unique_ptr<ExpressionNode> parsedExpr = parser.parseLoop();
+    NumberExpressionNode* convertedparsedExpr = dynamic_cast<NumberExpressionNode*>(parsedExpr.get());
+    int errorCode = checkParserErrors(parser);
+    TEST_EQ(errorCode, 0);
+
+    TEST( parsedExpr->getKind() == InfixKind::REAL );
+    TEST( convertedparsedExpr->Real == 0.125 );
+    TEST( parsedExpr->TokenLiteral() == "0.125" );
+}
+
+DEFINE_TEST(TestNumberTooBig) {
+    // past 64 bits a literal can't be read, it's Undefined rather than the parse failing
+    std::string input = "x + 99999999999999999999$";
+
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(lexer);
+    std::unique_ptr<ExpressionNode> parsedExpr = parser.parseLoop();
+    int errorCode = checkParserErrors(parser);
+    TEST_EQ(errorCode, 0);
+    TEST_EQ(parsedExpr->String(), "(x + Undefined)");
+}
+
 DEFINE_TEST(TestVariableExpression) {
     std::string input = "area$";
 
@@ -162,7 +189,12 @@ DEFINE_TEST(TestOperatorPrecedence) {
         {"(a + b) * c$", "((a + b) * c)"},
         {"a + b + c + d$", "(((a + b) + c) + d)"},
         {"(((a + b) + c) + d)$", "(((a + b) + c) + d)"},
-        {"a + b * c + d / 2$", "((a + (b * c)) + (d / 2))"}
+        {"a + b * c + d / 2$", "((a + (b * c)) + (d / 2))"},
+        {"2x^2 + x$", "((2 * (x ^ 2)) + x)"},
+        {"a^b^c$", "(a ^ (b ^ c))"},
+        {"-x^2$", "(-(x ^ 2))"},
+        {"(a + b)^2 * c$", "(((a + b) ^ 2) * c)"},
+        {"0.5x + 1.25$", "((0.5 * x) + 1.25)"}
         
         
         
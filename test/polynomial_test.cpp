@@ -0,0 +1,203 @@
+/*
+polynomial_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/polynomial_test Mathly/test/polynomial_test.cpp Mathly/polynomial.cpp Mathly/dense.cpp simpletest/simpletest.cpp
+
+#include <vector>
+
+#include "..\polynomial.hpp"
+#include "..\dense.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+// x + c in two variables x, y
+Polynomial linear(int var, i64 c) {
+    return Polynomial::variable(2, var) + Polynomial::constant(2, Rational(c));
+}
+
+DEFINE_TEST(TestPackedExponents) {
+    Polynomial p(3);
+    std::vector<int> exps = {2, 0, 5};
+    u64 packed = p.pack(exps);
+
+    TEST_EQ(p.exponent(packed, 0), 2);
+    TEST_EQ(p.exponent(packed, 1), 0);
+    TEST_EQ(p.exponent(packed, 2), 5);
+
+    // variable 0 is the most significant, so x beats any power of y or z
+    std::vector<int> x = {1, 0, 0};
+    std::vector<int> z = {0, 0, 9};
+    TEST(p.pack(x) > p.pack(z));
+}
+
+DEFINE_TEST(TestPolynomialAddition) {
+    // (x + 1) + (y - 1) = x + y
+    Polynomial sum = linear(0, 1) + linear(1, -1);
+
+    TEST_EQ(sum.size(), 2U);
+    TEST(sum.Terms[0].Exps > sum.Terms[1].Exps);
+    TEST(sum.Terms[0].Coeff.isOne());
+    TEST(sum.Terms[1].Coeff.isOne());
+
+    // x - x = 0
+    Polynomial x = Polynomial::variable(2, 0);
+    Polynomial minus_x = Polynomial::variable(2, 0).scale(Rational(-1));
+    TEST((x + minus_x).isZero());
+}
+
+DEFINE_TEST(TestPolynomialMultiplication) {
+    // (x + 1)(x - 1) = x^2 - 1, the x terms cancel in the heap
+    Polynomial p = linear(0, 1) * linear(0, -1);
+
+    TEST_EQ(p.size(), 2U);
+    TEST_EQ(p.exponent(p.Terms[0].Exps, 0), 2);
+    TEST(p.Terms[0].Coeff.isOne());
+    TEST_EQ(p.Terms[1].Exps, 0U);
+    TEST(p.Terms[1].Coeff == Rational(-1));
+
+    // (x + y)^2 = x^2 + 2xy + y^2, in decreasing order
+    Polynomial q = (Polynomial::variable(2, 0) + Polynomial::variable(2, 1)).pow(2);
+    TEST_EQ(q.size(), 3U);
+    TEST(q.Terms[1].Coeff == Rational(2));
+    TEST_EQ(q.exponent(q.Terms[1].Exps, 0), 1);
+    TEST_EQ(q.exponent(q.Terms[1].Exps, 1), 1);
+    for (size_t i = 1; i < q.size(); i++) {
+        TEST(q.Terms[i - 1].Exps > q.Terms[i].Exps);
+    }
+}
+
+DEFINE_TEST(TestPolynomialPower) {
+    // (x/2 + 1)^10, coefficients are C(10, k) / 2^k
+    Polynomial p = (Polynomial::variable(1, 0).scale(Rational(1, 2)) + Polynomial::constant(1, Rational(1))).pow(10);
+
+    TEST_EQ(p.size(), 11U);
+    TEST(p.Terms[0].Coeff == Rational(1, 1024));
+    TEST(p.Terms[5].Coeff == Rational(252, 32));
+    TEST(p.Terms[10].Coeff.isOne());
+}
+DEFINE_TEST(TestPolynomialDivision) {
+    Polynomial x = Polynomial::variable(2, 0);
+    Polynomial y = Polynomial::variable(2, 1);
+
+    // (x^2 - y^2) / (x + y) = x - y
+    Polynomial q;
+    TEST(divide(x * x + (y * y).scale(Rational(-1)), x + y, q));
+    Polynomial expected = x + Polynomial(y).scale(Rational(-1));
+    TEST_EQ(q.size(), 2U);
+    TEST(q.Terms[0].Exps == expected.Terms[0].Exps && q.Terms[1].Coeff == expected.Terms[1].Coeff);
+
+    // x^2 + 1 isn't a multiple of x + 1
+    TEST(!divide(x * x + Polynomial::constant(2, Rational(1)), x + Polynomial::constant(2, Rational(1)), q));
+}
+
+DEFINE_TEST(TestPolynomialGcd) {
+    Polynomial x = Polynomial::variable(2, 0);
+    Polynomial y = Polynomial::variable(2, 1);
+
+    // gcd((x + y)^2 (x - 1), 3 (x + y)(y + 2)) = x + y, monic
+    Polynomial a = (x + y).pow(2) * (x + Polynomial::constant(2, Rational(-1)));
+    Polynomial b = (x + y).scale(Rational(3)) * (y + Polynomial::constant(2, Rational(2)));
+    Polynomial g = gcd(a, b);
+    TEST_EQ(g.size(), 2U);
+    TEST(g.Terms[0].Coeff.isOne());
+    Polynomial q;
+    TEST(divide(g, x + y, q) && q.isConstant());
+
+    // nothing in common
+    TEST(gcd(x * x + Polynomial::constant(2, Rational(1)), x + y).isConstant());
+}
+
+DEFINE_TEST(TestPolynomialOverflow) {
+    Polynomial x1 = Polynomial::variable(1, 0) + Polynomial::constant(1, Rational(1));
+
+    // C(66, 33) still fits in 64 bits, C(67, 33) doesn't
+    Polynomial p = x1.pow(66);
+    TEST(!p.overflowed());
+    TEST(p.Terms[33].Coeff == Rational(INT64_C(7219428434016265740)));
+
+    Polynomial big = x1.pow(67);
+    TEST(big.overflowed());
+    TEST((big * x1).overflowed());
+
+    // nothing is divided or cancelled on coefficients that aren't right
+    Polynomial q;
+    TEST(!divide(big, x1, q));
+    TEST(gcd(big, x1).isConstant());
+}
+
+// plain O(nm) product to check the faster ones against
+std::vector<i128> naiveProduct(const std::vector<i64>& a, const std::vector<i64>& b) {
+    std::vector<i128> out(a.size() + b.size() - 1, 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j < b.size(); j++) out[i + j] += static_cast<i128>(a[i]) * b[j];
+    }
+    return out;
+}
+
+std::vector<i64> pseudoRandomCoeffs(size_t n, i64 range, uint32_t seed) {
+    std::vector<i64> coeffs(n);
+    for (auto& c : coeffs) {
+        seed = seed * 1103515245 + 12345;
+        c = static_cast<i64>(seed % (2 * range + 1)) - range;
+    }
+    return coeffs;
+}
+
+DEFINE_TEST(TestDenseMultiplication) {
+    // one size for each of schoolbook, Karatsuba (with a ragged longer side) and the NTT
+    std::vector<std::pair<size_t, size_t>> sizes = {{10, 17}, {100, 357}, {600, 700}};
+
+    for (auto& [n, m] : sizes) {
+        std::vector<i64> a = pseudoRandomCoeffs(n, 1000000007, 1);
+        std::vector<i64> b = pseudoRandomCoeffs(m, 1000000007, 2);
+
+        std::vector<i128> out;
+        TEST(multiplyDense(a, b, out));
+        TEST(out == naiveProduct(a, b));
+    }
+
+    // right at the edge of what the three NTT primes can give back with its sign, 256 * (2^39 - 1) * (2^38 - 1) < 2^85, and one
+    // bit past it, which has to go another way
+    for (i64 top : {(i64(1) << 38) - 1, (i64(1) << 39) - 1}) {
+        std::vector<i64> a(256, (i64(1) << 39) - 1), b(256, top);
+        std::vector<i128> out;
+        TEST(multiplyDense(a, b, out));
+        TEST(out == naiveProduct(a, b));
+    }
+}
+
+DEFINE_TEST(TestDenseUnivariatePolynomial) {
+    // 50 terms in x with coefficients k/6 - 1/3, long enough for the dense path, checked against adding up the single terms one by one
+    Polynomial p(1);
+    for (int k = 49; k >= 0; k--) {
+        Rational c = Rational(k % 5, 6) - Rational(1, 3);
+        if (!c.isZero()) p.Terms.push_back(PolyTerm{c, static_cast<u64>(k)});
+    }
+    Polynomial square = p * p;
+
+    Polynomial expected(1);
+    for (const auto& s : p.Terms) {
+        for (const auto& t : p.Terms) {
+            Polynomial single(1);
+            single.Terms.push_back(PolyTerm{s.Coeff * t.Coeff, s.Exps + t.Exps});
+            expected = expected + single;
+        }
+    }
+
+    TEST_EQ(square.size(), expected.size());
+    for (size_t i = 0; i < square.size() && i < expected.size(); i++) {
+        TEST_EQ(square.Terms[i].Exps, expected.Terms[i].Exps);
+        TEST(square.Terms[i].Coeff == expected.Terms[i].Coeff);
+    }
+}
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
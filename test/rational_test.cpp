@@ -0,0 +1,190 @@
+/*
+rational_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/rational_test Mathly/test/rational_test.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "..\rational.hpp"
+#include "..\parser.hpp"
+#include "..\simplifier.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+std::string simplified(std::string text) {
+    text.append("$");
+    Lexer lexer(text);
+    Parser parser(lexer);
+    auto parsed = parser.parseLoop();
+    SimplifyVisitor visitor;
+    parsed->accept(visitor);
+    return visitor.getResult()->String();
+}
+
+std::string expanded(std::string text) {
+    text.append("$");
+    Lexer lexer(text);
+    Parser parser(lexer);
+    auto parsed = parser.parseLoop();
+    SimplifyVisitor visitor;
+    parsed->accept(visitor);
+    auto result = visitor.getResult();
+    return visitor.expand_tree(result)->String();
+}
+
+DEFINE_TEST(TestRationalOverflow) {
+    const i64 big = INT64_C(4611686018427387904);     // 2^62
+
+    // in range, the 128 bit intermediate is divided back down
+    TEST(Rational(big, 3) * Rational(3, 2) == Rational(big / 2));
+    TEST(Rational(INT64_MAX) - Rational(INT64_MAX) == Rational(0));
+
+    // out of range is the overflow value, never a wrapped number
+    TEST((Rational(big) * Rational(4)).isOverflow());
+    TEST((Rational(INT64_MAX) + Rational(1)).isOverflow());
+    TEST((Rational(1, big) * Rational(1, 4)).isOverflow());
+    TEST(!(Rational(big) * Rational(4)).isZero());
+
+    // and it stays that way through whatever comes after
+    Rational r = Rational(big) * Rational(4);
+    TEST((r * Rational(0)).isOverflow());
+    TEST((r - r).isOverflow());
+    TEST((Rational(1) / r).isOverflow());
+    TEST((Rational(1) / Rational(0)).isOverflow());
+}
+
+DEFINE_TEST(TestRationalPower) {
+    Rational r;
+    TEST(powRational(Rational(2), 62, r) && r == Rational(INT64_C(4611686018427387904)));
+    TEST(powRational(Rational(-2, 3), -3, r) && r == Rational(-27, 8));
+
+    // failures leave out alone
+    r = Rational(5);
+    TEST(!powRational(Rational(2), 70, r));
+    TEST(!powRational(Rational(1, 2), 64, r));
+    TEST(!powRational(Rational(0), -2, r));
+    TEST(r == Rational(5));
+    TEST(powRational(Rational(3), 41).isOverflow());
+}
+
+DEFINE_TEST(TestSimplifierOverflow) {
+    // the simplifier says Undefined rather than print something that wrapped
+    TEST_EQ(simplified("4611686018427387904*4"), "Undefined");
+    TEST_EQ(simplified("9223372036854775807 + 1"), "Undefined");
+    TEST_EQ(simplified("4611686018427387904x*4 + y"), "Undefined");
+    TEST_EQ(simplified("4611686018427387904x + 4611686018427387904x"), "Undefined");
+
+    // right up to the edge is fine
+    TEST_EQ(simplified("4611686018427387903*2 + 1"), "9223372036854775807");
+}
+
+DEFINE_TEST(TestSimplifierBigLiterals) {
+    // numbers past 2^31 keep all 64 bits through the fraction folding
+    TEST_EQ(simplified("3000000000/7"), "(3000000000 / 7)");
+    TEST_EQ(simplified("6000000000/4"), "1500000000");
+    TEST_EQ(simplified("3000000000/7 + 1/7"), "(3000000001 / 7)");
+    TEST_EQ(simplified("(3000000000/7) / (5/7)"), "600000000");
+    TEST_EQ(simplified("(4294967296/3) * (3/2)"), "2147483648");
+}
+
+DEFINE_TEST(TestSimplifierBigPowers) {
+    // a number to a power too big for 64 bits stays a power, one that fits is evaluated
+    TEST_EQ(simplified("2^70"), "(2 ^ 70)");
+    TEST_EQ(simplified("2^70*2"), "(2 ^ 71)");
+    TEST_EQ(simplified("(2x)^70"), "((2 ^ 70) * (x ^ 70))");
+    TEST_EQ(simplified("2^62"), "4611686018427387904");
+    TEST_EQ(simplified("0^(-2)"), "Undefined");
+}
+
+DEFINE_TEST(TestExpansionOverflow) {
+    // coefficients past 64 bits, the power is kept instead of multiplied out
+    TEST_EQ(expanded("(x + 1)^70"), "((1 + x) ^ 70)");
+    TEST_EQ(expanded("(x^(1/2) + 1)^70"), "((1 + (x ^ (1 / 2))) ^ 70)");
+    TEST_EQ(expanded("(x + 1)^70*(x^(1/2) + 2)"), "((2 * ((1 + x) ^ 70)) + ((x ^ (1 / 2)) * ((1 + x) ^ 70)))");
+    TEST_EQ(simplified("((x + 1)^70 + x)/(x + 1)"), "((x + ((1 + x) ^ 70)) / (1 + x))");
+
+    // C(66, 33) is the largest one that fits
+    TEST_EQ(expanded("(x + 1)^66").find("Undefined"), std::string::npos);
+    TEST(expanded("(x + 1)^66").find("(7219428434016265740 * (x ^ 33))") != std::string::npos);
+
+    // exponents past 32 bits aren't cut down to fit the packed ones, the term stays
+    TEST_EQ(expanded("x^4294967296*(y + 1)"), "((x ^ 4294967296) + ((x ^ 4294967296) * y))");
+    TEST_EQ(expanded("x^4294967296*x^4294967296*(y + 1)"), "((x ^ 8589934592) + ((x ^ 8589934592) * y))");
+}
+
+DEFINE_TEST(TestSimplifierOperandOrder) {
+    // a number next to a sum in a product stays a factor whichever order they come in
+    TEST_EQ(simplified("-1*(3 - x)*y"), simplified("(3 - x)*y*(-1)"));
+    TEST_EQ(simplified("2*(3 - x)*y - (3 - x)*y*2"), "0");
+    TEST_EQ(simplified("2*(x + 2)*(x + 1) - (x + 1)*2*(x + 2)"), "0");
+
+    // random sums of products, u - (u with every sum and product shuffled) is 0, and simplifying what was printed changes nothing
+    const std::vector<std::string> factors = {"2", "-1", "(3/2)", "(3 - x)", "(x + y)", "y", "x^2", "(1 + x)^2", "(2x - 4)", "z"};
+    std::mt19937 rng(29);
+    std::uniform_int_distribution<int> pick(0, static_cast<int>(factors.size()) - 1), count(1, 4);
+    bool cancels = true, stable = true;
+    for (int trial = 0; trial < 500; trial++) {
+        std::vector<std::vector<std::string>> terms(count(rng));
+        for (auto& term : terms) {
+            term.resize(count(rng));
+            for (auto& f : term) f = factors[pick(rng)];
+        }
+
+        auto text = [](const std::vector<std::vector<std::string>>& sum) {
+            std::string s;
+            for (const auto& term : sum) {
+                s += s.empty() ? "(" : " + (";
+                for (size_t i = 0; i < term.size(); i++) s += (i ? "*" : "") + term[i];
+                s += ")";
+            }
+            return s;
+        };
+        std::string u = text(terms);
+        for (auto& term : terms) std::shuffle(term.begin(), term.end(), rng);
+        std::shuffle(terms.begin(), terms.end(), rng);
+
+        cancels &= simplified(u + " - (" + text(terms) + ")") == "0";
+        std::string once = simplified(u);
+        stable &= simplified(once) == once;
+    }
+    TEST(cancels);
+    TEST(stable);
+}
+
+DEFINE_TEST(TestSymbolOrder) {
+    // names in sorted order, backwards, shuffled, and each one squeezed in just after the last, which runs out of room between
+    // ranks and has them all spread out again part way through
+    std::vector<std::string> names;
+    for (int i = 0; i < 200; i++) names.push_back("m" + std::to_string(1000 + i));
+    for (int i = 0; i < 200; i++) names.push_back("f" + std::to_string(1999 - i));
+    std::vector<std::string> shuffled;
+    for (int i = 0; i < 200; i++) shuffled.push_back("s" + std::to_string(i));
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(26));
+    names.insert(names.end(), shuffled.begin(), shuffled.end());
+    std::string squeezed = "q";
+    for (int i = 0; i < 200; i++) names.push_back(squeezed += "a");
+    names.push_back("r");
+
+    for (const auto& name : names) internSymbol(name);
+    std::sort(names.begin(), names.end());
+    bool ordered = true;
+    for (size_t i = 1; i < names.size(); i++) ordered &= symbolRank(internSymbol(names[i - 1])) < symbolRank(internSymbol(names[i]));
+    TEST(ordered);
+
+    TEST_EQ(simplified("r + qaaa + qa + qaa"), "(qa + qaa + qaaa + r)");
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -1,6 +1,6 @@
 #include <iostream>
 #include "..\simplifier.hpp"
-// g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/simp_test Mathly/test/simplifier_test.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp
+// g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/simp_test Mathly/test/simplifier_test.cpp Mathly/ast.cpp Mathly/visitors.cpp Mathly/simplifier.cpp Mathly/polynomial.cpp Mathly/dense.cpp Mathly/termstream.cpp Mathly/linear.cpp
 // Helper function to create a number node
 std::unique_ptr<ExpressionNode> makeNumber(double value) {
     Token tok{token::INT, std::to_string(value)};
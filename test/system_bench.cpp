@@ -0,0 +1,190 @@
+/*
+system_bench.cpp
+
+Timings for SparseSystem with 100, 1k and 10k unknowns on two kinds of random sparse system: uniform ones, where each equation has
+its own unknown and two more picked anywhere, and block triangular ones that only look random until they're put in order. Then
+IncrementalSystem taking the block triangular equations one at a time, in order and shuffled.
+*/
+
+// to run: g++ -Wall -std=c++20 -O2 -o BIN/system_bench Mathly/test/system_bench.cpp Mathly/system.cpp Mathly/linear.cpp
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+
+#include "..\system.hpp"
+
+
+// the equations and the integer solution their right hand sides were made from
+struct RandomSystem {
+    std::vector<LinearForm> Equations;
+    std::vector<LinearForm> InOrder;    // the same equations block by block, each after the ones it builds on
+    std::vector<i64> Solution;          // by symbol
+};
+
+// Each equation has its unknown i and two others picked uniformly, coefficients in -9..9 and not 0, nothing in the way of structure
+// for the block triangular form to find. The right hand sides come from a known integer solution to check against
+RandomSystem uniform(int n, std::mt19937& rng) {
+    std::uniform_int_distribution<int> coeff(1, 9);
+    std::uniform_int_distribution<int> sign(0, 1);
+    std::uniform_int_distribution<int> value(-20, 20);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+
+    RandomSystem system;
+    system.Solution.resize(n);
+    for (auto& x : system.Solution) x = value(rng);
+
+    auto randomCoeff = [&]() { return Rational(sign(rng) ? coeff(rng) : -coeff(rng)); };
+    for (int i = 0; i < n; i++) {
+        LinearForm form;
+        form.addTerm(i, randomCoeff());
+        for (int extra = 0; extra < 2; extra++) form.addTerm(pick(rng), randomCoeff());
+
+        Rational at_solution(0);
+        for (const auto& [symbol, c] : form.Coeffs) at_solution += c * Rational(system.Solution[symbol]);
+        form.Constant = -at_solution;
+        system.Equations.push_back(form);
+    }
+    system.InOrder = system.Equations;
+    return system;
+}
+
+// by cofactors, the blocks are at most 3 x 3
+i64 determinant(const std::vector<std::vector<i64>>& m) {
+    size_t n = m.size();
+    if (n == 1) return m[0][0];
+
+    i64 det = 0;
+    for (size_t col = 0; col < n; col++) {
+        std::vector<std::vector<i64>> minor;
+        for (size_t row = 1; row < n; row++) {
+            std::vector<i64> r;
+            for (size_t k = 0; k < n; k++) {
+                if (k != col) r.push_back(m[row][k]);
+            }
+            minor.push_back(r);
+        }
+        det += (col % 2 == 0 ? 1 : -1) * m[0][col] * determinant(minor);
+    }
+    return det;
+}
+
+// Unknowns in blocks of 1 to 3, every equation of a block has all of the block's unknowns and a couple from earlier blocks.
+// That's block triangular once the equations and unknowns are put back in order, which they aren't: both are shuffled, so the
+// solver has to find the order itself. The right hand sides come from a known integer solution to check against
+RandomSystem blockTriangular(int n, std::mt19937& rng) {
+    std::uniform_int_distribution<int> coeff(1, 9);
+    std::uniform_int_distribution<int> sign(0, 1);
+    std::uniform_int_distribution<int> value(-20, 20);
+    std::uniform_int_distribution<int> block_size(1, 3);
+
+    RandomSystem system;
+    std::vector<int> symbol_of(n);
+    for (int i = 0; i < n; i++) symbol_of[i] = i;
+    std::shuffle(symbol_of.begin(), symbol_of.end(), rng);
+
+    system.Solution.resize(n);
+    for (auto& x : system.Solution) x = value(rng);
+
+    auto randomCoeff = [&]() { return Rational(sign(rng) ? coeff(rng) : -coeff(rng)); };
+
+    for (int start = 0; start < n;) {
+        int size = std::min(block_size(rng), n - start);
+
+        // the block's own coefficients, drawn again until they're independent so the whole system has the one solution
+        std::vector<std::vector<i64>> block;
+        do {
+            block.assign(size, std::vector<i64>(size));
+            for (auto& row : block) {
+                for (auto& c : row) c = sign(rng) ? coeff(rng) : -coeff(rng);
+            }
+        } while (determinant(block) == 0);
+
+        for (int row = 0; row < size; row++) {
+            LinearForm form;
+            for (int k = 0; k < size; k++) form.addTerm(symbol_of[start + k], Rational(block[row][k]));
+            if (start > 0) {
+                std::uniform_int_distribution<int> earlier(0, start - 1);
+                for (int extra = 0; extra < 2; extra++) form.addTerm(symbol_of[earlier(rng)], randomCoeff());
+            }
+
+            // form = 0 at the solution
+            Rational at_solution(0);
+            for (const auto& [symbol, c] : form.Coeffs) at_solution += c * Rational(system.Solution[symbol]);
+            form.Constant = -at_solution;
+            system.Equations.push_back(form);
+        }
+        start += size;
+    }
+
+    system.InOrder = system.Equations;
+    std::shuffle(system.Equations.begin(), system.Equations.end(), rng);
+    return system;
+}
+
+const char* statusName(SolveStatus status) {
+    switch (status) {
+        case SolveStatus::UNIQUE: return "unique";
+        case SolveStatus::UNDERDETERMINED: return "underdetermined";
+        case SolveStatus::INCONSISTENT: return "inconsistent";
+        default: return "overflow";
+    }
+}
+
+// solved all at once, how many values came out different from the ones the right hand sides were made from
+void timeSolve(const char* kind, int n, const RandomSystem& random) {
+    auto start = std::chrono::steady_clock::now();
+    SparseSystem system;
+    for (const auto& form : random.Equations) system.addEquation(form);
+    SystemSolution solution = system.solve();
+    auto end = std::chrono::steady_clock::now();
+
+    // a uniform system can come out singular, then it's one of its solutions and not necessarily this one
+    size_t wrong = 0;
+    if (solution.Status == SolveStatus::UNIQUE) {
+        for (const auto& [symbol, v] : solution.Values) {
+            if (v != Rational(random.Solution[symbol])) wrong++;
+        }
+    }
+
+    std::cout << n << " unknowns, " << kind << ": " << statusName(solution.Status) << ", fill " << solution.Fill << ", " << wrong
+              << " wrong, " << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
+
+int main() {
+    std::mt19937 rng(12345);
+
+    for (int n : {100, 1000, 10000}) {
+        timeSolve("uniform", n, uniform(n, rng));
+
+        RandomSystem random = blockTriangular(n, rng);
+        timeSolve("block triangular", n, random);
+
+        // the same equations one at a time, with the solution there to read after each. First in the order they build on each other,
+        // then shuffled, where the unknowns still open in between tie up long chains of the others and there's more fill
+        for (const auto* stream : {&random.InOrder, &random.Equations}) {
+            auto start = std::chrono::steady_clock::now();
+            IncrementalSystem incremental;
+            size_t turned_away = 0;
+            for (const auto& form : *stream) {
+                SolveStatus status = incremental.addEquation(form);
+                if (status == SolveStatus::INCONSISTENT || status == SolveStatus::OVERFLOW) turned_away++;
+            }
+            auto end = std::chrono::steady_clock::now();
+
+            size_t wrong = 0;
+            std::vector<std::pair<int, Rational>> values;
+            if (!incremental.values(values)) std::cout << "    values too big to read back\n";
+            for (const auto& [symbol, v] : values) {
+                if (v != Rational(random.Solution[symbol])) wrong++;
+            }
+            std::cout << "    one at a time" << (stream == &random.InOrder ? " in order: " : ", shuffled: ") << statusName(incremental.status())
+                      << ", " << values.size() << " pinned, " << turned_away << " turned away, " << wrong << " wrong, "
+                      << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+        }
+    }
+
+    return 0;
+}
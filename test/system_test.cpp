@@ -0,0 +1,221 @@
+/*
+system_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/system_test Mathly/test/system_test.cpp Mathly/system.cpp Mathly/linear.cpp simpletest/simpletest.cpp
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "..\system.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+// sum of c_i x_i = rhs as a form = 0, symbols are just numbered
+LinearForm equation(std::vector<std::pair<int, Rational>> terms, Rational rhs) {
+    LinearForm form;
+    for (const auto& [symbol, c] : terms) form.addTerm(symbol, c);
+    form.Constant = -rhs;
+    return form;
+}
+
+Rational valueOf(const SystemSolution& solution, int symbol) {
+    for (const auto& [s, v] : solution.Values) {
+        if (s == symbol) return v;
+    }
+    return Rational(0);
+}
+
+DEFINE_TEST(TestUniqueSolution) {
+    // x + y + z = 6, x/2 - y = -3/2, 2y + 3z = 13  ->  x = 1, y = 2, z = 3
+    SparseSystem system;
+    system.addEquation(equation({{0, Rational(1)}, {1, Rational(1)}, {2, Rational(1)}}, Rational(6)));
+    system.addEquation(equation({{0, Rational(1, 2)}, {1, Rational(-1)}}, Rational(-3, 2)));
+    system.addEquation(equation({{1, Rational(2)}, {2, Rational(3)}}, Rational(13)));
+
+    SystemSolution solution = system.solve();
+    TEST(solution.Status == SolveStatus::UNIQUE);
+    TEST(valueOf(solution, 0) == Rational(1));
+    TEST(valueOf(solution, 1) == Rational(2));
+    TEST(valueOf(solution, 2) == Rational(3));
+}
+
+DEFINE_TEST(TestFractionalSolution) {
+    // 3x + y = 1, x - y = 0  ->  x = y = 1/4
+    SparseSystem system;
+    system.addEquation(equation({{0, Rational(3)}, {1, Rational(1)}}, Rational(1)));
+    system.addEquation(equation({{0, Rational(1)}, {1, Rational(-1)}}, Rational(0)));
+
+    SystemSolution solution = system.solve();
+    TEST(solution.Status == SolveStatus::UNIQUE);
+    TEST(valueOf(solution, 0) == Rational(1, 4));
+    TEST(valueOf(solution, 1) == Rational(1, 4));
+}
+
+DEFINE_TEST(TestInconsistentSystem) {
+    // x + y = 1, 2x + 2y = 3
+    SparseSystem system;
+    system.addEquation(equation({{0, Rational(1)}, {1, Rational(1)}}, Rational(1)));
+    system.addEquation(equation({{0, Rational(2)}, {1, Rational(2)}}, Rational(3)));
+    TEST(system.solve().Status == SolveStatus::INCONSISTENT);
+}
+
+DEFINE_TEST(TestUnderdeterminedSystem) {
+    // x + y = 2 twice over, and z = 5
+    SparseSystem system;
+    system.addEquation(equation({{0, Rational(1)}, {1, Rational(1)}}, Rational(2)));
+    system.addEquation(equation({{0, Rational(2)}, {1, Rational(2)}}, Rational(4)));
+    system.addEquation(equation({{2, Rational(1)}}, Rational(5)));
+
+    SystemSolution solution = system.solve();
+    TEST(solution.Status == SolveStatus::UNDERDETERMINED);
+    TEST_EQ(solution.FreeSymbols.size(), 1U);
+    TEST(valueOf(solution, 0) + valueOf(solution, 1) == Rational(2));
+    TEST(valueOf(solution, 2) == Rational(5));
+}
+
+DEFINE_TEST(TestRandomSparseSystem) {
+    // 300 unknowns, each equation its own one and two more from anywhere, no structure to order it by. Worked over the integers
+    // this needs far more than 64 bits, mod the primes it doesn't
+    const int n = 300;
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> coeff(-9, 8);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    std::uniform_int_distribution<int> value(-20, 20);
+
+    std::vector<Rational> x(n);
+    for (auto& v : x) v = Rational(value(rng), 3);
+
+    SparseSystem system;
+    for (int i = 0; i < n; i++) {
+        std::vector<std::pair<int, Rational>> terms;
+        for (int symbol : {i, pick(rng), pick(rng)}) {
+            int c = coeff(rng);
+            terms.emplace_back(symbol, Rational(c >= 0 ? c + 1 : c));
+        }
+        Rational rhs(0);
+        for (const auto& [symbol, c] : terms) rhs += c * x[symbol];
+        system.addEquation(equation(terms, rhs));
+    }
+
+    SystemSolution solution = system.solve();
+    TEST(solution.Status == SolveStatus::UNIQUE);
+    bool all = true;
+    for (int i = 0; i < n; i++) all &= valueOf(solution, i) == x[i];
+    TEST(all);
+
+    // the rows aren't touched, so it solves the same again
+    TEST(system.solve().Values == solution.Values);
+}
+
+DEFINE_TEST(TestLongChain) {
+    // x[k-1] - x[k] = 1 and x[0] = n - 1 last, so x[k] = n - 1 - k. The cheap matching gives row k column k - 1 and leaves x[0] to
+    // an augmenting path through every row, and each block depends on the one before all the way down
+    const int n = 100000;
+    SparseSystem system;
+    for (int k = 1; k < n; k++) system.addEquation(equation({{k - 1, Rational(1)}, {k, Rational(-1)}}, Rational(1)));
+    system.addEquation(equation({{0, Rational(1)}}, Rational(n - 1)));
+
+    SystemSolution solution = system.solve();
+    TEST(solution.Status == SolveStatus::UNIQUE);
+    TEST_EQ(solution.Values.size(), static_cast<size_t>(n));
+    bool all = true;
+    for (const auto& [k, v] : solution.Values) all &= v == Rational(n - 1 - k);
+    TEST(all);
+}
+
+DEFINE_TEST(TestIncrementalSolve) {
+    IncrementalSystem system;
+
+    // x + y = 3, nothing pinned yet
+    SystemSolution solution;
+    TEST(system.addEquation(equation({{0, Rational(1)}, {1, Rational(1)}}, Rational(3))) == SolveStatus::UNDERDETERMINED);
+    TEST(system.values(solution.Values) && solution.Values.empty());
+    TEST_EQ(system.freeSymbols().size(), 1U);
+
+    // 2x + 2y = 6 adds nothing
+    TEST(system.addEquation(equation({{0, Rational(2)}, {1, Rational(2)}}, Rational(6))) == SolveStatus::UNDERDETERMINED);
+    TEST_EQ(system.equations(), 2U);
+
+    // x - y = 1/2  ->  x = 7/4, y = 5/4
+    TEST(system.addEquation(equation({{0, Rational(1)}, {1, Rational(-1)}}, Rational(1, 2))) == SolveStatus::UNIQUE);
+    TEST(system.freeSymbols().empty());
+
+    TEST(system.values(solution.Values));
+    TEST_EQ(solution.Values.size(), 2U);
+    TEST(valueOf(solution, 0) == Rational(7, 4));
+    TEST(valueOf(solution, 1) == Rational(5, 4));
+
+    // a new unknown tied to the others: z - x = 1  ->  z = 11/4
+    TEST(system.addEquation(equation({{2, Rational(1)}, {0, Rational(-1)}}, Rational(1))) == SolveStatus::UNIQUE);
+    TEST(system.values(solution.Values));
+    TEST(valueOf(solution, 2) == Rational(11, 4));
+}
+
+DEFINE_TEST(TestIncrementalRejects) {
+    IncrementalSystem system;
+    system.addEquation(equation({{0, Rational(1)}, {1, Rational(1)}}, Rational(1)));
+
+    // 3x + 3y = 2 contradicts it and leaves everything as it was
+    TEST(system.addEquation(equation({{0, Rational(3)}, {1, Rational(3)}}, Rational(2))) == SolveStatus::INCONSISTENT);
+    TEST_EQ(system.equations(), 1U);
+    TEST_EQ(system.unknowns(), 2U);
+
+    // still takes the equation that settles it
+    TEST(system.addEquation(equation({{1, Rational(1)}}, Rational(4))) == SolveStatus::UNIQUE);
+    SystemSolution solution;
+    TEST(system.values(solution.Values));
+    TEST(valueOf(solution, 0) == Rational(-3));
+    TEST(valueOf(solution, 1) == Rational(4));
+}
+
+DEFINE_TEST(TestIncrementalShuffled) {
+    // a random sparse system like TestRandomSparseSystem's, the equations in no order at all. Nothing is turned away for being too
+    // big, whatever the numbers in between would have been over the integers
+    const int n = 300;
+    std::mt19937 rng(38);
+    std::uniform_int_distribution<int> coeff(-9, 8);
+    std::uniform_int_distribution<int> pick(0, n - 1);
+    std::uniform_int_distribution<int> value(-20, 20);
+
+    std::vector<Rational> x(n);
+    for (auto& v : x) v = Rational(value(rng), 7);
+
+    std::vector<LinearForm> equations;
+    for (int i = 0; i < n; i++) {
+        std::vector<std::pair<int, Rational>> terms;
+        for (int symbol : {i, pick(rng), pick(rng)}) {
+            int c = coeff(rng);
+            terms.emplace_back(symbol, Rational(c >= 0 ? c + 1 : c));
+        }
+        Rational rhs(0);
+        for (const auto& [symbol, c] : terms) rhs += c * x[symbol];
+        equations.push_back(equation(terms, rhs));
+    }
+    std::shuffle(equations.begin(), equations.end(), rng);
+
+    IncrementalSystem system;
+    size_t overflowed = 0;
+    for (const auto& form : equations) overflowed += system.addEquation(form) == SolveStatus::OVERFLOW;
+    TEST_EQ(overflowed, 0U);
+    TEST(system.status() == SolveStatus::UNIQUE);
+
+    SystemSolution solution;
+    TEST(system.values(solution.Values));
+    TEST_EQ(solution.Values.size(), static_cast<size_t>(n));
+    bool all = true;
+    for (const auto& [symbol, v] : solution.Values) all &= v == x[symbol];
+    TEST(all);
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+termstream_test.cpp
+*/
+
+// to run: g++ -Wall -std=c++20 -g -O0 -Isimpletest -mconsole -o BIN/termstream_test Mathly/test/termstream_test.cpp Mathly/termstream.cpp Mathly/polynomial.cpp Mathly/dense.cpp simpletest/simpletest.cpp
+
+#include <vector>
+#include <sstream>
+
+#include "..\termstream.hpp"
+#include "..\..\simpletest\simpletest.h"
+
+
+// sum of the variables 0 .. n-1 in nvars variables, plus c
+std::shared_ptr<const Polynomial> linearSum(int nvars, int n, i64 c) {
+    Polynomial p = Polynomial::constant(nvars, Rational(c));
+    for (int var = 0; var < n; var++) p = p + Polynomial::variable(nvars, var);
+    return std::make_shared<const Polynomial>(p);
+}
+
+// everything the stream gives, checking the order on the way
+Polynomial collect(TermStream& stream, int nvars, bool& ordered) {
+    Polynomial p(nvars);
+    ordered = true;
+    for (const PolyTerm& term : stream) {
+        if (!p.Terms.empty() && p.Terms.back().Exps <= term.Exps) ordered = false;
+        p.Terms.push_back(term);
+    }
+    return p;
+}
+
+bool samePolynomial(const Polynomial& a, const Polynomial& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a.Terms[i].Exps != b.Terms[i].Exps || a.Terms[i].Coeff != b.Terms[i].Coeff) return false;
+    }
+    return true;
+}
+
+DEFINE_TEST(TestProductStreamMatchesPolynomial) {
+    // (a + b + c + 1)^5 * (a + b - 2)^3 * (x^2 + x + 1)^4 with a, b, c, x, the last factor overlaps in degree with itself
+    auto first = linearSum(4, 3, 1);
+    auto second = std::make_shared<const Polynomial>(*linearSum(4, 2, -2));
+    Polynomial x = Polynomial::variable(4, 3);
+    auto third = std::make_shared<const Polynomial>(x * x + x + Polynomial::constant(4, Rational(1)));
+
+    ProductStream stream(4, Rational(1, 2), {{first, 5}, {second, 3}, {third, 4}});
+    bool ordered;
+    Polynomial streamed = collect(stream, 4, ordered);
+
+    Polynomial expected = (first->pow(5) * second->pow(3) * third->pow(4)).scale(Rational(1, 2));
+    TEST(ordered);
+    TEST(samePolynomial(streamed, expected));
+}
+
+DEFINE_TEST(TestSumStreamCancels) {
+    // (a + b)^2 - (a^2 + b^2) leaves 2ab only
+    auto sum = linearSum(2, 2, 0);
+    std::vector<std::unique_ptr<TermStream>> streams;
+    streams.push_back(std::make_unique<ProductStream>(2, Rational(1), std::vector<PowerFactor>{{sum, 2}}));
+    Polynomial squares = (Polynomial::variable(2, 0).pow(2) + Polynomial::variable(2, 1).pow(2)).scale(Rational(-1));
+    streams.push_back(std::make_unique<PolynomialStream>(squares));
+
+    SumStream stream(std::move(streams));
+    std::ostringstream out;
+    TermPrinter printer(out, {"a", "b"});
+    TEST_EQ(drain(stream, printer), 1U);
+    TEST_EQ(out.str(), std::string("(2 * a * b)"));
+}
+
+DEFINE_TEST(TestTermPrinter) {
+    // (x + 1)^2 in x
+    auto sum = linearSum(1, 1, 1);
+    ProductStream stream(1, Rational(1), {{sum, 2}});
+    std::ostringstream out;
+    TermPrinter printer(out, {"x"});
+    drain(stream, printer);
+    TEST_EQ(out.str(), std::string("((x ^ 2) + (2 * x) + 1)"));
+}
+
+DEFINE_TEST(TestAggregateLargePower) {
+    // (a + b + c + d)^30 has C(33, 3) = 5456 terms, coefficients adding up to 4^30
+    auto sum = linearSum(4, 4, 0);
+    ProductStream stream(4, Rational(1), {{sum, 30}});
+    TermAggregator totals(4);
+    drain(stream, totals);
+
+    TEST_EQ(totals.Count, 5456U);
+    TEST_EQ(totals.MaxDegree, 30);
+    TEST(totals.CoeffSum == Rational(i64(1) << 60));
+}
+
+
+int main() {
+
+    bool allTestsPassed = true;
+
+    // Execute all tests
+    allTestsPassed &= TestFixture::ExecuteAllTests(TestFixture::Verbose);
+
+    return allTestsPassed ? 0 : 1;
+}
@@ -29,6 +29,7 @@ const TokenType PLUS = "PLUS";
 const TokenType MINUS = "MINUS";
 const TokenType MULT = "MULT";
 const TokenType DIV = "DIV";
+const TokenType POW = "POW";
 
 const TokenType PRE_MINUS = "PRE_MINUS";
 